@@ -0,0 +1,132 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+#include "JavaScript/VJavaScript.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	Line reading speed of the JavaScript TextStream: read('') one line at a time against readLines().
+
+	usage: BenchTextStream [-lines count]
+
+	A UTF-8 file of CSV like lines (20 to 200 characters) is written in the temporary folder, then each
+	script below is evaluated in a bare global context and timed as a whole, stream opening included.
+	Every script returns the number of lines it read, which must be the same for all of them.
+*/
+
+
+class BenchRuntimeDelegate : public IJSRuntimeDelegate
+{
+public:
+	virtual	VFolder*				RetainScriptsFolder()								{ return VFolder::RetainSystemFolder( eFK_Temporary, false); }
+	virtual VProgressIndicator*		CreateProgressIndicator( const VString& /*inTitle*/)	{ return NULL; }
+};
+
+
+static VError WriteLines( const VFile& inFile, sLONG inLines, sLONG8& outBytes)
+{
+	static const char sField[] = "2014-06-12T08:41:07Z;customer;Saint-Etienne;42.5;";
+	BenchTools::Random random;
+	std::vector<char> line;
+
+	VFileStream stream( &inFile);
+	VError err = stream.OpenWriting();
+	for (sLONG i = 0 ; i < inLines && err == VE_OK ; ++i)
+	{
+		line.resize( random.Between( 20, 200));
+		for (size_t j = 0 ; j < line.size() ; ++j)
+			line[j] = sField[j % (sizeof( sField) - 1)];
+		line.back() = '\n';
+		err = stream.PutData( &line[0], line.size());
+	}
+	outBytes = stream.GetSize();
+	VError closeErr = stream.CloseWriting();
+	return (err == VE_OK) ? closeErr : err;
+}
+
+
+static void Run( VJSGlobalContext *inContext, const char *inName, const VString& inPath, const char *inLoop, sLONG inLines, sLONG8 inBytes)
+{
+	VString script( "var stream = TextStream( File( '");
+	script += inPath;
+	script += "'), 'Read'); var count = 0; ";
+	script.AppendCString( inLoop);
+	script += " stream.close(); count;";
+
+	VValueSingle *result = NULL;
+
+	sLONG8 start = BenchTools::Now();
+	bool ok = inContext->EvaluateScript( script, NULL, &result);
+	sLONG8 duration = BenchTools::Now() - start;
+
+	sLONG count = (ok && result != NULL) ? result->GetLong() : -1;
+	delete result;
+
+	::printf( "%-24s %12.0f lines/s  %8.1f MB/s%s\n", inName, BenchTools::PerSecond( count, duration),
+		BenchTools::PerSecond( inBytes, duration) / (1024.0 * 1024.0), (count == inLines) ? "" : "  LINE COUNT MISMATCH");
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG lines = BenchTools::GetArgument( "-lines", 1000000);
+
+	VFolder *temporary = VFolder::RetainSystemFolder( eFK_Temporary, true);
+	if (temporary == NULL)
+		return 1;
+	VFile file( *temporary, CVSTR( "BenchTextStream.txt"));
+	temporary->Release();
+
+	sLONG8 bytes = 0;
+	VError err = WriteLines( file, lines, bytes);
+	if (err == VE_OK)
+	{
+		VString path;
+		file.GetPath( path, FPS_POSIX);
+
+		BenchRuntimeDelegate delegate;
+		VJSGlobalClass::CreateGlobalClasses();
+		VJSGlobalContext *context = VJSGlobalContext::Create( &delegate);
+		if (context != NULL)
+		{
+			Run( context, "read('')", path, "while (!stream.end()) { stream.read(''); ++count; }", lines, bytes);
+			Run( context, "readLines(1000)", path, "while (!stream.end()) count += stream.readLines( 1000).length;", lines, bytes);
+			Run( context, "readLines()", path, "count = stream.readLines().length;", lines, bytes);
+			context->Release();
+		}
+		else
+		{
+			::printf( "could not create the JavaScript context\n");
+		}
+	}
+	else
+	{
+		::printf( "could not write the test file (error %lld)\n", (long long) ERRCODE_FROM_VERROR( err));
+	}
+
+	file.Delete();
+
+	return (err == VE_OK) ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+#include "JavaScript/VJavaScript.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	VJSWorker event queue with many pending timers: setTimeout(), clearTimeout() and firing.
+
+	usage: BenchWorkerTimers [-timers count] [-spread milliseconds]
+
+	Scripts run in a bare global context, whose root worker services the timers in wait().
+	-timers timeouts (100000 by default) are scheduled with delays spread over -spread milliseconds,
+	then every other one is cleared and the remaining ones are fired. For the firing, the time beyond
+	the spread is the queue overhead, and the lateness of each callback against its due time is given
+	at p50 and p99 (Date has a millisecond resolution).
+*/
+
+
+class BenchRuntimeDelegate : public IJSRuntimeDelegate
+{
+public:
+	virtual	VFolder*				RetainScriptsFolder()								{ return VFolder::RetainSystemFolder( eFK_Temporary, false); }
+	virtual VProgressIndicator*		CreateProgressIndicator( const VString& /*inTitle*/)	{ return NULL; }
+};
+
+
+// Evaluates inScript and returns its numeric result, -1 if it failed.
+static Real Evaluate( VJSGlobalContext *inContext, const VString& inScript, sLONG8& outNanoSeconds)
+{
+	VValueSingle *result = NULL;
+
+	sLONG8 start = BenchTools::Now();
+	bool ok = inContext->EvaluateScript( inScript, NULL, &result);
+	outNanoSeconds = BenchTools::Now() - start;
+
+	Real value = (ok && result != NULL) ? result->GetReal() : -1.0;
+	delete result;
+	return value;
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG timers = BenchTools::GetArgument( "-timers", 100000);
+	sLONG spread = BenchTools::GetArgument( "-spread", 2000);
+
+	BenchRuntimeDelegate delegate;
+	VJSGlobalClass::CreateGlobalClasses();
+	VJSGlobalContext *context = VJSGlobalContext::Create( &delegate);
+	if (context == NULL)
+	{
+		::printf( "could not create the JavaScript context\n");
+		return 1;
+	}
+
+	VString schedule( "var count = ");
+	schedule.AppendLong( timers);
+	schedule += "; var spread = ";
+	schedule.AppendLong( spread);
+	schedule +=	"; var ids = new Array( count); var late = []; var fired = 0; var expected = count - Math.ceil( count / 2);"
+				"function fire( due) { late.push( Date.now() - due); if (++fired == expected) exitWait(); }"
+				"for (var i = 0 ; i < count ; ++i) { var delay = (i * 7919) % spread; ids[i] = setTimeout( fire, delay, Date.now() + Math.max( delay, 4)); }"
+				"count;";
+
+	VString clear(	"for (var i = 0 ; i < count ; i += 2) clearTimeout( ids[i]); Math.ceil( count / 2);");
+
+	VString wait(	"if (fired < expected) wait(); fired;");
+
+	VString p50( "late.sort( function( a, b) { return a - b; }); late[Math.floor( (late.length - 1) * 0.5)];");
+	VString p99( "late[Math.floor( (late.length - 1) * 0.99)];");
+
+	sLONG8 scheduleDuration, clearDuration, fireDuration, latenessDuration;
+	Real scheduled = Evaluate( context, schedule, scheduleDuration);
+	Real cleared = Evaluate( context, clear, clearDuration);
+	Real fired = Evaluate( context, wait, fireDuration);
+	Real lateness50 = Evaluate( context, p50, latenessDuration);
+	Real lateness99 = Evaluate( context, p99, latenessDuration);
+
+	// the first timers were scheduled when the schedule script started, the spread is counted from there
+	sLONG8 fireOverhead = scheduleDuration + clearDuration + fireDuration - (sLONG8) spread * 1000000;
+
+	::printf( "setTimeout    %12.0f timers/s\n", BenchTools::PerSecond( (sLONG8) scheduled, scheduleDuration));
+	::printf( "clearTimeout  %12.0f timers/s\n", BenchTools::PerSecond( (sLONG8) cleared, clearDuration));
+	::printf( "fire          %12.0f timers  overhead beyond the spread %8.1f ms  lateness p50 %6.0f ms  p99 %6.0f ms%s\n",
+		fired, fireOverhead / 1.0e6, lateness50, lateness99, (fired == scheduled - cleared) ? "" : "  TIMER COUNT MISMATCH");
+
+	context->Release();
+	VJSWorker::TerminateAll();
+
+	return 0;
+}
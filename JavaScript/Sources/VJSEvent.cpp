@@ -30,6 +30,7 @@
 #include "VJSNetServer.h"
 #include "VJSNetSocket.h"
 #include "VJSW3CFileSystem.h"
+#include "VJSRuntime_file.h"
 #include "VJSSystemWorker.h"
 
 USING_TOOLBOX_NAMESPACE
@@ -254,6 +255,8 @@ VJSTimerEvent *VJSTimerEvent::Create (VJSTimer *inTimer, XBOX::VTime &inTriggerT
 	timerEvent->fTimer = inTimer;
 	timerEvent->fArguments = inArguments;
 
+	inTimer->fEvent = timerEvent;
+
 	return timerEvent;
 }
 
@@ -292,24 +295,16 @@ void VJSTimerEvent::Process (XBOX::VJSContext inContext, VJSWorker *inWorker)
 
 void VJSTimerEvent::Discard ()
 {
+	fTimer->fEvent = NULL;
 	fTimer->_ReleaseIfCleared();
 	Release();
 }
 
-void VJSTimerEvent::RemoveTimerEvent (std::list<IJSEvent *> *ioEventQueue, VJSTimer *inTimer)
+VJSTimerEvent *VJSTimerEvent::GetTimerEvent (VJSTimer *inTimer)
 {
-	std::list<IJSEvent *>::iterator	i;
-
-	for (i = ioEventQueue->begin(); i != ioEventQueue->end(); i++)
-
-		if ((*i)->GetType() == eTYPE_TIMER 
-		&& ((VJSTimerEvent *) (*i))->fTimer == inTimer) {
-
-			(*i)->Discard();
-			ioEventQueue->erase(i);
-			break;
+	xbox_assert(inTimer != NULL);
 
-		}
+	return inTimer->fEvent;
 }
 
 VJSSystemWorkerEvent *VJSSystemWorkerEvent::Create (VJSSystemWorker *inSystemWorker, sLONG inType, XBOX::JS4D::ObjectRef inObjectRef, uBYTE *inData, sLONG inSize)
@@ -784,7 +779,7 @@ VJSW3CFSEvent *VJSW3CFSEvent::GetMetadata (VJSEntry *inEntry, const XBOX::VJSObj
 	
 	VJSW3CFSEvent	*fsEvent;
 	
-	if ((fsEvent = new VJSW3CFSEvent(eOPERATION_RESOLVE_URL, inSuccessCallback, inErrorCallback)) != NULL)
+	if ((fsEvent = new VJSW3CFSEvent(eOPERATION_GET_METADATA, inSuccessCallback, inErrorCallback)) != NULL)
 
 		fsEvent->fEntry = XBOX::RetainRefCountable<VJSEntry>(inEntry);
 	
@@ -951,60 +946,139 @@ VJSW3CFSEvent *VJSW3CFSEvent::ReadEntries (VJSDirectoryReader *inDirectoryReader
 	return fsEvent;	
 }
 
+void VJSW3CFSEvent::Schedule (VJSWorker *inWorker)
+{
+	xbox_assert(inWorker != NULL);
+
+	fIsExecuted = false;
+	if (_IsOffloadable())
+
+		VJSW3CFSIOPool::Schedule(this, inWorker);
+
+	else
+
+		inWorker->QueueEvent(this);
+}
+
+void VJSW3CFSEvent::Execute ()
+{
+	xbox_assert(_IsOffloadable() && !fIsExecuted);
+
+	switch (fSubType) {
+
+		case eOPERATION_GET_METADATA:			fCode = fEntry->DoGetMetadata(&fModificationTime); break;
+		case eOPERATION_MOVE_TO:				fCode = fEntry->DoMoveTo(fTargetEntry, fURL, &fResultPath); break;
+		case eOPERATION_COPY_TO:				fCode = fEntry->DoCopyTo(fTargetEntry, fURL, &fResultPath); break;
+		case eOPERATION_REMOVE:					fCode = fEntry->DoRemove(); break;
+
+		case eOPERATION_GET_FILE:				fCode = fEntry->DoGetFile(fEntry, fURL, fFlags, &fResultPath); break;
+		case eOPERATION_GET_DIRECTORY:			fCode = fEntry->DoGetDirectory(fEntry, fURL, fFlags, &fResultPath); break;
+		case eOPERATION_REMOVE_RECURSIVELY:		fCode = fEntry->DoRemoveRecursively(); break;
+		case eOPERATION_FOLDER:					fCode = fEntry->DoFolder(&fFolderIterator); break;
+		
+		case eOPERATION_FILE:					fCode = fEntry->DoFile(&fFileIterator); break;
+
+		case eOPERATION_READ_ENTRIES:			fCode = fDirectoryReader->DoReadEntries(&fFolderPaths, &fFilePaths); break;
+
+		default:								xbox_assert(false);
+
+	}
+	fIsExecuted = true;
+}
+
 void VJSW3CFSEvent::Process (XBOX::VJSContext inContext, VJSWorker *inWorker)
 {
 	xbox_assert(inWorker != NULL);
 	
 	sLONG			code;
 	XBOX::VJSObject	resultObject(inContext);	
-		
-	switch (fSubType) {
 
-		case eOPERATION_REQUEST_FILE_SYSTEM:	code = fLocalFileSystem->RequestFileSystem(inContext, fType, fQuota, &resultObject); break;
-		case eOPERATION_RESOLVE_URL:			code = fLocalFileSystem->ResolveURL(inContext, fURL, false, &resultObject); break;
+	// If the operation couldn't be executed by the pool, do it now.
 
-		case eOPERATION_GET_METADATA:			code = fEntry->GetMetadata(inContext, &resultObject); break;
-		case eOPERATION_MOVE_TO:				code = fEntry->MoveTo(inContext, fTargetEntry, fURL, &resultObject); break;
-		case eOPERATION_COPY_TO:				code = fEntry->CopyTo(inContext, fTargetEntry, fURL, &resultObject); break;
-		case eOPERATION_REMOVE:					code = fEntry->Remove(inContext, &resultObject); break;
-		case eOPERATION_GET_PARENT:				code = fEntry->GetParent(inContext, &resultObject); break;
+	if (_IsOffloadable() && !fIsExecuted)
 
-		case eOPERATION_GET_FILE:				code = fEntry->GetFile(inContext, fEntry, fURL, fFlags, &resultObject); break;
-		case eOPERATION_GET_DIRECTORY:			code = fEntry->GetDirectory(inContext, fEntry, fURL, fFlags, &resultObject); break;
-		case eOPERATION_REMOVE_RECURSIVELY:		code = fEntry->RemoveRecursively(inContext, &resultObject); break;
-		case eOPERATION_FOLDER:					code = fEntry->Folder(inContext, &resultObject); break;
-		
-		case eOPERATION_CREATE_WRITER:			code = fEntry->CreateWriter(inContext, &resultObject); break;
-		case eOPERATION_FILE:					code = fEntry->File(inContext, &resultObject); break;
+		Execute();
 
-		case eOPERATION_READ_ENTRIES: {
+	if (_IsOffloadable() && fCode != VJSFileErrorClass::OK) {
 
-			if ((code = fDirectoryReader->ReadEntries(inContext, &resultObject)) == VJSFileErrorClass::OK) {
+		code = fCode;
+		resultObject = VJSFileErrorClass::NewInstance(inContext, code);
 
-				xbox_assert(resultObject.IsArray());
+	} else {
 
-				XBOX::VJSArray	entries(resultObject, false);	// No check, already an assert before.
+		code = VJSFileErrorClass::OK;
+		switch (fSubType) {
 
-				// If array is empty, there are no more entries to read. If not, reschedule event.
+			case eOPERATION_REQUEST_FILE_SYSTEM:	code = fLocalFileSystem->RequestFileSystem(inContext, fType, fQuota, &resultObject); break;
+			case eOPERATION_RESOLVE_URL:			code = fLocalFileSystem->ResolveURL(inContext, fURL, false, &resultObject); break;
 
-				if (entries.GetLength()) 
+			case eOPERATION_GET_METADATA:			resultObject = VJSMetadataClass::NewInstance(inContext, fModificationTime); break;
+			case eOPERATION_MOVE_TO:				
+			case eOPERATION_COPY_TO:				resultObject = VJSEntry::CreateObject(inContext, fEntry->IsSync(), fEntry->GetFileSystem(), fResultPath, fEntry->IsFile()); break;
+			case eOPERATION_REMOVE:					break;
+			case eOPERATION_GET_PARENT:				code = fEntry->GetParent(inContext, &resultObject); break;
 
-					inWorker->QueueEvent(this);
+			case eOPERATION_GET_FILE:				resultObject = VJSEntry::CreateObject(inContext, fEntry->IsSync(), fEntry->GetFileSystem(), fResultPath, true); break;
+			case eOPERATION_GET_DIRECTORY:			resultObject = VJSEntry::CreateObject(inContext, fEntry->IsSync(), fEntry->GetFileSystem(), fResultPath, false); break;
+			case eOPERATION_REMOVE_RECURSIVELY:		break;
 
-				else
+			case eOPERATION_FOLDER: {
 
-					Discard();
+				resultObject = VJSFolderIterator::CreateInstance(inContext, fFolderIterator);
+				XBOX::ReleaseRefCountable<JS4DFolderIterator>(&fFolderIterator);
+				break;
 
-			} else
+			}
+		
+			case eOPERATION_CREATE_WRITER:			code = fEntry->CreateWriter(inContext, &resultObject); break;
 
-				Discard();	
+			case eOPERATION_FILE: {
 
-			break;
+				resultObject = VJSFileIterator::CreateInstance(inContext, fFileIterator);
+				XBOX::ReleaseRefCountable<JS4DFileIterator>(&fFileIterator);
+				break;
 
-		}
+			}
 
-		default:								xbox_assert(false);
+			case eOPERATION_READ_ENTRIES: {
+
+				// Currently folders are always returned first, followed by files.
+
+				XBOX::VJSArray	entries(inContext);
+				VJSFileSystem	*fileSystem	= fDirectoryReader->GetFileSystem();
+				bool			isSync		= fDirectoryReader->IsSync();
+				
+				for (std::vector<XBOX::VFilePath>::const_iterator i = fFolderPaths.begin(); i != fFolderPaths.end(); i++)
+
+					entries.PushValue(VJSEntry::CreateObject(inContext, isSync, fileSystem, *i, false));
+
+				for (std::vector<XBOX::VFilePath>::const_iterator i = fFilePaths.begin(); i != fFilePaths.end(); i++)
+
+					entries.PushValue(VJSEntry::CreateObject(inContext, isSync, fileSystem, *i, true));
+
+				resultObject = entries;
+				break;
+
+			}
+
+			default:								xbox_assert(false);
 			
+		}
+
+	}
+
+	// If there are entries read, there may be more, reschedule event. If none, there are no more to read.
+
+	bool	isRescheduled;
+
+	isRescheduled = false;
+	if (fSubType == eOPERATION_READ_ENTRIES && code == VJSFileErrorClass::OK && (fFolderPaths.size() || fFilePaths.size())) {
+
+		fFolderPaths.clear();
+		fFilePaths.clear();
+		Schedule(inWorker);
+		isRescheduled = true;
+
 	}
 
 	std::vector<XBOX::VJSValue>	callbackArguments;
@@ -1032,7 +1106,7 @@ void VJSW3CFSEvent::Process (XBOX::VJSContext inContext, VJSWorker *inWorker)
 		
 	}	
 
-	if (fSubType != eOPERATION_READ_ENTRIES)
+	if (!isRescheduled)
 
 		Discard();
 }
@@ -1065,9 +1139,26 @@ void VJSW3CFSEvent::Discard ()
 		}		
 
 	}
+
+	// Iterators are not set if the event is discarded before being processed.
+
+	XBOX::ReleaseRefCountable<JS4DFolderIterator>(&fFolderIterator);
+	XBOX::ReleaseRefCountable<JS4DFileIterator>(&fFileIterator);
+
 	Release();
 }
 
+bool VJSW3CFSEvent::_IsOffloadable () const
+{
+	// File system requests and URL resolution use the VJSLocalFileSystem of the worker, which isn't thread safe.
+	// Getting parent doesn't do any file access, and writer creation isn't implemented.
+
+	return fSubType != eOPERATION_REQUEST_FILE_SYSTEM 
+		&& fSubType != eOPERATION_RESOLVE_URL 
+		&& fSubType != eOPERATION_GET_PARENT 
+		&& fSubType != eOPERATION_CREATE_WRITER;
+}
+
 VJSW3CFSEvent::VJSW3CFSEvent (sLONG inSubType, const XBOX::VJSObject &inSuccessCallback, const XBOX::VJSObject &inErrorCallback)
 {
 	fType = eTYPE_W3C_FS;
@@ -1076,4 +1167,9 @@ VJSW3CFSEvent::VJSW3CFSEvent (sLONG inSubType, const XBOX::VJSObject &inSuccessC
 	fSubType = inSubType;
 	fSuccessCallback = inSuccessCallback.GetObjectRef();
 	fErrorCallback = inErrorCallback.GetObjectRef();	
+
+	fIsExecuted = false;
+	fCode = VJSFileErrorClass::OK;
+	fFolderIterator = NULL;
+	fFileIterator = NULL;
 }
\ No newline at end of file
@@ -34,6 +34,8 @@ class VJSNetServerObject;
 class VJSLocalFileSystem;
 class VJSEntry;
 class VJSDirectoryReader;
+class JS4DFolderIterator;
+class JS4DFileIterator;
 class VJSSystemWorker;
 
 // Worker event interface.
@@ -81,10 +83,18 @@ public:
 
 protected:
 
+friend class VJSWorker;
+
 	uLONG			fType;
 	XBOX::VTime		fTriggerTime;
 
-					IJSEvent ()	{}
+	// Set by VJSWorker: position in its event heap (-1 if not queued) and order of queuing, 
+	// so that events with identical trigger time are processed in the order they were queued.
+
+	sLONG			fQueueIndex;
+	sLONG8			fQueueOrder;
+
+					IJSEvent ()	{	fQueueIndex = -1;	fQueueOrder = 0;	}
 	virtual			~IJSEvent()	{}
 };
 
@@ -197,9 +207,9 @@ public:
 	void						Process (XBOX::VJSContext inContext, VJSWorker *inWorker);
 	void						Discard ();
 
-	// Remove a timer event from an event queue.
+	// Return the event of a timer, NULL if it has been discarded.
 
-	static void					RemoveTimerEvent (std::list<IJSEvent *> *ioEventQueue, VJSTimer *inTimer);
+	static VJSTimerEvent		*GetTimerEvent (VJSTimer *inTimer);
 
 private:
 
@@ -368,6 +378,16 @@ public:
 	// DirectoryReader interface operation.
 
 	static VJSW3CFSEvent	*ReadEntries (VJSDirectoryReader *inDirectoryReader, const XBOX::VJSObject &inSuccessCallback, const XBOX::VJSObject &inErrorCallback);
+
+	// Queue operation for execution. Operations doing file or folder access are executed by the VJSW3CFSIOPool,
+	// the event being queued to the worker once done. Others are queued directly to the worker.
+
+	void					Schedule (VJSWorker *inWorker);
+
+	// Do the file or folder access of the operation, without any JavaScript object creation. This can be called 
+	// from any thread, results are stored until the event is processed by the worker.
+
+	void					Execute ();
 	
 	void					Process (XBOX::VJSContext inContext, VJSWorker *inWorker);
 	void					Discard ();
@@ -414,6 +434,19 @@ private:
 	
 	XBOX::VString			fURL;				// URL or new name.
 	sLONG					fFlags;	
+
+	// Operations results, set by Execute().
+
+	bool							fIsExecuted;
+	sLONG							fCode;
+	XBOX::VFilePath					fResultPath;
+	XBOX::VTime						fModificationTime;
+	JS4DFolderIterator				*fFolderIterator;
+	JS4DFileIterator				*fFileIterator;
+	std::vector<XBOX::VFilePath>	fFolderPaths;
+	std::vector<XBOX::VFilePath>	fFilePaths;
+
+	bool					_IsOffloadable () const;
 	
 							VJSW3CFSEvent (sLONG inSubType, const XBOX::VJSObject &inSuccessCallback, const XBOX::VJSObject &inErrorCallback);
 };
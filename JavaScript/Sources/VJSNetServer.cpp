@@ -298,11 +298,21 @@ void VJSNetServerClass::_listen (XBOX::VJSParms_callStaticFunction &ioParms, VJS
 
 		inServer->fConnectionListener->SetSSLKeyAndCertificate(inServer->fCertificate, inServer->fKey);
 
+	// Accept from one task per processor (SO_REUSEPORT listeners, Linux only, see WITH_REUSEPORT_LISTENERS).
+
+	sLONG	acceptTaskCount	= XBOX::VSystem::GetNumberOfProcessors();
+
+	if (acceptTaskCount > VJSNetServerObject::kMAX_ACCEPT_TASKS)
+
+		acceptTaskCount = VJSNetServerObject::kMAX_ACCEPT_TASKS;
+
+	inServer->fConnectionListener->SetAcceptTaskCount(acceptTaskCount);
+
 	VJSNetSocketObject::sMutex.Lock();
 
 	if (VJSNetSocketObject::sSelectIOPool == NULL)
 
-		VJSNetSocketObject::sSelectIOPool = new XBOX::VTCPSelectIOPool();
+		VJSNetSocketObject::sSelectIOPool = new XBOX::VTCPSelectIOPool(XBOX::VTCPSelectIOPool::ePLACEMENT_SHARDED);
 
 	VJSNetSocketObject::sMutex.Unlock();
 
@@ -32,6 +32,10 @@ friend class VJSNetServerSyncClass;
 
 public:
 
+	// Maximum number of tasks accepting connections for an asynchronous server (one per processor up to that).
+
+	static const sLONG				kMAX_ACCEPT_TASKS	= 4;
+
 									VJSNetServerObject (bool inIsSynchronous, bool inAllowHalfOpen = true);
 	virtual							~VJSNetServerObject ();
 	
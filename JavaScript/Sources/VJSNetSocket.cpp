@@ -378,7 +378,7 @@ void VJSNetSocketClass::Connect (XBOX::VJSParms_withArguments &ioParms, XBOX::VJ
 
 	if (VJSNetSocketObject::sSelectIOPool == NULL)
 
-		VJSNetSocketObject::sSelectIOPool = new XBOX::VTCPSelectIOPool();
+		VJSNetSocketObject::sSelectIOPool = new XBOX::VTCPSelectIOPool(XBOX::VTCPSelectIOPool::ePLACEMENT_SHARDED);
 
 	VJSNetSocketObject::sMutex.Unlock();
 
@@ -518,6 +518,35 @@ void VJSStream::GetDefinition( ClassDefinition& outDefinition)
 
 //======================================================
 
+// Return a pointer on first CR or LF character of [inStart, inEnd[, or inEnd if there is none.
+// Characters are tested four at a time: a 16-bit lane of (word ^ pattern) is zero if and only if
+// that character matches, and HAS_ZERO_UNICHAR() tests all lanes at once.
+
+#define HAS_ZERO_UNICHAR(x)	(((x) - XBOX_LONG8(0x0001000100010001)) & ~(x) & XBOX_LONG8(0x8000800080008000))
+
+static const UniChar *_FindLineEnd (const UniChar *inStart, const UniChar *inEnd)
+{
+	const UniChar	*p;
+
+	for (p = inStart; inEnd - p >= 4; p += 4) {
+
+		uLONG8	word, cr, lf;
+
+		::memcpy(&word, p, sizeof(word));
+		cr = word ^ XBOX_LONG8(0x000D000D000D000D);
+		lf = word ^ XBOX_LONG8(0x000A000A000A000A);
+		if (HAS_ZERO_UNICHAR(cr) | HAS_ZERO_UNICHAR(lf))
+
+			break;
+
+	}
+	for ( ; p < inEnd && *p != '\r' && *p != '\n'; p++)
+
+		;
+
+	return p;
+}
+
 bool VJSTextStreamState::_ReadUntilDelimiter (const XBOX::VString &inDelimiter, XBOX::VString *outResult)
 {
 	bool	isFound	= false;
@@ -548,13 +577,13 @@ bool VJSTextStreamState::_ReadUntilDelimiter (const XBOX::VString &inDelimiter,
 
 			}
 
-			const UniChar	*p, *q;
+			const UniChar	*p, *q, *end;
 
-			for (p = q = fBuffer.GetCPointer() + fIndex; *q != 0 && *q != '\r' && *q != '\n'; q++)
+			end = fBuffer.GetCPointer() + fBuffer.GetLength();
+			p = fBuffer.GetCPointer() + fIndex;
+			q = _FindLineEnd(p, end);
 
-				;
-
-			if (*q) {
+			if (q != end) {
 
 				outResult->AppendUniChars(p, q - p);
 
@@ -710,6 +739,75 @@ void VJSTextStreamState::_ReadCharacters (sLONG inNumberCharacters, XBOX::VStrin
 	}
 }
 
+sLONG VJSTextStreamState::_ReadLines (sLONG inMaximumLines, std::vector<XBOX::VString> *outLines)
+{
+	xbox_assert(outLines != NULL);
+
+	sLONG	numberCharactersRead	= 0;
+	bool	isLineOpen				= false;	// Last line of outLines continues in next slice.
+
+	while (!inMaximumLines || (sLONG) outLines->size() < inMaximumLines || isLineOpen) {
+
+		if (fIndex >= fBuffer.GetLength()) {
+
+			fBuffer.Clear();
+			fIndex = 0;
+
+			XBOX::VError	error;
+
+			if ((error = fStream->GetText(fBuffer, kREAD_LINES_SLICE_SIZE)) != XBOX::VE_OK && error != XBOX::VE_STREAM_EOF) 
+					
+				break;				// Error!
+				
+			if (!fBuffer.GetLength())
+						
+				break;				// End-of-file.
+
+		}
+
+		// Split the whole slice, each line is copied once into a string of its exact size.
+
+		const UniChar	*start, *end, *p, *q;
+
+		start = fBuffer.GetCPointer();
+		end = start + fBuffer.GetLength();
+		for (p = start + fIndex; p < end && (!inMaximumLines || (sLONG) outLines->size() < inMaximumLines || isLineOpen); p = q + 1) {
+
+			q = _FindLineEnd(p, end);
+
+			if (!isLineOpen)
+
+				outLines->push_back(XBOX::VString());
+
+			outLines->back().AppendUniChars(p, q - p);
+			numberCharactersRead += q - p;
+
+			if (q == end) {
+
+				isLineOpen = true;
+				p = end;
+				break;
+
+			}
+
+			isLineOpen = false;
+			numberCharactersRead++;	// Delimiter.
+
+		}
+		fIndex = p - start;
+
+	}
+
+	if (fIndex >= fBuffer.GetLength()) {
+
+		fBuffer.Clear();
+		fIndex = 0;
+
+	}
+
+	return numberCharactersRead;
+}
+
 void VJSTextStream::GetDefinition (ClassDefinition &outDefinition)
 {
 	static inherited::StaticFunction functions[] = 
@@ -720,6 +818,7 @@ void VJSTextStream::GetDefinition (ClassDefinition &outDefinition)
 
 		{	"rewind",	js_callStaticFunction<_Rewind>,		JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete	},
 		{	"read",		js_callStaticFunction<_Read>,		JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete	},		
+		{	"readLines",	js_callStaticFunction<_ReadLines>,	JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete	},
 		{	"end",		js_callStaticFunction<_End>,		JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete	},
 
 		{	"write",	js_callStaticFunction<_Write>,		JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete	},
@@ -1009,6 +1108,44 @@ void VJSTextStream::_Read (VJSParms_callStaticFunction &ioParms, VJSTextStreamSt
 	}
 }
 
+void VJSTextStream::_ReadLines (VJSParms_callStaticFunction &ioParms, VJSTextStreamState *inStreamState)
+{
+	sLONG	numberLines;
+
+	numberLines = 0;
+	if (inStreamState == NULL || !inStreamState->fStream->IsReading())
+
+		XBOX::vThrowError(XBOX::VE_JVSC_INVALID_STATE, L"TextStream.readLines()");
+
+	else if (ioParms.CountParams() >= 1 && (!ioParms.GetLongParam(1, &numberLines) || numberLines < 0))
+
+		XBOX::vThrowError(XBOX::VE_JVSC_WRONG_PARAMETER_TYPE_NUMBER, "1");
+
+	else {
+
+		std::vector<XBOX::VString>	lines;
+
+		inStreamState->fPosition += inStreamState->_ReadLines(numberLines, &lines);
+
+		// Build the array in one call, this is a lot faster than pushing lines one by one.
+
+		std::vector<XBOX::VJSValue>	values;
+
+		values.reserve(lines.size());
+		for (std::vector<XBOX::VString>::const_iterator i = lines.begin(); i != lines.end(); i++) {
+
+			XBOX::VJSValue	value(ioParms.GetContextRef());
+
+			value.SetString(*i);
+			values.push_back(value);
+
+		}
+
+		ioParms.ReturnValue(XBOX::VJSArray(ioParms.GetContextRef(), values));
+
+	}
+}
+
 void VJSTextStream::_End (VJSParms_callStaticFunction &ioParms, VJSTextStreamState *inStreamState)
 {
 	if (inStreamState != NULL && inStreamState->fStream->IsReading())
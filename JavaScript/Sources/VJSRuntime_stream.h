@@ -73,6 +73,10 @@ friend class VJSTextStream;
 
 	static const sLONG	kREAD_SLICE_SIZE	=	256;
 
+	// Number of characters decoded at once when reading lines in batch.
+
+	static const sLONG	kREAD_LINES_SLICE_SIZE	=	64 * 1024;
+
 	XBOX::VStream	*fStream;
 	XBOX::VString	fBuffer;
 	VIndex			fIndex;		// Zero starting index.
@@ -87,6 +91,11 @@ friend class VJSTextStream;
 
 	void	_ReadCharacters (sLONG inNumberCharacters, XBOX::VString *outResult);
 
+	// Read up to inMaximumLines lines (use zero to read till end of file), line delimiters are the same as 
+	// _ReadUntilDelimiter() with an empty delimiter. Return the number of characters consumed, delimiters included.
+
+	sLONG	_ReadLines (sLONG inMaximumLines, std::vector<XBOX::VString> *outLines);
+
 public:
 	XBOX::VStream* GetStream()
 	{
@@ -121,6 +130,7 @@ private:
 
 	static void				_Rewind (VJSParms_callStaticFunction &ioParms, VJSTextStreamState *inStreamState);	// rewind()
 	static void				_Read (VJSParms_callStaticFunction& ioParms, VJSTextStreamState *inStreamState);	// read(string, { number : nbchar })  // if nbchar is missing then performs a read until linefeed or CR or eof
+	static void				_ReadLines (VJSParms_callStaticFunction &ioParms, VJSTextStreamState *inStreamState);	// array : readLines({ number : nblines })  // if nblines is missing or zero then reads all lines till eof
 	static void				_End (VJSParms_callStaticFunction &ioParms, VJSTextStreamState *inStreamState);		// bool : end()
 
 	static void				_Write (VJSParms_callStaticFunction &ioParms, VJSTextStreamState *inStreamState);	// write(string)	
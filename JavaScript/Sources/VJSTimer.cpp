@@ -141,6 +141,7 @@ VJSTimer::VJSTimer (XBOX::VJSObject &inFunctionObject, sLONG inInterval)
 	fID = -1;
 	fInterval = inInterval;
 	fFunctionObject = inFunctionObject.GetObjectRef();	
+	fEvent = NULL;
 }
 
 VJSTimer::~VJSTimer ()
@@ -310,14 +311,14 @@ void VJSTimer::_ClearTimer (VJSParms_callStaticFunction &ioParms, VJSWorker *inW
 
 	timer->_Clear();	
 
-	// This will loop the event queue, trying to find the VJSTimerEvent.
+	// This will remove the VJSTimerEvent from the event queue.
 	//
 	// If the clearTimeout() or clearInterval() is executed inside "itself" (in its callback),
 	// this will do nothing. The event is already executing, but as the timer is marked as 
 	// "cleared", VJSTimerEvent::Discard() will free it.
 	//
-	// Otherwise, the loop will find the VJSTimerEvent object, calling its Discard() and thus 
-	// freeing the timer.
+	// Otherwise, the VJSTimerEvent object is removed from the queue and its Discard() is 
+	// called, thus freeing the timer.
 	
 	inWorker->UnscheduleTimer(timer);
 }
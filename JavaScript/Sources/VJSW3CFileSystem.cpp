@@ -502,7 +502,7 @@ void VJSLocalFileSystem::_requestFileSystem (XBOX::VJSParms_callStaticFunction &
 
 		else
 
-			worker->QueueEvent(request);
+			request->Schedule(worker);
 
 	}
 }
@@ -566,7 +566,7 @@ void VJSLocalFileSystem::_resolveLocalFileSystemURL (XBOX::VJSParms_callStaticFu
 
 		else
 
-			worker->QueueEvent(request);
+			request->Schedule(worker);
 
 	}	
 }
@@ -973,6 +973,23 @@ sLONG VJSEntry::GetMetadata (const XBOX::VJSContext &inContext, XBOX::VJSObject
 	sLONG		code;
 	XBOX::VTime	modificationTime;
 
+	if ((code = DoGetMetadata(&modificationTime)) == VJSFileErrorClass::OK)
+
+		*outResult = VJSMetadataClass::NewInstance(inContext, modificationTime);
+
+	else
+
+		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
+
+	return code;
+}
+
+sLONG VJSEntry::DoGetMetadata (XBOX::VTime *outModificationTime)
+{
+	xbox_assert(outModificationTime != NULL);
+
+	sLONG	code;
+
 	if (!fFileSystem->IsValid())
 
 		code = VJSFileErrorClass::INVALID_STATE_ERR;
@@ -985,7 +1002,7 @@ sLONG VJSEntry::GetMetadata (const XBOX::VJSContext &inContext, XBOX::VJSObject
 
 			code = VJSFileErrorClass::NOT_FOUND_ERR;
 
-		else if (file.GetTimeAttributes(&modificationTime, NULL, NULL) != XBOX::VE_OK)
+		else if (file.GetTimeAttributes(outModificationTime, NULL, NULL) != XBOX::VE_OK)
 
 			code = VJSFileErrorClass::SECURITY_ERR;
 
@@ -1001,7 +1018,7 @@ sLONG VJSEntry::GetMetadata (const XBOX::VJSContext &inContext, XBOX::VJSObject
 						
 			code = VJSFileErrorClass::NOT_FOUND_ERR;
 
-		else if (folder.GetTimeAttributes(&modificationTime, NULL, NULL) != XBOX::VE_OK) 
+		else if (folder.GetTimeAttributes(outModificationTime, NULL, NULL) != XBOX::VE_OK) 
 
 			code = VJSFileErrorClass::SECURITY_ERR;
 
@@ -1011,9 +1028,19 @@ sLONG VJSEntry::GetMetadata (const XBOX::VJSContext &inContext, XBOX::VJSObject
 
 	}
 
-	if (code == VJSFileErrorClass::OK)
+	return code;
+}
 
-		*outResult = VJSMetadataClass::NewInstance(inContext, modificationTime);
+sLONG VJSEntry::MoveTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEntry, const XBOX::VString &inNewName, XBOX::VJSObject *outResult)
+{
+	xbox_assert(outResult != NULL);
+
+	sLONG			code;
+	XBOX::VFilePath	resultPath;
+
+	if ((code = DoMoveTo(inTargetEntry, inNewName, &resultPath)) == VJSFileErrorClass::OK)
+
+		*outResult = VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, resultPath, fIsFile);
 
 	else
 
@@ -1022,22 +1049,18 @@ sLONG VJSEntry::GetMetadata (const XBOX::VJSContext &inContext, XBOX::VJSObject
 	return code;
 }
 
-sLONG VJSEntry::MoveTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEntry, const XBOX::VString &inNewName, XBOX::VJSObject *outResult)
+sLONG VJSEntry::DoMoveTo (VJSEntry *inTargetEntry, const XBOX::VString &inNewName, XBOX::VFilePath *outResultPath)
 {
-	xbox_assert(outResult != NULL);
+	xbox_assert(outResultPath != NULL);
 	xbox_assert(inTargetEntry != NULL && !inTargetEntry->fIsFile);
 
-	if (!_IsNameCorrect(inNewName)) {
-		
-		*outResult = VJSFileErrorClass::NewInstance(inContext, VJSFileErrorClass::ENCODING_ERR);
+	if (!_IsNameCorrect(inNewName)) 
+
 		return VJSFileErrorClass::ENCODING_ERR;
 
-	}
- 
 	sLONG			code;
 	XBOX::VFilePath	sourceParent;
 	XBOX::VFolder	targetFolder(inTargetEntry->fPath);
-	XBOX::VFilePath	resultPath;
 
 	if (!fFileSystem->IsValid()) 
 
@@ -1178,7 +1201,7 @@ sLONG VJSEntry::MoveTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEnt
 					else {
 
 						code = VJSFileErrorClass::OK;
-						resultPath = file->GetPath();
+						*outResultPath = file->GetPath();
 						XBOX::ReleaseRefCountable<XBOX::VFile>(&file);
 
 					}
@@ -1194,7 +1217,7 @@ sLONG VJSEntry::MoveTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEnt
 					else {
 
 						code = VJSFileErrorClass::OK;
-						resultPath = file->GetPath();
+						*outResultPath = file->GetPath();
 						XBOX::ReleaseRefCountable<XBOX::VFile>(&file);
 	
 					}
@@ -1214,7 +1237,7 @@ sLONG VJSEntry::MoveTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEnt
 					else {
 
 						code = VJSFileErrorClass::OK;
-						resultPath = folder->GetPath();
+						*outResultPath = folder->GetPath();
 						XBOX::ReleaseRefCountable<XBOX::VFolder>(&folder);
 
 					}
@@ -1228,7 +1251,7 @@ sLONG VJSEntry::MoveTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEnt
 					else {
 
 						code = VJSFileErrorClass::OK;
-						resultPath = folder->GetPath();
+						*outResultPath = folder->GetPath();
 						XBOX::ReleaseRefCountable<XBOX::VFolder>(&folder);
 
 					}
@@ -1289,14 +1312,14 @@ sLONG VJSEntry::MoveTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEnt
 							else {
 
 								code = VJSFileErrorClass::OK;
-								resultPath = targetFolder->GetPath();
+								*outResultPath = targetFolder->GetPath();
 
 							}
 
 						} else {
 
 							code = VJSFileErrorClass::OK;
-							resultPath = targetFolder->GetPath();
+							*outResultPath = targetFolder->GetPath();
 	
 						}
 						XBOX::ReleaseRefCountable<XBOX::VFolder>(&sourceFolder);
@@ -1312,7 +1335,17 @@ sLONG VJSEntry::MoveTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEnt
 
 	}
 
-	if (code == VJSFileErrorClass::OK)
+	return code;
+}
+
+sLONG VJSEntry::CopyTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEntry, const XBOX::VString &inNewName, XBOX::VJSObject *outResult)
+{
+	xbox_assert(outResult != NULL);
+
+	sLONG			code;
+	XBOX::VFilePath	resultPath;
+
+	if ((code = DoCopyTo(inTargetEntry, inNewName, &resultPath)) == VJSFileErrorClass::OK)
 
 		*outResult = VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, resultPath, fIsFile);
 
@@ -1323,21 +1356,18 @@ sLONG VJSEntry::MoveTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEnt
 	return code;
 }
 
-sLONG VJSEntry::CopyTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEntry, const XBOX::VString &inNewName, XBOX::VJSObject *outResult)
+sLONG VJSEntry::DoCopyTo (VJSEntry *inTargetEntry, const XBOX::VString &inNewName, XBOX::VFilePath *outResultPath)
 {
-	xbox_assert(outResult != NULL);
+	xbox_assert(outResultPath != NULL);
 	xbox_assert(inTargetEntry != NULL && !inTargetEntry->fIsFile);
 
-	if (!_IsNameCorrect(inNewName)) {
-		 
-		*outResult = VJSFileErrorClass::NewInstance(inContext, VJSFileErrorClass::ENCODING_ERR);
+	if (!_IsNameCorrect(inNewName)) 
+
 		return VJSFileErrorClass::ENCODING_ERR;
 
-	}
 	sLONG			code;
 	XBOX::VFilePath	sourceParent;
 	XBOX::VFolder	targetFolder(inTargetEntry->fPath);
-	XBOX::VFilePath	resultPath;
 	
 	if (!fFileSystem->IsValid()) 
 
@@ -1438,7 +1468,7 @@ sLONG VJSEntry::CopyTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEnt
 				if (XBOX::VFile(fPath).CopyTo(path, &file, FCP_Overwrite) == XBOX::VE_OK) {
 
 					code = VJSFileErrorClass::OK;
-					resultPath = file->GetPath();
+					*outResultPath = file->GetPath();
 					XBOX::ReleaseRefCountable<XBOX::VFile>(&file);
 
 				} else
@@ -1453,7 +1483,7 @@ sLONG VJSEntry::CopyTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEnt
 				&& XBOX::VFolder(fPath).CopyContentsTo(folder, FCP_Overwrite) == XBOX::VE_OK) {
 
 					code = VJSFileErrorClass::OK;
-					resultPath = folder.GetPath();
+					*outResultPath = folder.GetPath();
 
 				} else
 
@@ -1465,21 +1495,24 @@ sLONG VJSEntry::CopyTo (const XBOX::VJSContext &inContext, VJSEntry *inTargetEnt
 
 	}
 
-	if (code == VJSFileErrorClass::OK)
+	return code;
+}
 
-		*outResult = VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, resultPath, fIsFile);
+sLONG VJSEntry::Remove (const XBOX::VJSContext &inContext, XBOX::VJSObject *outException)
+{
+	xbox_assert(outException != NULL);
 
-	else
+	sLONG	code;
 
-		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
+	if ((code = DoRemove()) != VJSFileErrorClass::OK) 
+
+		*outException = VJSFileErrorClass::NewInstance(inContext, code);
 
 	return code;
 }
 
-sLONG VJSEntry::Remove (const XBOX::VJSContext &inContext, XBOX::VJSObject *outException)
+sLONG VJSEntry::DoRemove ()
 {
-	xbox_assert(outException != NULL);
-
 	sLONG	code;
 
 	if (!fFileSystem->IsValid())
@@ -1534,10 +1567,6 @@ sLONG VJSEntry::Remove (const XBOX::VJSContext &inContext, XBOX::VJSObject *outE
 		
 	}
 
-	if (code != VJSFileErrorClass::OK) 
-
-		*outException = VJSFileErrorClass::NewInstance(inContext, code);
-
 	return code;
 }
 	
@@ -1581,7 +1610,25 @@ sLONG VJSEntry::GetParent (const XBOX::VJSContext &inContext, XBOX::VJSObject *o
 
 sLONG VJSEntry::GetFile (const XBOX::VJSContext &inContext, VJSEntry *inFolderEntry, const XBOX::VString &inURL, sLONG inFlags, XBOX::VJSObject *outResult)
 {
-	xbox_assert(inFolderEntry != NULL && !inFolderEntry->IsFile() && outResult != NULL);
+	xbox_assert(outResult != NULL);
+
+	sLONG		code;
+	VFilePath	path;
+
+	if ((code = DoGetFile(inFolderEntry, inURL, inFlags, &path)) == VJSFileErrorClass::OK) 
+
+		*outResult = VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, path, true);
+
+	else
+
+		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
+
+	return code;
+}
+
+sLONG VJSEntry::DoGetFile (VJSEntry *inFolderEntry, const XBOX::VString &inURL, sLONG inFlags, XBOX::VFilePath *outPath)
+{
+	xbox_assert(inFolderEntry != NULL && !inFolderEntry->IsFile() && outPath != NULL);
 
 	sLONG		code;
 	VFilePath	path(inFolderEntry->GetPath());
@@ -1654,9 +1701,21 @@ sLONG VJSEntry::GetFile (const XBOX::VJSContext &inContext, VJSEntry *inFolderEn
 
 	}
 
-	if (code == VJSFileErrorClass::OK) 
+	*outPath = path;
 
-		*outResult = VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, path, true);
+	return code;
+}
+
+sLONG VJSEntry::GetDirectory (const XBOX::VJSContext &inContext, VJSEntry *inFolderEntry, const XBOX::VString &inURL, sLONG inFlags, XBOX::VJSObject *outResult)
+{
+	xbox_assert(outResult != NULL);
+
+	sLONG		code;
+	VFilePath	path;
+
+	if ((code = DoGetDirectory(inFolderEntry, inURL, inFlags, &path)) == VJSFileErrorClass::OK) 
+
+		*outResult = VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, path, false);
 
 	else
 
@@ -1665,9 +1724,9 @@ sLONG VJSEntry::GetFile (const XBOX::VJSContext &inContext, VJSEntry *inFolderEn
 	return code;
 }
 
-sLONG VJSEntry::GetDirectory (const XBOX::VJSContext &inContext, VJSEntry *inFolderEntry, const XBOX::VString &inURL, sLONG inFlags, XBOX::VJSObject *outResult)
+sLONG VJSEntry::DoGetDirectory (VJSEntry *inFolderEntry, const XBOX::VString &inURL, sLONG inFlags, XBOX::VFilePath *outPath)
 {
-	xbox_assert(inFolderEntry != NULL && !inFolderEntry->IsFile() && outResult != NULL);
+	xbox_assert(inFolderEntry != NULL && !inFolderEntry->IsFile() && outPath != NULL);
 
 	sLONG		code;
 	VFilePath	path(inFolderEntry->GetPath());
@@ -1751,20 +1810,26 @@ sLONG VJSEntry::GetDirectory (const XBOX::VJSContext &inContext, VJSEntry *inFol
 
 	}
 
-	if (code == VJSFileErrorClass::OK) 
+	*outPath = path;
 
-		*outResult = VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, path, false);
+	return code;
+}
 
-	else
+sLONG VJSEntry::RemoveRecursively (const XBOX::VJSContext &inContext, XBOX::VJSObject *outException)
+{
+	xbox_assert(outException != NULL);
 
-		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
+	sLONG	code;
+
+	if ((code = DoRemoveRecursively()) != VJSFileErrorClass::OK) 
+
+		*outException = VJSFileErrorClass::NewInstance(inContext, code);
 
 	return code;
 }
 
-sLONG VJSEntry::RemoveRecursively (const XBOX::VJSContext &inContext, XBOX::VJSObject *outException)
+sLONG VJSEntry::DoRemoveRecursively ()
 {
-	xbox_assert(outException != NULL);
 	xbox_assert(!fIsFile);
 
 	sLONG	code;
@@ -1798,16 +1863,31 @@ sLONG VJSEntry::RemoveRecursively (const XBOX::VJSContext &inContext, XBOX::VJSO
 		
 	}
 
-	if (code != VJSFileErrorClass::OK) 
-
-		*outException = VJSFileErrorClass::NewInstance(inContext, code);
-
 	return code;
 }
 
 sLONG VJSEntry::Folder (const XBOX::VJSContext &inContext, XBOX::VJSObject *outResult)
 {
 	xbox_assert(outResult != NULL);
+
+	sLONG				code;
+	JS4DFolderIterator	*folderIterator;
+
+	if ((code = DoFolder(&folderIterator)) == VJSFileErrorClass::OK) {
+
+		*outResult = VJSFolderIterator::CreateInstance(inContext, folderIterator);
+		XBOX::ReleaseRefCountable<JS4DFolderIterator>(&folderIterator);
+		
+	} else 
+
+		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
+
+	return code;
+}
+
+sLONG VJSEntry::DoFolder (JS4DFolderIterator **outFolderIterator)
+{
+	xbox_assert(outFolderIterator != NULL);
 	xbox_assert(!fIsFile);
 
 	sLONG				code;
@@ -1841,14 +1921,7 @@ sLONG VJSEntry::Folder (const XBOX::VJSContext &inContext, XBOX::VJSObject *outR
 
 	}
 
-	if (code == VJSFileErrorClass::OK) {
-
-		*outResult = VJSFolderIterator::CreateInstance(inContext, folderIterator);
-		XBOX::ReleaseRefCountable<JS4DFolderIterator>(&folderIterator);
-		
-	} else 
-
-		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
+	*outFolderIterator = (code == VJSFileErrorClass::OK) ? folderIterator : NULL;
 
 	return code;
 }
@@ -1865,6 +1938,25 @@ sLONG VJSEntry::CreateWriter (const XBOX::VJSContext &inContext, XBOX::VJSObject
 sLONG VJSEntry::File (const XBOX::VJSContext &inContext, XBOX::VJSObject *outResult)
 {
 	xbox_assert(outResult != NULL);
+
+	sLONG				code;
+	JS4DFileIterator	*fileIterator;
+
+	if ((code = DoFile(&fileIterator)) == VJSFileErrorClass::OK) {
+
+		*outResult = VJSFileIterator::CreateInstance(inContext, fileIterator);
+		XBOX::ReleaseRefCountable<JS4DFileIterator>(&fileIterator);
+		
+	} else 
+
+		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
+
+	return code;
+}
+
+sLONG VJSEntry::DoFile (JS4DFileIterator **outFileIterator)
+{
+	xbox_assert(outFileIterator != NULL);
 	xbox_assert(fIsFile);
 
 	sLONG				code;
@@ -1898,14 +1990,7 @@ sLONG VJSEntry::File (const XBOX::VJSContext &inContext, XBOX::VJSObject *outRes
 
 	}
 
-	if (code == VJSFileErrorClass::OK) {
-
-		*outResult = VJSFileIterator::CreateInstance(inContext, fileIterator);
-		XBOX::ReleaseRefCountable<JS4DFileIterator>(&fileIterator);
-		
-	} else 
-
-		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
+	*outFileIterator = (code == VJSFileErrorClass::OK) ? fileIterator : NULL;
 
 	return code;
 }
@@ -1974,7 +2059,7 @@ void VJSEntry::_getMetadata (XBOX::VJSParms_callStaticFunction &ioParms, VJSEntr
 
 		else
 
-			worker->QueueEvent(request);
+			request->Schedule(worker);
 
 	}
 }
@@ -2085,7 +2170,7 @@ void VJSEntry::_remove (XBOX::VJSParms_callStaticFunction &ioParms, VJSEntry *in
 
 		else
 
-			worker->QueueEvent(request);
+			request->Schedule(worker);
 
 	}
 }
@@ -2132,7 +2217,7 @@ void VJSEntry::_getParent (XBOX::VJSParms_callStaticFunction &ioParms, VJSEntry
 
 		else
 
-			worker->QueueEvent(request);
+			request->Schedule(worker);
 
 	}
 }
@@ -2197,7 +2282,7 @@ void VJSEntry::_removeRecursively (XBOX::VJSParms_callStaticFunction &ioParms, V
 
 		else
 
-			worker->QueueEvent(request);
+			request->Schedule(worker);
 
 	}
 }
@@ -2249,7 +2334,7 @@ void VJSEntry::_folder (XBOX::VJSParms_callStaticFunction &ioParms, VJSEntry *in
 
 		else
 
-			worker->QueueEvent(request);
+			request->Schedule(worker);
 
 	}
 }
@@ -2308,7 +2393,7 @@ void VJSEntry::_file (XBOX::VJSParms_callStaticFunction &ioParms, VJSEntry *inEn
 
 		else
 
-			worker->QueueEvent(request);
+			request->Schedule(worker);
 
 	}
 }
@@ -2443,7 +2528,7 @@ void VJSEntry::_moveOrCopyTo (XBOX::VJSParms_callStaticFunction &ioParms, VJSEnt
 
 		else
 
-			worker->QueueEvent(request);
+			request->Schedule(worker);
 
 	}
 }
@@ -2562,7 +2647,7 @@ void VJSEntry::_getFileOrDirectory (XBOX::VJSParms_callStaticFunction &ioParms,
 
 		else
 
-			worker->QueueEvent(request);
+			request->Schedule(worker);
 
 	}
 }
@@ -2704,47 +2789,68 @@ sLONG VJSDirectoryReader::ReadEntries (const XBOX::VJSContext &inContext, XBOX::
 {
 	xbox_assert(outResult != NULL);
 
+	sLONG							code;
+	std::vector<XBOX::VFilePath>	folderPaths, filePaths;
+
+	if ((code = DoReadEntries(&folderPaths, &filePaths)) == VJSFileErrorClass::OK) {
+
+		// Currently folders are always returned first, followed by files. Yet there is no defined order in the spec, 
+		// and this (order) can change in the future.
+
+		XBOX::VJSArray	entriesArray(inContext);
+		
+		for (std::vector<XBOX::VFilePath>::const_iterator i = folderPaths.begin(); i != folderPaths.end(); i++)
+
+			entriesArray.PushValue(VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, *i, false));
+
+		for (std::vector<XBOX::VFilePath>::const_iterator i = filePaths.begin(); i != filePaths.end(); i++)
+
+			entriesArray.PushValue(VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, *i, true));
+
+		*outResult = entriesArray;
+
+	} else 
+
+		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
+
+	return code;
+}
+
+sLONG VJSDirectoryReader::DoReadEntries (std::vector<XBOX::VFilePath> *outFolderPaths, std::vector<XBOX::VFilePath> *outFilePaths)
+{
+	xbox_assert(outFolderPaths != NULL && outFilePaths != NULL);
+
 	sLONG	code;
 
-	if (!fFileSystem->IsValid()) {
+	if (!fFileSystem->IsValid()) 
 	
 		code = VJSFileErrorClass::INVALID_STATE_ERR;
-		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
 	
-	} else if (!fFolder->Exists()) { 
+	else if (!fFolder->Exists()) 
 	
 		code = VJSFileErrorClass::NOT_FOUND_ERR;
-		*outResult = VJSFileErrorClass::NewInstance(inContext, code);
 	
-	} else {
-
-		// Currently folders are always returned first, followed by files. Yet there is no defined order in the spec, 
-		// and this (order) can change in the future.
+	else {
 
-		sLONG			numberEntries;
-		XBOX::VJSArray	entriesArray(inContext);
+		sLONG	numberEntries;
 		
 		numberEntries = 0;
 
 		for ( ; fFolderIterator->IsValid() && numberEntries < kMaximumEntries; ++*fFolderIterator) {
 		
-			XBOX::VFolder	*f = fFolderIterator->Current();
-
-			entriesArray.PushValue(VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, fFolderIterator->Current()->GetPath(), false));
+			outFolderPaths->push_back(fFolderIterator->Current()->GetPath());
 			numberEntries++;
 
 		}
 
 		for ( ; fFileIterator->IsValid() && numberEntries < kMaximumEntries; ++*fFileIterator) {
 		
-			entriesArray.PushValue(VJSEntry::CreateObject(inContext, fIsSync, fFileSystem, fFileIterator->Current()->GetPath(), true));
+			outFilePaths->push_back(fFileIterator->Current()->GetPath());
 			numberEntries++;
 
 		}
 
-		numberEntries = entriesArray.GetLength();
-		*outResult = entriesArray;
-		code =  VJSFileErrorClass::OK;
+		code = VJSFileErrorClass::OK;
 
 	}
 
@@ -2867,7 +2973,7 @@ void VJSDirectoryReaderClass::_readEntries (XBOX::VJSParms_callStaticFunction &i
 	else {
 
 		inDirectoryReader->SetAsReading();
-		worker->QueueEvent(request);
+		request->Schedule(worker);
 
 	}
 }
@@ -3066,4 +3172,158 @@ void VJSFileErrorClass::_toString (XBOX::VJSParms_callStaticFunction &ioParms, v
 	xbox_assert(propertyExits && code >= FIRST_CODE && code <= LAST_CODE);
 
 	ioParms.ReturnString(sErrorNames[code]);
-}
\ No newline at end of file
+}
+XBOX::VCriticalSection							VJSW3CFSIOPool::sMutex;
+XBOX::VSemaphore								VJSW3CFSIOPool::sSemaphore(0, kMAX_sLONG);
+std::list<VJSW3CFSIOPool::SRequest>				VJSW3CFSIOPool::sQueue;
+std::list<VJSW3CFSIOPool::SRequest>				VJSW3CFSIOPool::sExecuting;
+sLONG											VJSW3CFSIOPool::sNumberTasks		= 0;
+sLONG											VJSW3CFSIOPool::sNumberIdleTasks	= 0;
+
+void VJSW3CFSIOPool::Schedule (VJSW3CFSEvent *inEvent, VJSWorker *inWorker)
+{
+	xbox_assert(inEvent != NULL && inWorker != NULL);
+
+	XBOX::StLocker<XBOX::VCriticalSection>	lock(&sMutex);
+
+	sQueue.push_back(SRequest(inEvent, inWorker));
+
+	// Launch a new task if all are busy and maximum isn't reached.
+
+	if ((sLONG) sQueue.size() > sNumberIdleTasks && sNumberTasks < kMaximumTasks) {
+
+		XBOX::VTask	*task;
+
+		if ((task = new XBOX::VTask(NULL, 0, XBOX::eTaskStylePreemptive, _RunProc)) != NULL) {
+
+			task->SetName("W3C File System I/O");
+			sNumberTasks++;
+			sNumberIdleTasks++;
+			if (!task->Run()) {
+
+				// Task didn't start, don't count it.
+
+				sNumberTasks--;
+				sNumberIdleTasks--;
+
+			}
+			task->Release();
+
+		}
+
+	}
+
+	if (!sNumberTasks) {
+
+		// Unable to launch any task, operation will be executed by the worker when processing the event.
+
+		sQueue.pop_back();
+		inWorker->QueueEvent(inEvent);
+
+	} else 
+
+		sSemaphore.Unlock();
+}
+
+void VJSW3CFSIOPool::CancelWorker (VJSWorker *inWorker)
+{
+	xbox_assert(inWorker != NULL);
+
+	for ( ; ; ) {
+
+		{
+			XBOX::StLocker<XBOX::VCriticalSection>	lock(&sMutex);
+
+			std::list<SRequest>::iterator	i;
+			bool							isExecuting;
+
+			for (i = sQueue.begin(); i != sQueue.end(); )
+
+				if (i->second == inWorker) {
+
+					inWorker->QueueEvent(i->first);
+					i = sQueue.erase(i);
+
+				} else
+
+					i++;
+
+			isExecuting = false;
+			for (i = sExecuting.begin(); i != sExecuting.end(); i++)
+
+				if (i->second == inWorker) {
+
+					isExecuting = true;
+					break;
+
+				}
+
+			if (!isExecuting)
+
+				break;
+
+		}
+
+		// An operation can't be interrupted, wait for its completion.
+
+		XBOX::VTask::Sleep(10);
+
+	}
+}
+
+sLONG VJSW3CFSIOPool::_RunProc (XBOX::VTask *inVTask)
+{
+	while (!inVTask->IsDying()) {
+
+		if (!sSemaphore.Lock(kIdleTimeOut)) {
+
+			// A request may have been queued just after time out, check again before terminating.
+
+			XBOX::StLocker<XBOX::VCriticalSection>	lock(&sMutex);
+
+			if (!sSemaphore.TryToLock()) {
+
+				sNumberTasks--;
+				sNumberIdleTasks--;
+				return 0;
+
+			}
+
+		}
+
+		SRequest	request;
+
+		{
+			XBOX::StLocker<XBOX::VCriticalSection>	lock(&sMutex);
+
+			// Queue can be empty if requests have been cancelled.
+
+			if (sQueue.empty())
+
+				continue;
+
+			request = sQueue.front();
+			sQueue.pop_front();
+			sExecuting.push_back(request);
+			sNumberIdleTasks--;
+		}
+
+		request.first->Execute();
+
+		{
+			XBOX::StLocker<XBOX::VCriticalSection>	lock(&sMutex);
+
+			sExecuting.remove(request);
+			request.second->QueueEvent(request.first);
+			sNumberIdleTasks++;
+		}
+
+	}
+
+	XBOX::StLocker<XBOX::VCriticalSection>	lock(&sMutex);
+
+	sNumberTasks--;
+	sNumberIdleTasks--;
+
+	return 0;
+}
@@ -21,6 +21,8 @@
 
 #include "VJSWorker.h"
 
+#include <list>
+
 // W3C File System API implementation:
 //
 //	http://www.w3.org/TR/file-system-api/
@@ -30,9 +32,16 @@
 // Notes:
 //
 //	* DirectoryEntry and DirectoryEntrySync have an additional Folder() function not in W3C specification.
+//
+//	* Asynchronous operations doing actual file or folder access are executed by the VJSW3CFSIOPool tasks, 
+//	  only the completion event is processed by the worker.
 
 BEGIN_TOOLBOX_NAMESPACE
 
+class JS4DFolderIterator;
+class JS4DFileIterator;
+class VJSW3CFSEvent;
+
 // LocalFileSystem (3.4.1) and LocalFileSystemSync (3.4.2) interfaces. Each worker has a VJSLocalFileSystem 
 // object which encapsulates all the "file systems" (sandboxes) available.
 
@@ -278,6 +287,21 @@ public:
 	sLONG					CreateWriter (const XBOX::VJSContext &inContext, XBOX::VJSObject *outResult);
 	sLONG					File (const XBOX::VJSContext &inContext, XBOX::VJSObject *outResult);
 
+	// Same operations without any JavaScript object creation, so they can be executed outside the worker. Return error
+	// code (see VJSFileErrorClass) along with resulting path, modification time, or iterator (to be released by caller).
+
+	sLONG					DoGetMetadata (XBOX::VTime *outModificationTime);
+	sLONG					DoMoveTo (VJSEntry *inTargetEntry, const XBOX::VString &inNewName, XBOX::VFilePath *outResultPath);
+	sLONG					DoCopyTo (VJSEntry *inTargetEntry, const XBOX::VString &inNewName, XBOX::VFilePath *outResultPath);
+	sLONG					DoRemove ();
+
+	sLONG					DoGetFile (VJSEntry *inFolderEntry, const XBOX::VString &inURL, sLONG inFlags, XBOX::VFilePath *outPath);
+	sLONG					DoGetDirectory (VJSEntry *inFolderEntry, const XBOX::VString &inURL, sLONG inFlags, XBOX::VFilePath *outPath);
+	sLONG					DoRemoveRecursively ();
+	sLONG					DoFolder (JS4DFolderIterator **outFolderIterator);
+
+	sLONG					DoFile (JS4DFileIterator **outFileIterator);
+
 private:
 
 friend class VJSDirectoryEntryClass;
@@ -367,6 +391,12 @@ public:
 
 	sLONG					ReadEntries (const XBOX::VJSContext &inContext, XBOX::VJSObject *outResult);
 
+	// Read up to kMaximumEntries paths, without JavaScript object creation. Folders are appended to *outFolderPaths 
+	// first, then files to *outFilePaths. Return error code (see VJSFileErrorClass).
+
+	sLONG					DoReadEntries (std::vector<XBOX::VFilePath> *outFolderPaths, std::vector<XBOX::VFilePath> *outFilePaths);
+
+	VJSFileSystem			*GetFileSystem ()	{	return fFileSystem;	}
 	bool					IsSync ()		{	return fIsSync;		}
 	bool					IsReading ()	{	return fIsReading;	}
 
@@ -497,6 +527,41 @@ private:
 	static void				_toString (XBOX::VJSParms_callStaticFunction &ioParms, void *);
 };
 
+// Shared and bounded pool of tasks executing the file or folder access of asynchronous operations. Once executed,
+// an event is queued back to its worker which will then trigger the callback. Events are never discarded by the pool.
+
+class XTOOLBOX_API VJSW3CFSIOPool : public XBOX::VObject
+{
+public:
+
+	// Maximum number of pool tasks, and delay after which an idle task terminates.
+
+	static const sLONG		kMaximumTasks		= 4;
+	static const sLONG		kIdleTimeOut		= 10000;
+
+	// Queue an event for execution by a pool task.
+
+	static void				Schedule (VJSW3CFSEvent *inEvent, VJSWorker *inWorker);
+
+	// Remove all queued events of a terminating worker and wait for the ones being executed. Events are not 
+	// discarded but returned to the worker queue, so they can be discarded along with its other events.
+
+	static void				CancelWorker (VJSWorker *inWorker);
+
+private:
+
+	typedef std::pair<VJSW3CFSEvent *, VJSWorker *>	SRequest;
+
+	static XBOX::VCriticalSection	sMutex;
+	static XBOX::VSemaphore			sSemaphore;		// One resource per queued request.
+	static std::list<SRequest>		sQueue;
+	static std::list<SRequest>		sExecuting;
+	static sLONG					sNumberTasks;
+	static sLONG					sNumberIdleTasks;
+
+	static sLONG			_RunProc (XBOX::VTask *inVTask);
+};
+
 END_TOOLBOX_NAMESPACE
 
 #endif
\ No newline at end of file
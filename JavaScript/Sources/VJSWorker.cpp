@@ -56,6 +56,7 @@ VJSWorker::VJSWorker (XBOX::VJSContext &inParentContext, const XBOX::VString &in
 	fVTask = new XBOX::VTask(NULL, 0, XBOX::eTaskStylePreemptive, _RunProc);
 	fVTask->SetKindData((sLONG_PTR) this);
 	fClosingFlag = fIsLockedWaiting = fExitWaitFlag = false;
+	fEventCounter = 0;
 
 	fIsDedicatedWorker = true;
 	fURL = inURL;
@@ -194,8 +195,7 @@ sLONG VJSWorker::WaitFor (XBOX::VJSContext &inContext, sLONG inWaitingDuration,
 
 			IJSEvent	*event;
 
-			event = fEventQueue.front();
-			fEventQueue.pop_front();
+			event = _PopEvent();
 
 			// If an event generator and event type has been specified, check if the event to process is matching.
 
@@ -415,17 +415,8 @@ void VJSWorker::QueueEvent (IJSEvent *inEvent)
 	xbox_assert(inEvent != NULL);
 
 	XBOX::StLocker<XBOX::VCriticalSection>	lock(&fMutex);
-	std::list<IJSEvent *>::iterator			i;
-	
-	for (i = fEventQueue.begin(); i != fEventQueue.end(); i++) 
-
-		// If two events have identical trigger time, first queued will be processed first.
-		
-		if ((*i)->GetTriggerTime() > inEvent->GetTriggerTime())
-
-			break;
 
-	fEventQueue.insert(i, inEvent);	
+	_PushEvent(inEvent);
 
 	// If locked waiting for an event, send signal.
 
@@ -440,7 +431,16 @@ void VJSWorker::UnscheduleTimer (VJSTimer *inTimer)
 
 	XBOX::StLocker<XBOX::VCriticalSection>	lock(&fMutex);
 
-	VJSTimerEvent::RemoveTimerEvent(&fEventQueue, inTimer);	
+	VJSTimerEvent	*event;
+
+	// If the timer event is being processed, it is not in queue.
+
+	if ((event = VJSTimerEvent::GetTimerEvent(inTimer)) != NULL && event->fQueueIndex >= 0) {
+
+		_RemoveEvent(event);
+		event->Discard();
+
+	}
 }
 
 void VJSWorker::AddMessagePort (VJSMessagePort *inMessagePort)
@@ -529,6 +529,7 @@ VJSWorker::VJSWorker (XBOX::VJSContext &inParentContext, const XBOX::VString &in
 	fVTask = new XBOX::VTask(NULL, 0, XBOX::eTaskStylePreemptive, _RunProc);
 	fVTask->SetKindData((sLONG_PTR) this);
 	fClosingFlag = fIsLockedWaiting = fExitWaitFlag = false;
+	fEventCounter = 0;
 
 	fIsDedicatedWorker = false;	
 	fURL = inURL;
@@ -561,6 +562,7 @@ VJSWorker::VJSWorker (const XBOX::VJSContext &inContext)
 
 	fVTask = NULL;
 	fClosingFlag = fIsLockedWaiting = fExitWaitFlag = false;
+	fEventCounter = 0;
 
 	fIsDedicatedWorker = false;			// "Root" is not a dedicated worker of another worker.
 
@@ -575,6 +577,10 @@ VJSWorker::VJSWorker (const XBOX::VJSContext &inContext)
 
 VJSWorker::~VJSWorker ()
 {
+	// Get back W3C file system operations being executed, they will be discarded along with other pending events.
+
+	VJSW3CFSIOPool::CancelWorker(this);
+
 	XBOX::StLocker<XBOX::VCriticalSection>	lock(&sMutex);
 
 	// Release all error ports, requesting termination of "child" dedicated workers if needed.
@@ -610,12 +616,9 @@ VJSWorker::~VJSWorker ()
 	
 	// Discard all pending events. 
 
-	while (!fEventQueue.empty()) {
+	while (!fEventQueue.empty()) 
 
-		fEventQueue.front()->Discard();
-		fEventQueue.pop_front();
-
-	}
+		_PopEvent()->Discard();
 
 	std::list<VJSWorker *>	*list;
 	
@@ -701,6 +704,131 @@ void VJSWorker::_RemoveMessagePort (std::list<VJSMessagePort *> *ioMessagePorts,
 		ioMessagePorts->erase(i);
 }
 
+bool VJSWorker::_IsEarlier (const IJSEvent *inA, const IJSEvent *inB)
+{
+	// If two events have identical trigger time, first queued will be processed first.
+
+	if (inA->fTriggerTime == inB->fTriggerTime)
+
+		return inA->fQueueOrder < inB->fQueueOrder;
+
+	else
+
+		return inA->fTriggerTime < inB->fTriggerTime;
+}
+
+void VJSWorker::_PushEvent (IJSEvent *inEvent)
+{
+	xbox_assert(inEvent->fQueueIndex < 0);
+
+	inEvent->fQueueOrder = fEventCounter++;
+	inEvent->fQueueIndex = (sLONG) fEventQueue.size();
+	fEventQueue.push_back(inEvent);
+	_SiftUp(inEvent->fQueueIndex);
+}
+
+IJSEvent *VJSWorker::_PopEvent ()
+{
+	xbox_assert(!fEventQueue.empty());
+
+	IJSEvent	*event;
+
+	event = fEventQueue.front();
+	_RemoveEvent(event);
+
+	return event;
+}
+
+void VJSWorker::_RemoveEvent (IJSEvent *inEvent)
+{
+	sLONG	index, lastIndex;
+
+	index = inEvent->fQueueIndex;
+	lastIndex = (sLONG) fEventQueue.size() - 1;
+	xbox_assert(index >= 0 && index <= lastIndex && fEventQueue[index] == inEvent);
+
+	inEvent->fQueueIndex = -1;
+	if (index != lastIndex) {
+
+		// Move last event in the hole, then restore heap order in whichever direction is needed.
+
+		fEventQueue[index] = fEventQueue[lastIndex];
+		fEventQueue[index]->fQueueIndex = index;
+		fEventQueue.pop_back();
+
+		if (index > 0 && _IsEarlier(fEventQueue[index], fEventQueue[(index - 1) / 4]))
+
+			_SiftUp(index);
+
+		else
+
+			_SiftDown(index);
+
+	} else
+
+		fEventQueue.pop_back();
+}
+
+void VJSWorker::_SiftUp (sLONG inIndex)
+{
+	IJSEvent	*event;
+
+	event = fEventQueue[inIndex];
+	while (inIndex > 0) {
+
+		sLONG	parent;
+
+		parent = (inIndex - 1) / 4;
+		if (!_IsEarlier(event, fEventQueue[parent]))
+
+			break;
+
+		fEventQueue[inIndex] = fEventQueue[parent];
+		fEventQueue[inIndex]->fQueueIndex = inIndex;
+		inIndex = parent;
+
+	}
+	fEventQueue[inIndex] = event;
+	event->fQueueIndex = inIndex;
+}
+
+void VJSWorker::_SiftDown (sLONG inIndex)
+{
+	IJSEvent	*event;
+	sLONG		size;
+
+	event = fEventQueue[inIndex];
+	size = (sLONG) fEventQueue.size();
+	for ( ; ; ) {
+
+		sLONG	first, last, earliest;
+
+		first = inIndex * 4 + 1;
+		if (first >= size)
+
+			break;
+
+		last = first + 4 < size ? first + 4 : size;
+		earliest = first;
+		for (sLONG i = first + 1; i < last; i++)
+
+			if (_IsEarlier(fEventQueue[i], fEventQueue[earliest]))
+
+				earliest = i;
+
+		if (!_IsEarlier(fEventQueue[earliest], event))
+
+			break;
+
+		fEventQueue[inIndex] = fEventQueue[earliest];
+		fEventQueue[inIndex]->fQueueIndex = inIndex;
+		inIndex = earliest;
+
+	}
+	fEventQueue[inIndex] = event;
+	event->fQueueIndex = inIndex;
+}
+
 void VJSWorker::_PopulateGlobalObject (XBOX::VJSContext inContext)
 {
 	XBOX::VJSObject	globalObject	= inContext.GetGlobalObject();
@@ -152,7 +152,8 @@ private:
 	bool							fClosingFlag, fExitWaitFlag;
 	XBOX::VSyncEvent				fSyncEvent;
 	bool							fIsLockedWaiting;			// True if locked waiting on fSyncEvent.
-	std::list<IJSEvent *>			fEventQueue;		
+	std::vector<IJSEvent *>			fEventQueue;				// 4-ary min heap on trigger time (then queuing order).
+	sLONG8							fEventCounter;				// Queuing order of next event.
 	std::list<VJSMessagePort *>		fMessagePorts;				// List of all message ports (any type).
 	VJSTimerContext					fTimerContext;				// All timers.
 	
@@ -182,6 +183,15 @@ private:
 	void			_AddMessagePort (std::list<VJSMessagePort *> *ioMessagePorts, VJSMessagePort *inMessagePort);
 	void			_RemoveMessagePort (std::list<VJSMessagePort *> *ioMessagePorts, VJSMessagePort *inMessagePort);
 
+	// Event heap, fMutex must be locked. Removal is by heap index (IJSEvent::fQueueIndex), there is no search.
+
+	static bool		_IsEarlier (const IJSEvent *inA, const IJSEvent *inB);
+	void			_PushEvent (IJSEvent *inEvent);
+	IJSEvent		*_PopEvent ();
+	void			_RemoveEvent (IJSEvent *inEvent);
+	void			_SiftUp (sLONG inIndex);
+	void			_SiftDown (sLONG inIndex);
+
 	// Add worker attributes and functions to global object.
 
 	void			_PopulateGlobalObject (XBOX::VJSContext inContext);
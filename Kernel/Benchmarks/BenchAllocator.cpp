@@ -0,0 +1,328 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+
+#include <stdlib.h>
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	Allocator benchmark: VCppMemMgr (process allocator, stdlib and xbox kinds) against plain malloc.
+
+	usage: BenchAllocator [-ops count] [-live count]
+
+	+ churn: random sizes from 8 to 512 bytes replacing a live set, with latency percentiles;
+	+ cross task: one task allocates, another one frees;
+	+ realloc: buffers growing by steps up to 16 MB;
+	+ VString and VValueBag: build and teardown through the process allocator (VObject).
+
+	After each allocator, the VCppMemMgr statistics (allocated, used, fragmentation) and the RSS are printed.
+*/
+
+
+class BenchAllocator
+{
+public:
+	virtual					~BenchAllocator()								{}
+	virtual	const char*		GetName() const = 0;
+	virtual	void*			Alloc( VSize inSize) = 0;
+	virtual	void*			Realloc( void *inPtr, VSize inSize) = 0;
+	virtual	void			Free( void *inPtr) = 0;
+	virtual	VCppMemMgr*		GetMemMgr() const								{ return NULL; }
+};
+
+
+class BenchMemMgrAllocator : public BenchAllocator
+{
+public:
+							BenchMemMgrAllocator( const char *inName, VCppMemMgr *inMgr, bool inOwned) : fName( inName), fMgr( inMgr), fOwned( inOwned)	{}
+	virtual					~BenchMemMgrAllocator()							{ if (fOwned) delete fMgr; }
+	virtual	const char*		GetName() const									{ return fName; }
+	virtual	void*			Alloc( VSize inSize)							{ return fMgr->Malloc( inSize, false, 'bnch'); }
+	virtual	void*			Realloc( void *inPtr, VSize inSize)				{ return fMgr->Realloc( inPtr, inSize); }
+	virtual	void			Free( void *inPtr)								{ fMgr->Free( inPtr); }
+	virtual	VCppMemMgr*		GetMemMgr() const								{ return fMgr; }
+
+private:
+	const char*				fName;
+	VCppMemMgr*				fMgr;
+	bool					fOwned;
+};
+
+
+class BenchMallocAllocator : public BenchAllocator
+{
+public:
+	virtual	const char*		GetName() const									{ return "malloc"; }
+	virtual	void*			Alloc( VSize inSize)							{ return ::malloc( inSize); }
+	virtual	void*			Realloc( void *inPtr, VSize inSize)				{ return ::realloc( inPtr, inSize); }
+	virtual	void			Free( void *inPtr)								{ ::free( inPtr); }
+};
+
+
+static void PrintMeasure( const char *inAllocator, const char *inWorkload, sLONG8 inOps, sLONG8 inNanoSeconds, std::vector<sLONG8> *inLatencies = NULL)
+{
+	::printf( "%-22s %-14s %14.0f ops/s", inAllocator, inWorkload, BenchTools::PerSecond( inOps, inNanoSeconds));
+	if (inLatencies != NULL)
+	{
+		sLONG8 p50 = BenchTools::Percentile( *inLatencies, 50.0);
+		sLONG8 p99 = BenchTools::Percentile( *inLatencies, 99.0);
+		sLONG8 p999 = BenchTools::Percentile( *inLatencies, 99.9);
+		::printf( "  p50 %6lld ns  p99 %6lld ns  p99.9 %6lld ns", (long long) p50, (long long) p99, (long long) p999);
+	}
+	::printf( "\n");
+}
+
+
+static void Churn( BenchAllocator& inAllocator, sLONG inOps, sLONG inLive)
+{
+	BenchTools::Random random;
+	std::vector<void*> live( inLive, (void*) NULL);
+	std::vector<sLONG8> latencies;
+	latencies.reserve( inOps / 16 + 1);
+
+	sLONG8 start = BenchTools::Now();
+	for (sLONG i = 0 ; i < inOps ; ++i)
+	{
+		size_t slot = random.Next() % live.size();
+		VSize size = random.Between( 8, 512);
+
+		// one operation out of 16 is timed alone, timing all of them would mostly measure the clock
+		if ((i & 15) == 0)
+		{
+			sLONG8 opStart = BenchTools::Now();
+			if (live[slot] != NULL)
+				inAllocator.Free( live[slot]);
+			live[slot] = inAllocator.Alloc( size);
+			latencies.push_back( BenchTools::Now() - opStart);
+		}
+		else
+		{
+			if (live[slot] != NULL)
+				inAllocator.Free( live[slot]);
+			live[slot] = inAllocator.Alloc( size);
+		}
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+
+	for (std::vector<void*>::iterator i = live.begin() ; i != live.end() ; ++i)
+	{
+		if (*i != NULL)
+			inAllocator.Free( *i);
+	}
+
+	PrintMeasure( inAllocator.GetName(), "churn", inOps, duration, &latencies);
+}
+
+
+class CrossTaskQueue
+{
+public:
+	CrossTaskQueue( BenchAllocator& inAllocator) : fAllocator( inAllocator), fDone( false)	{}
+
+	BenchAllocator&			fAllocator;
+	VCriticalSection		fLock;
+	std::vector<void*>		fBlocks;
+	bool					fDone;
+};
+
+
+static sLONG CrossTaskFreeProc( VTask *inTask)
+{
+	CrossTaskQueue *queue = (CrossTaskQueue*) inTask->GetKindData();
+	std::vector<void*> blocks;
+	bool done = false;
+
+	while (!done)
+	{
+		{
+			StLocker<VCriticalSection> lock( &queue->fLock);
+			blocks.swap( queue->fBlocks);
+			done = queue->fDone && blocks.empty();
+		}
+		if (blocks.empty())
+			VTask::Yield();
+		for (std::vector<void*>::iterator i = blocks.begin() ; i != blocks.end() ; ++i)
+			queue->fAllocator.Free( *i);
+		blocks.clear();
+	}
+	return 0;
+}
+
+
+static void CrossTask( BenchAllocator& inAllocator, sLONG inOps)
+{
+	const size_t kBatch = 256;
+	BenchTools::Random random;
+	CrossTaskQueue queue( inAllocator);
+	std::vector<void*> batch;
+	batch.reserve( kBatch);
+
+	VTask *freer = new VTask( NULL, 0, eTaskStylePreemptive, CrossTaskFreeProc);
+	freer->SetKindData( (sLONG_PTR) &queue);
+
+	sLONG8 start = BenchTools::Now();
+	freer->Run();
+	for (sLONG i = 0 ; i < inOps ; ++i)
+	{
+		batch.push_back( inAllocator.Alloc( random.Between( 8, 512)));
+		if (batch.size() == kBatch)
+		{
+			StLocker<VCriticalSection> lock( &queue.fLock);
+			queue.fBlocks.insert( queue.fBlocks.end(), batch.begin(), batch.end());
+			batch.clear();
+		}
+	}
+	{
+		StLocker<VCriticalSection> lock( &queue.fLock);
+		queue.fBlocks.insert( queue.fBlocks.end(), batch.begin(), batch.end());
+		queue.fDone = true;
+	}
+	while (!freer->WaitForDeath( 1000))
+		;
+	sLONG8 duration = BenchTools::Now() - start;
+	freer->Release();
+
+	PrintMeasure( inAllocator.GetName(), "cross task", inOps, duration);
+}
+
+
+static void ReallocGrowth( BenchAllocator& inAllocator, sLONG inOps)
+{
+	const VSize kMaxSize = 16 * 1024 * 1024;
+	BenchTools::Random random;
+	sLONG8 count = 0;
+	sLONG rounds = inOps / 10000 + 1;
+
+	sLONG8 start = BenchTools::Now();
+	for (sLONG round = 0 ; round < rounds ; ++round)
+	{
+		VSize size = 16;
+		void *ptr = inAllocator.Alloc( size);
+		while (ptr != NULL && size < kMaxSize)
+		{
+			// growth by about an eighth, as strings and blobs do
+			size += size / 8 + random.Between( 1, 64);
+			void *newPtr = inAllocator.Realloc( ptr, size);
+			if (newPtr == NULL)
+				break;
+			ptr = newPtr;
+			++count;
+		}
+		if (ptr != NULL)
+			inAllocator.Free( ptr);
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+
+	PrintMeasure( inAllocator.GetName(), "realloc", count, duration);
+}
+
+
+static void PrintMemory( BenchAllocator& inAllocator)
+{
+	VCppMemMgr *mgr = inAllocator.GetMemMgr();
+	if (mgr != NULL)
+	{
+		::printf( "%-22s memory         allocated %lld  used %lld  fragmentation %.3f  rss %lld\n", inAllocator.GetName(),
+			(long long) mgr->GetAllocatedMem(), (long long) mgr->GetUsedMem(), mgr->GetFragmentation(), (long long) BenchTools::GetRSS());
+	}
+	else
+	{
+		::printf( "%-22s memory         rss %lld\n", inAllocator.GetName(), (long long) BenchTools::GetRSS());
+	}
+}
+
+
+static void StringChurn( sLONG inOps)
+{
+	BenchTools::Random random;
+	std::vector<VString> live( 1024);
+
+	sLONG8 start = BenchTools::Now();
+	for (sLONG i = 0 ; i < inOps ; ++i)
+	{
+		VString& s = live[random.Next() % live.size()];
+		s.Clear();
+		sLONG length = random.Between( 1, 200);
+		for (sLONG j = 0 ; j < length ; j += 10)
+			s.AppendCString( "0123456789");
+		if ((i & 3) == 0)
+			s = VString( "/api/v1/resource/") + s;
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+
+	PrintMeasure( "VObject allocator", "VString", inOps, duration);
+}
+
+
+static void BagBuildAndTeardown( sLONG inOps)
+{
+	sLONG rounds = inOps / 100 + 1;
+
+	sLONG8 start = BenchTools::Now();
+	for (sLONG round = 0 ; round < rounds ; ++round)
+	{
+		VValueBag *bag = new VValueBag;
+		for (sLONG i = 0 ; i < 20 ; ++i)
+		{
+			VValueBag *child = new VValueBag;
+			child->SetLong( "id", i);
+			child->SetString( "name", VString( "element name"));
+			child->SetReal( "value", i * 0.5);
+			bag->AddElement( "item", child);
+			child->Release();
+		}
+		bag->Release();
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+
+	PrintMeasure( "VObject allocator", "VValueBag", rounds, duration);
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG ops = BenchTools::GetArgument( "-ops", 2000000);
+	sLONG liveCount = BenchTools::GetArgument( "-live", 10000);
+
+	std::vector<BenchAllocator*> allocators;
+	allocators.push_back( new BenchMemMgrAllocator( "VCppMemMgr (process)", VObject::GetMainMemMgr(), false));
+	allocators.push_back( new BenchMemMgrAllocator( "VCppMemMgr stdlib", new VCppMemMgr( VCppMemMgr::kAllocator_stdlib), true));
+	allocators.push_back( new BenchMemMgrAllocator( "VCppMemMgr xbox", new VCppMemMgr( VCppMemMgr::kAllocator_xbox), true));
+	allocators.push_back( new BenchMallocAllocator);
+
+	for (std::vector<BenchAllocator*>::iterator i = allocators.begin() ; i != allocators.end() ; ++i)
+	{
+		Churn( **i, ops, liveCount);
+		CrossTask( **i, ops);
+		ReallocGrowth( **i, ops);
+		PrintMemory( **i);
+		delete *i;
+	}
+
+	StringChurn( ops);
+	BagBuildAndTeardown( ops);
+
+	return 0;
+}
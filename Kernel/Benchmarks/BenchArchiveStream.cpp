@@ -0,0 +1,199 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	VArchiveStream format 4 (sequential, uncompressed) against format 5 (compressed chunks and catalog).
+
+	usage: BenchArchiveStream [-files count] [-size kilobytes]
+
+	A folder of generated files is created in the temporary folder, half of them compressible text
+	and half random bytes. For each format: archive time and size, full restore time and, for format 5
+	only, the time to extract the last file of the catalog with VArchiveUnStream::ProceedEntry().
+	The generated files and archives are deleted at the end.
+*/
+
+
+static VError WriteFile( const VFolder& inFolder, const VString& inName, const std::vector<uBYTE>& inContent)
+{
+	VFile file( inFolder, inName);
+	VFileStream stream( &file);
+	VError err = stream.OpenWriting();
+	if (err == VE_OK)
+	{
+		err = stream.PutData( &inContent[0], inContent.size());
+		VError closeErr = stream.CloseWriting();
+		if (err == VE_OK)
+			err = closeErr;
+	}
+	return err;
+}
+
+
+static VError MakeSources( const VFolder& inFolder, sLONG inFiles, VSize inSize)
+{
+	static const char sText[] = "function handler( request, response) { return response.send( { status: 'ok', items: [] }); }\n";
+	BenchTools::Random random;
+	std::vector<uBYTE> content( inSize);
+	VError err = VE_OK;
+
+	for (sLONG i = 0 ; i < inFiles && err == VE_OK ; ++i)
+	{
+		bool text = (i & 1) == 0;
+		for (VSize j = 0 ; j < inSize ; ++j)
+			content[j] = text ? (uBYTE) sText[j % (sizeof( sText) - 1)] : (uBYTE) random.Next();
+
+		VString name( text ? "text" : "random");
+		name.AppendLong( i);
+		name.AppendCString( text ? ".js" : ".bin");
+		err = WriteFile( inFolder, name, content);
+	}
+	return err;
+}
+
+
+static void Run( uBYTE inVersion, VFolder& inSources, const VFolder& inWork, sLONG inFiles)
+{
+	VString archiveName( "archive_v");
+	archiveName.AppendLong( inVersion);
+	archiveName.AppendCString( ".bak");
+	VFile archiveFile( inWork, archiveName);
+
+	// archive
+	VFilePath sourcePath( inSources.GetPath());
+	VFileStream *writeStream = new VFileStream( &archiveFile);
+	VArchiveStream *archive = new VArchiveStream;
+	archive->SetVersion( inVersion);
+	archive->SetRelativeFolderSource( sourcePath);
+	archive->SetStreamer( writeStream);
+	archive->AddFolder( &inSources);
+
+	sLONG8 start = BenchTools::Now();
+	VError err = archive->Proceed();
+	sLONG8 archiveDuration = BenchTools::Now() - start;
+
+	delete archive;
+	delete writeStream;
+
+	sLONG8 archiveSize = 0;
+	if (err == VE_OK)
+		err = archiveFile.GetSize( &archiveSize);
+
+	// full restore
+	VString restoreName( "restore_v");
+	restoreName.AppendLong( inVersion);
+	VFolder restoreFolder( inWork, restoreName);
+	sLONG8 restoreDuration = 0;
+	if (err == VE_OK)
+		err = restoreFolder.CreateRecursive();
+	if (err == VE_OK)
+	{
+		VFileStream readStream( &archiveFile);
+		VArchiveUnStream *unarchive = new VArchiveUnStream;
+		unarchive->SetDestinationFolder( &restoreFolder);
+		unarchive->SetStreamer( &readStream);
+
+		start = BenchTools::Now();
+		err = unarchive->Proceed();
+		restoreDuration = BenchTools::Now() - start;
+
+		delete unarchive;
+	}
+
+	// single entry, the last one of the catalog
+	sLONG8 entryDuration = -1;
+	if (err == VE_OK && inVersion >= 5)
+	{
+		restoreFolder.DeleteContents( true);
+
+		VFileStream readStream( &archiveFile);
+		VArchiveUnStream *unarchive = new VArchiveUnStream;
+		unarchive->SetDestinationFolder( &restoreFolder);
+		unarchive->SetStreamer( &readStream);
+
+		start = BenchTools::Now();
+		err = readStream.OpenReading();
+		if (err == VE_OK)
+		{
+			err = unarchive->ProceedCatalog();
+			ArchiveCatalog *catalog = unarchive->GetCatalog();
+			if (err == VE_OK && !catalog->empty())
+				err = unarchive->ProceedEntry( catalog->back());
+			readStream.CloseReading();
+		}
+		entryDuration = BenchTools::Now() - start;
+
+		delete unarchive;
+	}
+
+	restoreFolder.Delete( true);
+	archiveFile.Delete();
+
+	if (err != VE_OK)
+	{
+		::printf( "format %d  failed (error %lld)\n", (int) inVersion, (long long) ERRCODE_FROM_VERROR( err));
+		return;
+	}
+
+	::printf( "format %d  %4d files  archive %8.1f ms  size %12lld  restore %8.1f ms", (int) inVersion, (int) inFiles,
+		archiveDuration / 1.0e6, (long long) archiveSize, restoreDuration / 1.0e6);
+	if (entryDuration >= 0)
+		::printf( "  single entry %8.1f ms", entryDuration / 1.0e6);
+	::printf( "\n");
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG files = BenchTools::GetArgument( "-files", 200);
+	VSize size = (VSize) BenchTools::GetArgument( "-size", 256) * 1024;
+
+	VFolder *temporary = VFolder::RetainSystemFolder( eFK_Temporary, true);
+	if (temporary == NULL)
+		return 1;
+
+	VFolder work( *temporary, CVSTR( "BenchArchiveStream"));
+	VFolder sources( work, CVSTR( "sources"));
+	temporary->Release();
+
+	VError err = sources.CreateRecursive();
+	if (err == VE_OK)
+		err = MakeSources( sources, files, size);
+
+	if (err == VE_OK)
+	{
+		Run( 4, sources, work, files);
+		Run( 5, sources, work, files);
+	}
+	else
+	{
+		::printf( "could not create the source files (error %lld)\n", (long long) ERRCODE_FROM_VERROR( err));
+	}
+
+	work.Delete( true);
+
+	return (err == VE_OK) ? 0 : 1;
+}
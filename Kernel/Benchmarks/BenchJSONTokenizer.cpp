@@ -0,0 +1,196 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	JSON tokenizing throughput and peak RSS: VJSONStreamTokenizer reading a file by chunks against
+	VJSONImporter on the same document loaded in a VString.
+
+	usage: BenchJSONTokenizer [-megabytes size]
+
+	A UTF-8 JSON array of records (numbers, booleans, strings with escapes, nested arrays) of about
+	-megabytes is written in the temporary folder. The VJSONImporter run includes reading the file and
+	converting it to UTF-16, since it can't work without. Throughput is given in MB of UTF-8 input per second.
+	RSS is sampled during each run, the peak is given with its growth over the RSS at the start of the run.
+	Runs go from the least to the most memory hungry, since freed memory is not always given back to the system.
+*/
+
+
+class RSSSampler
+{
+public:
+	RSSSampler() : fStart( BenchTools::GetRSS()), fPeak( fStart)	{}
+
+	void	Sample()			{ fPeak = std::max( fPeak, BenchTools::GetRSS()); }
+	sLONG8	GetPeak() const		{ return fPeak; }
+	sLONG8	GetGrowth() const	{ return fPeak - fStart; }
+
+private:
+	sLONG8	fStart;
+	sLONG8	fPeak;
+};
+
+
+static VError WritePayload( const VFile& inFile, sLONG inMegaBytes, sLONG8& outBytes)
+{
+	static const char *sNames[] = { "Dupont", "Martin", "Durand", "Lef\xc3\xa8vre", "Moreau", "Fran\xc3\xa7ois" };
+	BenchTools::Random random;
+	sLONG8 target = (sLONG8) inMegaBytes * 1024 * 1024;
+	char record[512];
+
+	VFileStream stream( &inFile);
+	VError err = stream.OpenWriting();
+	if (err == VE_OK)
+		err = stream.PutData( "[", 1);
+	for (sLONG i = 0 ; (stream.GetSize() < target) && (err == VE_OK) ; ++i)
+	{
+		uLONG balance = random.Next() % 1000000;
+		int size = ::sprintf( record,
+			"%s{\"id\":%d,\"name\":\"%s %d\",\"email\":\"customer%d@example.com\",\"active\":%s,\"balance\":%u.%02u,"
+			"\"tags\":[\"retail\",\"zone-%u\",null],\"note\":\"first line\\nsecond \\\"quoted\\\" line \\u00e9\\t%u\"}",
+			(i == 0) ? "" : ",\n", (int) i, sNames[random.Next() % 6], (int) i, (int) i, (random.Next() & 1) ? "true" : "false",
+			(unsigned int) (balance / 100), (unsigned int) (balance % 100), (unsigned int) (random.Next() % 50), (unsigned int) random.Next());
+		err = stream.PutData( record, size);
+	}
+	if (err == VE_OK)
+		err = stream.PutData( "]\n", 2);
+	outBytes = stream.GetSize();
+	VError closeErr = stream.CloseWriting();
+	return (err == VE_OK) ? closeErr : err;
+}
+
+
+static void Print( const char *inName, sLONG8 inBytes, sLONG8 inDuration, sLONG8 inTokens, const RSSSampler& inRSS, VError inError)
+{
+	::printf( "%-28s %8.1f MB/s  %10lld tokens  peak RSS %7lld MB (+%lld MB)", inName,
+		BenchTools::PerSecond( inBytes, inDuration) / (1024.0 * 1024.0), (long long) inTokens,
+		(long long) (inRSS.GetPeak() / (1024 * 1024)), (long long) (inRSS.GetGrowth() / (1024 * 1024)));
+	if (inError != VE_OK)
+		::printf( "  (error %lld)", (long long) ERRCODE_FROM_VERROR( inError));
+	::printf( "\n");
+}
+
+
+static sLONG8 RunStreamTokenizer( const char *inName, const VFile& inFile, sLONG8 inBytes, bool inDecodeStrings)
+{
+	RSSSampler rss;
+	sLONG8 tokens = 0;
+	VString value;
+
+	sLONG8 start = BenchTools::Now();
+	VFileStream stream( &inFile);
+	VError err = stream.OpenReading();
+	if (err == VE_OK)
+	{
+		VJSONStreamTokenizer tokenizer( &stream);
+		for (VJSONImporter::JsonToken token = tokenizer.GetNextToken() ; token != VJSONImporter::jsonNone ; token = tokenizer.GetNextToken())
+		{
+			if (inDecodeStrings && (token == VJSONImporter::jsonString))
+				tokenizer.GetTokenString( value);
+			if ((++tokens & 0xFFFF) == 0)
+				rss.Sample();
+		}
+		err = tokenizer.GetLastError();
+		stream.CloseReading();
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+	rss.Sample();
+
+	Print( inName, inBytes, duration, tokens, rss, err);
+	return tokens;
+}
+
+
+static sLONG8 RunImporter( const VFile& inFile, sLONG8 inBytes)
+{
+	RSSSampler rss;
+	sLONG8 tokens = 0;
+
+	sLONG8 start = BenchTools::Now();
+	VString json;
+	VError err;
+	{
+		VFileStream stream( &inFile);
+		err = stream.OpenReading();
+		if (err == VE_OK)
+		{
+			std::vector<char> data( (size_t) inBytes);
+			err = stream.GetData( &data[0], data.size());
+			stream.CloseReading();
+			if (err == VE_OK)
+				json.FromBlock( &data[0], data.size(), VTC_UTF_8);
+			rss.Sample();
+		}
+	}
+
+	if (err == VE_OK)
+	{
+		VJSONImporter importer( json);
+		VString value;
+		bool isQuoted;
+		while (importer.GetNextJSONToken( value, &isQuoted) != VJSONImporter::jsonNone)
+		{
+			if ((++tokens & 0xFFFF) == 0)
+				rss.Sample();
+		}
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+	rss.Sample();
+
+	Print( "VJSONImporter", inBytes, duration, tokens, rss, err);
+	return tokens;
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG megaBytes = BenchTools::GetArgument( "-megabytes", 100);
+
+	VFolder *temporary = VFolder::RetainSystemFolder( eFK_Temporary, true);
+	if (temporary == NULL)
+		return 1;
+	VFile file( *temporary, CVSTR( "BenchJSONTokenizer.json"));
+	temporary->Release();
+
+	sLONG8 bytes = 0;
+	VError err = WritePayload( file, megaBytes, bytes);
+	if (err == VE_OK)
+	{
+		sLONG8 streamTokens = RunStreamTokenizer( "VJSONStreamTokenizer", file, bytes, false);
+		RunStreamTokenizer( "VJSONStreamTokenizer decoded", file, bytes, true);
+		sLONG8 importerTokens = RunImporter( file, bytes);
+		if (streamTokens != importerTokens)
+			::printf( "TOKEN COUNT MISMATCH\n");
+	}
+	else
+	{
+		::printf( "could not write the test file (error %lld)\n", (long long) ERRCODE_FROM_VERROR( err));
+	}
+
+	file.Delete();
+
+	return (err == VE_OK) ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	VMessageQueue posts per second with 1, 8 and 64 producer tasks and a single consumer.
+
+	usage: BenchMessageQueue [-posts count]
+
+	Plain messages take the lock free inbox. Messages with a coalescing signature go through the critical
+	section and the coalescing index (DoCoalesce accepts every message, so all of them are queued).
+	"post" is the rate seen by the producers, "end to end" runs until the consumer got every message.
+*/
+
+
+class VBenchCoalescingMessage : public VMessage
+{
+public:
+	virtual	OsType		GetCoalescingSignature() const				{ return 'bnch'; }
+
+protected:
+	virtual	bool		DoCoalesce( const VMessage& /*inNewMessage*/)	{ return true; }
+};
+
+
+class BenchProducers
+{
+public:
+	BenchProducers( VMessageQueue& inQueue, sLONG inPostsPerProducer, bool inCoalescing)
+		: fQueue( inQueue), fPostsPerProducer( inPostsPerProducer), fCoalescing( inCoalescing), fStarted( 0), fRunning( 0)	{}
+
+	VMessageQueue&		fQueue;
+	sLONG				fPostsPerProducer;
+	bool				fCoalescing;
+	sLONG				fStarted;		// producers wait for it to be set so that they start together
+	sLONG				fRunning;
+};
+
+
+static sLONG ProducerProc( VTask *inTask)
+{
+	BenchProducers *producers = (BenchProducers*) inTask->GetKindData();
+
+	while (VInterlocked::AtomicGet( &producers->fStarted) == 0)
+		VTask::Yield();
+
+	for (sLONG i = 0 ; i < producers->fPostsPerProducer ; ++i)
+	{
+		VMessage *message = producers->fCoalescing ? new VBenchCoalescingMessage : new VMessage;
+		producers->fQueue.AddMessage( message);
+		message->Release();
+	}
+
+	VInterlocked::Decrement( &producers->fRunning);
+	return 0;
+}
+
+
+static void Run( sLONG inProducerCount, sLONG inPosts, bool inCoalescing)
+{
+	VMessageQueue queue;
+	BenchProducers producers( queue, inPosts / inProducerCount, inCoalescing);
+	sLONG total = producers.fPostsPerProducer * inProducerCount;
+
+	std::vector<VTask*> tasks;
+	for (sLONG i = 0 ; i < inProducerCount ; ++i)
+	{
+		VTask *task = new VTask( NULL, 0, eTaskStylePreemptive, ProducerProc);
+		task->SetKindData( (sLONG_PTR) &producers);
+		VInterlocked::Increment( &producers.fRunning);
+		task->Run();
+		tasks.push_back( task);
+	}
+
+	sLONG8 start = BenchTools::Now();
+	sLONG8 postDuration = 0;
+	VInterlocked::Exchange( &producers.fStarted, 1);
+
+	sLONG received = 0;
+	while (received < total)
+	{
+		VMessage *message = queue.RetainMessageWithTimeout( 100);
+		if (message != NULL)
+		{
+			++received;
+			message->Release();
+		}
+		if (postDuration == 0 && VInterlocked::AtomicGet( &producers.fRunning) == 0)
+			postDuration = BenchTools::Now() - start;
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+	if (postDuration == 0)
+		postDuration = duration;
+
+	for (std::vector<VTask*>::iterator i = tasks.begin() ; i != tasks.end() ; ++i)
+	{
+		while (!(*i)->WaitForDeath( 1000))
+			;
+		(*i)->Release();
+	}
+
+	::printf( "%-10s %3d producers  post %12.0f msg/s  end to end %12.0f msg/s\n", inCoalescing ? "coalescing" : "plain", (int) inProducerCount,
+		BenchTools::PerSecond( total, postDuration), BenchTools::PerSecond( total, duration));
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG posts = BenchTools::GetArgument( "-posts", 1000000);
+	static const sLONG sProducerCounts[] = { 1, 8, 64 };
+
+	for (size_t i = 0 ; i < sizeof( sProducerCounts) / sizeof( sLONG) ; ++i)
+		Run( sProducerCounts[i], posts, false);
+	for (size_t i = 0 ; i < sizeof( sProducerCounts) / sizeof( sLONG) ; ++i)
+		Run( sProducerCounts[i], posts, true);
+
+	return 0;
+}
@@ -0,0 +1,165 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	Sequential read throughput of a VFileStream alone and wrapped in a VPrefetchStream.
+
+	usage: BenchPrefetchStream [-size megabytes] [-chunk bytes] [-work rounds]
+
+	A file of the given size is written in the temporary folder, then read in chunks, each chunk going
+	through -work rounds of checksum to stand for the reader processing. The read ahead only pays when
+	the reader has work to overlap with the reads: with -work 0 and a file in the system cache, both
+	should be close. For VPrefetchStream, the prefetched bytes and the reader stalls are printed too.
+	Drop the system cache between runs to measure cold reads.
+*/
+
+
+static uLONG Process( const std::vector<uBYTE>& inChunk, VSize inCount, sLONG inWork)
+{
+	uLONG sum = 0;
+	for (sLONG round = 0 ; round <= inWork ; ++round)
+	{
+		for (VSize i = 0 ; i < inCount ; ++i)
+			sum = sum * 31 + inChunk[i];
+	}
+	return sum;
+}
+
+
+static VError ReadAll( VStream& inStream, VSize inChunkSize, sLONG inWork, sLONG8& outBytes, uLONG& outSum)
+{
+	std::vector<uBYTE> chunk( inChunkSize);
+	outBytes = 0;
+	outSum = 0;
+
+	// reads up to the size rather than until VE_STREAM_EOF, which would be thrown
+	VError err = inStream.OpenReading();
+	sLONG8 size = (err == VE_OK) ? inStream.GetSize() : 0;
+	while (err == VE_OK && outBytes < size)
+	{
+		VSize count = (VSize) std::min( (sLONG8) inChunkSize, size - outBytes);
+		err = inStream.GetData( &chunk[0], &count);
+		outBytes += count;
+		outSum += Process( chunk, count, inWork);
+	}
+	inStream.CloseReading();
+	return err;
+}
+
+
+static void PrintMeasure( const char *inName, VError inErr, sLONG8 inBytes, sLONG8 inNanoSeconds, uLONG inSum)
+{
+	if (inErr != VE_OK)
+		::printf( "%-28s failed (error %lld)", inName, (long long) ERRCODE_FROM_VERROR( inErr));
+	else
+		::printf( "%-28s %8.1f MB/s  (%u)", inName, BenchTools::PerSecond( inBytes, inNanoSeconds) / (1024.0 * 1024.0), (unsigned int) (inSum & 1));
+}
+
+
+static void RunFileStream( const VFile& inFile, VSize inChunkSize, sLONG inWork)
+{
+	VFileStream stream( &inFile);
+	sLONG8 bytes;
+	uLONG sum;
+
+	sLONG8 start = BenchTools::Now();
+	VError err = ReadAll( stream, inChunkSize, inWork, bytes, sum);
+	sLONG8 duration = BenchTools::Now() - start;
+
+	PrintMeasure( "VFileStream", err, bytes, duration, sum);
+	::printf( "\n");
+}
+
+
+static void RunPrefetchStream( const VFile& inFile, VSize inChunkSize, sLONG inWork, VSize inBufferSize, sLONG inQueueDepth)
+{
+	VPrefetchStream stream( new VFileStream( &inFile), true, inBufferSize, inQueueDepth);
+	sLONG8 bytes;
+	uLONG sum;
+
+	sLONG8 start = BenchTools::Now();
+	VError err = ReadAll( stream, inChunkSize, inWork, bytes, sum);
+	sLONG8 duration = BenchTools::Now() - start;
+
+	char name[64];
+	::snprintf( name, sizeof( name), "VPrefetchStream %4dK x %d", (int) (inBufferSize / 1024), (int) inQueueDepth);
+	PrintMeasure( name, err, bytes, duration, sum);
+	if (err == VE_OK)
+	{
+		::printf( "  prefetched %12lld  stalls %6d  stalled %6u ms", (long long) stream.GetPrefetchedBytes(),
+			(int) stream.GetStallCount(), (unsigned int) stream.GetStallMilliseconds());
+	}
+	::printf( "\n");
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	VSize size = (VSize) BenchTools::GetArgument( "-size", 256) * 1024 * 1024;
+	VSize chunkSize = (VSize) BenchTools::GetArgument( "-chunk", 4096);
+	sLONG work = BenchTools::GetArgument( "-work", 1);
+
+	VFolder *temporary = VFolder::RetainSystemFolder( eFK_Temporary, true);
+	if (temporary == NULL)
+		return 1;
+	VFile file( *temporary, CVSTR( "BenchPrefetchStream.bin"));
+	temporary->Release();
+
+	VError err;
+	{
+		BenchTools::Random random;
+		std::vector<uLONG> block( 256 * 1024 / sizeof( uLONG));
+		VFileStream stream( &file);
+		err = stream.OpenWriting();
+		for (VSize written = 0 ; written < size && err == VE_OK ; written += block.size() * sizeof( uLONG))
+		{
+			for (std::vector<uLONG>::iterator i = block.begin() ; i != block.end() ; ++i)
+				*i = random.Next();
+			err = stream.PutData( &block[0], block.size() * sizeof( uLONG));
+		}
+		VError closeErr = stream.CloseWriting();
+		if (err == VE_OK)
+			err = closeErr;
+	}
+
+	if (err == VE_OK)
+	{
+		RunFileStream( file, chunkSize, work);
+		RunPrefetchStream( file, chunkSize, work, VPrefetchStream::kDefaultBufferSize, VPrefetchStream::kDefaultQueueDepth);
+		RunPrefetchStream( file, chunkSize, work, VPrefetchStream::kDefaultBufferSize, 4);
+		RunPrefetchStream( file, chunkSize, work, 1024 * 1024, 2);
+		RunPrefetchStream( file, chunkSize, work, 64 * 1024, 8);
+	}
+	else
+	{
+		::printf( "could not write the test file (error %lld)\n", (long long) ERRCODE_FROM_VERROR( err));
+	}
+
+	file.Delete();
+
+	return (err == VE_OK) ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	VString search and replace throughput on multi-megabyte strings: FindRawString() and Find() over every
+	match, ExchangeRawString() and Exchange() of every match, against one Replace() per match.
+
+	usage: BenchStringExchange [-megabytes size] [-spacing unichars]
+
+	The text is made of words separated by spaces, with the pattern inserted about every -spacing UniChars.
+	The Replace() loop is what Exchange() did before it collected the matches first: each match moves
+	the rest of the string, so it is quadratic in the number of matches.
+	Throughput is given in MB of UTF-16 per second, with the number of matches.
+*/
+
+
+static const char sPattern[] = "{{placeholder}}";
+static const char sReplacement[] = "a longer replacement value";
+
+
+static void MakeText( VString& outText, sLONG inMegaBytes, sLONG inSpacing)
+{
+	static const char *sWords[] = { "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit", "sed", "eiusmod" };
+	BenchTools::Random random;
+	VIndex length = (VIndex) inMegaBytes * 1024 * 1024 / sizeof( UniChar);
+	VIndex nextPattern = inSpacing;
+
+	outText.Clear();
+	outText.EnsureSize( length + 64);
+	while (outText.GetLength() < length)
+	{
+		if (outText.GetLength() >= nextPattern)
+		{
+			outText.AppendCString( sPattern);
+			nextPattern += random.Between( inSpacing / 2, inSpacing + inSpacing / 2);
+		}
+		else
+		{
+			outText.AppendCString( sWords[random.Next() % 10]);
+		}
+		outText.AppendUniChar( ' ');
+	}
+}
+
+
+static void Print( const char *inName, const VString& inText, sLONG8 inDuration, VIndex inMatches)
+{
+	::printf( "%-20s %8.1f MB/s  %8d matches\n", inName,
+		BenchTools::PerSecond( (sLONG8) inText.GetLength() * sizeof( UniChar), inDuration) / (1024.0 * 1024.0), (int) inMatches);
+}
+
+
+static void RunFindRawString( const VString& inText, const VString& inPattern)
+{
+	VIndex matches = 0;
+	sLONG8 start = BenchTools::Now();
+	for (VIndex pos = 0 ; pos < inText.GetLength() ; )
+	{
+		sLONG found = VString::FindRawString( inText.GetCPointer() + pos, inText.GetLength() - pos, inPattern.GetCPointer(), inPattern.GetLength());
+		if (found <= 0)
+			break;
+		++matches;
+		pos += found - 1 + inPattern.GetLength();
+	}
+	Print( "FindRawString", inText, BenchTools::Now() - start, matches);
+}
+
+
+static void RunFind( const VString& inText, const VString& inPattern)
+{
+	VIndex matches = 0;
+	sLONG8 start = BenchTools::Now();
+	for (VIndex pos = 1 ; pos <= inText.GetLength() ; )
+	{
+		VIndex found = inText.Find( inPattern, pos);
+		if (found <= 0)
+			break;
+		++matches;
+		pos = found + inPattern.GetLength();
+	}
+	Print( "Find", inText, BenchTools::Now() - start, matches);
+}
+
+
+static VIndex CountMatches( const VString& inText, const VString& inReplacement)
+{
+	VIndex matches = 0;
+	for (VIndex pos = 0 ; pos < inText.GetLength() ; )
+	{
+		sLONG found = VString::FindRawString( inText.GetCPointer() + pos, inText.GetLength() - pos, inReplacement.GetCPointer(), inReplacement.GetLength());
+		if (found <= 0)
+			break;
+		++matches;
+		pos += found - 1 + inReplacement.GetLength();
+	}
+	return matches;
+}
+
+
+static void RunExchangeRawString( const VString& inText, const VString& inPattern, const VString& inReplacement)
+{
+	VString text( inText);
+	sLONG8 start = BenchTools::Now();
+	text.ExchangeRawString( inPattern, inReplacement, 1, kMAX_VIndex);
+	Print( "ExchangeRawString", inText, BenchTools::Now() - start, CountMatches( text, inReplacement));
+}
+
+
+static void RunExchange( const VString& inText, const VString& inPattern, const VString& inReplacement)
+{
+	VString text( inText);
+	sLONG8 start = BenchTools::Now();
+	text.ExchangeAll( inPattern, inReplacement);
+	Print( "Exchange", inText, BenchTools::Now() - start, CountMatches( text, inReplacement));
+}
+
+
+static void RunReplacePerMatch( const VString& inText, const VString& inPattern, const VString& inReplacement)
+{
+	VString text( inText);
+	sLONG8 start = BenchTools::Now();
+	for (VIndex pos = 1 ; pos <= text.GetLength() ; )
+	{
+		VIndex found = text.Find( inPattern, pos);
+		if (found <= 0)
+			break;
+		text.Replace( inReplacement, found, inPattern.GetLength());
+		pos = found + inReplacement.GetLength();
+	}
+	Print( "Replace per match", inText, BenchTools::Now() - start, CountMatches( text, inReplacement));
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG megaBytes = BenchTools::GetArgument( "-megabytes", 8);
+	sLONG spacing = std::max( BenchTools::GetArgument( "-spacing", 4096), (sLONG) 2);
+
+	VString text;
+	MakeText( text, megaBytes, spacing);
+	VString pattern( sPattern);
+	VString replacement( sReplacement);
+
+	RunFindRawString( text, pattern);
+	RunFind( text, pattern);
+	RunExchangeRawString( text, pattern, replacement);
+	RunExchange( text, pattern, replacement);
+	RunReplacePerMatch( text, pattern, replacement);
+
+	return 0;
+}
@@ -0,0 +1,204 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+#include "Kernel/Sources/MurmurHash.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	VString::GetHashValue() collision rate and throughput on URL, file path and JSON key corpora,
+	against the previous hash that only sampled the first and last 8 UniChars, and against MurmurHash2
+	of the full content (what GetHashValue() uses on 32-bit targets).
+
+	usage: BenchStringHash [-count strings] [-rounds count]
+
+	For each corpus and hash: the ratio of strings sharing their full 32 bits hash with another one,
+	the longest chain and the share of strings in a collided bucket of a power of two table
+	(as VString keyed hash containers use), and the hashing throughput in MB of UTF-16 per second.
+*/
+
+
+// GetHashValue() before it hashed the full content, kept as the baseline.
+static uLONG SampledHash( const VString& inString)
+{
+	uLONG stringLength = inString.GetLength();
+	uLONG result = stringLength;
+	const UniChar *uContents = inString.GetCPointer();
+	if (stringLength <= 16)
+	{
+		for (uLONG i = 0 ; i < stringLength ; ++i)
+			result = result * 257 + uContents[i];
+	}
+	else
+	{
+		for (uLONG i = 0 ; i < 8 ; ++i)
+			result = result * 257 + uContents[i];
+		for (uLONG i = stringLength - 8 ; i < stringLength ; ++i)
+			result = result * 257 + uContents[i];
+	}
+	result += (result << (stringLength & 31));
+	return result;
+}
+
+
+static uLONG Murmur2Hash( const VString& inString)
+{
+	uLONG stringLength = inString.GetLength();
+	return (uLONG) MurmurHash2( inString.GetCPointer(), (int) (stringLength * sizeof( UniChar)), stringLength);
+}
+
+
+static uLONG FullHash( const VString& inString)
+{
+	return inString.GetHashValue();
+}
+
+
+typedef uLONG (*HashProc)( const VString& inString);
+
+
+static void MakeURLs( std::vector<VString>& outStrings, sLONG inCount)
+{
+	BenchTools::Random random;
+	outStrings.clear();
+	for (sLONG i = 0 ; i < inCount ; ++i)
+	{
+		VString s( "/rest/v1/customers/");
+		s.AppendLong( random.Between( 1, 99999));
+		s.AppendCString( "/orders/");
+		s.AppendLong( i);
+		s.AppendCString( "/items.json");
+		outStrings.push_back( s);
+	}
+}
+
+
+static void MakePaths( std::vector<VString>& outStrings, sLONG inCount)
+{
+	static const char *sFolders[] = { "scripts", "styles", "images", "modules", "models", "views" };
+	BenchTools::Random random;
+	outStrings.clear();
+	for (sLONG i = 0 ; i < inCount ; ++i)
+	{
+		VString s( "/var/lib/wakanda/solutions/");
+		s.AppendCString( sFolders[random.Next() % 6]);
+		s.AppendCString( "/project");
+		s.AppendLong( i % 50);
+		s.AppendCString( "/component");
+		s.AppendLong( i);
+		s.AppendCString( "/index.html");
+		outStrings.push_back( s);
+	}
+}
+
+
+static void MakeJSONKeys( std::vector<VString>& outStrings, sLONG inCount)
+{
+	outStrings.clear();
+	for (sLONG i = 0 ; i < inCount ; ++i)
+	{
+		VString s( "customerBillingAddress_");
+		s.AppendLong( i);
+		s.AppendCString( "_postalCodeValue");
+		outStrings.push_back( s);
+	}
+}
+
+
+static void Run( const char *inCorpus, const char *inHashName, HashProc inHash, const std::vector<VString>& inStrings, sLONG inRounds)
+{
+	std::vector<uLONG> hashes( inStrings.size());
+	VSize bytes = 0;
+	for (size_t i = 0 ; i < inStrings.size() ; ++i)
+	{
+		hashes[i] = inHash( inStrings[i]);
+		bytes += inStrings[i].GetLength() * sizeof( UniChar);
+	}
+
+	// strings whose full hash is shared with another string
+	std::vector<uLONG> sorted( hashes);
+	std::sort( sorted.begin(), sorted.end());
+	size_t shared = 0;
+	for (size_t i = 0 ; i < sorted.size() ; ++i)
+	{
+		if ((i > 0 && sorted[i] == sorted[i-1]) || (i + 1 < sorted.size() && sorted[i] == sorted[i+1]))
+			++shared;
+	}
+
+	// buckets of the smallest power of two table not below the string count
+	size_t tableSize = 1;
+	while (tableSize < hashes.size())
+		tableSize <<= 1;
+	std::vector<sLONG> buckets( tableSize, 0);
+	for (size_t i = 0 ; i < hashes.size() ; ++i)
+		++buckets[hashes[i] & (tableSize - 1)];
+	sLONG longestChain = 0;
+	size_t inCollidedBuckets = 0;
+	for (size_t i = 0 ; i < buckets.size() ; ++i)
+	{
+		longestChain = std::max( longestChain, buckets[i]);
+		if (buckets[i] > 1)
+			inCollidedBuckets += buckets[i];
+	}
+
+	uLONG sink = 0;
+	sLONG8 start = BenchTools::Now();
+	for (sLONG round = 0 ; round < inRounds ; ++round)
+	{
+		for (std::vector<VString>::const_iterator i = inStrings.begin() ; i != inStrings.end() ; ++i)
+			sink += inHash( *i);
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+
+	::printf( "%-10s %-8s  shared hash %6.2f%%  longest chain %5d  in collided buckets %6.2f%%  %8.1f MB/s  (%u)\n",
+		inCorpus, inHashName,
+		100.0 * shared / (Real) hashes.size(), (int) longestChain, 100.0 * inCollidedBuckets / (Real) hashes.size(),
+		BenchTools::PerSecond( (sLONG8) bytes * inRounds, duration) / (1024.0 * 1024.0), (unsigned int) (sink & 1));
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG count = BenchTools::GetArgument( "-count", 200000);
+	sLONG rounds = BenchTools::GetArgument( "-rounds", 20);
+
+	std::vector<VString> strings;
+
+	MakeURLs( strings, count);
+	Run( "URL", "sampled", SampledHash, strings, rounds);
+	Run( "URL", "murmur2", Murmur2Hash, strings, rounds);
+	Run( "URL", "full", FullHash, strings, rounds);
+
+	MakePaths( strings, count);
+	Run( "path", "sampled", SampledHash, strings, rounds);
+	Run( "path", "murmur2", Murmur2Hash, strings, rounds);
+	Run( "path", "full", FullHash, strings, rounds);
+
+	MakeJSONKeys( strings, count);
+	Run( "JSON key", "sampled", SampledHash, strings, rounds);
+	Run( "JSON key", "murmur2", Murmur2Hash, strings, rounds);
+	Run( "JSON key", "full", FullHash, strings, rounds);
+
+	return 0;
+}
@@ -0,0 +1,137 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	UTF-8 <-> UTF-16 transcoding throughput of VToUnicodeConverter_UTF8 and VFromUnicodeConverter_UTF8.
+
+	usage: BenchTextConverter [-size megabytes] [-rounds count]
+
+	Three generated corpora: ASCII (JSON like), Latin (western european text, about one accented letter
+	in eight) and CJK (ideographs and kana with ASCII punctuation). Each one is encoded to UTF-8 and decoded
+	back, the decoded text is checked against the original. Throughput is given in MB of UTF-8 per second.
+*/
+
+
+static void MakeASCII( std::vector<UniChar>& outText, size_t inChars)
+{
+	static const char sPattern[] = "{\"id\": 4521, \"name\": \"quick brown fox\", \"path\": \"/api/v1/items\", \"tags\": [\"a\", \"b\"]}\n";
+	outText.resize( inChars);
+	for (size_t i = 0 ; i < inChars ; ++i)
+		outText[i] = (UniChar) sPattern[i % (sizeof( sPattern) - 1)];
+}
+
+
+static void MakeLatin( std::vector<UniChar>& outText, size_t inChars)
+{
+	static const UniChar sAccented[] = { 0x00E9, 0x00E8, 0x00E0, 0x00E7, 0x00F4, 0x00FC, 0x00F6, 0x00DF, 0x00F1, 0x00C9 };
+	BenchTools::Random random;
+	outText.resize( inChars);
+	for (size_t i = 0 ; i < inChars ; ++i)
+	{
+		uLONG r = random.Next();
+		if ((r & 7) == 0)
+			outText[i] = sAccented[(r >> 3) % (sizeof( sAccented) / sizeof( UniChar))];
+		else if ((r & 7) == 1)
+			outText[i] = ' ';
+		else
+			outText[i] = (UniChar) ('a' + (r >> 3) % 26);
+	}
+}
+
+
+static void MakeCJK( std::vector<UniChar>& outText, size_t inChars)
+{
+	BenchTools::Random random;
+	outText.resize( inChars);
+	for (size_t i = 0 ; i < inChars ; ++i)
+	{
+		uLONG r = random.Next();
+		if ((r & 15) == 0)
+			outText[i] = (UniChar) ((r & 16) ? ',' : ' ');
+		else if ((r & 15) < 4)
+			outText[i] = (UniChar) (0x3041 + (r >> 4) % 0x56);		// hiragana
+		else
+			outText[i] = (UniChar) (0x4E00 + (r >> 4) % 0x5000);	// CJK unified ideographs
+	}
+}
+
+
+static void Run( const char *inName, const std::vector<UniChar>& inText, sLONG inRounds)
+{
+	VFromUnicodeConverter_UTF8 *encoder = new VFromUnicodeConverter_UTF8;
+	VToUnicodeConverter_UTF8 *decoder = new VToUnicodeConverter_UTF8;
+
+	std::vector<uBYTE> utf8( inText.size() * 3);
+	std::vector<UniChar> decoded( inText.size());
+	VIndex consumedChars = 0;
+	VSize producedBytes = 0;
+	VSize consumedBytes = 0;
+	VIndex producedChars = 0;
+
+	sLONG8 start = BenchTools::Now();
+	for (sLONG i = 0 ; i < inRounds ; ++i)
+		encoder->Convert( &inText[0], (VIndex) inText.size(), &consumedChars, &utf8[0], utf8.size(), &producedBytes);
+	sLONG8 encodeDuration = BenchTools::Now() - start;
+
+	start = BenchTools::Now();
+	for (sLONG i = 0 ; i < inRounds ; ++i)
+		decoder->Convert( &utf8[0], producedBytes, &consumedBytes, &decoded[0], (VIndex) decoded.size(), &producedChars);
+	sLONG8 decodeDuration = BenchTools::Now() - start;
+
+	bool ok = (consumedChars == (VIndex) inText.size()) && (producedChars == (VIndex) inText.size())
+			&& std::equal( inText.begin(), inText.end(), decoded.begin());
+
+	Real megabytes = (Real) producedBytes * inRounds / (1024.0 * 1024.0);
+	::printf( "%-6s %10lld UTF-8 bytes  encode %9.1f MB/s  decode %9.1f MB/s%s\n", inName, (long long) producedBytes,
+		megabytes * 1.0e9 / (Real) (encodeDuration > 0 ? encodeDuration : 1),
+		megabytes * 1.0e9 / (Real) (decodeDuration > 0 ? decodeDuration : 1),
+		ok ? "" : "  ROUND TRIP MISMATCH");
+
+	encoder->Release();
+	decoder->Release();
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	size_t chars = (size_t) BenchTools::GetArgument( "-size", 16) * 1024 * 1024;
+	sLONG rounds = BenchTools::GetArgument( "-rounds", 10);
+
+	std::vector<UniChar> text;
+
+	MakeASCII( text, chars);
+	Run( "ASCII", text, rounds);
+
+	MakeLatin( text, chars);
+	Run( "Latin", text, rounds);
+
+	// CJK chars take 3 bytes in UTF-8, keep about the same amount of UTF-8
+	MakeCJK( text, chars / 3);
+	Run( "CJK", text, rounds);
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#ifndef __BenchTools__
+#define __BenchTools__
+
+#include "Kernel/VKernel.h"
+
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+/*
+	Helpers shared by the benchmark programs.
+
+	Benchmarks are built with the XTOOLBOX_BENCHMARKS CMake option, one program per source file found
+	in the Benchmarks folder of each component. They print one line per measure on stdout.
+*/
+namespace BenchTools
+{
+	// Nanoseconds from the profiling counter.
+	inline sLONG8 Now()
+	{
+		sLONG8 counter;
+		XBOX::VSystem::GetProfilingCounter( counter);
+		return (sLONG8) ((Real) counter * 1.0e9 / (Real) XBOX::VSystem::GetProfilingFrequency());
+	}
+
+	// Operations (or bytes) per second.
+	inline Real PerSecond( sLONG8 inCount, sLONG8 inNanoSeconds)
+	{
+		return (inNanoSeconds > 0) ? (Real) inCount * 1.0e9 / (Real) inNanoSeconds : 0.0;
+	}
+
+	// inPercent in [0, 100]; sorts ioSamples.
+	inline sLONG8 Percentile( std::vector<sLONG8>& ioSamples, Real inPercent)
+	{
+		if (ioSamples.empty())
+			return 0;
+		std::sort( ioSamples.begin(), ioSamples.end());
+		size_t index = (size_t) ((Real) (ioSamples.size() - 1) * inPercent / 100.0);
+		return ioSamples[index];
+	}
+
+	// Resident set size of the process in bytes, 0 if unknown.
+	inline sLONG8 GetRSS()
+	{
+		return XBOX::VSystem::GetApplicationPhysicalMemSize();
+	}
+
+	// Integer argument from the command line ("-name value"), or inDefault.
+	inline sLONG GetArgument( const char *inName, sLONG inDefault)
+	{
+		sLONG value;
+		return XBOX::VProcess::GetCommandLineArgumentAsLong( inName, &value) ? value : inDefault;
+	}
+
+	// Deterministic pseudo random generator (xorshift), so that runs are comparable.
+	class Random
+	{
+	public:
+		explicit Random( uLONG inSeed = 2463534242UL) : fState( inSeed ? inSeed : 1)	{}
+
+		uLONG	Next()
+		{
+			fState ^= fState << 13;
+			fState ^= fState >> 17;
+			fState ^= fState << 5;
+			return fState;
+		}
+
+		// in [inMin, inMax]
+		uLONG	Between( uLONG inMin, uLONG inMax)	{ return inMin + Next() % (inMax - inMin + 1); }
+
+	private:
+		uLONG	fState;
+	};
+}
+
+
+#endif
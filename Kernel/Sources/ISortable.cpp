@@ -16,6 +16,16 @@
 #include "VKernelPrecompiled.h"
 #include "ISortable.h"
 #include "VMemoryCpp.h"
+#include "VSystem.h"
+
+
+// Below this count MultiCriteriaQSort doesn't bother extracting keys
+#define kKEY_SORT_THRESHOLD	64
+
+// Parts of a parallel sort are at least that large
+#define kMIN_SORT_PART_SIZE	(64 * 1024)
+
+#define kMAX_SORT_PARTS		16
 
 
 ISortable::ISortable()
@@ -99,6 +109,9 @@ void ISortable::MultiCriteriaQSort(ISortable** inArrays, Boolean* inInvert, sLON
 	for (i = 0; i < nb; i++)
 		datas[i] = inArrays[i]->LockAndGetData();
 	
+	if ((inTo - inFrom >= kKEY_SORT_THRESHOLD) && MultiCriteriaKeySort(inArrays, datas, inInvert, inMultiCriteriaLevel, inFrom, inTo))
+		goto done;
+
 	stkptr = 0;						/* initialize stack */
 
     lo = inFrom;
@@ -205,3 +218,141 @@ done:
 }
 
 
+/*
+	Stable LSD radix sort of ioOrder (indexes into inKeys) on the bytes of the keys.
+	ioBuffer is as large as ioOrder. Returns the array holding the result (ioOrder or ioBuffer).
+*/
+static sLONG* _RadixSortOrder(const uLONG8* inKeys, sLONG* ioOrder, sLONG* ioBuffer, sLONG inCount)
+{
+	sLONG counts[8][256];
+	::memset(counts, 0, sizeof(counts));
+
+	for (sLONG i = 0; i < inCount; i++)
+	{
+		uLONG8 key = inKeys[i];
+		for (sLONG digit = 0; digit < 8; digit++)
+			++counts[digit][(key >> (8 * digit)) & 0xFF];
+	}
+
+	sLONG* source = ioOrder;
+	sLONG* destination = ioBuffer;
+	for (sLONG digit = 0; digit < 8; digit++)
+	{
+		sLONG* count = counts[digit];
+		sLONG shift = 8 * digit;
+		if (count[(inKeys[0] >> shift) & 0xFF] == inCount)
+			continue;	// same byte for all keys
+
+		sLONG offset = 0;
+		for (sLONG b = 0; b < 256; b++)
+		{
+			sLONG n = count[b];
+			count[b] = offset;
+			offset += n;
+		}
+
+		for (sLONG i = 0; i < inCount; i++)
+		{
+			sLONG index = source[i];
+			destination[count[(inKeys[index] >> shift) & 0xFF]++] = index;
+		}
+
+		sLONG* swap = source;
+		source = destination;
+		destination = swap;
+	}
+
+	return source;
+}
+
+
+/*
+	Sorts on the criteria keys from the last criterion to the first one, each pass being stable.
+	The resulting permutation is then applied to all arrays with MultiCriteriaSwap, following its cycles.
+	Returns false, with the arrays untouched, if a criterion has no keys or memory is short.
+*/
+bool ISortable::MultiCriteriaKeySort(ISortable** inArrays, uBYTE** inDatas, Boolean* inInvert, sLONG inMultiCriteriaLevel, sLONG inFrom, sLONG inTo)
+{
+	sLONG count = inTo - inFrom + 1;
+
+	uLONG8* keys = (uLONG8*) vMalloc(count * sizeof(uLONG8), 'sort');
+	sLONG* order = (sLONG*) vMalloc(count * sizeof(sLONG), 'sort');
+	sLONG* buffer = (sLONG*) vMalloc(count * sizeof(sLONG), 'sort');
+
+	bool ok = (keys != NULL) && (order != NULL) && (buffer != NULL);
+	if (ok)
+	{
+		for (sLONG i = 0; i < count; i++)
+			order[i] = i;
+
+		for (sLONG level = inMultiCriteriaLevel - 1; ok && (level >= 0); level--)
+		{
+			ok = inArrays[level]->GetSortKeys(inDatas[level], inFrom, count, keys);
+			if (ok)
+			{
+				if (inInvert[level])
+				{
+					for (sLONG i = 0; i < count; i++)
+						keys[i] = ~keys[i];
+				}
+
+				sLONG* sorted = _RadixSortOrder(keys, order, buffer, count);
+				if (sorted != order)
+				{
+					buffer = order;
+					order = sorted;
+				}
+			}
+		}
+	}
+
+	if (ok)
+	{
+		// element order[i] goes to i
+		for (sLONG i = 0; i < count; i++)
+		{
+			sLONG current = i;
+			while (order[current] != i)
+			{
+				sLONG next = order[current];
+				order[current] = current;
+				MultiCriteriaSwap(inArrays, inDatas, inFrom + current, inFrom + next);
+				current = next;
+			}
+			order[current] = current;
+		}
+	}
+
+	vFree(keys);
+	vFree(order);
+	vFree(buffer);
+
+	return ok;
+}
+
+
+sLONG ISortable::GetSortConcurrency(sLONG inNb)
+{
+	if (inNb < kPARALLEL_SORT_THRESHOLD)
+		return 1;
+
+	sLONG parts = VSystem::GetNumberOfProcessors();
+	if (parts > kMAX_SORT_PARTS)
+		parts = kMAX_SORT_PARTS;
+	if (parts > inNb / kMIN_SORT_PART_SIZE)
+		parts = inNb / kMIN_SORT_PART_SIZE;
+
+	return (parts > 1) ? parts : 1;
+}
+
+
+void* ISortable::NewSortBuffer(VSize inSize)
+{
+	return vMalloc(inSize, 'sort');
+}
+
+
+void ISortable::DisposeSortBuffer(void* inBuffer)
+{
+	vFree(inBuffer);
+}
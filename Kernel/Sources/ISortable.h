@@ -17,9 +17,18 @@
 #define __ISortable__
 
 #include "Kernel/Sources/VKernelTypes.h"
+#include "Kernel/Sources/VTask.h"
+
+#include <algorithm>
 
 BEGIN_TOOLBOX_NAMESPACE
 
+// Sorts of at least this many elements are split across tasks, see ISortable::GetSortConcurrency
+const sLONG	kPARALLEL_SORT_THRESHOLD = 256 * 1024;
+
+// Below this count, radix sorts fall back to QSort
+const sLONG	kRADIX_SORT_THRESHOLD = 256;
+
 class XTOOLBOX_API ISortable
 {
 public:
@@ -28,6 +37,13 @@ public:
 
 	static void	MultiCriteriaQSort (ISortable** inArrays, Boolean* inInvert, sLONG inMultiCriteriaLevel, sLONG inFrom, sLONG inTo);
 
+	// Number of parts a sort of inNb elements is split into: 1 below kPARALLEL_SORT_THRESHOLD or with a single processor.
+	static sLONG	GetSortConcurrency (sLONG inNb);
+
+	// Scratch buffers of the sort templates, allocated out of line so that this header doesn't depend on VMemoryCpp.h
+	static void*	NewSortBuffer (VSize inSize);
+	static void		DisposeSortBuffer (void* inBuffer);
+
 protected:
 	virtual uBYTE*	LockAndGetData () const { return NULL; };
 	virtual void	UnlockData () const {};
@@ -35,168 +51,193 @@ protected:
 	virtual void	SwapElements (uBYTE* data, sLONG inA, sLONG inB) = 0;
 	virtual CompareResult	CompareElements (uBYTE* data, sLONG inA, sLONG inB) = 0;
 
+	// Fills outKeys with unsigned keys ordered as CompareElements orders elements [inFrom, inFrom + inCount[.
+	// When every criterion provides keys, MultiCriteriaQSort runs a stable radix sort on them instead of comparing elements.
+	virtual bool	GetSortKeys (uBYTE* /*data*/, sLONG /*inFrom*/, sLONG /*inCount*/, uLONG8* /*outKeys*/) { return false; };
+
 	static CompareResult	MultiCriteriaCompare (ISortable** inArrays, uBYTE** inDatas, Boolean* inInvert, sLONG inMultiCriteriaLevel, sLONG inIndexA, sLONG inIndexB);
 	static void	MultiCriteriaSwap (ISortable** inArrays, uBYTE** inDatas, sLONG inIndexA, sLONG inIndexB);
+	static bool	MultiCriteriaKeySort (ISortable** inArrays, uBYTE** inDatas, Boolean* inInvert, sLONG inMultiCriteriaLevel, sLONG inFrom, sLONG inTo);
 };
 
 
-// This is an optimized quicksort routines for arrays of standard types like short, long or double
+// Unsigned keys with the same order as the signed or real values, for radix sorts
+
+inline uLONG8 GetSortKey (sBYTE inValue)	{ return (uBYTE) inValue ^ 0x80; }
+inline uLONG8 GetSortKey (sWORD inValue)	{ return (uWORD) inValue ^ 0x8000; }
+inline uLONG8 GetSortKey (sLONG inValue)	{ return (uLONG) inValue ^ 0x80000000UL; }
+inline uLONG8 GetSortKey (sLONG8 inValue)	{ return (uLONG8) inValue ^ (uLONG8) XBOX_LONG8(0x8000000000000000); }
+inline uLONG8 GetSortKey (uLONG8 inValue)	{ return inValue; }
 
-#define CUTOFF 8
+// -0.0 and +0.0 get the same key since they compare equal, and all NaNs get the largest key (sorted last).
+
+inline uLONG8 GetSortKey (Real inValue)
+{
+	if (inValue != inValue)
+		return ~(uLONG8) 0;
+	if (inValue == 0)
+		inValue = 0;	// -0.0
+	uLONG8 bits;
+	::memcpy( &bits, &inValue, sizeof( bits));
+	const uLONG8 sign = (uLONG8) XBOX_LONG8(0x8000000000000000);
+	return (bits & sign) ? ~bits : (bits | sign);
+}
+
+
+// Strict weak orders for QSort. A NaN compares false with everything, which std::sort doesn't allow:
+// they are sorted after all other reals, and so before them by VSortGreater which is the exact reverse order
+// (as RadixSort and MultiCriteriaKeySort with the inverted key).
+
+template <class Type> struct VSortLess
+{
+	bool operator() (const Type& inA, const Type& inB) const { return inA < inB; }
+};
+
+template <class Type> struct VSortGreater
+{
+	bool operator() (const Type& inA, const Type& inB) const { return inB < inA; }
+};
+
+template <> struct VSortLess<Real>
+{
+	bool operator() (Real inA, Real inB) const { return (inA < inB) || ((inB != inB) && (inA == inA)); }
+};
+
+template <> struct VSortGreater<Real>
+{
+	bool operator() (Real inA, Real inB) const { return VSortLess<Real>()( inB, inA); }
+};
+
+
+// Sorts each part with std::sort (introsort) in its own task (see VTask::RunInParallel), then merges adjacent runs two by two, also in parallel.
+// Elements must be copyable with memcpy.
+
+template <class Type, class Compare> struct VParallelSortContext
+{
+	Type*	fSource;
+	Type*	fDestination;
+	sLONG	fCount;
+	sLONG	fParts;
+	sLONG	fWidth;		// parts per run being merged
+	Compare	fCompare;
+
+	sLONG	GetBound (sLONG inPart) const	{ return (inPart >= fParts) ? fCount : (sLONG) (((sLONG8) fCount * inPart) / fParts); }
+};
+
+template <class Type, class Compare> void _ParallelSortPart (void* inContext, sLONG inIndex)
+{
+	VParallelSortContext<Type, Compare>* context = (VParallelSortContext<Type, Compare>*) inContext;
+	std::sort( context->fSource + context->GetBound( inIndex), context->fSource + context->GetBound( inIndex + 1), context->fCompare);
+}
+
+template <class Type, class Compare> void _ParallelMergeRuns (void* inContext, sLONG inIndex)
+{
+	VParallelSortContext<Type, Compare>* context = (VParallelSortContext<Type, Compare>*) inContext;
+	sLONG first = context->GetBound( inIndex * 2 * context->fWidth);
+	sLONG middle = context->GetBound( inIndex * 2 * context->fWidth + context->fWidth);
+	sLONG last = context->GetBound( (inIndex + 1) * 2 * context->fWidth);
+
+	// std::merge is stable: equal elements of the first run come first
+	std::merge( context->fSource + first, context->fSource + middle, context->fSource + middle, context->fSource + last, context->fDestination + first, context->fCompare);
+}
+
+template <class Type, class Compare> void ParallelSort (Type *inBase, sLONG inNb, Compare inCompare)
+{
+	sLONG parts = ISortable::GetSortConcurrency( inNb);
+	Type *buffer = (parts > 1) ? (Type*) ISortable::NewSortBuffer( inNb * sizeof( Type)) : NULL;
+	if (buffer == NULL)
+	{
+		std::sort( inBase, inBase + inNb, inCompare);
+		return;
+	}
+
+	VParallelSortContext<Type, Compare> context;
+	context.fSource = inBase;
+	context.fDestination = buffer;
+	context.fCount = inNb;
+	context.fParts = parts;
+	context.fWidth = 1;
+	context.fCompare = inCompare;
+
+	VTask::RunInParallel( parts, &_ParallelSortPart<Type, Compare>, &context);
+
+	for( ; context.fWidth < parts ; context.fWidth *= 2)
+	{
+		VTask::RunInParallel( (parts + 2 * context.fWidth - 1) / (2 * context.fWidth), &_ParallelMergeRuns<Type, Compare>, &context);
+		std::swap( context.fSource, context.fDestination);
+	}
+
+	if (context.fSource != inBase)
+		::memcpy( inBase, context.fSource, inNb * sizeof( Type));
+
+	ISortable::DisposeSortBuffer( buffer);
+}
+
+
+// Sorts arrays of standard types like short, long or double: introsort on the raw data, parallel for large arrays.
 
 template <class Type> void QSort (Type *inBase, sLONG inNb, Boolean inInvert)
 {
-    Type *lo, *hi;					/* ends of sub-array currently sorting */
-    Type *mid;						/* points to middle of subarray */
-    Type *loguy, *higuy;			/* traveling pointers for partition step */
-	Type tmp;
-    sLONG size;						/* size of the sub-array */
-    Type *lostk[30], *histk[30];
-    sLONG stkptr;					/* stack for saving sub-array to be processed */
+	if (inNb < 2)
+		return;						/* nothing to do */
 
-    if (inNb < 2)
-        return;						/* nothing to do */
+	if (inInvert)
+		ParallelSort( inBase, inNb, VSortGreater<Type>());
+	else
+		ParallelSort( inBase, inNb, VSortLess<Type>());
+}
 
-    stkptr = 0;						/* initialize stack */
 
-    lo = inBase;
-    hi = inBase + inNb - 1;			/* initialize limits */
+// LSD radix sort on bytes for types having a GetSortKey. Bytes that are the same for all elements are skipped.
 
-    if (hi - lo <= CUTOFF)
+template <class Type> void RadixSort (Type *inBase, sLONG inNb, Boolean inInvert)
+{
+	Type *buffer = (inNb >= kRADIX_SORT_THRESHOLD) ? (Type*) ISortable::NewSortBuffer( inNb * sizeof( Type)) : NULL;
+	if (buffer == NULL)
 	{
-		Type *p, *max;
-		
-		while (hi > lo)
-		{
-			max = lo;
-			for (p = lo + 1; p <= hi; p++)
-			{
-				if (inInvert)
-				{
-					if (*p < *max)
-						max = p;
-				}
-				else
-				{
-					if (*p > *max)
-						max = p;
-				}
-			}
-        
-			tmp = *max;
-			*max = *hi;
-			*hi = tmp;
-
-			hi--;
-		}
+		QSort( inBase, inNb, inInvert);
 		return;
-    }
-    else
+	}
+
+	const uLONG8 invertMask = inInvert ? ~(uLONG8) 0 : 0;
+	sLONG counts[sizeof( Type)][256];
+	::memset( counts, 0, sizeof( counts));
+
+	for( sLONG i = 0 ; i < inNb ; ++i)
 	{
-recurse:
-	    size = (sLONG) (hi - lo + 1);		/* number of el's to sort */
-		mid = lo + size / 2;	/* find middle element */
-		
-		tmp = *mid;
-		*mid = *lo;
-		*lo = tmp;				/* swap it to beginning of array */
-
-        loguy = lo;
-        higuy = hi + 1;
-
-        if (inInvert)
-		{
-			for (;;)
-			{
-				do 
-				{
-					loguy++;
-				}
-				while (loguy <= hi && *loguy >= *lo);
-
-				do
-				{
-					higuy--;
-				}
-				while (higuy > lo && *higuy <= *lo);
-
-				if (higuy < loguy)
-					break;
-
-				tmp = *loguy;
-				*loguy = *higuy;
-				*higuy = tmp;
-			}
-		}
-		else
+		uLONG8 key = GetSortKey( inBase[i]) ^ invertMask;
+		for( sLONG digit = 0 ; digit < (sLONG) sizeof( Type) ; ++digit)
+			++counts[digit][(key >> (8 * digit)) & 0xFF];
+	}
+
+	Type *source = inBase;
+	Type *destination = buffer;
+	uLONG8 firstKey = GetSortKey( inBase[0]) ^ invertMask;
+	for( sLONG digit = 0 ; digit < (sLONG) sizeof( Type) ; ++digit)
+	{
+		sLONG *count = counts[digit];
+		sLONG shift = 8 * digit;
+		if (count[(firstKey >> shift) & 0xFF] == inNb)
+			continue;
+
+		sLONG offset = 0;
+		for( sLONG b = 0 ; b < 256 ; ++b)
 		{
-			for (;;)
-			{
-				do 
-				{
-					loguy++;
-				}
-				while (loguy <= hi && *loguy <= *lo);
-
-				do
-				{
-					higuy--;
-				}
-				while (higuy > lo && *higuy >= *lo);
-
-				if (higuy < loguy)
-					break;
-
-				tmp = *loguy;
-				*loguy = *higuy;
-				*higuy = tmp;
-			}
+			sLONG n = count[b];
+			count[b] = offset;
+			offset += n;
 		}
-        tmp = *lo;
-		*lo = *higuy;
-		*higuy = tmp;					/* put partition element in place */
 
-        if (higuy - 1 - lo >= hi - loguy)
-		{
-            if (lo + 1 < higuy)
-			{
-                lostk[stkptr] = lo;
-                histk[stkptr] = higuy - 1;
-                ++stkptr;
-            }							/* save big recursion for later */
-
-            if (loguy < hi)
-			{
-                lo = loguy;
-                goto recurse;			/* do small recursion */
-            }
-        }
-        else
-		{
-            if (loguy < hi) 
-			{
-                lostk[stkptr] = loguy;
-                histk[stkptr] = hi;
-                ++stkptr;			/* save big recursion for later */
-            }
-
-            if (lo + 1 < higuy)
-			{
-                hi = higuy - 1;
-                goto recurse;		/* do small recursion */
-            }
-        }
-    }
-
-    --stkptr;
-    if (stkptr >= 0)
-	{
-        lo = lostk[stkptr];
-        hi = histk[stkptr];
-        goto recurse;			/* pop subarray from stack */
-    }
-    else
-        return;					/* all subarrays done */
+		for( sLONG i = 0 ; i < inNb ; ++i)
+			destination[count[((GetSortKey( source[i]) ^ invertMask) >> shift) & 0xFF]++] = source[i];
+
+		std::swap( source, destination);
+	}
+
+	if (source != inBase)
+		::memcpy( inBase, source, inNb * sizeof( Type));
+
+	ISortable::DisposeSortBuffer( buffer);
 }
 
 END_TOOLBOX_NAMESPACE
@@ -17,11 +17,344 @@
 #include "VArchiveStream.h"
 #include "VStream.h"
 #include "VErrorContext.h"
+#include "VSystem.h"
+#include "VTask.h"
 
 #if VERSIONMAC
 #include <mach-o/loader.h>
 #endif
 
+BEGIN_TOOLBOX_NAMESPACE
+
+// version 5 archives: forks are stored as a sequence of chunks of at most kARCHIVE_CHUNK_SIZE bytes,
+// each one written as raw size, stored size and stored bytes. A chunk is stored as is if compression doesn't shrink it.
+#define kARCHIVE_VERSION_COMPRESSED	5
+#define kARCHIVE_CHUNK_SIZE			(1024*1024)
+#define kARCHIVE_MAX_BATCH_CHUNKS	16
+
+#define kLZ_HASH_BITS		14
+#define kLZ_MIN_MATCH		4
+#define kLZ_MAX_OFFSET		65535
+#define kLZ_NO_POSITION		0xFFFFFFFF
+
+
+/*
+	Block compression in the spirit of LZ4: a sequence is a token (literal count in the high nibble,
+	match length - kLZ_MIN_MATCH in the low nibble, 15 meaning that extra bytes follow, until one is < 255),
+	the literals, then the little endian 16 bits match offset. The last sequence has literals only.
+*/
+
+static inline uLONG _LZRead32( const uBYTE *inData)
+{
+	uLONG value;
+	memcpy( &value, inData, sizeof( value));
+	return value;
+}
+
+
+static inline uLONG _LZHash( uLONG inSequence)
+{
+	return (inSequence * 2654435761U) >> (32 - kLZ_HASH_BITS);
+}
+
+
+static uBYTE* _LZPutLength( uBYTE *ioDest, const uBYTE *inDestEnd, VSize inLength)
+{
+	// writes the bytes following a nibble set to 15
+	for( inLength -= 15 ; (ioDest != NULL) && (inLength >= 255) ; inLength -= 255)
+		ioDest = (ioDest < inDestEnd) ? (*ioDest++ = 255, ioDest) : NULL;
+
+	if ( (ioDest != NULL) && (ioDest < inDestEnd) )
+		*ioDest++ = (uBYTE) inLength;
+	else
+		ioDest = NULL;
+
+	return ioDest;
+}
+
+
+static uBYTE* _LZPutSequence( uBYTE *ioDest, const uBYTE *inDestEnd, const uBYTE *inLiterals, VSize inLiteralCount, VSize inMatchOffset, VSize inMatchLength)
+{
+	if (ioDest >= inDestEnd)
+		return NULL;
+
+	uBYTE *token = ioDest++;
+	*token = (uBYTE) (((inLiteralCount < 15) ? inLiteralCount : 15) << 4);
+
+	if (inLiteralCount >= 15)
+		ioDest = _LZPutLength( ioDest, inDestEnd, inLiteralCount);
+
+	if ( (ioDest == NULL) || ((VSize) (inDestEnd - ioDest) < inLiteralCount) )
+		return NULL;
+
+	memcpy( ioDest, inLiterals, inLiteralCount);
+	ioDest += inLiteralCount;
+
+	if (inMatchOffset != 0)
+	{
+		if (inDestEnd - ioDest < 2)
+			return NULL;
+		*ioDest++ = (uBYTE) inMatchOffset;
+		*ioDest++ = (uBYTE) (inMatchOffset >> 8);
+
+		VSize length = inMatchLength - kLZ_MIN_MATCH;
+		*token |= (uBYTE) ((length < 15) ? length : 15);
+		if (length >= 15)
+			ioDest = _LZPutLength( ioDest, inDestEnd, length);
+	}
+
+	return ioDest;
+}
+
+
+// returns the compressed size, or 0 if it doesn't fit in inDestSize bytes.
+// ioHashTable must have 1 << kLZ_HASH_BITS entries.
+static VSize _LZCompress( const uBYTE *inSource, VSize inSourceSize, uBYTE *outDest, VSize inDestSize, uLONG *ioHashTable)
+{
+	memset( ioHashTable, 0xFF, sizeof( uLONG) << kLZ_HASH_BITS);
+
+	const uBYTE *source = inSource;
+	const uBYTE *sourceEnd = inSource + inSourceSize;
+	const uBYTE *anchor = inSource;
+	const uBYTE *destEnd = outDest + inDestSize;
+	uBYTE *dest = outDest;
+
+	while( (dest != NULL) && (sourceEnd - source >= kLZ_MIN_MATCH) )
+	{
+		uLONG sequence = _LZRead32( source);
+		uLONG *slot = &ioHashTable[_LZHash( sequence)];
+		uLONG candidate = *slot;
+		uLONG position = (uLONG) (source - inSource);
+		*slot = position;
+
+		if ( (candidate != kLZ_NO_POSITION) && (position - candidate <= kLZ_MAX_OFFSET) && (_LZRead32( inSource + candidate) == sequence) )
+		{
+			const uBYTE *match = inSource + candidate + kLZ_MIN_MATCH;
+			const uBYTE *end = source + kLZ_MIN_MATCH;
+			while( (end < sourceEnd) && (*end == *match) )
+			{
+				++end;
+				++match;
+			}
+
+			dest = _LZPutSequence( dest, destEnd, anchor, source - anchor, position - candidate, end - source);
+			source = anchor = end;
+		}
+		else
+		{
+			// go faster through data that doesn't compress
+			source += 1 + ((source - anchor) >> 6);
+		}
+	}
+
+	if (dest != NULL)
+		dest = _LZPutSequence( dest, destEnd, anchor, sourceEnd - anchor, 0, 0);
+
+	return (dest != NULL) ? (VSize) (dest - outDest) : 0;
+}
+
+
+static bool _LZGetLength( const uBYTE **ioSource, const uBYTE *inSourceEnd, VSize *ioLength)
+{
+	uBYTE byte;
+	do
+	{
+		if (*ioSource >= inSourceEnd)
+			return false;
+		byte = *(*ioSource)++;
+		*ioLength += byte;
+	} while( byte == 255);
+	return true;
+}
+
+
+// returns the decompressed size, or 0 if the source is corrupted or doesn't fit in inDestSize bytes.
+static VSize _LZDecompress( const uBYTE *inSource, VSize inSourceSize, uBYTE *outDest, VSize inDestSize)
+{
+	const uBYTE *source = inSource;
+	const uBYTE *sourceEnd = inSource + inSourceSize;
+	uBYTE *dest = outDest;
+	const uBYTE *destEnd = outDest + inDestSize;
+
+	while( source < sourceEnd)
+	{
+		uBYTE token = *source++;
+
+		VSize literalCount = token >> 4;
+		if ( (literalCount == 15) && !_LZGetLength( &source, sourceEnd, &literalCount) )
+			return 0;
+		if ( ((VSize) (sourceEnd - source) < literalCount) || ((VSize) (destEnd - dest) < literalCount) )
+			return 0;
+		memcpy( dest, source, literalCount);
+		dest += literalCount;
+		source += literalCount;
+
+		if (source == sourceEnd)
+			break;	// last sequence
+
+		if (sourceEnd - source < 2)
+			return 0;
+		VSize offset = source[0] | (source[1] << 8);
+		source += 2;
+
+		VSize length = token & 15;
+		if ( (length == 15) && !_LZGetLength( &source, sourceEnd, &length) )
+			return 0;
+		length += kLZ_MIN_MATCH;
+
+		if ( (offset == 0) || (offset > (VSize) (dest - outDest)) || ((VSize) (destEnd - dest) < length) )
+			return 0;
+
+		// byte per byte since the match may overlap
+		for( const uBYTE *match = dest - offset ; length > 0 ; --length)
+			*dest++ = *match++;
+	}
+
+	return (VSize) (dest - outDest);
+}
+
+
+/*
+	Chunks are compressed or decompressed by batches, the tasks of VTask::RunInParallel sharing the chunks of a batch.
+	Reads and writes on the archive stream stay in the calling task, in archive order.
+*/
+
+typedef struct VArchiveChunk
+{
+	VFileDesc*			fFileDesc;		/* file read from (archiving) or written to (restoring) */
+	sLONG8				fOffset;		/* offset of the chunk in the file */
+	size_t				fFork;			/* archiving: index of the fork in the archive */
+	VArchiveCatalog*	fCatalog;		/* restoring: entry being extracted */
+	VSize				fRawSize;
+	VSize				fStoredSize;
+	char*				fRawBuffer;
+	char*				fStoredBuffer;
+	uLONG*				fHashTable;
+	const char*			fRawData;		/* raw bytes, in fRawBuffer or fStoredBuffer */
+	const char*			fStoredData;	/* stored bytes, in fStoredBuffer or fRawBuffer */
+	VError				fError;
+} VArchiveChunk;
+
+
+class VArchiveChunkBatch
+{
+public:
+	VArchiveChunkBatch( bool inCompress )
+	{
+		sLONG capacity = 2 * VSystem::GetNumberOfProcessors();
+		if ( capacity > kARCHIVE_MAX_BATCH_CHUNKS )
+			capacity = kARCHIVE_MAX_BATCH_CHUNKS;
+
+		fCount = 0;
+		fCompress = inCompress;
+		fChunks.resize( (capacity > 2) ? capacity : 2 );
+		for ( std::vector<VArchiveChunk>::iterator i = fChunks.begin() ; i != fChunks.end() ; ++i )
+		{
+			memset( &*i, 0, sizeof( VArchiveChunk ) );
+			i->fRawBuffer = new char[kARCHIVE_CHUNK_SIZE];
+			i->fStoredBuffer = new char[kARCHIVE_CHUNK_SIZE];
+			i->fHashTable = inCompress ? new uLONG[1 << kLZ_HASH_BITS] : NULL;
+		}
+	}
+
+	~VArchiveChunkBatch()
+	{
+		for ( std::vector<VArchiveChunk>::iterator i = fChunks.begin() ; i != fChunks.end() ; ++i )
+		{
+			delete[] i->fRawBuffer;
+			delete[] i->fStoredBuffer;
+			delete[] i->fHashTable;
+		}
+	}
+
+	bool			IsFull() const		{ return fCount >= (sLONG) fChunks.size(); }
+	bool			IsEmpty() const		{ return fCount == 0; }
+	sLONG			GetCount() const	{ return fCount; }
+	VArchiveChunk&	operator[]( sLONG inIndex )	{ return fChunks[inIndex]; }
+
+	VArchiveChunk&	Add()
+	{
+		VArchiveChunk& chunk = fChunks[fCount++];
+		chunk.fError = VE_OK;
+		return chunk;
+	}
+
+	void			Clear()				{ fCount = 0; }
+
+	// compresses or decompresses all chunks, returns the first error
+	VError			Run()
+	{
+		fTaskCount = VSystem::GetNumberOfProcessors();
+		if ( fTaskCount > fCount )
+			fTaskCount = fCount;
+		VTask::RunInParallel( fTaskCount, &_RunPart, this );
+
+		VError result = VE_OK;
+		for ( sLONG i = 0 ; i < fCount && result == VE_OK ; ++i )
+			result = fChunks[i].fError;
+		return result;
+	}
+
+private:
+	static	void	_RunPart( void *inContext, sLONG inIndex )
+	{
+		VArchiveChunkBatch *batch = (VArchiveChunkBatch*) inContext;
+		StErrorContextInstaller errors( false);
+		for ( sLONG i = inIndex ; i < batch->fCount ; i += batch->fTaskCount )
+		{
+			if ( batch->fCompress )
+				_Compress( batch->fChunks[i] );
+			else
+				_Decompress( batch->fChunks[i] );
+		}
+	}
+
+	static	void	_Compress( VArchiveChunk& ioChunk )
+	{
+		ioChunk.fRawData = ioChunk.fRawBuffer;
+		ioChunk.fError = ioChunk.fFileDesc->ReadAt( ioChunk.fRawBuffer, ioChunk.fRawSize, ioChunk.fOffset );
+		if ( ioChunk.fError == VE_OK )
+		{
+			ioChunk.fStoredSize = _LZCompress( (const uBYTE*) ioChunk.fRawBuffer, ioChunk.fRawSize, (uBYTE*) ioChunk.fStoredBuffer, ioChunk.fRawSize - 1, ioChunk.fHashTable );
+			if ( ioChunk.fStoredSize == 0 )
+			{
+				ioChunk.fStoredSize = ioChunk.fRawSize;
+				ioChunk.fStoredData = ioChunk.fRawBuffer;
+			}
+			else
+			{
+				ioChunk.fStoredData = ioChunk.fStoredBuffer;
+			}
+		}
+	}
+
+	static	void	_Decompress( VArchiveChunk& ioChunk )
+	{
+		ioChunk.fStoredData = ioChunk.fStoredBuffer;
+		if ( ioChunk.fStoredSize == ioChunk.fRawSize )
+		{
+			ioChunk.fRawData = ioChunk.fStoredBuffer;
+		}
+		else
+		{
+			ioChunk.fRawData = ioChunk.fRawBuffer;
+			if ( _LZDecompress( (const uBYTE*) ioChunk.fStoredBuffer, ioChunk.fStoredSize, (uBYTE*) ioChunk.fRawBuffer, ioChunk.fRawSize ) != ioChunk.fRawSize )
+				ioChunk.fError = VE_STREAM_BAD_SIGNATURE;
+		}
+
+		if ( ioChunk.fError == VE_OK )
+			ioChunk.fError = ioChunk.fFileDesc->WriteAt( ioChunk.fRawData, ioChunk.fRawSize, ioChunk.fOffset );
+	}
+
+	std::vector<VArchiveChunk>	fChunks;
+	sLONG						fCount;
+	sLONG						fTaskCount;
+	bool						fCompress;
+};
+
+END_TOOLBOX_NAMESPACE
+
+
 VArchiveCatalog::VArchiveCatalog( VFile *inFile, sLONG8 inDataFileSize, sLONG8 inResFileSize, VString &inStoredPath, VString &inFileExtra, uLONG inKind, uLONG inCreator )
 {
 	inFile->Retain();
@@ -33,6 +366,8 @@ VArchiveCatalog::VArchiveCatalog( VFile *inFile, sLONG8 inDataFileSize, sLONG8 i
 	fExtract = true;
 	fKind = inKind;
 	fCreator = inCreator;
+	fDataOffset = -1;
+	fResOffset = -1;
 }
 
 VArchiveCatalog::~VArchiveCatalog()
@@ -85,11 +420,23 @@ uLONG VArchiveCatalog::GetCreator()
 	return fCreator;
 }
 
+sLONG8 VArchiveCatalog::GetForkOffset( eFileSizeType inForkType )
+{
+	return (inForkType == fst_Resource) ? fResOffset : fDataOffset;
+}
+
+void VArchiveCatalog::SetForkOffsets( sLONG8 inDataOffset, sLONG8 inResOffset )
+{
+	fDataOffset = inDataOffset;
+	fResOffset = inResOffset;
+}
+
 VArchiveStream::VArchiveStream()
 {
 	fDestinationFile = NULL;
 	fStream = NULL;
 	fCallBack = NULL;
+	fVersion = 4;
 }
 
 VArchiveStream::~VArchiveStream()
@@ -237,6 +584,11 @@ void VArchiveStream::SetProgressCallBack( CB_VArchiveStream inProgressCallBack )
 	fCallBack = inProgressCallBack;
 }
 
+void VArchiveStream::SetVersion( uBYTE inVersion )
+{
+	fVersion = inVersion;
+}
+
 VError VArchiveStream::_WriteFile( const VFileDesc* inFileDesc, char* buffToUse, VSize buffSize, uLONG8 &ioPartialByteCount, uLONG8 inTotalByteCount )
 {
 	bool userAbort = false;
@@ -354,7 +706,11 @@ VError VArchiveStream::_WriteCatalog( const VFile* inFile, const VString &inExtr
 VError VArchiveStream::Proceed()
 {
 	VError result = VE_STREAM_NOT_OPENED;
-	if ( fStream )
+	if ( fStream && fVersion >= kARCHIVE_VERSION_COMPRESSED )
+	{
+		result = _ProceedCompressed();
+	}
+	else if ( fStream )
 	{
 		bool userAbort = false;
 		result = fStream->OpenWriting();
@@ -463,10 +819,179 @@ VError VArchiveStream::Proceed()
 	return result;
 }
 
+VFileDesc* VArchiveStream::_OpenFork( size_t inEntry, bool inResourceFork, bool &outOwned )
+{
+	VFileDesc *fileDesc = NULL;
+	outOwned = false;
+
+	if ( inEntry < fFileDescList.size() )
+	{
+		/* nota : filedesc passed to the archivestream is considered as data fork */
+		if ( !inResourceFork )
+			fileDesc = fFileDescList[inEntry];
+	}
+	else
+	{
+		/* a file that can't be opened is stored as empty, as in version 4 */
+		StErrorContextInstaller errors( false);
+		VFile *file = fFileList[inEntry - fFileDescList.size()];
+		if ( !inResourceFork )
+			file->Open( FA_READ, &fileDesc );
+#if VERSIONMAC
+		else
+			file->Open( FA_READ, &fileDesc, FO_OpenResourceFork );
+#endif
+		outOwned = (fileDesc != NULL);
+	}
+	return fileDesc;
+}
+
+VError VArchiveStream::_ProceedCompressed()
+{
+	VError result = fStream->OpenWriting();
+	if ( result == VE_OK )
+	{
+		bool userAbort = false;
+		uLONG8 totalByteCount = 0;
+		uLONG8 partialByteCount = 0;
+		size_t entryCount = fFileDescList.size() + fFileList.size();
+		sLONG8 archiveStart = fStream->GetPos();
+
+		for( VectorOfVFileDesc::iterator i = fFileDescList.begin() ; i != fFileDescList.end() ; ++i )
+			totalByteCount += (*i)->GetSize();
+		for( VectorOfVFile::iterator i = fFileList.begin() ; i != fFileList.end() ; ++i )
+		{
+			sLONG8 fileSize = 0;
+			(*i)->GetSize( &fileSize );
+			totalByteCount += fileSize;
+#if VERSIONMAC
+			fileSize = 0;
+			(*i)->GetResourceForkSize( &fileSize );
+			totalByteCount += fileSize;
+#endif
+		}
+
+		/* the catalog goes after the data, it is found through the trailer */
+		fStream->PutLong('FPBK');
+		fStream->PutByte(kARCHIVE_VERSION_COMPRESSED);
+		result = fStream->PutLong8((sLONG8)entryCount);
+
+		if ( fCallBack )
+			fCallBack(CB_OpenProgress,partialByteCount,totalByteCount,userAbort);
+
+		/* data fork then resource fork of each entry: offset relative to archive start and size */
+		std::vector<std::pair<sLONG8,sLONG8> > forks( 2 * entryCount, std::pair<sLONG8,sLONG8>( 0, 0 ) );
+
+		VArchiveChunkBatch batch( true );
+		std::vector<VFileDesc*> doneFileDescs;
+		VFileDesc *fileDesc = NULL;
+		bool ownedFileDesc = false;
+		bool forkOpened = false;
+		sLONG8 forkSize = 0;
+		sLONG8 forkOffset = 0;
+		size_t fork = 0;
+
+		while ( result == VE_OK && fork < forks.size() )
+		{
+			/* fill the batch with the next chunks, possibly from several files */
+			batch.Clear();
+			while ( fork < forks.size() && !batch.IsFull() )
+			{
+				if ( !forkOpened )
+				{
+					fileDesc = _OpenFork( fork / 2, (fork & 1) != 0, ownedFileDesc );
+					forkSize = (fileDesc != NULL) ? fileDesc->GetSize() : 0;
+					forkOffset = 0;
+					forkOpened = true;
+				}
+
+				if ( forkOffset < forkSize )
+				{
+					VArchiveChunk& chunk = batch.Add();
+					chunk.fFileDesc = fileDesc;
+					chunk.fFork = fork;
+					chunk.fOffset = forkOffset;
+					chunk.fRawSize = (forkSize - forkOffset > kARCHIVE_CHUNK_SIZE) ? kARCHIVE_CHUNK_SIZE : (VSize) (forkSize - forkOffset);
+					forkOffset += chunk.fRawSize;
+				}
+
+				if ( forkOffset >= forkSize )
+				{
+					if ( ownedFileDesc )
+						doneFileDescs.push_back( fileDesc );
+					fileDesc = NULL;
+					forkOpened = false;
+					++fork;
+				}
+			}
+
+			if ( !batch.IsEmpty() )
+				result = batch.Run();
+
+			for ( sLONG i = 0 ; i < batch.GetCount() && result == VE_OK ; ++i )
+			{
+				VArchiveChunk& chunk = batch[i];
+				if ( chunk.fOffset == 0 )
+					forks[chunk.fFork].first = fStream->GetPos() - archiveStart;
+				forks[chunk.fFork].second += chunk.fRawSize;
+
+				fStream->PutLong((sLONG)chunk.fRawSize);
+				fStream->PutLong((sLONG)chunk.fStoredSize);
+				result = fStream->PutData(chunk.fStoredData,chunk.fStoredSize);
+				partialByteCount += chunk.fRawSize;
+			}
+
+			for ( std::vector<VFileDesc*>::iterator i = doneFileDescs.begin() ; i != doneFileDescs.end() ; ++i )
+				delete *i;
+			doneFileDescs.clear();
+
+			if ( fCallBack && result == VE_OK )
+			{
+				fCallBack(CB_UpdateProgress,partialByteCount,totalByteCount,userAbort);
+				if ( userAbort )
+					result = VE_STREAM_USER_ABORTED;
+			}
+		}
+
+		if ( ownedFileDesc && fileDesc != NULL )
+			delete fileDesc;
+
+		/* put the file listing, with the position of each fork, then the trailer */
+		sLONG8 catalogOffset = fStream->GetPos() - archiveStart;
+		if ( result == VE_OK )
+			result = fStream->PutLong('LIST');
+		for ( size_t i = 0; i < entryCount && result == VE_OK; i++ )
+		{
+			uLONG8 byteCount = 0;
+			if ( i < fFileDescList.size() )
+				result = _WriteCatalog(fFileDescList[i]->GetParentVFile(),fFileDescExtra[i],byteCount);
+			else
+				result = _WriteCatalog(fFileList[i - fFileDescList.size()],fFileExtra[i - fFileDescList.size()],byteCount);
+
+			fStream->PutLong8(forks[2*i].first);
+			fStream->PutLong8(forks[2*i].second);
+			fStream->PutLong8(forks[2*i+1].first);
+			if ( result == VE_OK )
+				result = fStream->PutLong8(forks[2*i+1].second);
+		}
+		if ( result == VE_OK )
+			result = fStream->PutLong8(catalogOffset);
+		if ( result == VE_OK )
+			result = fStream->PutLong('FEND');
+
+		if ( fCallBack )
+			fCallBack(CB_CloseProgress,partialByteCount,totalByteCount,userAbort);
+
+		fStream->CloseWriting();
+	}
+	return result;
+}
+
 VArchiveUnStream::VArchiveUnStream()
 {
 	fCallBack = NULL;
 	fSourceFile = NULL;
+	fVersion = 0;
 }
 
 VArchiveUnStream::~VArchiveUnStream()
@@ -513,6 +1038,7 @@ VError VArchiveUnStream::ProceedCatalog()
 	VStr8 slash("/");
 	VStr8 extra("::");
 	VStr8 folderSep(XBOX::FOLDER_SEPARATOR);
+	sLONG8 archiveStart = fStream->GetPos();
 
 	if ( fStream->GetLong() == 'FPBK' )
 	{
@@ -523,12 +1049,26 @@ VError VArchiveUnStream::ProceedCatalog()
 		uLONG creator = 0;
 		sLONG8 dataFileSize = 0;
 		sLONG8 resFileSize = 0;
-		uBYTE version = fStream->GetByte();
+		fVersion = fStream->GetByte();
 		uLONG8 fileCount = fStream->GetLong8();
 		fTotalByteCount = 0;
 
+		if ( fVersion > kARCHIVE_VERSION_COMPRESSED )
+		{
+			result = VE_STREAM_BAD_VERSION;
+		}
+		else if ( fVersion == kARCHIVE_VERSION_COMPRESSED )
+		{
+			/* the trailer at the end of the archive gives the position of the catalog */
+			result = fStream->SetPos( fStream->GetSize() - 12 );
+			sLONG8 catalogOffset = fStream->GetLong8();
+			if ( result == VE_OK && fStream->GetLong() == 'FEND' )
+				result = fStream->SetPos( archiveStart + catalogOffset );
+			else if ( result == VE_OK )
+				result = VE_STREAM_BAD_SIGNATURE;
+		}
 
-		if ( fStream->GetLong() == 'LIST' )
+		if ( result == VE_OK && fStream->GetLong() == 'LIST' )
 		{
 			for ( uLONG i = 0; i < fileCount && result == VE_OK; i++ )
 			{
@@ -551,15 +1091,28 @@ VError VArchiveUnStream::ProceedCatalog()
 						filePath.Exchange(slash ,folderSep, 1, 255);
 					
 						dataFileSize = fStream->GetLong8();
-						fTotalByteCount += dataFileSize;
 						resFileSize = fStream->GetLong8();
-						fTotalByteCount += resFileSize;
 
 						kind = fStream->GetLong();
 						creator = fStream->GetLong();
 
+						sLONG8 dataOffset = -1;
+						sLONG8 resOffset = -1;
+						if ( fVersion >= kARCHIVE_VERSION_COMPRESSED )
+						{
+							/* position and size of the stored forks */
+							dataOffset = archiveStart + fStream->GetLong8();
+							dataFileSize = fStream->GetLong8();
+							resOffset = archiveStart + fStream->GetLong8();
+							resFileSize = fStream->GetLong8();
+						}
+						fTotalByteCount += dataFileSize;
+						fTotalByteCount += resFileSize;
+
 						VFile *file = new VFile(filePath);
-						fFileCatalog.push_back(new VArchiveCatalog(file,dataFileSize,resFileSize,storedPath,fileExtra,kind,creator));
+						VArchiveCatalog *catalog = new VArchiveCatalog(file,dataFileSize,resFileSize,storedPath,fileExtra,kind,creator);
+						catalog->SetForkOffsets( dataOffset, resOffset );
+						fFileCatalog.push_back(catalog);
 						ReleaseRefCountable( &file);
 					}
 				}
@@ -567,7 +1120,7 @@ VError VArchiveUnStream::ProceedCatalog()
 					result = VE_STREAM_BAD_SIGNATURE;
 			}
 		}
-		else
+		else if ( result == VE_OK )
 			result = VE_STREAM_BAD_SIGNATURE;
 	}
 	return result;
@@ -661,8 +1214,153 @@ VError VArchiveUnStream::_ExtractFile( VArchiveCatalog *inCatalog, const VFileDe
 	return result;
 }
 
+VError VArchiveUnStream::_RunExtractBatch( VArchiveChunkBatch &ioBatch, std::vector<VFileDesc*> &ioDoneFileDescs, uLONG8 &ioPartialByteCount, uLONG8 inTotalByteCount )
+{
+	bool userAbort = false;
+	VError result = ioBatch.Run();
+
+	for ( sLONG i = 0 ; i < ioBatch.GetCount() && result == VE_OK ; ++i )
+	{
+		VArchiveChunk& chunk = ioBatch[i];
+#if VERSIONMAC
+		if ( chunk.fCatalog != NULL && _IsExecutable( (char*) chunk.fRawData, chunk.fRawSize ) )
+		{
+			uWORD mode;
+			chunk.fCatalog->GetFile()->MAC_GetPermissions( &mode );
+			mode |= 0111;
+			chunk.fCatalog->GetFile()->MAC_SetPermissions(mode);
+		}
+#endif
+		ioPartialByteCount += chunk.fRawSize;
+	}
+	ioBatch.Clear();
+
+	for ( std::vector<VFileDesc*>::iterator i = ioDoneFileDescs.begin() ; i != ioDoneFileDescs.end() ; ++i )
+		delete *i;
+	ioDoneFileDescs.clear();
+
+	if ( fCallBack && result == VE_OK )
+	{
+		fCallBack(CB_UpdateProgress,ioPartialByteCount,inTotalByteCount,userAbort);
+		if ( userAbort )
+			result = VE_STREAM_USER_ABORTED;
+	}
+	return result;
+}
+
+VError VArchiveUnStream::_ExtractCompressedEntries( const ArchiveCatalog &inEntries )
+{
+	VError result = VE_OK;
+	bool userAbort = false;
+	uLONG8 partialByteCount = 0;
+	uLONG8 totalByteCount = 0;
+
+	for ( ArchiveCatalog::const_iterator i = inEntries.begin() ; i != inEntries.end() ; ++i )
+		totalByteCount += (*i)->GetFileSize( fst_Both );
+
+	if ( fCallBack )
+		fCallBack(CB_OpenProgress,partialByteCount,totalByteCount,userAbort);
+
+	VArchiveChunkBatch batch( false );
+	std::vector<VFileDesc*> doneFileDescs;
+
+	for ( ArchiveCatalog::const_iterator i = inEntries.begin() ; i != inEntries.end() && result == VE_OK ; ++i )
+	{
+		VArchiveCatalog *catalog = *i;
+		VFileDesc *fileDescs[2] = { NULL, NULL };
+
+		VFolder *parentFolder = catalog->GetFile()->RetainParentFolder();
+		if ( parentFolder )
+		{
+			result = parentFolder->CreateRecursive();
+			parentFolder->Release();
+		}
+		if ( result == VE_OK )
+		{
+			result = catalog->GetFile()->Open( FA_SHARED, &fileDescs[0], FO_CreateIfNotFound);
+#if VERSIONMAC
+			catalog->GetFile()->MAC_SetKind(catalog->GetKind());
+			catalog->GetFile()->MAC_SetCreator(catalog->GetCreator());
+			if ( result == VE_OK && catalog->GetFileSize( fst_Resource ) > 0 )
+				result = catalog->GetFile()->Open( FA_SHARED, &fileDescs[1], FO_OpenResourceFork);
+#endif
+		}
+
+		for ( sLONG fork = 0 ; fork < 2 && result == VE_OK ; ++fork )
+		{
+			eFileSizeType forkType = (fork == 0) ? fst_Data : fst_Resource;
+			VFileDesc *fileDesc = fileDescs[fork];
+			sLONG8 forkSize = (fork == 0) ? catalog->GetFileSize( fst_Data ) : catalog->GetFileSize( fst_Resource );
+			sLONG8 offset = 0;
+
+			if ( fileDesc == NULL )
+				continue;
+
+			result = fileDesc->SetSize( forkSize );
+			if ( result == VE_OK && forkSize > 0 )
+				result = fStream->SetPos( catalog->GetForkOffset( forkType ) );
+
+			while ( offset < forkSize && result == VE_OK )
+			{
+				if ( batch.IsFull() )
+					result = _RunExtractBatch( batch, doneFileDescs, partialByteCount, totalByteCount );
+
+				if ( result == VE_OK )
+				{
+					sLONG rawSize = fStream->GetLong();
+					sLONG storedSize = fStream->GetLong();
+					if ( (rawSize <= 0) || (rawSize > kARCHIVE_CHUNK_SIZE) || (storedSize <= 0) || (storedSize > rawSize) || (offset + rawSize > forkSize) )
+						result = VE_STREAM_BAD_SIGNATURE;
+
+					if ( result == VE_OK )
+					{
+						VArchiveChunk& chunk = batch.Add();
+						chunk.fFileDesc = fileDesc;
+						chunk.fCatalog = (fork == 0 && offset == 0) ? catalog : NULL;	/* the first chunk tells if the file is an executable */
+						chunk.fOffset = offset;
+						chunk.fRawSize = rawSize;
+						chunk.fStoredSize = storedSize;
+						result = fStream->GetData(chunk.fStoredBuffer,storedSize);
+						offset += rawSize;
+					}
+				}
+			}
+		}
+
+		/* the batch may still have chunks for these files */
+		for ( sLONG fork = 0 ; fork < 2 ; ++fork )
+		{
+			if ( fileDescs[fork] != NULL )
+				doneFileDescs.push_back( fileDescs[fork] );
+		}
+	}
+
+	if ( result == VE_OK && !batch.IsEmpty() )
+		result = _RunExtractBatch( batch, doneFileDescs, partialByteCount, totalByteCount );
+
+	for ( std::vector<VFileDesc*>::iterator i = doneFileDescs.begin() ; i != doneFileDescs.end() ; ++i )
+		delete *i;
+
+	if ( fCallBack )
+		fCallBack(CB_CloseProgress,partialByteCount,totalByteCount,userAbort);
+
+	return result;
+}
+
 VError VArchiveUnStream::ProceedFile()
 {
+	if ( fVersion >= kARCHIVE_VERSION_COMPRESSED )
+	{
+		/* version 5 archives have the position of each file: only extracted ones are read */
+		ArchiveCatalog entries;
+		for ( ArchiveCatalog::iterator i = fFileCatalog.begin() ; i != fFileCatalog.end() ; ++i )
+		{
+			if ( (*i)->GetExtractFlag() )
+				entries.push_back( *i );
+		}
+		return _ExtractCompressedEntries( entries );
+	}
+
 	VError result = VE_OK;
 	bool userAbort = false;
 	uLONG8 partialByteCount = 0;
@@ -751,6 +1449,17 @@ VError VArchiveUnStream::Proceed()
 	return result;
 }
 
+VError VArchiveUnStream::ProceedEntry( VArchiveCatalog *inEntry )
+{
+	VError result = VE_STREAM_BAD_VERSION;
+	if ( fVersion >= kARCHIVE_VERSION_COMPRESSED )
+	{
+		ArchiveCatalog entries( 1, inEntry );
+		result = _ExtractCompressedEntries( entries );
+	}
+	return result;
+}
+
 ArchiveCatalog* VArchiveUnStream::GetCatalog()
 {
 	return &fFileCatalog;
@@ -22,6 +22,8 @@
 
 BEGIN_TOOLBOX_NAMESPACE
 
+class VArchiveChunkBatch;
+
 typedef enum eCallBackAction
 {
 	CB_OpenProgress,
@@ -51,6 +53,10 @@ public:
 	uLONG		GetKind();
 	uLONG		GetCreator();
 
+	// position of the first chunk of a fork in the archive stream (version 5 archives only, -1 otherwise)
+	sLONG8		GetForkOffset( eFileSizeType inForkType = fst_Data );
+	void		SetForkOffsets( sLONG8 inDataOffset, sLONG8 inResOffset );
+
 protected:
 	VFile *fFile;
 	sLONG8 fResFileSize;
@@ -60,6 +66,8 @@ protected:
 	Boolean fExtract;
 	uLONG fKind;
 	uLONG fCreator;
+	sLONG8 fDataOffset;
+	sLONG8 fResOffset;
 };
 
 typedef std::vector<VArchiveCatalog*> ArchiveCatalog;
@@ -91,10 +99,18 @@ public:
 			void	SetStreamer( VStream* inStream );
 			void	SetProgressCallBack( CB_VArchiveStream inProgressCallBack );
 
+			/* 4 (default): sequential uncompressed archive.
+			   5: files are split in chunks compressed by several tasks, followed by a catalog giving the offset of each file,
+			   so that VArchiveUnStream can extract a single file or restore files in parallel. */
+			void	SetVersion( uBYTE inVersion );
+
 	virtual	VError	Proceed();
 
 protected:
 
+			VError	_ProceedCompressed();
+			VFileDesc*	_OpenFork( size_t inEntry, bool inResourceFork, bool &outOwned );
+
 	virtual VError	_WriteCatalog( const VFile* inFile, const VString &inExtraInfo, uLONG8 &ioTotalByteCount );
 	virtual VError	_WriteFile( const VFileDesc* inFileDesc, char* buffToUse, VSize buffSize, uLONG8 &ioPartialByteCount, uLONG8 inTotalByteCount );
 
@@ -109,6 +125,7 @@ protected:
 
 	VStream				*fStream;			/* streaming used for pushing data */
 	CB_VArchiveStream	fCallBack;			/* compression progress call back */
+	uBYTE				fVersion;			/* archive format version */
 };
 
 class XTOOLBOX_API VArchiveUnStream : public VObject
@@ -128,6 +145,10 @@ public:
 	virtual	VError			ProceedCatalog();
 	virtual	VError			ProceedFile();
 
+	/* extracts a single file of the catalog, whatever its extract flag.
+	   Needs a version 5 archive, returns VE_STREAM_BAD_VERSION otherwise. */
+	virtual	VError			ProceedEntry( VArchiveCatalog *inEntry );
+
 	virtual	ArchiveCatalog*	GetCatalog();
 
 protected:
@@ -136,9 +157,13 @@ protected:
 	#if VERSIONMAC
 	static bool				_IsExecutable(char* buffToUse, VSize buffSize);
 	#endif
+
+			VError			_ExtractCompressedEntries( const ArchiveCatalog &inEntries );
+			VError			_RunExtractBatch( VArchiveChunkBatch &ioBatch, std::vector<VFileDesc*> &ioDoneFileDescs, uLONG8 &ioPartialByteCount, uLONG8 inTotalByteCount );
 	
 	VFile				*fSourceFile;
 	uLONG8				fTotalByteCount;
+	uBYTE				fVersion;			/* archive format version read by ProceedCatalog */
 
 	ArchiveCatalog		fFileCatalog;
 	VFilePath			fDestinationFolder;
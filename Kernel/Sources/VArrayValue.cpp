@@ -1103,7 +1103,7 @@ void VArrayByte::Sort(sLONG inFrom, sLONG inTo, Boolean inDescending)
 	inFrom--;
 
 	sBYTE* data = (sBYTE*) LockAndGetData();
-	QSort<sBYTE>(data + inFrom, inTo - inFrom, inDescending);
+	RadixSort<sBYTE>(data + inFrom, inTo - inFrom, inDescending);
 	UnlockData();
 }
 
@@ -1346,6 +1346,17 @@ CompareResult VArrayByte::CompareElements(uBYTE* inData, sLONG inA, sLONG inB)
 }
 
 
+bool VArrayByte::GetSortKeys(uBYTE* inData, sLONG inFrom, sLONG inCount, uLONG8* outKeys)
+{
+	const sBYTE*	ptr = ((sBYTE*) inData) + inFrom;
+
+	for (sLONG i = 0; i < inCount; i++)
+		outKeys[i] = GetSortKey(ptr[i]);
+
+	return true;
+}
+
+
 const VValueInfo *VArrayByte::GetValueInfo() const
 {
 	return &sInfo;
@@ -1477,7 +1488,7 @@ void VArrayWord::Sort(sLONG inFrom, sLONG inTo, Boolean inDescending)
 	inFrom--;
 
 	sWORD* data = (sWORD*) LockAndGetData();
-	QSort<sWORD>(data + inFrom, inTo - inFrom, inDescending);
+	RadixSort<sWORD>(data + inFrom, inTo - inFrom, inDescending);
 	UnlockData();
 }
 
@@ -1720,6 +1731,17 @@ CompareResult VArrayWord::CompareElements(uBYTE* inData, sLONG inA, sLONG inB)
 }
 
 
+bool VArrayWord::GetSortKeys(uBYTE* inData, sLONG inFrom, sLONG inCount, uLONG8* outKeys)
+{
+	const sWORD*	ptr = ((sWORD*) inData) + inFrom;
+
+	for (sLONG i = 0; i < inCount; i++)
+		outKeys[i] = GetSortKey(ptr[i]);
+
+	return true;
+}
+
+
 const VValueInfo *VArrayWord::GetValueInfo() const
 {
 	return &sInfo;
@@ -1837,6 +1859,17 @@ CompareResult VArrayLong::CompareElements(uBYTE* inData, sLONG inA, sLONG inB)
 }
 
 
+bool VArrayLong::GetSortKeys(uBYTE* inData, sLONG inFrom, sLONG inCount, uLONG8* outKeys)
+{
+	const sLONG*	ptr = ((sLONG*) inData) + inFrom;
+
+	for (sLONG i = 0; i < inCount; i++)
+		outKeys[i] = GetSortKey(ptr[i]);
+
+	return true;
+}
+
+
 sLONG VArrayLong::QuickFind(sLONG inValue) const
 {
 	sLONG*	data = (sLONG*) LockAndGetData();
@@ -1879,7 +1912,7 @@ void VArrayLong::Sort(sLONG inFrom, sLONG inTo, Boolean inDescending)
 	inFrom--;
 
 	sLONG* data = (sLONG*) LockAndGetData();
-	QSort<sLONG>(data + inFrom, inTo - inFrom, inDescending);
+	RadixSort<sLONG>(data + inFrom, inTo - inFrom, inDescending);
 	UnlockData();
 }
 
@@ -2164,6 +2197,17 @@ CompareResult VArrayLong8::CompareElements(uBYTE* inData, sLONG inA, sLONG inB)
 }
 
 
+bool VArrayLong8::GetSortKeys(uBYTE* inData, sLONG inFrom, sLONG inCount, uLONG8* outKeys)
+{
+	const sLONG8*	ptr = ((sLONG8*) inData) + inFrom;
+
+	for (sLONG i = 0; i < inCount; i++)
+		outKeys[i] = GetSortKey(ptr[i]);
+
+	return true;
+}
+
+
 sLONG VArrayLong8::QuickFind(sLONG8 inValue) const
 {
 	sLONG8*	data = (sLONG8*) LockAndGetData();
@@ -2206,7 +2250,7 @@ void VArrayLong8::Sort(sLONG inFrom, sLONG inTo, Boolean inDescending)
 	inFrom--;
 
 	sLONG8* data = (sLONG8*) LockAndGetData();
-	QSort<sLONG8>(data + inFrom, inTo - inFrom, inDescending);
+	RadixSort<sLONG8>(data + inFrom, inTo - inFrom, inDescending);
 	UnlockData();
 }
 
@@ -2492,6 +2536,17 @@ CompareResult VArrayReal::CompareElements(uBYTE* inData, sLONG inA, sLONG inB)
 }
 
 
+bool VArrayReal::GetSortKeys(uBYTE* inData, sLONG inFrom, sLONG inCount, uLONG8* outKeys)
+{
+	const Real*	ptr = ((Real*) inData) + inFrom;
+
+	for (sLONG i = 0; i < inCount; i++)
+		outKeys[i] = GetSortKey(ptr[i]);
+
+	return true;
+}
+
+
 sLONG VArrayReal::QuickFind(Real inValue) const
 {
 	Real*	data = (Real*) LockAndGetData();
@@ -3967,6 +4022,17 @@ CompareResult VArrayDuration::CompareElements(uBYTE* inData, sLONG inA, sLONG in
 }
 
 
+bool VArrayDuration::GetSortKeys(uBYTE* inData, sLONG inFrom, sLONG inCount, uLONG8* outKeys)
+{
+	const sLONG8*	ptr = ((sLONG8*) inData) + inFrom;
+
+	for (sLONG i = 0; i < inCount; i++)
+		outKeys[i] = GetSortKey(ptr[i]);
+
+	return true;
+}
+
+
 const VValueInfo *VArrayDuration::GetValueInfo() const
 {
 	return &sInfo;
@@ -4247,6 +4313,17 @@ CompareResult VArrayTime::CompareElements(uBYTE* inData, sLONG inA, sLONG inB)
 }
 
 
+bool VArrayTime::GetSortKeys(uBYTE* inData, sLONG inFrom, sLONG inCount, uLONG8* outKeys)
+{
+	const uLONG8*	ptr = ((uLONG8*) inData) + inFrom;
+
+	for (sLONG i = 0; i < inCount; i++)
+		outKeys[i] = GetSortKey(ptr[i]);
+
+	return true;
+}
+
+
 const VValueInfo *VArrayTime::GetValueInfo() const
 {
 	return &sInfo;
@@ -184,6 +184,7 @@ public:
 protected:
 	virtual void	SwapElements (uBYTE* data, sLONG inA, sLONG inB);
 	virtual CompareResult	CompareElements (uBYTE* data, sLONG inA, sLONG inB);
+	virtual bool	GetSortKeys (uBYTE* data, sLONG inFrom, sLONG inCount, uLONG8* outKeys);
 };
 
 
@@ -229,6 +230,7 @@ public:
 protected:
 	virtual void	SwapElements (uBYTE* data, sLONG inA, sLONG inB);
 	virtual CompareResult	CompareElements (uBYTE* data, sLONG inA, sLONG inB);
+	virtual bool	GetSortKeys (uBYTE* data, sLONG inFrom, sLONG inCount, uLONG8* outKeys);
 };
 
 
@@ -275,6 +277,7 @@ public:
 protected:
 	virtual void	SwapElements (uBYTE* data, sLONG inA, sLONG inB);
 	virtual CompareResult	CompareElements (uBYTE* data, sLONG inA, sLONG inB);
+	virtual bool	GetSortKeys (uBYTE* data, sLONG inFrom, sLONG inCount, uLONG8* outKeys);
 };
 
 
@@ -316,6 +319,7 @@ public:
 protected:
 	virtual void	SwapElements (uBYTE* data, sLONG inA, sLONG inB);
 	virtual CompareResult	CompareElements (uBYTE* data, sLONG inA, sLONG inB);
+	virtual bool	GetSortKeys (uBYTE* data, sLONG inFrom, sLONG inCount, uLONG8* outKeys);
 };
 
 
@@ -363,6 +367,7 @@ public:
 protected:
 	virtual void	SwapElements (uBYTE* data, sLONG inA, sLONG inB);
 	virtual CompareResult	CompareElements (uBYTE* data, sLONG inA, sLONG inB);
+	virtual bool	GetSortKeys (uBYTE* data, sLONG inFrom, sLONG inCount, uLONG8* outKeys);
 };
 
 
@@ -443,6 +448,7 @@ public:
 protected:
 	virtual void	SwapElements (uBYTE* data, sLONG inA, sLONG inB);
 	virtual CompareResult	CompareElements (uBYTE* data, sLONG inA, sLONG inB);
+	virtual bool	GetSortKeys (uBYTE* data, sLONG inFrom, sLONG inCount, uLONG8* outKeys);
 };
 
 
@@ -482,6 +488,7 @@ public:
 protected:
 	virtual void	SwapElements (uBYTE* data, sLONG inA, sLONG inB);
 	virtual CompareResult	CompareElements (uBYTE* data, sLONG inA, sLONG inB);
+	virtual bool	GetSortKeys (uBYTE* data, sLONG inFrom, sLONG inCount, uLONG8* outKeys);
 };
 
 
@@ -220,6 +220,134 @@ VError VFileDesc::PutDataAtPos( const void *inData, VSize inCount, sLONG8 inOffs
 }
 
 
+VError VFileDesc::ReadAt( void *outData, VSize inCount, sLONG8 inOffset, VSize *outActualCount) const
+{
+	VSize size = inCount;
+#if VERSION_LINUX
+	VError err = fImpl.ReadAt( outData, size, inOffset);
+#else
+	VError err = fImpl.GetData( outData, size, inOffset, true);
+#endif
+	xbox_assert( (size == inCount) || (err != VE_OK) );
+
+	if (outActualCount)
+		*outActualCount = size;
+
+	if (IS_NATIVE_VERROR( err))
+	{
+		StThrowFileError errThrow( fFile, VE_STREAM_CANNOT_GET_DATA, err);
+		errThrow->SetLong( "count", inCount);
+		errThrow->SetLong8( "offset", inOffset);
+
+		sLONG8 dsize;
+		if (fImpl.GetSize( &dsize) == VE_OK)
+			errThrow->SetLong8( "size", dsize);
+
+		err = errThrow.GetError();
+	}
+
+	return err;
+}
+
+
+VError VFileDesc::WriteAt( const void *inData, VSize inCount, sLONG8 inOffset, VSize *outActualCount) const
+{
+	VSize size = inCount;
+#if VERSION_LINUX
+	VError err = fImpl.WriteAt( inData, size, inOffset);
+#else
+	VError err = fImpl.PutData( inData, size, inOffset, true);
+#endif
+	xbox_assert( (size == inCount) || (err != VE_OK) );
+
+	if (outActualCount)
+		*outActualCount = size;
+
+	if (IS_NATIVE_VERROR( err))
+	{
+		StThrowFileError errThrow( fFile, VE_STREAM_CANNOT_PUT_DATA, err);
+		errThrow->SetLong( "count", inCount);
+		errThrow->SetLong8( "offset", inOffset);
+
+		sLONG8 dsize;
+		if (fImpl.GetSize( &dsize) == VE_OK)
+			errThrow->SetLong8( "size", dsize);
+
+		err = errThrow.GetError();
+	}
+
+	return err;
+}
+
+
+VError VFileDesc::ReadVAt( const VFileIOBuffer *inBuffers, sLONG inBufferCount, sLONG8 inOffset, VSize *outActualCount) const
+{
+	VSize count = 0;
+#if VERSION_LINUX
+	VError err = fImpl.ReadVAt( inBuffers, inBufferCount, count, inOffset);
+#else
+	VError err = VE_OK;
+	for( sLONG i = 0 ; (i < inBufferCount) && (err == VE_OK) ; ++i)
+	{
+		VSize size = inBuffers[i].fSize;
+		err = fImpl.GetData( inBuffers[i].fData, size, inOffset + count, true);
+		count += size;
+	}
+#endif
+
+	if (outActualCount)
+		*outActualCount = count;
+
+	if (IS_NATIVE_VERROR( err))
+	{
+		StThrowFileError errThrow( fFile, VE_STREAM_CANNOT_GET_DATA, err);
+		errThrow->SetLong8( "offset", inOffset);
+
+		sLONG8 dsize;
+		if (fImpl.GetSize( &dsize) == VE_OK)
+			errThrow->SetLong8( "size", dsize);
+
+		err = errThrow.GetError();
+	}
+
+	return err;
+}
+
+
+VError VFileDesc::WriteVAt( const VFileIOBuffer *inBuffers, sLONG inBufferCount, sLONG8 inOffset, VSize *outActualCount) const
+{
+	VSize count = 0;
+#if VERSION_LINUX
+	VError err = fImpl.WriteVAt( inBuffers, inBufferCount, count, inOffset);
+#else
+	VError err = VE_OK;
+	for( sLONG i = 0 ; (i < inBufferCount) && (err == VE_OK) ; ++i)
+	{
+		VSize size = inBuffers[i].fSize;
+		err = fImpl.PutData( inBuffers[i].fData, size, inOffset + count, true);
+		count += size;
+	}
+#endif
+
+	if (outActualCount)
+		*outActualCount = count;
+
+	if (IS_NATIVE_VERROR( err))
+	{
+		StThrowFileError errThrow( fFile, VE_STREAM_CANNOT_PUT_DATA, err);
+		errThrow->SetLong8( "offset", inOffset);
+
+		sLONG8 dsize;
+		if (fImpl.GetSize( &dsize) == VE_OK)
+			errThrow->SetLong8( "size", dsize);
+
+		err = errThrow.GetError();
+	}
+
+	return err;
+}
+
+
 sLONG8 VFileDesc::GetPos() const
 {
 	sLONG8 pos;
@@ -36,6 +36,13 @@ BEGIN_TOOLBOX_NAMESPACE
 class VFileKind;
 class VVolumeInfo;
 
+// one buffer of a vectored read or write (see VFileDesc::ReadVAt)
+struct VFileIOBuffer
+{
+	void*	fData;
+	VSize	fSize;
+};
+
 // you can not create a VFileDesc by yourself, you have to get one by calling the method VFile::Open
 // or "create" with a VFile
 class XTOOLBOX_API VFileDesc : public VObject
@@ -81,6 +88,16 @@ public:
 			// absolute offset by default
 			VError				SetPos( sLONG8 inOffset, bool inFromStart = true) const;
 
+			// positional I/O: read or write inCount bytes at inOffset from beginning, without using the current pos.
+			// On Linux they map to pread/pwrite and the current pos is left untouched, so that several threads may share
+			// the same VFileDesc without serializing. On other platforms they behave like GetData/PutData.
+			VError				ReadAt( void *outData, VSize inCount, sLONG8 inOffset, VSize *outActualCount = NULL) const;
+			VError				WriteAt( const void *inData, VSize inCount, sLONG8 inOffset, VSize *outActualCount = NULL) const;
+
+			// vectored versions (preadv/pwritev on Linux): buffers are filled or written in order, starting at inOffset.
+			VError				ReadVAt( const VFileIOBuffer *inBuffers, sLONG inBufferCount, sLONG8 inOffset, VSize *outActualCount = NULL) const;
+			VError				WriteVAt( const VFileIOBuffer *inBuffers, sLONG inBufferCount, sLONG8 inOffset, VSize *outActualCount = NULL) const;
+
 			VError				Flush() const; 
 
 			FileAccess			GetMode() const											{ return fMode; }
@@ -355,3 +355,121 @@ void VFileStream::ReleaseBuffer()
 }
 
 
+
+VMappedFileStream::VMappedFileStream( const VFile *inFile, bool inSequentialAccess)
+: VFileStream( inFile)
+{
+	fSequentialAccess = inSequentialAccess;
+	fMappedData = NULL;
+	fMappedSize = 0;
+}
+
+
+VMappedFileStream::~VMappedFileStream()
+{
+	_UnMap();
+}
+
+
+VFileStream* VMappedFileStream::Create( const VFile *inFile, bool inSequentialAccess)
+{
+	sLONG8 size;
+	if (inFile->Exists() && (inFile->GetSize( &size) == VE_OK) && (size >= kMinMappedSize))
+		return new VMappedFileStream( inFile, inSequentialAccess);
+	
+	return new VFileStream( inFile);
+}
+
+
+const void* VMappedFileStream::GetDataPointer( sLONG8 inOffset, VSize inCount) const
+{
+	if ( (fMappedData == NULL) || (inOffset < 0) || (inOffset > (sLONG8) fMappedSize) || (inCount > fMappedSize - (VSize) inOffset) )
+		return NULL;
+
+	return fMappedData + inOffset;
+}
+
+
+VError VMappedFileStream::DoOpenReading()
+{
+	if (fFile == NULL)
+		return vThrowError( VE_STREAM_CANNOT_FIND_SOURCE);
+	
+	VError err = VE_OK;
+	if (fFileDesc == NULL)
+	{
+		err = fFile->Open( FA_READ, &fFileDesc, fSequentialAccess ? FO_SequentialScan : FO_RandomAccess);
+	}
+	
+	if (err == VE_OK)
+	{
+		fLogSize = fFileDesc->GetSize();
+
+#if VERSION_LINUX
+		// an empty file can't be mapped, and the whole file must fit in the address space.
+		if ( (fLogSize > 0) && ((sLONG8) (VSize) fLogSize == fLogSize) )
+		{
+			if (fMapHelper.Map( fFileDesc->GetSystemRef(), (VSize) fLogSize) == VE_OK)
+			{
+				fMappedData = (const sBYTE*) fMapHelper.GetAddr();
+				fMappedSize = (VSize) fLogSize;
+
+				// only a hint for the kernel readahead
+				fMapHelper.Advise( fSequentialAccess ? MapHelper::SEQUENTIAL : MapHelper::RANDOM);
+			}
+		}
+#endif
+
+		// not mapped: read through the VFileStream buffer
+		if (fMappedData == NULL)
+		{
+			if (fLogSize > (sLONG8)MaxLongInt)
+				AllocateBuffer(MaxLongInt);
+			else
+				AllocateBuffer( (VSize) fLogSize);
+		}
+	}
+
+	return err;
+}
+
+
+VError VMappedFileStream::DoCloseReading()
+{
+	_UnMap();
+
+	return VFileStream::DoCloseReading();
+}
+
+
+VError VMappedFileStream::DoGetData( void *inBuffer, VSize *ioCount)
+{
+	if (fMappedData == NULL)
+		return VFileStream::DoGetData( inBuffer, ioCount);
+
+	VError err = VE_OK;
+	sLONG8 pos = GetPos();
+	VSize available = (pos < (sLONG8) fMappedSize) ? (VSize) (fMappedSize - pos) : 0;
+
+	if (*ioCount > available)
+	{
+		*ioCount = available;
+		err = VE_STREAM_EOF;
+	}
+	
+	if (*ioCount > 0)
+		::CopyBlock( fMappedData + pos, inBuffer, *ioCount);
+
+	return err;
+}
+
+
+void VMappedFileStream::_UnMap()
+{
+#if VERSION_LINUX
+	if (fMappedData != NULL)
+		fMapHelper.UnMap();
+#endif
+	fMappedData = NULL;
+	fMappedSize = 0;
+}
@@ -63,6 +63,52 @@ protected:
 	void	ReleaseBuffer ();
 };
 
+
+/*
+	Read-only file stream that maps the whole file in memory instead of copying it through a private buffer,
+	so that GetDataPointer() gives direct access to the file content.
+
+	Mapping is only available on Linux. On other platforms, or if the mapping fails, VMappedFileStream behaves
+	exactly like a VFileStream and GetDataPointer() returns NULL, so callers must be ready to use GetData().
+
+	Beware that the file must not be truncated by someone else while it is mapped: touching the pages past the new
+	end of file raises SIGBUS. Only map files you own or ask for it explicitly (see XML_MapFile), never by default.
+*/
+class XTOOLBOX_API VMappedFileStream : public VFileStream
+{ 
+public:
+	// files smaller than this are not worth mapping (see Create)
+	static const sLONG8	kMinMappedSize = 1024L * 1024L;
+
+			VMappedFileStream (const VFile* inFile, bool inSequentialAccess = true);
+	virtual ~VMappedFileStream ();
+
+	// returns a VMappedFileStream if the file is at least kMinMappedSize bytes long, else a plain VFileStream.
+	static	VFileStream*	Create (const VFile* inFile, bool inSequentialAccess = true);
+
+	// returns a pointer on inCount bytes at inOffset, valid until the stream is closed.
+	// returns NULL if the file is not mapped or if the range goes beyond the end of file.
+			const void*		GetDataPointer (sLONG8 inOffset, VSize inCount) const;
+
+			bool			IsMapped () const	{ return fMappedData != NULL; }
+
+protected:
+	// Inherited from VStream
+	virtual VError	DoOpenReading ();
+	virtual VError	DoCloseReading ();
+	virtual VError	DoGetData (void* inBuffer, VSize* ioCount);
+	
+private:
+			bool			fSequentialAccess;
+			const sBYTE*	fMappedData;
+			VSize			fMappedSize;
+#if VERSION_LINUX
+			MapHelper		fMapHelper;
+#endif
+
+			void			_UnMap ();
+};
+
 END_TOOLBOX_NAMESPACE
 
 #endif
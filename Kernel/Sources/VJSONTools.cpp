@@ -18,6 +18,8 @@
 #include "VJSONTools.h"
 #include "VError.h"
 #include "VValueBag.h"
+#include "VStream.h"
+#include "VErrorContext.h"
 
 BEGIN_TOOLBOX_NAMESPACE
 
@@ -463,6 +465,264 @@ VError VJSONImporter::JSONObjectToBag(VValueBag& outBag)
 	return vThrowError(err);
 }
 
+// ===========================================================
+#pragma mark -
+#pragma mark VJSONStreamTokenizer
+// ===========================================================
+
+VJSONStreamTokenizer::VJSONStreamTokenizer( VStream* inStream, VSize inBufferSize)
+: fStream( inStream)
+, fBuffer( NULL)
+, fBufferSize( inBufferSize)
+, fCurChar( NULL)
+, fEnd( NULL)
+, fIsFirstChunk( true)
+, fTokenData( NULL)
+, fTokenSize( 0)
+, fTokenIsQuoted( false)
+, fTokenHasEscapes( false)
+, fLastError( VE_OK)
+{
+	if (fBufferSize < 16)
+		fBufferSize = 16;
+	fBuffer = VMemory::NewPtr( fBufferSize, 'json');
+	if (fBuffer == NULL)
+		fLastError = VE_MEMORY_FULL;
+}
+
+
+VJSONStreamTokenizer::VJSONStreamTokenizer( const void* inData, VSize inDataSize)
+: fStream( NULL)
+, fBuffer( NULL)
+, fBufferSize( 0)
+, fCurChar( (const char*) inData)
+, fEnd( (const char*) inData + inDataSize)
+, fIsFirstChunk( true)
+, fTokenData( NULL)
+, fTokenSize( 0)
+, fTokenIsQuoted( false)
+, fTokenHasEscapes( false)
+, fLastError( VE_OK)
+{
+}
+
+
+VJSONStreamTokenizer::~VJSONStreamTokenizer()
+{
+	if (fBuffer != NULL)
+		VMemory::DisposePtr( fBuffer);
+}
+
+
+bool VJSONStreamTokenizer::_FillBuffer()
+{
+	if (fStream == NULL || fBuffer == NULL || fLastError != VE_OK)
+		return false;
+
+	VSize nbBytes = 0;
+	VError err;
+	{
+		// reading less than asked at the end of the stream is expected
+		StErrorContextInstaller context( false, true);
+		err = fStream->GetData( fBuffer, fBufferSize, &nbBytes);
+	}
+	if (err != VE_OK && err != VE_STREAM_EOF)
+	{
+		fLastError = vThrowError( err);
+		return false;
+	}
+	
+	fCurChar = fBuffer;
+	fEnd = fBuffer + nbBytes;
+	return nbBytes > 0;
+}
+
+
+void VJSONStreamTokenizer::_SetTokenFrom( const char* inStart, const char* inEnd, bool inSpilled)
+{
+	if (inSpilled)
+	{
+		fSpill.insert( fSpill.end(), inStart, inEnd);
+		fTokenData = fSpill.empty() ? NULL : &fSpill[0];
+		fTokenSize = fSpill.size();
+	}
+	else
+	{
+		fTokenData = inStart;
+		fTokenSize = inEnd - inStart;
+	}
+}
+
+
+VJSONImporter::JsonToken VJSONStreamTokenizer::GetNextToken()
+{
+	fTokenData = NULL;
+	fTokenSize = 0;
+	fTokenIsQuoted = false;
+	fTokenHasEscapes = false;
+	fSpill.clear();
+
+	for(;;)
+	{
+		if (fCurChar == fEnd && !_FillBuffer())
+			return VJSONImporter::jsonNone;
+
+		if (fIsFirstChunk)
+		{
+			// skip the UTF-8 BOM
+			fIsFirstChunk = false;
+			if ( (fEnd - fCurChar >= 3) && ((uBYTE) fCurChar[0] == 0xEF) && ((uBYTE) fCurChar[1] == 0xBB) && ((uBYTE) fCurChar[2] == 0xBF) )
+				fCurChar += 3;
+		}
+
+		while( (fCurChar != fEnd) && ((uBYTE) *fCurChar <= 32) )
+			++fCurChar;
+		if (fCurChar != fEnd)
+			break;
+	}
+	
+	char c = *fCurChar++;
+	switch( c)
+	{
+		case '{':	return VJSONImporter::jsonBeginObject;
+		case '}':	return VJSONImporter::jsonEndObject;
+		case '[':	return VJSONImporter::jsonBeginArray;
+		case ']':	return VJSONImporter::jsonEndArray;
+		case ',':	return VJSONImporter::jsonSeparator;
+		case ':':	return VJSONImporter::jsonAssigne;
+
+		case '"':
+		{
+			fTokenIsQuoted = true;
+			bool spilled = false;
+			bool escaped = false;
+			for(;;)
+			{
+				const char *p = fCurChar;
+				for( ; p != fEnd ; ++p)
+				{
+					if (escaped)
+						escaped = false;
+					else if (*p == '\\')
+						escaped = fTokenHasEscapes = true;
+					else if (*p == '"')
+						break;
+				}
+				if (p != fEnd)
+				{
+					_SetTokenFrom( fCurChar, p, spilled);
+					fCurChar = p + 1;
+					return VJSONImporter::jsonString;
+				}
+				fSpill.insert( fSpill.end(), fCurChar, fEnd);
+				spilled = true;
+				if (!_FillBuffer())
+				{
+					// unterminated string
+					if (fLastError == VE_OK)
+						fLastError = VE_MALFORMED_JSON_DESCRIPTION;
+					return VJSONImporter::jsonNone;
+				}
+			}
+		}
+
+		default:
+		{
+			// number, true, false or null: up to the next blank or structural char
+			bool spilled = false;
+			const char *start = fCurChar - 1;
+			for(;;)
+			{
+				const char *p = fCurChar;
+				for( ; p != fEnd ; ++p)
+				{
+					uBYTE b = (uBYTE) *p;
+					if ( (b <= 32) || (b == '{') || (b == '}') || (b == '[') || (b == ']') || (b == ',') || (b == ':') || (b == '"') )
+						break;
+				}
+				if ( (p != fEnd) || (fStream == NULL) )
+				{
+					_SetTokenFrom( spilled ? fCurChar : start, p, spilled);
+					fCurChar = p;
+					return VJSONImporter::jsonString;
+				}
+				fSpill.insert( fSpill.end(), spilled ? fCurChar : start, fEnd);
+				spilled = true;
+				if (!_FillBuffer())
+				{
+					// the value ends with the input
+					_SetTokenFrom( fEnd, fEnd, true);
+					return (fLastError == VE_OK) ? VJSONImporter::jsonString : VJSONImporter::jsonNone;
+				}
+			}
+		}
+	}
+}
+
+
+VError VJSONStreamTokenizer::GetTokenString( VString& outString) const
+{
+	if (!fTokenHasEscapes)
+	{
+		outString.FromBlock( fTokenData, fTokenSize, VTC_UTF_8);
+		return VE_OK;
+	}
+
+	outString.Clear();
+	const char *p = fTokenData;
+	const char *end = fTokenData + fTokenSize;
+	while( p != end)
+	{
+		const char *run = p;
+		while( (p != end) && (*p != '\\') )
+			++p;
+		if (p != run)
+			outString.AppendBlock( run, p - run, VTC_UTF_8);
+		if (p == end)
+			break;
+
+		if (++p == end)
+			return VE_MALFORMED_JSON_DESCRIPTION;
+
+		UniChar c;
+		switch( *p++)
+		{
+			case '\\':	c = '\\'; break;
+			case '"':	c = '"'; break;
+			case '/':	c = '/'; break;
+			case 't':	c = 9; break;
+			case 'r':	c = 13; break;
+			case 'n':	c = 10; break;
+			case 'b':	c = 8; break;
+			case 'f':	c = 12; break;
+			case 'u':
+			{
+				// surrogates pairs are written as 2 escapes, so that appending both UniChars gives valid UTF-16
+				if (end - p < 4)
+					return VE_MALFORMED_JSON_DESCRIPTION;
+				c = 0;
+				for( sLONG i = 0 ; i < 4 ; ++i, ++p)
+				{
+					char h = *p;
+					if (h >= '0' && h <= '9')
+						c = (UniChar) (c * 16 + (h - '0'));
+					else if (h >= 'A' && h <= 'F')
+						c = (UniChar) (c * 16 + (h - 'A') + 10);
+					else if (h >= 'a' && h <= 'f')
+						c = (UniChar) (c * 16 + (h - 'a') + 10);
+					else
+						return VE_MALFORMED_JSON_DESCRIPTION;
+				}
+				break;
+			}
+			default:
+				return VE_MALFORMED_JSON_DESCRIPTION;
+		}
+		outString.AppendUniChar( c);
+	}
+	return VE_OK;
+}
+
 // ===========================================================
 #pragma mark -
 #pragma mark VJSONArrayWriter
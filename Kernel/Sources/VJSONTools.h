@@ -101,6 +101,64 @@ private:
 	
 };
 
+/** @brief	VJSONStreamTokenizer is a pull tokenizer for big UTF-8 JSON inputs, read from a VStream or a memory block.
+
+			Unlike VJSONImporter, the input is never converted into a VString:
+				-> A stream is read by chunks of inBufferSize bytes. A memory block is used in place.
+				-> String tokens are returned as views into the input (GetTokenData()/GetTokenSize(), UTF-8, without the quotes).
+				   A token is copied in a private buffer only if it straddles two chunks.
+				-> Escape sequences are decoded only when the value is asked with GetTokenString().
+			So memory used is the size of one chunk plus the size of the biggest token.
+
+			Tokens are the ones of VJSONImporter. Numbers, true, false and null are returned as jsonString with IsTokenQuoted() == false.
+			GetNextToken() returns jsonNone at the end of the input or on error (see GetLastError()).
+
+			WARNING: the view is valid only until the next call to GetNextToken().
+			WARNING: the memory block passed to the constructor is not duplicated.
+*/
+class XTOOLBOX_API VJSONStreamTokenizer : public VObject
+{
+public:
+	/**@brief	inStream must be opened for reading. It is not closed by the tokenizer. */
+						VJSONStreamTokenizer( VStream* inStream, VSize inBufferSize = 64 * 1024);
+						VJSONStreamTokenizer( const void* inData, VSize inDataSize);
+	virtual				~VJSONStreamTokenizer();
+
+	VJSONImporter::JsonToken	GetNextToken();
+
+	/**@brief	Raw UTF-8 content of the last jsonString token, escape sequences included */
+	const char*			GetTokenData() const		{ return fTokenData; }
+	VSize				GetTokenSize() const		{ return fTokenSize; }
+	bool				IsTokenQuoted() const		{ return fTokenIsQuoted; }
+	bool				TokenHasEscapes() const		{ return fTokenHasEscapes; }
+
+	/**@brief	Decodes the last jsonString token */
+	VError				GetTokenString( VString& outString) const;
+
+	VError				GetLastError() const		{ return fLastError; }
+
+private:
+						VJSONStreamTokenizer( const VJSONStreamTokenizer&);
+						VJSONStreamTokenizer& operator=( const VJSONStreamTokenizer&);
+
+	bool				_FillBuffer();
+	void				_SetTokenFrom( const char* inStart, const char* inEnd, bool inSpilled);
+
+	VStream*			fStream;
+	char*				fBuffer;			// owned in stream mode
+	VSize				fBufferSize;
+	const char*			fCurChar;
+	const char*			fEnd;
+	bool				fIsFirstChunk;
+	std::vector<char>	fSpill;				// token straddling two chunks
+	const char*			fTokenData;
+	VSize				fTokenSize;
+	bool				fTokenIsQuoted;
+	bool				fTokenHasEscapes;
+	VError				fLastError;
+};
+
+
 /** @brief	VJSONArrayWriter creates a JSON array: ["string",123,"2008-12-10T00:00:00",3.14,true]
 			No spaces, no human-more-easy-readable formating. For example, the php json_decode does'nt want carrage return,
 			it only allows a space after the comma between each element.
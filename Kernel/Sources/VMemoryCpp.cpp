@@ -29,6 +29,10 @@
 
 #include <algorithm>
 
+#if !VERSIONWIN
+	#include <pthread.h>
+#endif
+
 
 #if VERSIONMAC || VERSION_LINUX_ON_XCODE
 
@@ -50,8 +54,95 @@
 #define WITH_PURGE_TRIGGER 0
 
 
+#if VERSIONWIN
+	#define THREAD_LOCAL_STORAGE	__declspec(thread)
+#else
+	#define THREAD_LOCAL_STORAGE	__thread
+#endif
+
+
 BEGIN_TOOLBOX_NAMESPACE
 
+
+// small blocks caches of the current thread (see VMemThreadCache), one per VCppMemMgr the thread used.
+// a thread using more managers than that allocates from the others through their mutex.
+enum { kMaxThreadCaches = 4 };
+static THREAD_LOCAL_STORAGE VMemThreadCache*	sThreadCaches[kMaxThreadCaches];
+
+
+// caches of a manager that was deleted are not in its list anymore, only the thread still points to them.
+static void _FlushThreadCaches()
+{
+	for (sLONG i = 0; i < kMaxThreadCaches; i++)
+	{
+		VMemThreadCache* cache = sThreadCaches[i];
+		if (cache == NULL)
+			continue;
+		if (cache->GetOwner() != NULL)
+		{
+			cache->GetOwner()->FlushThreadCache();
+		}
+		else
+		{
+			sThreadCaches[i] = NULL;
+			cache->~VMemThreadCache();
+			::free(cache);
+		}
+	}
+}
+
+
+/*
+	Threads that don't run a VTask (or that allocate after VTask::_Exit) give their cached blocks back
+	through a thread exit callback, set up when a thread creates its first cache.
+*/
+#if VERSIONWIN
+
+static DWORD	sThreadCachesExitSlot = FLS_OUT_OF_INDEXES;
+
+static VOID WINAPI _ThreadCachesExitCallback(PVOID /*inData*/)
+{
+	_FlushThreadCaches();
+}
+
+static void _FlushThreadCachesAtExit()
+{
+	if (sThreadCachesExitSlot == FLS_OUT_OF_INDEXES)
+	{
+		DWORD slot = ::FlsAlloc(_ThreadCachesExitCallback);
+		if (slot == FLS_OUT_OF_INDEXES)
+			return;
+		if (VInterlocked::CompareExchange((sLONG*) &sThreadCachesExitSlot, (sLONG) FLS_OUT_OF_INDEXES, (sLONG) slot) != (sLONG) FLS_OUT_OF_INDEXES)
+			::FlsFree(slot);	// another thread got there first
+	}
+	::FlsSetValue(sThreadCachesExitSlot, (PVOID) 1);
+}
+
+#else
+
+static pthread_key_t	sThreadCachesExitKey;
+static pthread_once_t	sThreadCachesExitOnce = PTHREAD_ONCE_INIT;
+
+static void _ThreadCachesExitCallback(void* /*inData*/)
+{
+	_FlushThreadCaches();
+}
+
+static void _CreateThreadCachesExitKey()
+{
+	::pthread_key_create(&sThreadCachesExitKey, _ThreadCachesExitCallback);
+}
+
+static void _FlushThreadCachesAtExit()
+{
+	// the callback is only called for a non NULL value
+	::pthread_once(&sThreadCachesExitOnce, _CreateThreadCachesExitKey);
+	::pthread_setspecific(sThreadCachesExitKey, (void*) 1);
+}
+
+#endif
+
+
 class VMemCppImpl_stdlib : public XMemCppImpl
 {
 public:
@@ -158,6 +249,7 @@ VError VMemStats::DumpToStream(VStream* outStream)
 	outStream->PutText(L"\n\n");
 
 	outStream->PutText(L"Nb Objects = "+ToString(fNbObjects)+L"\n");
+	outStream->PutText(L"Thread Cache Hits = "+ToString(fNbThreadCacheHits)+L" , Misses = "+ToString(fNbThreadCacheMisses)+L"\n");
 	outStream->PutText(L"\n\n");
 	for (VMapOfObjectInfo::iterator cur = fObjectInfo.begin(), end = fObjectInfo.end(); cur != end; cur++)
 	{
@@ -263,6 +355,21 @@ void VMemStats::Dump()
 	DebugMsg(s);
 	DebugMsg(L"\n");
 
+	DebugMsg(L"Thread Cache Hits = ");
+	s.FromLong8(fNbThreadCacheHits);
+	DebugMsg(s);
+	DebugMsg(L"\n");
+
+	DebugMsg(L"Thread Cache Misses = ");
+	s.FromLong8(fNbThreadCacheMisses);
+	DebugMsg(s);
+	DebugMsg(L"\n");
+
+	DebugMsg(L"Thread Cache Blocks = ");
+	s.FromLong(fNbThreadCacheBlocks);
+	DebugMsg(s);
+	DebugMsg(L"\n");
+
 	DebugMsg(L"\n");
 	for_each(fObjectInfo.begin(), fObjectInfo.end(), DumpObjectInfo);
 
@@ -316,6 +423,10 @@ void VMemStats::Clear()
 	fBiggestBlock = 0;
 	fBiggestBlockFree = 0;
 	fNbObjects = 0;
+	fNbThreadCacheHits = 0;
+	fNbThreadCacheMisses = 0;
+	fNbThreadCacheBlocks = 0;
+	fThreadCacheBytes = 0;
 }
 
 
@@ -409,6 +520,15 @@ void VCppMemMgr::_Init( EAllocatorKind inKind, bool inWithDebugInfo, bool inWith
 
 	if (VProcess::GetCommandLineArgumentAsLong( "-memDebugFill", &val))
 		fWithStrangeFill = (val != 0);
+
+	// per thread caches bypass the debug headers and fill, use them only with the plain xbox allocator
+	fThreadCaches = NULL;
+	fRetiredThreadCacheHits = 0;
+	fRetiredThreadCacheMisses = 0;
+	fWithThreadCache = !fUseStdLibMgr && !fWithDebugInfo && !fWithStrangeFill;
+
+	if (VProcess::GetCommandLineArgumentAsLong( "-memThreadCache", &val))
+		fWithThreadCache = fWithThreadCache && (val != 0);
 	
 	fMaxVirtualAllocatedSize = (VSize) MaxLongInt;
 	fCurrentVirtualAllocatedSize = 0;
@@ -422,6 +542,14 @@ VCppMemMgr::~VCppMemMgr()
 		delete fStdMemMgr;
 	else
 	{
+		// threads may still point to their cache, detach them so that they don't use it anymore.
+		{
+			VKernelTaskLock lock(&fMgrMutex);
+			for (VMemThreadCache* cache = fThreadCaches; cache != NULL; cache = cache->GetNext())
+				cache->SetOwner(NULL);
+			fThreadCaches = NULL;
+		}
+
 		for (memarray::iterator cur = fMems.begin(), end = fMems.end(); cur != end; cur++)
 		{
 			delete *cur;
@@ -515,6 +643,145 @@ void VCppMemMgr::PurgeMem(sLONG whatBlock)
 }
 
 
+VMemThreadCache* VCppMemMgr::_GetThreadCache()
+{
+	sLONG freeSlot = -1;
+	for (sLONG i = 0; i < kMaxThreadCaches; i++)
+	{
+		VMemThreadCache* cache = sThreadCaches[i];
+		if (cache == NULL)
+		{
+			if (freeSlot < 0)
+				freeSlot = i;
+			continue;
+		}
+		if (cache->GetOwner() == this)
+			return cache;
+		if (cache->GetOwner() == NULL)
+		{
+			// its manager was deleted
+			sThreadCaches[i] = NULL;
+			cache->~VMemThreadCache();
+			::free(cache);
+			if (freeSlot < 0)
+				freeSlot = i;
+			continue;
+		}
+	}
+
+	if (freeSlot < 0)
+		return NULL;
+
+	// not allocated from ourself
+	void* p = ::malloc(sizeof(VMemThreadCache));
+	if (p == NULL)
+		return NULL;
+	VMemThreadCache* cache = new (p) VMemThreadCache(this);
+
+	{
+		VKernelTaskLock lock(&fMgrMutex);
+		cache->SetNext(fThreadCaches);
+		fThreadCaches = cache;
+	}
+	sThreadCaches[freeSlot] = cache;
+	_FlushThreadCachesAtExit();
+
+	return cache;
+}
+
+
+void* VCppMemMgr::_MallocFromThreadCache(VSize inNbBytes, bool inIsVObject, sLONG inTag)
+{
+	// same range as small blocks in VMemCppImpl::Malloc
+	if (inNbBytes >= kThirdStepAlloc)
+		return NULL;
+
+	VMemThreadCache* cache = _GetThreadCache();
+	if (cache == NULL)
+		return NULL;
+
+	sLONG step = VMemThreadImpl::GetStepFromSize(inNbBytes + VMemThreadImpl::SizeSmallHeader, NULL);
+	void* result = cache->Pop(step, inIsVObject, inTag);
+	if (result == NULL)
+	{
+		// list is empty, allocate as usual then take a batch from the same page under the same lock
+		VKernelTaskLock lock(&fMgrMutex);
+		result = TryToMalloc(inNbBytes, inIsVObject, inTag, -1);
+		if (result != NULL)
+		{
+			VMemImplSmallBlock* xsmall = (VMemImplSmallBlock*) (((char*)result) - VMemThreadImpl::SizeSmallHeader);
+			cache->Refill(VMemThreadCache::GetPage(xsmall), step);
+		}
+	}
+	return result;
+}
+
+
+bool VCppMemMgr::_FreeToThreadCache(void* ioPtr)
+{
+	// see VMemCppImpl::Free
+	VMemImplBlock* x = (VMemImplBlock*) (((char*)ioPtr) - VMemCppImpl::SizeHeader);
+	if (!x->IsASmallBlock())
+		return false;
+
+	VMemImplSmallBlock* xsmall = (VMemImplSmallBlock*) (((char*)ioPtr) - VMemThreadImpl::SizeSmallHeader);
+	VPageAllocationImpl* page = VMemThreadCache::GetPage(xsmall);
+	if (page->GetOwner()->GetOwner()->GetMemMgr() != this)
+		return false;
+
+	VMemThreadCache* cache = _GetThreadCache();
+	if (cache == NULL)
+		return false;
+
+	VSize elemsize = page->GetElemSize();
+	sLONG step = VMemThreadImpl::GetStepFromSize(elemsize, NULL);
+	if (!cache->Push(xsmall, step, elemsize))
+	{
+		// list is full, give half of it back to the pages in one go
+		VKernelTaskLock lock(&fMgrMutex);
+		cache->Flush(step, VMemThreadCache::MaxBlocksPerStep / 2);
+		if (!cache->Push(xsmall, step, elemsize))
+			page->Free(xsmall);
+	}
+	return true;
+}
+
+
+void VCppMemMgr::FlushThreadCache()
+{
+	sLONG slot = 0;
+	while (slot < kMaxThreadCaches && (sThreadCaches[slot] == NULL || sThreadCaches[slot]->GetOwner() != this))
+		slot++;
+	if (slot == kMaxThreadCaches)
+		return;
+
+	VMemThreadCache* cache = sThreadCaches[slot];
+
+	VKernelTaskLock lock(&fMgrMutex);
+
+	cache->FlushAll();
+	fRetiredThreadCacheHits += cache->GetNbHits();
+	fRetiredThreadCacheMisses += cache->GetNbMisses();
+
+	if (fThreadCaches == cache)
+	{
+		fThreadCaches = cache->GetNext();
+	}
+	else
+	{
+		VMemThreadCache* prev = fThreadCaches;
+		while (prev != NULL && prev->GetNext() != cache)
+			prev = prev->GetNext();
+		if (prev != NULL)
+			prev->SetNext(cache->GetNext());
+	}
+
+	sThreadCaches[slot] = NULL;
+	cache->~VMemThreadCache();
+	::free(cache);
+}
+
+
 void* VCppMemMgr::Malloc(VSize inNbBytes, bool inIsVObject, sLONG inTag, sLONG preferedBlock)
 {
 	void* result = NULL;
@@ -522,6 +789,13 @@ void* VCppMemMgr::Malloc(VSize inNbBytes, bool inIsVObject, sLONG inTag, sLONG p
 		result = fStdMemMgr->Malloc(inNbBytes, false, inIsVObject, inTag);
 	else
 	{
+		if (fWithThreadCache && preferedBlock < 0)
+		{
+			result = _MallocFromThreadCache(inNbBytes, inIsVObject, inTag);
+			if (result != NULL)
+				return result;
+		}
+
 		fMgrMutex.Lock();
 
 		Check();
@@ -861,6 +1135,8 @@ void VCppMemMgr::Free(void* ioPtr)
 
 	if (fUseStdLibMgr)
 		fStdMemMgr->Free(ioPtr);
+	else if (fWithThreadCache && (ioPtr != NULL) && _FreeToThreadCache(ioPtr))
+		;
 	else
 	{
 		VKernelTaskLock lock(&fMgrMutex);
@@ -1333,6 +1609,25 @@ VSize VCppMemMgr::GetUsedMem()
 }
 
 
+Real VCppMemMgr::GetFragmentation()
+{
+	VSize	nbHeaps;
+	VSize	nbBlocs;
+	VSize	totalAlloc;
+	VSize	nbUsed;
+	VSize	totalUsed;
+	VSize	maxUsed;
+	VSize	nbFree;
+	VSize	totalFree;
+	VSize	maxFree;
+	
+	GetMemStatistics (nbHeaps, nbBlocs, totalAlloc, nbUsed, totalUsed, maxUsed, nbFree, totalFree, maxFree);
+	if (totalFree == 0)
+		return 0;
+	return 1.0 - ((Real) maxFree / (Real) totalFree);
+}
+
+
 VSize VCppMemMgr::GetAllocatedMem()
 {
 	VKernelTaskLock lock(&fMgrMutex);
@@ -1402,6 +1697,17 @@ void VCppMemMgr::GetStatistics(VMemStats& outStats, sLONG blockNumber)
 				(*cur)->GetStats(outStats, blocknum);
 			}
 		}
+
+		// counters of live threads are read without synchronization, they are only indicative
+		outStats.fNbThreadCacheHits = fRetiredThreadCacheHits;
+		outStats.fNbThreadCacheMisses = fRetiredThreadCacheMisses;
+		for (VMemThreadCache* cache = fThreadCaches; cache != NULL; cache = cache->GetNext())
+		{
+			outStats.fNbThreadCacheHits += cache->GetNbHits();
+			outStats.fNbThreadCacheMisses += cache->GetNbMisses();
+			outStats.fNbThreadCacheBlocks += cache->GetNbBlocks();
+			outStats.fThreadCacheBytes += cache->GetCachedBytes();
+		}
 	}
 }
 
@@ -56,6 +56,7 @@ class XTOOLBOX_API VMemoryHog
 class IMemoryWalker;
 class VArrayLong;
 class VCppMemMgr;
+class VMemThreadCache;
 
 // Class definitions
 typedef VSize (*PurgeHandlerProc) (sLONG allocationBlockNumber, VSize inNeededBytes, bool withFlush);
@@ -138,6 +139,10 @@ public:
 		fBiggestBlock = 0;
 		fBiggestBlockFree = 0;
 		fNbObjects = 0;
+		fNbThreadCacheHits = 0;
+		fNbThreadCacheMisses = 0;
+		fNbThreadCacheBlocks = 0;
+		fThreadCacheBytes = 0;
 	};
 
 	void Dump();
@@ -156,6 +161,10 @@ public:
 	sLONG fNbBigBlocksUsed;
 	VSize fBiggestBlock;
 	VSize fBiggestBlockFree;
+	sLONG8 fNbThreadCacheHits;		// small block allocations served by per thread caches
+	sLONG8 fNbThreadCacheMisses;
+	sLONG fNbThreadCacheBlocks;		// blocks currently held by per thread caches (counted as used)
+	VSize fThreadCacheBytes;
 	VMapOfObjectInfo fObjectInfo;
 	VMapOfBlockInfo fBlockInfo;
 	VMapOfMemBlockInfo fSmallBlockInfo;
@@ -236,6 +245,7 @@ public:
 			VSize	GetMaxUsed();
 			VSize	GetAllocatedMem();
 			VSize	GetUsedMem();
+			Real	GetFragmentation();	// 0 when all free memory is in one block, close to 1 when it is scattered
 	
 			void	GetUsage( VArrayString& inTabClassNames, VArrayLong& inTabNbObjects, VArrayLong& inTabTotalSize);
 			void	GetMemStatistics( VSize& outNbHeaps, VSize& outNbBlocs, VSize& outTotalAlloc, VSize& outNbUsed, VSize& outTotalUsed, VSize& outMaxUsed, VSize& outNbFree, VSize& outTotalFree, VSize& outMaxFree);
@@ -302,10 +312,18 @@ public:
 
 			void PurgeMem(sLONG whatBlock = -1);
 
+			// Gives back to their pages the small blocks cached by the current thread (called when a task ends,
+			// and by a thread exit callback for any other thread).
+			void	FlushThreadCache();
+
 	
 private:
 			void	_Init( EAllocatorKind inKind, bool inWithDebugInfo, bool inWithStrangeFill);
 			void*	TryToMalloc( VSize inNbBytes, bool inIsVObject, sLONG inTag, sLONG preferedBlock);
+
+			VMemThreadCache*	_GetThreadCache();
+			void*	_MallocFromThreadCache( VSize inNbBytes, bool inIsVObject, sLONG inTag);
+			bool	_FreeToThreadCache( void* ioPtr);
 			
 			//XMemCppImpl*					fMemMgr;
 			VKernelCriticalSection			fMgrMutex;
@@ -334,6 +352,10 @@ private:
 			VCriticalSection				fWaitBeforeNewPtrMutex;
 			sLONG							fWaitBeforeNewPtrStarter;
 			VStackOfMemHogs					fMemHogsStack;
+			VMemThreadCache*				fThreadCaches;		// caches of all threads that used this manager, under fMgrMutex
+			sLONG8							fRetiredThreadCacheHits;	// counters of flushed caches
+			sLONG8							fRetiredThreadCacheMisses;
+			bool							fWithThreadCache;
 	
 	// Private allocation support
 			void	RegisterBlock( DebugBlockHeader* inAddr, VSize inUserSize, bool inIsVObject);
@@ -656,6 +656,122 @@ Boolean VMemThreadImpl::Check(void* skipthisone)
 
 
 
+/* --------------------------------------------------- */
+
+VMemThreadCache::VMemThreadCache(VCppMemMgr* inOwner)
+{
+	fOwner = inOwner;
+	fNext = NULL;
+	for (sLONG i = 0; i < kTotalStepAllocPagesInThread; i++)
+	{
+		fFirstFree[i] = NULL;
+		fCount[i] = 0;
+	}
+	fNbHits = 0;
+	fNbMisses = 0;
+	fNbBlocks = 0;
+	fCachedBytes = 0;
+}
+
+
+VPageAllocationImpl* VMemThreadCache::GetPage(VMemImplSmallBlock* inBlock)
+{
+	sLONG offset = inBlock->GetOffset();
+	offset = (-offset) & -2;
+	return (VPageAllocationImpl*) (((char*)inBlock)-offset);
+}
+
+
+void* VMemThreadCache::Pop(sLONG inStep, Boolean isAnObject, sLONG inTag)
+{
+	VMemImplSmallBlock* x = fFirstFree[inStep];
+	if (x == NULL)
+	{
+		fNbMisses++;
+		return NULL;
+	}
+
+	fFirstFree[inStep] = x->GetNext();
+	fCount[inStep]--;
+	fNbBlocks--;
+	fCachedBytes -= GetPage(x)->GetElemSize();
+	fNbHits++;
+
+	x->SetIsAnObject(isAnObject);
+#if WITH_ASSERT
+	x->SetTag(inTag);
+#endif
+	return (void*) (((char*)x) + VMemThreadImpl::SizeSmallHeader);
+}
+
+
+sLONG VMemThreadCache::_GetMaxBlocks(VSize inElemSize)
+{
+	sLONG maxblocks = (sLONG) (MaxBytesPerStep / inElemSize);
+	if (maxblocks > MaxBlocksPerStep)
+		maxblocks = MaxBlocksPerStep;
+	else if (maxblocks < MinBlocksPerStep)
+		maxblocks = MinBlocksPerStep;
+	return maxblocks;
+}
+
+
+bool VMemThreadCache::Push(VMemImplSmallBlock* inBlock, sLONG inStep, VSize inElemSize)
+{
+	if (fCount[inStep] >= _GetMaxBlocks(inElemSize))
+		return false;
+
+	inBlock->SetNext(fFirstFree[inStep]);
+	fFirstFree[inStep] = inBlock;
+	fCount[inStep]++;
+	fNbBlocks++;
+	fCachedBytes += inElemSize;
+	return true;
+}
+
+
+void VMemThreadCache::Refill(VPageAllocationImpl* inPage, sLONG inStep)
+{
+	VSize elemsize = inPage->GetElemSize();
+	sLONG count = _GetMaxBlocks(elemsize) / 2 - fCount[inStep];
+
+	// the page removes itself from the not full pages of its owner when its last block is taken
+	while (count > 0 && (VSize) inPage->GetNbFull() < inPage->GetMaxElems())
+	{
+		void* p = inPage->Malloc(elemsize, false, 0);
+		if (p == NULL)
+			break;
+		Push((VMemImplSmallBlock*) (((char*)p) - VMemThreadImpl::SizeSmallHeader), inStep, elemsize);
+		count--;
+	}
+}
+
+
+void VMemThreadCache::Flush(sLONG inStep, sLONG inCount)
+{
+	while (inCount > 0 && fFirstFree[inStep] != NULL)
+	{
+		VMemImplSmallBlock* x = fFirstFree[inStep];
+		fFirstFree[inStep] = x->GetNext();
+		fCount[inStep]--;
+		fNbBlocks--;
+
+		VPageAllocationImpl* page = GetPage(x);
+		fCachedBytes -= page->GetElemSize();
+		page->Free(x);
+		inCount--;
+	}
+}
+
+
+void VMemThreadCache::FlushAll()
+{
+	for (sLONG i = 0; i < kTotalStepAllocPagesInThread; i++)
+		Flush(i, fCount[i]);
+}
+
+
+
 /* --------------------------------------------------- */
 
 VMemCppImpl::VMemCppImpl(sLONG inBlockNumber)
@@ -843,7 +959,7 @@ void* VMemCppImpl::Malloc( VSize inSize, Boolean inForceinMain, Boolean isAnObje
 	if (inSize < kThirdStepAlloc && !inForceinMain)
 	{
 		//inSize = AdjusteSize(inSize);
-		sLONG curthread = VTask::GetCurrentID() % MaxThreads;
+		sLONG curthread = (MaxThreads == 1) ? 0 : VTask::GetCurrentID() % MaxThreads;
 		VMemThreadImpl* th = &(fThreads[curthread]);
 		result = (char*)(th->Malloc(inSize + VMemThreadImpl::SizeSmallHeader, isAnObject, inTag));
 	}
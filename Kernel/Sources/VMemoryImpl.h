@@ -150,6 +150,7 @@ public:
 	void	SetNext (VMemImplSmallBlock* inNext) { fNext = inNext; };
 
 	inline Boolean IsAnObject() { return ((-fOffset) & 1) == 1; };
+	inline void SetIsAnObject(Boolean isAnObject) { fOffset = -(((-fOffset) & -2) + (isAnObject ? 1 : 0)); };
 	
 	//VMemImplSmallBlock*	GetPrevious () const { return fPrevious; };
 	//void	SetPrevious (VMemImplSmallBlock* inPrevious) { fPrevious = inPrevious; };
@@ -246,13 +247,70 @@ public:
 
 	Boolean	Check (void* skipthisone = NULL);
 
+	static sLONG	GetStepFromSize (VSize inSize, sLONG* outStepInc);
+
 private:
 	VMemCppImpl*	fOwner;
 	//VKernelCriticalSection	fMutex;
 	//VPageAllocationImpl*	fPages[kTotalStepAllocPagesInThread];
 	VPageAllocationImpl*	fNotFullPages[kTotalStepAllocPagesInThread];
-	
-	sLONG	GetStepFromSize (VSize inSize, sLONG* outStepInc);
+};
+
+
+
+/*
+	Per thread front-end cache (magazines) for small blocks of a VCppMemMgr.
+
+	Small blocks freed by a thread are kept in free lists, one per VMemThreadImpl step, and handed
+	back by the next allocations of the same step on that thread without taking the manager mutex.
+	When a list is empty, it is refilled with a batch of blocks taken from one page, and when it is full,
+	half of it is given back to the owning pages, each in one go under the manager mutex.
+	Cached blocks are still counted as used by their VMemCppImpl.
+*/
+class VMemThreadCache
+{
+public:
+	enum { MaxBlocksPerStep = 64, MinBlocksPerStep = 4, MaxBytesPerStep = 32768 };
+
+	VMemThreadCache (VCppMemMgr* inOwner);
+
+	VCppMemMgr*	GetOwner () const { return fOwner; };
+	void	SetOwner (VCppMemMgr* inOwner) { fOwner = inOwner; };
+
+	VMemThreadCache*	GetNext () const { return fNext; };
+	void	SetNext (VMemThreadCache* inNext) { fNext = inNext; };
+
+	// returns NULL if no block is cached for inStep
+	void*	Pop (sLONG inStep, Boolean isAnObject, sLONG inTag);
+
+	// returns false if the list for inStep is full, in which case caller should Flush it first
+	bool	Push (VMemImplSmallBlock* inBlock, sLONG inStep, VSize inElemSize);
+
+	// takes up to half the capacity of the list for inStep from the free blocks of inPage, manager mutex must be held
+	void	Refill (VPageAllocationImpl* inPage, sLONG inStep);
+
+	// give blocks back to their pages, manager mutex must be held
+	void	Flush (sLONG inStep, sLONG inCount);
+	void	FlushAll ();
+
+	sLONG8	GetNbHits () const { return fNbHits; };
+	sLONG8	GetNbMisses () const { return fNbMisses; };
+	sLONG	GetNbBlocks () const { return fNbBlocks; };
+	VSize	GetCachedBytes () const { return fCachedBytes; };
+
+	static VPageAllocationImpl*	GetPage (VMemImplSmallBlock* inBlock);
+
+private:
+	static sLONG	_GetMaxBlocks (VSize inElemSize);
+
+	VCppMemMgr*			fOwner;
+	VMemThreadCache*	fNext;
+	VMemImplSmallBlock*	fFirstFree[kTotalStepAllocPagesInThread];
+	sWORD				fCount[kTotalStepAllocPagesInThread];
+	sLONG8				fNbHits;
+	sLONG8				fNbMisses;
+	sLONG				fNbBlocks;
+	VSize				fCachedBytes;
 };
 
 
@@ -318,6 +376,8 @@ public:
 
 	sLONG GetAllocationBlockNumber(void *inBlock);
 
+	VCppMemMgr*	GetMemMgr() const { return fOwner; };
+
 
 private:
 	//VKernelCriticalSection	fMutex;
@@ -497,8 +497,16 @@ bool VMessage::DoCoalesce(const VMessage& /*inNewMessage*/)
 #pragma mark-
 
 
+struct VMessageQueue::InboxNode
+{
+	VMessage*	fMessage;	// retained
+	InboxNode*	fNext;
+};
+
+
 VMessageQueue::VMessageQueue()
 {
+	fInbox = NULL;
 	fCriticalSection = new VCriticalSection;
 	fEvent = new VSyncEvent;
 }
@@ -506,51 +514,133 @@ VMessageQueue::VMessageQueue()
 
 VMessageQueue::~VMessageQueue()
 {
+	_DrainInbox();
+	fCoalescingIndex.clear();
 	fMessageBox.clear();
 	delete fCriticalSection;
 	ReleaseRefCountable( &fEvent);
 }
 
 
+void VMessageQueue::_DrainInbox() const
+{
+	// producers push in LIFO order, reverse to get posting order back.
+	InboxNode *node = VInterlocked::ExchangePtr<InboxNode>( &fInbox, NULL);
+	InboxNode *fifo = NULL;
+	while (node != NULL)
+	{
+		InboxNode *next = node->fNext;
+		node->fNext = fifo;
+		fifo = node;
+		node = next;
+	}
+
+	while (fifo != NULL)
+	{
+		InboxNode *next = fifo->fNext;
+		_PushBack( fifo->fMessage);
+		fifo->fMessage->Release();
+		delete fifo;
+		fifo = next;
+	}
+}
+
+
+void VMessageQueue::_PushBack( VMessage* inMessage) const
+{
+	fMessageBox.push_back( inMessage);
+
+	OsType signature = inMessage->GetCoalescingSignature();
+	if (signature != 0)
+		fCoalescingIndex.insert( MultiMapOfCoalescingMessages::value_type( signature, inMessage));
+}
+
+
+void VMessageQueue::_Unindex( VMessage* inMessage) const
+{
+	OsType signature = inMessage->GetCoalescingSignature();
+	if (signature != 0)
+	{
+		std::pair<MultiMapOfCoalescingMessages::iterator, MultiMapOfCoalescingMessages::iterator> range = fCoalescingIndex.equal_range( signature);
+		for( MultiMapOfCoalescingMessages::iterator i = range.first ; i != range.second ; ++i)
+		{
+			if (i->second == inMessage)
+			{
+				fCoalescingIndex.erase( i);
+				break;
+			}
+		}
+	}
+}
+
+
+void VMessageQueue::_ResetEventIfEmpty() const
+{
+	// called with the critical section held after draining the inbox.
+	// a producer may have pushed onto the inbox meanwhile: it has set the event already but we must not reset it.
+	if (fMessageBox.empty())
+	{
+		fEvent->Reset();
+		if (VInterlocked::CompareExchangePtr( (void**) &fInbox, NULL, NULL) != NULL)
+			fEvent->Unlock();
+	}
+}
+
+
 bool VMessageQueue::AddMessage( VMessage* inMessage)
 {
 	xbox_assert(!inMessage->Answered() /* on envoie un msg deja valide ??? */);
 
-	// process special messages
 	bool isOK = true;
 	
 	OsType signature = inMessage->GetCoalescingSignature();
-	if (signature != 0)
+	if (signature == 0)
 	{
-		VTaskLock lock( fCriticalSection);
-		
-		DequeOfVMessage::iterator i = fMessageBox.begin();
-		for(  ; (i != fMessageBox.end()) && ((*i)->GetCoalescingSignature() != signature) ; ++i)
-			;
+		// lock free path
+		InboxNode *node = new InboxNode;
+		node->fMessage = RetainRefCountable( inMessage);
 
-		if (i != fMessageBox.end())
+		InboxNode *head;
+		do
 		{
-			VMessage* tocoalesce = *i;
-			// warning: called from inside the task lock! (to avoid Getting this message while processing it)
-			isOK = tocoalesce->DoCoalesce( *inMessage);
-		}
+			head = (InboxNode*) VInterlocked::CompareExchangePtr( (void**) &fInbox, NULL, NULL);
+			node->fNext = head;
+		} while (VInterlocked::CompareExchangePtr( (void**) &fInbox, head, node) != head);
+
+		// the consumer resets the event only when both the inbox and the message box are empty.
+		// if the inbox was not empty, the event is already set.
+		if (head == NULL)
+			fEvent->Unlock();
 	}
-
-	// push it
-	if (isOK)
+	else
 	{
+		// process special messages
 		VTaskLock lock( fCriticalSection);
 
-		try
+		_DrainInbox();
+		
+		MultiMapOfCoalescingMessages::iterator i = fCoalescingIndex.lower_bound( signature);
+		if ( (i != fCoalescingIndex.end()) && (i->first == signature) )
 		{
-			// optim: if the message box was not empty, no need to set the event because it should be already set.
-			if (fMessageBox.empty())
-				fEvent->Unlock();
-			fMessageBox.push_back( inMessage);
+			VMessage* tocoalesce = i->second;
+			// warning: called from inside the task lock! (to avoid Getting this message while processing it)
+			isOK = tocoalesce->DoCoalesce( *inMessage);
 		}
-		catch(...)
+
+		// push it
+		if (isOK)
 		{
-			isOK = false;
+			try
+			{
+				// optim: if the message box was not empty, no need to set the event because it should be already set.
+				if (fMessageBox.empty())
+					fEvent->Unlock();
+				_PushBack( inMessage);
+			}
+			catch(...)
+			{
+				isOK = false;
+			}
 		}
 	}
 	
@@ -564,8 +654,8 @@ VMessage* VMessageQueue::_RetainFrontMessage()
 	fMessageBox.pop_front();
 	XBOX_ASSERT_VOBJECT( msg);
 	xbox_assert(!msg->Answered() /* on envoie un msg deja executed ??? */);
-	if (fMessageBox.empty())
-		fEvent->Reset();
+	_Unindex( msg);
+	_ResetEventIfEmpty();
 	
 	return msg;
 }
@@ -575,6 +665,8 @@ VMessage* VMessageQueue::RetainMessage()
 {
 	VTaskLock lock( fCriticalSection);
 
+	_DrainInbox();
+
 	return fMessageBox.empty() ? NULL : _RetainFrontMessage();
 }
 
@@ -586,11 +678,13 @@ VMessage* VMessageQueue::RetainMessageWithTimeout( sLONG inTimeoutMilliseconds)
 	
 	VTaskLock lock( fCriticalSection);
 
+	_DrainInbox();
+
 	VMessage *msg;
 	if (fMessageBox.empty())
 	{
 		// the event was triggered from the outside, we must reset here ourselves
-		fEvent->Reset();
+		_ResetEventIfEmpty();
 		msg = NULL;
 	}
 	else
@@ -605,15 +699,27 @@ void VMessageQueue::CancelMessages( IMessageable* inTarget)
 {
 	VTaskLock lock( fCriticalSection);
 
-	DequeOfVMessage::iterator i = std::remove_if( fMessageBox.begin(), fMessageBox.end(), IMessageableCompareTarget( inTarget));
-	
-	for( ; i != fMessageBox.end() ; ++i)
-		(*i)->Abort();
+	_DrainInbox();
+
+	IMessageableCompareTarget isTarget( inTarget);
+	DequeOfVMessage kept;
+
+	for( DequeOfVMessage::iterator i = fMessageBox.begin() ; i != fMessageBox.end() ; ++i)
+	{
+		if (isTarget( *i))
+		{
+			(*i)->Abort();
+			_Unindex( *i);
+		}
+		else
+		{
+			kept.push_back( *i);
+		}
+	}
 	
-	fMessageBox.erase( i, fMessageBox.end());
+	fMessageBox.swap( kept);
 
-	if (fMessageBox.empty())
-		fEvent->Reset();
+	_ResetEventIfEmpty();
 }
 
 
@@ -621,6 +727,8 @@ void VMessageQueue::CancelMessages()
 {
 	VTaskLock lock( fCriticalSection);
 
+	_DrainInbox();
+
 	DequeOfVMessage::iterator i = fMessageBox.begin();
 
 	for( ; i != fMessageBox.end() ; ++i)
@@ -628,23 +736,24 @@ void VMessageQueue::CancelMessages()
 	
 	fMessageBox.erase( i, fMessageBox.end());
 
-	if (fMessageBox.empty())
-		fEvent->Reset();
+	_ResetEventIfEmpty();
 }
 
 
 bool VMessageQueue::RemoveMessage( VMessage* inMessage)
 {
 	VTaskLock lock( fCriticalSection);
+
+	_DrainInbox();
 	
 	DequeOfVMessage::iterator i = std::find( fMessageBox.begin(), fMessageBox.end(), VRefPtr<VMessage>( inMessage));
 
 	bool isFound = (i != fMessageBox.end());
 	if (isFound)
 	{
+		_Unindex( inMessage);
 		fMessageBox.erase( i);
-		if (fMessageBox.empty())
-			fEvent->Reset();
+		_ResetEventIfEmpty();
 	}
 
 	return isFound;
@@ -654,6 +763,9 @@ bool VMessageQueue::RemoveMessage( VMessage* inMessage)
 sLONG VMessageQueue::CountMessages() const
 {
 	VTaskLock lock( fCriticalSection);
+
+	_DrainInbox();
+
 	return (sLONG) fMessageBox.size();
 }
 
@@ -662,6 +774,8 @@ sLONG VMessageQueue::CountMessagesFor(IMessageable* inTarget) const
 {
 	VTaskLock lock( fCriticalSection);
 
+	_DrainInbox();
+
 	sLONG count = 0;
 	for( DequeOfVMessage::const_iterator i = fMessageBox.begin() ; i != fMessageBox.end() ; ++i)
 	{
@@ -674,6 +788,9 @@ sLONG VMessageQueue::CountMessagesFor(IMessageable* inTarget) const
 
 bool VMessageQueue::IsEmpty() const
 {
+	if (VInterlocked::CompareExchangePtr( (void**) &fInbox, NULL, NULL) != NULL)
+		return false;
+
 	VTaskLock lock( fCriticalSection);
 	
 	return fMessageBox.empty();
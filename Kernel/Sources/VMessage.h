@@ -17,6 +17,7 @@
 #define __VMessage__
 
 #include <deque>
+#include <map>
 
 #include "Kernel/Sources/VObject.h"
 #include "Kernel/Sources/IRefCountable.h"
@@ -58,6 +59,7 @@ private:
 
 
 typedef std::deque<VRefPtr<VMessage> >	DequeOfVMessage;
+typedef std::multimap<OsType, VMessage*>	MultiMapOfCoalescingMessages;
 
 
 /*!
@@ -306,6 +308,11 @@ private:
 	@class	VMessageQueue
 	@abstract	Thread safe queue for VMessage
 	@discussion
+		Posting a message without coalescing signature is lock free: it is pushed onto an inbox
+		that the queue owner drains (under the critical section) into the message box before
+		any other operation. Messages with a coalescing signature still take the critical section
+		since DoCoalesce must be called with the queue blocked, but the message to coalesce with
+		is found through an index keyed by signature instead of scanning the queue.
 */
 
 class XTOOLBOX_API VMessageQueue : public VObject
@@ -333,11 +340,19 @@ public:
 			VSyncEvent*			GetSyncEvent() const	{ return fEvent;}
 
 private:
+			struct InboxNode;
+
 			VMessage*			_RetainFrontMessage();
+			void				_DrainInbox() const;
+			void				_PushBack( VMessage* inMessage) const;
+			void				_Unindex( VMessage* inMessage) const;
+			void				_ResetEventIfEmpty() const;
 			
-			DequeOfVMessage		fMessageBox;
-			VCriticalSection*	fCriticalSection;
-			VSyncEvent*			fEvent;
+	mutable	DequeOfVMessage					fMessageBox;
+	mutable	MultiMapOfCoalescingMessages	fCoalescingIndex;	// queued messages with a coalescing signature, in queue order
+	mutable	InboxNode*						fInbox;				// lock free LIFO of posted messages
+			VCriticalSection*				fCriticalSection;
+			VSyncEvent*						fEvent;
 };
 
 
@@ -0,0 +1,359 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "VKernelPrecompiled.h"
+#include "VPrefetchStream.h"
+#include "VErrorContext.h"
+#include "VMemory.h"
+#include "VTask.h"
+#include "VSyncObject.h"
+#include "VInterlocked.h"
+#include "VSystem.h"
+
+
+VPrefetchStream::VPrefetchStream( VStream *inSource, bool inOwnsSource, VSize inBufferSize, sLONG inQueueDepth)
+{
+	assert(inSource != NULL);
+	fSource = inSource;
+	fOwnsSource = inOwnsSource;
+	fSourceOpened = false;
+	fSourceSize = 0;
+
+	fBufferSize = (inBufferSize > 0) ? inBufferSize : kDefaultBufferSize;
+	fQueueDepth = (inQueueDepth >= 2) ? inQueueDepth : 2;	// one is drained while the other one is filled
+	fBuffers = NULL;
+
+	fTask = NULL;
+	fFreeBuffers = NULL;
+	fFilledBuffers = NULL;
+	fTaskDone = NULL;
+	fStopRequested = 0;
+	fTaskPos = 0;
+	fStatsMutex = new VCriticalSection;
+	fPrefetchedBytes = 0;
+
+	fNextBuffer = 0;
+	fCurrent = NULL;
+	fCurrentOffset = 0;
+	fReadPos = 0;
+	fLastError = VE_OK;
+	fStallCount = 0;
+	fStallMilliseconds = 0;
+
+	SetReadOnly( true);
+}
+
+
+VPrefetchStream::~VPrefetchStream()
+{
+	if (IsReading())
+		CloseReading();
+
+	delete fStatsMutex;
+
+	if (fOwnsSource)
+		delete fSource;
+}
+
+
+sLONG8 VPrefetchStream::GetPrefetchedBytes() const
+{
+	VTaskLock lock( fStatsMutex);
+	return fPrefetchedBytes;
+}
+
+
+VError VPrefetchStream::DoOpenReading()
+{
+	VError err = VE_OK;
+
+	if (!fSource->IsReading())
+	{
+		err = fSource->OpenReading();
+		fSourceOpened = (err == VE_OK);
+	}
+
+	if (err == VE_OK)
+	{
+		fSourceSize = fSource->GetSize();
+
+		fBuffers = new VPrefetchBuffer[fQueueDepth];
+		for( sLONG i = 0 ; i < fQueueDepth ; ++i)
+		{
+			fBuffers[i].fData = (sBYTE*) VMemory::NewPtr( fBufferSize, 'stmp');
+			fBuffers[i].fPos = 0;
+			fBuffers[i].fCount = 0;
+			fBuffers[i].fError = VE_OK;
+			if (fBuffers[i].fData == NULL)
+				err = VE_MEMORY_FULL;
+		}
+
+		if (err == VE_OK)
+			err = _Start( 0);
+		else
+			err = vThrowError( err);
+
+		if (err != VE_OK)
+			DoCloseReading();
+	}
+
+	return err;
+}
+
+
+VError VPrefetchStream::DoCloseReading()
+{
+	VError err = VE_OK;
+
+	_Stop();
+
+	if (fBuffers != NULL)
+	{
+		for( sLONG i = 0 ; i < fQueueDepth ; ++i)
+		{
+			if (fBuffers[i].fData != NULL)
+				VMemory::DisposePtr( fBuffers[i].fData);
+		}
+		delete [] fBuffers;
+		fBuffers = NULL;
+	}
+
+	if (fSourceOpened)
+	{
+		err = fSource->CloseReading();
+		fSourceOpened = false;
+	}
+
+	return err;
+}
+
+
+VError VPrefetchStream::DoGetData( void *inBuffer, VSize *ioCount)
+{
+	VError err = VE_OK;
+	sLONG8 pos = GetPos();
+
+	// SetPos() or UngetData() moved the position: stay in current buffer if possible, else read ahead from there
+	if (pos != fReadPos)
+	{
+		if ( (fCurrent != NULL) && (pos >= fCurrent->fPos) && (pos <= fCurrent->fPos + (sLONG8) fCurrent->fCount) )
+			fCurrentOffset = (VSize) (pos - fCurrent->fPos);
+		else
+			err = _Start( pos);
+		fReadPos = pos;
+	}
+
+	VSize copied = 0;
+	while( (copied < *ioCount) && (err == VE_OK) )
+	{
+		if ( (fCurrent == NULL) || (fCurrentOffset >= fCurrent->fCount) )
+		{
+			err = _NextBuffer();
+		}
+		else
+		{
+			VSize count = fCurrent->fCount - fCurrentOffset;
+			if (count > *ioCount - copied)
+				count = *ioCount - copied;
+			::CopyBlock( fCurrent->fData + fCurrentOffset, (char *) inBuffer + copied, count);
+			fCurrentOffset += count;
+			copied += count;
+		}
+	}
+
+	fReadPos += copied;
+	*ioCount = copied;
+
+	return err;
+}
+
+
+VError VPrefetchStream::DoOpenWriting()
+{
+	return vThrowError( VE_STREAM_CANNOT_WRITE);
+}
+
+
+VError VPrefetchStream::DoPutData( const void* /*inBuffer*/, VSize /*inNbBytes*/)
+{
+	return vThrowError( VE_STREAM_CANNOT_WRITE);
+}
+
+
+VError VPrefetchStream::DoSetSize( sLONG8 /*inNewSize*/)
+{
+	return vThrowError( VE_STREAM_CANNOT_WRITE);
+}
+
+
+VError VPrefetchStream::DoSetPos( sLONG8 inNewPos)
+{
+	// actual move is done by next DoGetData
+	if (inNewPos > fSourceSize)
+		return vThrowError( VE_STREAM_EOF);
+
+	return VE_OK;
+}
+
+
+sLONG8 VPrefetchStream::DoGetSize()
+{
+	// the source can't be accessed while the task is running
+	return (fTask != NULL) ? fSourceSize : fSource->GetSize();
+}
+
+
+VError VPrefetchStream::_Start( sLONG8 inPos)
+{
+	_Stop();
+
+	fSource->ResetLastError();
+	VError err = fSource->SetPos( inPos);
+	if (err != VE_OK)
+		return err;
+
+	fFreeBuffers = new VSemaphore( fQueueDepth, fQueueDepth);
+	fFilledBuffers = new VSemaphore( 0, fQueueDepth);
+	fTaskDone = new VSemaphore( 0, 1);
+	fStopRequested = 0;
+	fTaskPos = inPos;
+
+	fNextBuffer = 0;
+	fCurrent = NULL;
+	fCurrentOffset = 0;
+	fLastError = VE_OK;
+
+	fTask = new VTask( NULL, 0, eTaskStylePreemptive, _RunProc);
+	fTask->SetKindData( (sLONG_PTR) this);
+	fTask->SetName( CVSTR( "Stream prefetch"));
+
+	// the task releases fTaskDone once signaled, so that it remains valid while the reader wakes up.
+	fTaskDone->Retain();
+	if (!fTask->Run())
+	{
+		fTaskDone->Release();
+		fTask->Release();
+		fTask = NULL;
+		err = vThrowError( VE_MEMORY_FULL);
+	}
+
+	return err;
+}
+
+
+void VPrefetchStream::_Stop()
+{
+	if (fTask != NULL)
+	{
+		// the task checks the flag each time it gets a free buffer, give it one in case it's waiting.
+		VInterlocked::Exchange( &fStopRequested, 1);
+		fFreeBuffers->Unlock();
+		fTaskDone->Lock();
+
+		fTask->Release();
+		fTask = NULL;
+	}
+
+	ReleaseRefCountable( &fFreeBuffers);
+	ReleaseRefCountable( &fFilledBuffers);
+	ReleaseRefCountable( &fTaskDone);
+
+	fCurrent = NULL;
+	fCurrentOffset = 0;
+}
+
+
+VError VPrefetchStream::_NextBuffer()
+{
+	// after the last buffer, the task is done. Like VFileStream, end of file is not thrown.
+	if (fLastError == VE_STREAM_EOF)
+		return fLastError;
+	else if (fLastError != VE_OK)
+		return vThrowError( fLastError);
+
+	if (fCurrent != NULL)
+	{
+		fCurrent = NULL;
+		fFreeBuffers->Unlock();
+	}
+
+	if (!fFilledBuffers->TryToLock())
+	{
+		uLONG start = VSystem::GetCurrentTime();
+		fFilledBuffers->Lock();
+		fStallMilliseconds += VSystem::GetCurrentTime() - start;
+		++fStallCount;
+	}
+
+	fCurrent = &fBuffers[fNextBuffer];
+	fCurrentOffset = 0;
+	fNextBuffer = (fNextBuffer + 1) % fQueueDepth;
+
+	fLastError = fCurrent->fError;
+
+	return VE_OK;
+}
+
+
+void VPrefetchStream::_Prefetch()
+{
+	// source errors are given back to the reader with the last buffer
+	StErrorContextInstaller errors( false);
+
+	sLONG index = 0;
+	sLONG8 pos = fTaskPos;
+	VError err = VE_OK;
+
+	while( err == VE_OK)
+	{
+		fFreeBuffers->Lock();
+		if (VInterlocked::AtomicGet( &fStopRequested) != 0)
+			break;
+
+		VPrefetchBuffer& buffer = fBuffers[index];
+		VSize count = 0;
+
+		err = fSource->GetData( buffer.fData, fBufferSize, &count);
+		if ( (err == VE_OK) && (pos + (sLONG8) count >= fSourceSize) )
+			err = VE_STREAM_EOF;
+
+		buffer.fPos = pos;
+		buffer.fCount = count;
+		buffer.fError = err;
+		pos += count;
+
+		fStatsMutex->Lock();
+		fPrefetchedBytes += count;
+		fStatsMutex->Unlock();
+
+		fFilledBuffers->Unlock();
+		index = (index + 1) % fQueueDepth;
+	}
+}
+
+
+sLONG VPrefetchStream::_RunProc( VTask *inTask)
+{
+	VPrefetchStream *stream = (VPrefetchStream *) inTask->GetKindData();
+	VSemaphore *done = stream->fTaskDone;
+
+	stream->_Prefetch();
+
+	// the stream may be gone as soon as done is unlocked
+	done->Unlock();
+	done->Release();
+
+	return 0;
+}
@@ -0,0 +1,117 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#ifndef __VPrefetchStream__
+#define __VPrefetchStream__
+
+#include "VStream.h"
+
+BEGIN_TOOLBOX_NAMESPACE
+
+// Needed declarations
+class VTask;
+class VSemaphore;
+class VCriticalSection;
+
+/*
+	Read-only stream that reads ahead another stream in a background task.
+
+	The source is read in buffers of inBufferSize bytes. While the reader drains one buffer, the
+	background task fills the next ones, up to inQueueDepth buffers (2 is double buffering).
+
+	The source must not be used by anyone else while the VPrefetchStream is opened for reading.
+	It is opened for reading by the VPrefetchStream if needed, and closed accordingly.
+	Moving the position outside the current buffer (SetPos, UngetData) restarts the read ahead at the new position.
+
+	Errors of the source are thrown again in the reader task.
+*/
+class XTOOLBOX_API VPrefetchStream : public VStream
+{
+public:
+	static const VSize	kDefaultBufferSize	= 256L * 1024L;
+	static const sLONG	kDefaultQueueDepth	= 2;
+
+			VPrefetchStream (VStream* inSource, bool inOwnsSource = false, VSize inBufferSize = kDefaultBufferSize, sLONG inQueueDepth = kDefaultQueueDepth);
+	virtual ~VPrefetchStream ();
+
+			VStream*	GetSource () const				{ return fSource; }
+
+	// statistics, cumulated since the stream was created.
+	// stall count and duration tell how often and how long the reader had to wait for the background task.
+			sLONG8		GetPrefetchedBytes () const;
+			sLONG		GetStallCount () const			{ return fStallCount; }
+			uLONG		GetStallMilliseconds () const	{ return fStallMilliseconds; }
+
+protected:
+	// Inherited from VStream
+	virtual VError	DoOpenReading ();
+	virtual VError	DoCloseReading ();
+	virtual VError	DoGetData (void* inBuffer, VSize* ioCount);
+
+	virtual VError	DoOpenWriting ();
+	virtual VError	DoPutData (const void* inBuffer, VSize inNbBytes);
+
+	virtual VError	DoSetSize (sLONG8 inNewSize);
+	virtual VError	DoSetPos (sLONG8 inNewPos);
+	virtual sLONG8	DoGetSize ();
+
+private:
+	typedef struct VPrefetchBuffer
+	{
+		sBYTE*	fData;
+		sLONG8	fPos;		// position in source
+		VSize	fCount;		// useful bytes
+		VError	fError;		// VE_STREAM_EOF or source error if it's the last buffer
+	} VPrefetchBuffer;
+
+			VStream*			fSource;
+			bool				fOwnsSource;
+			bool				fSourceOpened;	// true if source has been opened by us
+			sLONG8				fSourceSize;
+
+			VSize				fBufferSize;
+			sLONG				fQueueDepth;
+			VPrefetchBuffer*	fBuffers;
+
+			// shared with the background task
+			VTask*				fTask;
+			VSemaphore*			fFreeBuffers;	// one resource per buffer the task may fill
+			VSemaphore*			fFilledBuffers;	// one resource per buffer the reader may drain
+			VSemaphore*			fTaskDone;
+			sLONG				fStopRequested;
+			sLONG8				fTaskPos;
+			VCriticalSection*	fStatsMutex;
+			sLONG8				fPrefetchedBytes;
+
+			// reader side
+			sLONG				fNextBuffer;
+			VPrefetchBuffer*	fCurrent;
+			VSize				fCurrentOffset;
+			sLONG8				fReadPos;
+			VError				fLastError;
+			sLONG				fStallCount;
+			uLONG				fStallMilliseconds;
+
+			VError				_Start (sLONG8 inPos);
+			void				_Stop ();
+			VError				_NextBuffer ();
+			void				_Prefetch ();
+
+	static	sLONG				_RunProc (VTask* inTask);
+};
+
+END_TOOLBOX_NAMESPACE
+
+#endif
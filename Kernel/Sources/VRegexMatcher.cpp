@@ -17,6 +17,9 @@
 
 #if USE_ICU
 #include "unicode/regex.h"
+#include "unicode/utext.h"
+
+#include <list>
 
 #include "VString.h"
 #include "VValueBag.h"
@@ -48,43 +51,269 @@ static void _CheckError( const VString& inPattern, UErrorCode inStatus, VError *
 }
 
 
+// number of compiled patterns kept by default in the cache
+#define kDEFAULT_PATTERN_CACHE_SIZE	256
+
+
+class VRegexCompiledPattern : public VObject, public IRefCountable
+{
+public:
+									VRegexCompiledPattern( const VString& inSource, xbox_icu::RegexPattern *inPattern, sLONG inGroupCount):fSource( inSource), fPattern( inPattern), fGroupCount( inGroupCount) {;}
+
+			const VString&			GetSource() const		{ return fSource;}
+			xbox_icu::RegexPattern*	GetPattern() const		{ return fPattern;}
+			sLONG					GetGroupCount() const	{ return fGroupCount;}
+
+private:
+									~VRegexCompiledPattern()	{ delete fPattern;}
+
+			VString					fSource;
+			xbox_icu::RegexPattern*	fPattern;
+			sLONG					fGroupCount;
+};
+
+
+// binary order, much cheaper than VString collation
+class VRegexPatternLess
+{
+public:
+			bool					operator()( const VString& inPattern1, const VString& inPattern2) const
+			{
+				if (inPattern1.GetLength() != inPattern2.GetLength())
+					return inPattern1.GetLength() < inPattern2.GetLength();
+				return ::memcmp( inPattern1.GetCPointer(), inPattern2.GetCPointer(), inPattern1.GetLength() * sizeof( UniChar)) < 0;
+			}
+};
+
+
+class VRegexPatternCache
+{
+public:
+									VRegexPatternCache():fMaxPatterns( kDEFAULT_PATTERN_CACHE_SIZE) {;}
+									~VRegexPatternCache()	{ Purge();}
+
+			VRegexCompiledPattern*	RetainPattern( const VString& inPattern, VError *outError);
+
+			void					SetMaxPatterns( VSize inMaxPatterns);
+			void					Purge();
+
+private:
+	typedef std::list<VRegexCompiledPattern*>										LRUList;
+	typedef std::map<VString, LRUList::iterator, VRegexPatternLess>	MapOfPattern;
+
+			void					_Trim();
+
+			VCriticalSection		fMutex;
+			LRUList					fPatterns;		// most recently used first
+			MapOfPattern			fPatternsBySource;
+			VSize					fMaxPatterns;
+};
+
+static VRegexPatternCache sPatternCache;
+
+
+VRegexCompiledPattern* VRegexPatternCache::RetainPattern( const VString& inPattern, VError *outError)
+{
+	{
+		VTaskLock lock( &fMutex);
+		MapOfPattern::iterator found = fPatternsBySource.find( inPattern);
+		if (found != fPatternsBySource.end())
+		{
+			fPatterns.splice( fPatterns.begin(), fPatterns, found->second);
+			return RetainRefCountable( *found->second);
+		}
+	}
+
+	// compile outside of the lock
+	UErrorCode status = U_ZERO_ERROR;
+	UParseError parseError;
+	xbox_icu::UnicodeString string( FALSE, (const UChar*) inPattern.GetCPointer(), inPattern.GetLength());
+	xbox_icu::RegexPattern *icu_pattern = xbox_icu::RegexPattern::compile( string, 0 /*flags*/, parseError, status);
+
+	sLONG groupCount = 0;
+	if (U_SUCCESS( status))
+	{
+		RegexMatcher *icu_matcher = icu_pattern->matcher( status);
+		if (U_SUCCESS( status))
+			groupCount = icu_matcher->groupCount();
+		delete icu_matcher;
+	}
+
+	if (!U_SUCCESS( status))
+	{
+		_CheckError( inPattern, status, outError);
+		delete icu_pattern;
+		return NULL;
+	}
+
+	VRegexCompiledPattern *pattern = new VRegexCompiledPattern( inPattern, icu_pattern, groupCount);
+
+	VTaskLock lock( &fMutex);
+	MapOfPattern::iterator found = fPatternsBySource.find( inPattern);
+	if (found != fPatternsBySource.end())
+	{
+		// another task compiled the same pattern meanwhile
+		pattern->Release();
+		fPatterns.splice( fPatterns.begin(), fPatterns, found->second);
+		pattern = *found->second;
+	}
+	else
+	{
+		fPatterns.push_front( pattern);
+		fPatternsBySource[inPattern] = fPatterns.begin();
+		_Trim();
+	}
+
+	return RetainRefCountable( pattern);
+}
+
+
+void VRegexPatternCache::SetMaxPatterns( VSize inMaxPatterns)
+{
+	VTaskLock lock( &fMutex);
+	fMaxPatterns = inMaxPatterns;
+	_Trim();
+}
+
+
+void VRegexPatternCache::Purge()
+{
+	VTaskLock lock( &fMutex);
+	for( LRUList::iterator i = fPatterns.begin() ; i != fPatterns.end() ; ++i)
+		(*i)->Release();
+	fPatterns.clear();
+	fPatternsBySource.clear();
+}
+
+
+void VRegexPatternCache::_Trim()
+{
+	// matchers still using a dropped pattern keep it alive
+	while( fPatternsBySource.size() > fMaxPatterns)
+	{
+		VRegexCompiledPattern *pattern = fPatterns.back();
+		fPatternsBySource.erase( pattern->GetSource());
+		fPatterns.pop_back();
+		pattern->Release();
+	}
+}
+
+
+VRegexMatcher::VRegexMatcher( const VString& inPattern, VRegexCompiledPattern *inCompiledPattern, xbox_icu::RegexMatcher *inMatcher)
+: fMatcher( inMatcher)
+, fCompiledPattern( RetainRefCountable( inCompiledPattern))
+, fPattern( inPattern)
+{
+}
+
+
 VRegexMatcher::~VRegexMatcher()
 {
 	delete fMatcher;
+	ReleaseRefCountable( &fCompiledPattern);
 }
 
 
 VRegexMatcher *VRegexMatcher::Create( const VString& inPattern, VError *outError)
 {
-	UErrorCode status = U_ZERO_ERROR;
+	VRegexMatcher *matcher = NULL;
 	
-	VRegexMatcher *matcher;
-	
-	xbox_icu::UnicodeString string( FALSE, inPattern.GetCPointer(), inPattern.GetLength());
-    RegexMatcher *icu_matcher = new RegexMatcher( string, 0 /*flags*/, status);
+	VRegexCompiledPattern *pattern = sPatternCache.RetainPattern( inPattern, outError);
+	if (pattern != NULL)
+	{
+		UErrorCode status = U_ZERO_ERROR;
+		RegexMatcher *icu_matcher = pattern->GetPattern()->matcher( status);
+
+		if ( !U_SUCCESS( status) )
+		{
+			_CheckError( inPattern, status, outError);
+			delete icu_matcher;
+		}
+		else
+		{
+			matcher = new VRegexMatcher( inPattern, pattern, icu_matcher);
+		}
+		pattern->Release();
+	}
+
+	return matcher;
+}
+
 
-	if ( !U_SUCCESS( status) )
+VRegexMatcher *VRegexMatcher::CreateMultiple( const std::vector<VString>& inPatterns, VError *outError)
+{
+	VRegexMatcher *matcher = NULL;
+	VString alternation;
+	std::vector<sLONG> groupOffsets;
+	sLONG group = 1;
+	bool ok = true;
+
+	// compiling each pattern alone checks it and tells how many groups it has
+	for( std::vector<VString>::const_iterator i = inPatterns.begin() ; (i != inPatterns.end()) && ok ; ++i)
 	{
-		_CheckError( inPattern, status, outError);
+		VRegexCompiledPattern *pattern = sPatternCache.RetainPattern( *i, outError);
+		if (pattern != NULL)
+		{
+			if (!alternation.IsEmpty())
+				alternation.AppendUniChar( '|');
+			alternation.AppendUniChar( '(');
+			alternation.AppendString( *i);
+			alternation.AppendUniChar( ')');
 
-		delete icu_matcher;
-		icu_matcher = NULL;
-		matcher = NULL;
+			groupOffsets.push_back( group);
+			group += 1 + pattern->GetGroupCount();
+			pattern->Release();
+		}
+		else
+		{
+			ok = false;
+		}
 	}
-	else
+	groupOffsets.push_back( group);
+
+	if (ok && !inPatterns.empty())
 	{
-		matcher = new VRegexMatcher( inPattern, icu_matcher);
+		matcher = Create( alternation, outError);
+		if (matcher != NULL)
+			matcher->fGroupOffsets.swap( groupOffsets);
 	}
 
 	return matcher;
 }
 
 
+VRegexMatcher *VRegexMatcher::Clone() const
+{
+	UErrorCode status = U_ZERO_ERROR;
+	RegexMatcher *icu_matcher = fCompiledPattern->GetPattern()->matcher( status);
+	if (!U_SUCCESS( status))
+	{
+		delete icu_matcher;
+		return NULL;
+	}
+
+	VRegexMatcher *matcher = new VRegexMatcher( fPattern, fCompiledPattern, icu_matcher);
+	matcher->fGroupOffsets = fGroupOffsets;
+	return matcher;
+}
+
+
+void VRegexMatcher::_SetText( const VString& inText)
+{
+	// the matcher keeps a shallow clone of the UText so that inText buffer is used in place, without wrapping it in a UnicodeString
+	UErrorCode status = U_ZERO_ERROR;
+	UText text = UTEXT_INITIALIZER;
+	utext_openUChars( &text, (const UChar*) inText.GetCPointer(), inText.GetLength(), &status);
+	fMatcher->reset( &text);
+	utext_close( &text);
+}
+
+
 bool VRegexMatcher::Find( const VString& inText, VIndex inStart, bool inContinueSearching, VError *outError)
 {
 	UErrorCode status = U_ZERO_ERROR;
 
-	fMatcher->reset( xbox_icu::UnicodeString( FALSE, inText.GetCPointer(), inText.GetLength()));
+	_SetText( inText);
 
 	UBool found;
 	if (inContinueSearching)
@@ -98,16 +327,76 @@ bool VRegexMatcher::Find( const VString& inText, VIndex inStart, bool inContinue
 }
 
 
+VIndex VRegexMatcher::FindAll( const VString& inText, VIndex inStart, VectorOfRegexMatch& ioMatches, VError *outError)
+{
+	UErrorCode status = U_ZERO_ERROR;
+	VIndex count = 0;
+
+	_SetText( inText);
+
+	UBool found = fMatcher->find( inStart - 1, status);
+	while( found && U_SUCCESS( status))
+	{
+		sLONG start = fMatcher->start( status);
+		sLONG end = fMatcher->end( status);
+
+		VRegexMatch match;
+		match.fStart = start + 1;
+		match.fLength = end - start;
+		match.fPatternIndex = GetMatchedPatternIndex();
+		ioMatches.push_back( match);
+		++count;
+
+		// an empty match makes find() move forward by one char
+		found = fMatcher->find();
+	}
+
+	_CheckError( fPattern, status, outError);
+
+	return count;
+}
+
+
+VIndex VRegexMatcher::GetMatchedPatternIndex() const
+{
+	if (fGroupOffsets.empty())
+		return 0;
+
+	for( size_t i = 0 ; i + 1 < fGroupOffsets.size() ; ++i)
+	{
+		UErrorCode status = U_ZERO_ERROR;
+		if (fMatcher->start( fGroupOffsets[i], status) >= 0)
+			return (VIndex) i;
+	}
+	return -1;
+}
+
+
+sLONG VRegexMatcher::_GetICUGroup( VIndex inGroupIndex) const
+{
+	if (fGroupOffsets.empty())
+		return inGroupIndex;
+
+	// group 0 of a pattern is its group in the alternation
+	VIndex patternIndex = GetMatchedPatternIndex();
+	return (patternIndex >= 0) ? fGroupOffsets[patternIndex] + inGroupIndex : inGroupIndex;
+}
+
+
 VIndex VRegexMatcher::GetGroupCount() const
 {
-	return fMatcher->groupCount();
+	if (fGroupOffsets.empty())
+		return fMatcher->groupCount();
+
+	VIndex patternIndex = GetMatchedPatternIndex();
+	return (patternIndex >= 0) ? fGroupOffsets[patternIndex + 1] - fGroupOffsets[patternIndex] - 1 : 0;
 }
 
 
 VIndex VRegexMatcher::GetGroupStart( VIndex inGroupIndex) const
 {
 	UErrorCode status = U_ZERO_ERROR;
-	sLONG start = fMatcher->start( inGroupIndex, status);
+	sLONG start = fMatcher->start( _GetICUGroup( inGroupIndex), status);
 	xbox_assert( U_SUCCESS( status));
 	
 	return (start >= 0) ? (start + 1) : start;
@@ -117,8 +406,9 @@ VIndex VRegexMatcher::GetGroupStart( VIndex inGroupIndex) const
 VIndex VRegexMatcher::GetGroupLength( VIndex inGroupIndex) const
 {
 	UErrorCode status = U_ZERO_ERROR;
-	sLONG start = fMatcher->start( inGroupIndex, status);
-	sLONG end = fMatcher->end( inGroupIndex, status);
+	sLONG icuGroup = _GetICUGroup( inGroupIndex);
+	sLONG start = fMatcher->start( icuGroup, status);
+	sLONG end = fMatcher->end( icuGroup, status);
 	xbox_assert( U_SUCCESS( status));
 
 	return (end >= 0) ? (end - start) : 0;
@@ -132,6 +422,18 @@ bool VRegexMatcher::IsSamePattern( const VString& inPattern) const
 	return (inPattern.GetLength() == fPattern.GetLength()) && (::memcmp( inPattern.GetCPointer(), fPattern.GetCPointer(), inPattern.GetLength()*sizeof(UniChar)) == 0);
 }
 
+
+void VRegexMatcher::SetCacheSize( VSize inMaxPatterns)
+{
+	sPatternCache.SetMaxPatterns( inMaxPatterns);
+}
+
+
+void VRegexMatcher::PurgeCache()
+{
+	sPatternCache.Purge();
+}
+
 END_TOOLBOX_NAMESPACE
 
 #endif
@@ -24,13 +24,45 @@ namespace xbox_icu
 
 BEGIN_TOOLBOX_NAMESPACE
 
+class VRegexCompiledPattern;
+
+typedef struct VRegexMatch
+{
+	VIndex		fStart;
+	VIndex		fLength;
+	VIndex		fPatternIndex;	// index of matched pattern for a matcher created with CreateMultiple, 0 otherwise
+} VRegexMatch;
+
+typedef std::vector<VRegexMatch> VectorOfRegexMatch;
+
+/*
+	Compiled patterns are kept in a process-wide LRU cache shared by all tasks:
+	creating a matcher for a pattern already seen doesn't compile it again.
+
+	A matcher is not thread-safe. Use Clone to get a matcher for another task, it shares the compiled pattern.
+*/
 class XTOOLBOX_API VRegexMatcher : public VObject, public IRefCountable
 {
 public:
 	static	VRegexMatcher*			Create( const VString& inPattern, VError *outError);
 
+	/*
+		Creates a matcher for the alternation of all inPatterns so that a text is scanned only once whatever the number of patterns.
+		At a given position, the first pattern in inPatterns that matches wins.
+		Groups are numbered within the matched pattern, which can't use numbered back references.
+	*/
+	static	VRegexMatcher*			CreateMultiple( const std::vector<VString>& inPatterns, VError *outError);
+
+			VRegexMatcher*			Clone() const;
+
 			bool					Find( const VString& inText, VIndex inStart, bool inContinueSearching, VError *outError);
 
+			// appends all successive matches found from inStart to ioMatches and returns their count
+			VIndex					FindAll( const VString& inText, VIndex inStart, VectorOfRegexMatch& ioMatches, VError *outError);
+
+			// index in the patterns given to CreateMultiple of the pattern matched by last Find, 0 for a single pattern
+			VIndex					GetMatchedPatternIndex() const;
+
 			VIndex					GetGroupCount() const;
 
 			VIndex					GetGroupStart( VIndex inGroupIndex) const;
@@ -38,12 +70,20 @@ public:
 			
 			bool					IsSamePattern( const VString& inPattern) const;
 
+	static	void					SetCacheSize( VSize inMaxPatterns);
+	static	void					PurgeCache();
+
 private:
-									VRegexMatcher( const VString& inPattern, xbox_icu::RegexMatcher *inMatcher):fPattern( inPattern), fMatcher( inMatcher) {;}
+									VRegexMatcher( const VString& inPattern, VRegexCompiledPattern *inCompiledPattern, xbox_icu::RegexMatcher *inMatcher);
 									~VRegexMatcher();
 
+			void					_SetText( const VString& inText);
+			sLONG					_GetICUGroup( VIndex inGroupIndex) const;
+
 			xbox_icu::RegexMatcher*		fMatcher;
+			VRegexCompiledPattern*	fCompiledPattern;
 			VString					fPattern;
+			std::vector<sLONG>		fGroupOffsets;	// CreateMultiple: group of each pattern in the alternation, plus one past the last group
 };
 
 END_TOOLBOX_NAMESPACE
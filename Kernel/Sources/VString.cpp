@@ -22,6 +22,7 @@
 #include "VStream.h"
 #include "VUUID.h"
 #include "VTime.h"
+#include "MurmurHash.h"
 #include "VFloat.h"
 #include "VArrayValue.h"
 #include "VArray.h"
@@ -35,6 +36,22 @@
 	#include <xlocale.h>
 #endif
 
+// FindRawString scans 8 UniChars at a time when SSE2 is available (always the case on x86_64)
+#ifndef WITH_SSE2_FIND_STRING
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+		#define WITH_SSE2_FIND_STRING 1
+	#else
+		#define WITH_SSE2_FIND_STRING 0
+	#endif
+#endif
+
+#if WITH_SSE2_FIND_STRING
+	#include <emmintrin.h>
+	#if VERSIONWIN
+		#include <intrin.h>
+	#endif
+#endif
+
 BEGIN_TOOLBOX_NAMESPACE
 
 
@@ -625,80 +642,163 @@ bool VString::EqualToStringRaw( const VString& inString) const
 }
 
 
+#if WITH_SSE2_FIND_STRING
+static inline sLONG _FirstBitSet( uLONG inMask)
+{
+#if VERSIONWIN
+	unsigned long index;
+	_BitScanForward( &index, inMask);
+	return (sLONG) index;
+#else
+	return (sLONG) __builtin_ctz( inMask);
+#endif
+}
+#endif
+
+
 /*
 	static
 */
 sLONG VString::FindRawString( const UniChar* inText, sLONG inTextSize, const UniChar* inPattern, sLONG inPatternSize)
 {
-	// see http://fr.wikipedia.org/wiki/Algorithme_de_Knuth-Morris-Pratt
+	// candidates are filtered on first and last char of the pattern before comparing the middle part.
+	// this is what makes the vectorized scan effective since most positions are discarded 8 at a time.
 	
-	sLONG targetBuffer[256];
-	sLONG *retarget = (inPatternSize < 256) ? targetBuffer : (sLONG*) malloc( sizeof( sLONG) * (inPatternSize + 1));
+	if (inPatternSize <= 0)
+		return 1;
+
+	if (inPatternSize > inTextSize)
+		return 0;
+
+	const UniChar first = inPattern[0];
+	const sLONG lastOffset = inPatternSize - 1;
+	const UniChar last = inPattern[lastOffset];
+	const size_t middleSize = (inPatternSize > 2) ? (inPatternSize - 2) * sizeof( UniChar) : 0;
+
+	const UniChar *candidate = inText;
+	const UniChar *candidateEnd = inText + inTextSize - lastOffset;	// one past the last possible start
 
+#if WITH_SSE2_FIND_STRING
+	const __m128i firsts = _mm_set1_epi16( (short) first);
+	const __m128i lasts = _mm_set1_epi16( (short) last);
+	for( ; candidateEnd - candidate >= 8 ; candidate += 8)
 	{
-		sLONG i = 0;
-		sLONG j = -1;
-		UniChar c = 0;
-		
-		retarget[0] = j;
-		while( i != inPatternSize)
+		__m128i blockFirst = _mm_loadu_si128( (const __m128i*) candidate);
+		__m128i blockLast = _mm_loadu_si128( (const __m128i*) (candidate + lastOffset));
+		uLONG mask = (uLONG) _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi16( blockFirst, firsts), _mm_cmpeq_epi16( blockLast, lasts)));
+		while (mask != 0)
 		{
-			if (inPattern[i] == c)
-			{
-				retarget[i + 1] = j + 1;
-				++j;
-				++i;
-			}
-			else if (j > 0)
-			{
-				j = retarget[j];
-			}
-			else
-			{
-				retarget[i + 1] = 0;
-				++i;
-				j = 0;
-			}
-			c = inPattern[j];
+			// 2 bits per UniChar
+			sLONG bit = _FirstBitSet( mask);
+			const UniChar *p = candidate + (bit >> 1);
+			if ( (middleSize == 0) || (::memcmp( p + 1, inPattern + 1, middleSize) == 0) )
+				return (sLONG) (p - inText) + 1;
+			mask &= ~(3U << bit);
 		}
 	}
+#endif
 
-	sLONG m = 0;
-	sLONG i = 0;
-	while( (m + i != inTextSize) && (i != inPatternSize))
+	for( ; candidate != candidateEnd ; ++candidate)
 	{
-		if (inText[m + i] == inPattern[i])
+		if ( (*candidate == first) && (candidate[lastOffset] == last) )
 		{
-			++i;
-		}
-		else
-		{
-			m += i - retarget[i];
-			if (i > 0)
-				i = retarget[i];
+			if ( (middleSize == 0) || (::memcmp( candidate + 1, inPattern + 1, middleSize) == 0) )
+				return (sLONG) (candidate - inText) + 1;
 		}
 	}
-	
-	if (retarget != targetBuffer)
-		free( retarget);
 
-	if (i >= inPatternSize)
-		return m + 1;
-	else
-		return 0;
+	return 0;
 }
 
 
 void VString::ExchangeRawString( const VString& inStringToFind, const VString& inStringToInsert, VIndex inPlaceToStart, VIndex inCountToReplace)
 {
-	VIndex morelen = inStringToInsert.GetLength();
-	while(inCountToReplace-- && inPlaceToStart <= GetLength())
+	VIndex findLength = inStringToFind.GetLength();
+	if ( (findLength <= 0) || (inCountToReplace <= 0) || (inPlaceToStart < 1) || (inPlaceToStart > GetLength()) )
+		return;
+
+	if ( (&inStringToFind == this) || (&inStringToInsert == this) )
+	{
+		VString find( inStringToFind);
+		VString insert( inStringToInsert);
+		ExchangeRawString( find, insert, inPlaceToStart, inCountToReplace);
+		return;
+	}
+
+	// collect all matches first so that the result is built in one pass instead of one Replace per match
+	const UniChar *text = GetCPointer();
+	VIndex textLength = GetLength();
+	std::vector<std::pair<VIndex,VIndex> > matches;
+	for( VIndex pos = inPlaceToStart - 1 ; (inCountToReplace > 0) && (pos < textLength) ; --inCountToReplace)
 	{
-		VIndex pos = FindRawString( GetCPointer() + inPlaceToStart - 1, GetLength() - inPlaceToStart + 1, inStringToFind.GetCPointer(), inStringToFind.GetLength());
-		if (pos <= 0)
+		VIndex found = FindRawString( text + pos, textLength - pos, inStringToFind.GetCPointer(), findLength);
+		if (found <= 0)
 			break;
-		Replace( inStringToInsert, pos + inPlaceToStart - 1, inStringToFind.GetLength());
-		inPlaceToStart = pos + inPlaceToStart - 1 + morelen;
+		pos += found - 1;
+		matches.push_back( std::pair<VIndex,VIndex>( pos, findLength));
+		pos += findLength;
+	}
+
+	_ReplaceMatches( matches, inStringToInsert);
+}
+
+
+void VString::_ReplaceMatches( const std::vector<std::pair<VIndex,VIndex> >& inMatches, const VString& inStringToInsert)
+{
+	if (inMatches.empty())
+		return;
+
+	const UniChar *text = GetCPointer();
+	VIndex textLength = GetLength();
+	const UniChar *insertPtr = inStringToInsert.GetCPointer();
+	VIndex insertLength = inStringToInsert.GetLength();
+
+	VIndex newLength = textLength;
+	bool neverLonger = true;
+	for( std::vector<std::pair<VIndex,VIndex> >::const_iterator i = inMatches.begin() ; i != inMatches.end() ; ++i)
+	{
+		newLength += insertLength - i->second;
+		if (insertLength > i->second)
+			neverLonger = false;
+	}
+
+	if (neverLonger)
+	{
+		// compact in place, the write position never passes the read position
+		UniChar *dest = GetCPointerForWrite();
+		if (dest == NULL)
+			return;
+		UniChar *write = dest + inMatches.front().first;
+		VIndex read = inMatches.front().first;
+		for( std::vector<std::pair<VIndex,VIndex> >::const_iterator i = inMatches.begin() ; i != inMatches.end() ; ++i)
+		{
+			::memmove( write, dest + read, (i->first - read) * sizeof( UniChar));
+			write += i->first - read;
+			::memmove( write, insertPtr, insertLength * sizeof( UniChar));
+			write += insertLength;
+			read = i->first + i->second;
+		}
+		::memmove( write, dest + read, (textLength - read) * sizeof( UniChar));
+		Validate( newLength);
+	}
+	else
+	{
+		VString result;
+		UniChar *dest = result.GetCPointerForWrite( newLength);
+		if (dest == NULL)
+			return;
+		VIndex read = 0;
+		for( std::vector<std::pair<VIndex,VIndex> >::const_iterator i = inMatches.begin() ; i != inMatches.end() ; ++i)
+		{
+			::memcpy( dest, text + read, (i->first - read) * sizeof( UniChar));
+			dest += i->first - read;
+			::memcpy( dest, insertPtr, insertLength * sizeof( UniChar));
+			dest += insertLength;
+			read = i->first + i->second;
+		}
+		::memcpy( dest, text + read, (textLength - read) * sizeof( UniChar));
+		result.Validate( newLength);
+		Swap( result);
 	}
 }
 
@@ -1654,23 +1754,16 @@ void VString::GetDuration(VDuration& outDuration) const
 
 uLONG VString::GetHashValue() const
 {
-    uLONG stringLength = GetLength();
-    uLONG result = stringLength;
-    uLONG characterIndex;
-
-	const UniChar *uContents = GetCPointer();
-	if (stringLength <= 16) {
-		for (characterIndex = 0; characterIndex < stringLength; ++characterIndex) 
-			result = result * 257 + uContents[characterIndex];
-	} else {
-		for (characterIndex = 0; characterIndex < 8; ++characterIndex) 
-			result = result * 257 + uContents[characterIndex];
-		for (characterIndex = stringLength - 8; characterIndex < stringLength; ++characterIndex) 
-			result = result * 257 + uContents[characterIndex];
-	}
-	
-    result += (result << (stringLength & 31));
-    return result;
+	// hash the whole content: paths, urls or json keys often share their first and last characters
+	// so that sampling only a few of them makes hash containers degenerate.
+	// MurmurHash64Wide mixes 16 bytes (8 UniChars) per round, MurmurHash2 only 4 but without 64-bit multiplies.
+	uLONG stringLength = GetLength();
+#if ARCH_64
+	uLONG8 hash = MurmurHash64Wide( GetCPointer(), (int) (stringLength * sizeof( UniChar)), stringLength);
+	return (uLONG) (hash ^ (hash >> 32));
+#else
+	return (uLONG) MurmurHash2( GetCPointer(), (int) (stringLength * sizeof( UniChar)), stringLength);
+#endif
 }
 
 Real VString::GetReal() const
@@ -2382,17 +2475,32 @@ VIndex VString::Find( const VString& inStringToFind, VIndex inPlaceToStart, bool
 
 void VString::Exchange(const VString& inStringToFind, const VString& inStringToInsert, VIndex inPlaceToStart, VIndex inCountToReplace, bool inDiacritical, VCollator *inCollator)
 {
+	if ( (&inStringToFind == this) || (&inStringToInsert == this) )
+	{
+		VString find( inStringToFind);
+		VString insert( inStringToInsert);
+		Exchange( find, insert, inPlaceToStart, inCountToReplace, inDiacritical, inCollator);
+		return;
+	}
+
 	VCollator *collator = (inCollator != NULL) ? inCollator : VIntlMgr::GetDefaultMgr()->GetCollator();
-	VIndex morelen = inStringToInsert.GetLength();
-	while(inCountToReplace-- && inPlaceToStart <= GetLength())
+
+	// the collator may match a different length than inStringToFind, so matches are kept with their length
+	const UniChar *text = GetCPointer();
+	VIndex textLength = GetLength();
+	std::vector<std::pair<VIndex,VIndex> > matches;
+	for( VIndex pos = inPlaceToStart - 1 ; (inCountToReplace > 0) && (pos < textLength) ; --inCountToReplace)
 	{
 		sLONG matchedLength;
-		VIndex pos = collator->FindString( GetCPointer() + inPlaceToStart - 1, GetLength() - inPlaceToStart + 1, inStringToFind.GetCPointer(), inStringToFind.GetLength(), inDiacritical, &matchedLength);
-		if ((pos <= 0) || (matchedLength == 0))
+		VIndex found = collator->FindString( text + pos, textLength - pos, inStringToFind.GetCPointer(), inStringToFind.GetLength(), inDiacritical, &matchedLength);
+		if ((found <= 0) || (matchedLength == 0))
 			break;
-		Replace(inStringToInsert, pos + inPlaceToStart - 1, matchedLength);
-		inPlaceToStart = pos + inPlaceToStart - 1 + morelen;
+		pos += found - 1;
+		matches.push_back( std::pair<VIndex,VIndex>( pos, matchedLength));
+		pos += matchedLength;
 	}
+
+	_ReplaceMatches( matches, inStringToInsert);
 }
 
 
@@ -781,6 +781,9 @@ private:
 			bool				_PrepareWriteKeepContent( VIndex inNbChars)				{ return _IsShared() ? _ReallocBuffer( Max( inNbChars, fLength), true) : _EnsureSize( inNbChars, true); }
 			bool				_PrepareWriteTrashContent( VIndex inNbChars)			{ return _IsShared() ? _ReallocBuffer( inNbChars, false) : _EnsureSize( inNbChars, false); }
 			bool				_EnsureSize( VIndex inNbChars, bool inCopyCharacters)	{ return ( inNbChars <= fMaxLength) ? true : _EnlargeBuffer( inNbChars, inCopyCharacters); }
+
+			// replaces each (position, length) match, sorted and not overlapping, with inStringToInsert in one pass
+			void				_ReplaceMatches( const std::vector<std::pair<VIndex,VIndex> >& inMatches, const VString& inStringToInsert);
 };
 
 
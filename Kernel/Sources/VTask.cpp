@@ -365,11 +365,102 @@ bool VTask::Run()
 }
 
 
+namespace
+{
+	struct VParallelJob
+	{
+		void		(*fProc)( void* inContext, sLONG inIndex);
+		void*		fContext;
+		sLONG		fPending;
+		VSyncEvent*	fDone;
+	};
+
+	struct VParallelTaskData
+	{
+		VParallelJob*	fJob;
+		sLONG			fIndex;
+	};
+}
+
+
+static void _EndParallelCall( VParallelJob *inJob, VSyncEvent *inDone)
+{
+	// the waiting task may return as soon as the count drops to 0: inDone must have been retained before
+	if (VInterlocked::Decrement( &inJob->fPending) == 0)
+		inDone->Unlock();
+}
+
+
+static sLONG _ParallelTaskRunProc( VTask *inTask)
+{
+	VParallelTaskData *data = (VParallelTaskData*) inTask->GetKindData();
+	VParallelJob *job = data->fJob;
+	VSyncEvent *done = RetainRefCountable( job->fDone);
+
+	job->fProc( job->fContext, data->fIndex);
+
+	_EndParallelCall( job, done);
+	done->Release();
+
+	return 0;
+}
+
+
+/*
+	static
+*/
+void VTask::RunInParallel( sLONG inCount, void (*inProc)( void* inContext, sLONG inIndex), void* inContext)
+{
+	if (inCount <= 1)
+	{
+		if (inCount == 1)
+			inProc( inContext, 0);
+		return;
+	}
+
+	VParallelJob job;
+	job.fProc = inProc;
+	job.fContext = inContext;
+	job.fPending = inCount - 1;
+	job.fDone = new VSyncEvent;
+
+	std::vector<VParallelTaskData> taskDatas( inCount);
+
+	for( sLONG i = 1 ; i < inCount ; ++i)
+	{
+		taskDatas[i].fJob = &job;
+		taskDatas[i].fIndex = i;
+
+		VTask *task = new VTask( NULL, 0, eTaskStylePreemptive, _ParallelTaskRunProc);
+		task->SetKindData( (sLONG_PTR) &taskDatas[i]);
+		if (!task->Run())
+		{
+			inProc( inContext, i);
+			_EndParallelCall( &job, job.fDone);
+		}
+		task->Release();
+	}
+
+	inProc( inContext, 0);
+
+	job.fDone->Lock();
+	job.fDone->Release();
+}
+
+
 void VTask::_Exit()
 {
 	StopMessaging();
 	DisposeAllData();
 	fManager->_TaskStopped( this);
+
+	// give back the small blocks this thread kept for itself
+	VCppMemMgr *allocator = VObject::GetAllocator();
+	if (allocator != NULL)
+		allocator->FlushThreadCache();
+	allocator = VObject::GetAllocator( true);
+	if (allocator != NULL)
+		allocator->FlushThreadCache();
 }
 
 
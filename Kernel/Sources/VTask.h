@@ -310,6 +310,15 @@ public:
 	*/
 			bool						Run();
 
+	/*!
+		@function RunInParallel
+		@abstract Calls inProc( inContext, i) for each i in [0, inCount[ and returns once all calls are done.
+		@discussion
+			Call 0 runs in the current task, the others each in a new preemptive task.
+			A call whose task can't be launched runs in the current task.
+	*/
+	static	void						RunInParallel( sLONG inCount, void (*inProc)( void* inContext, sLONG inIndex), void* inContext);
+
 	/*!
 		@function Sleep
 		@abstract Puts the current task into sleep for a certain amount of time.
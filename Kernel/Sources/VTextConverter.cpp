@@ -23,50 +23,32 @@
 
 #include "VCharSetNames.h"
 
+// UTF-8 conversions widen or narrow runs of 16 ASCII chars at a time when SSE2 is available (always the case on x86_64)
+#ifndef WITH_SSE2_UTF8
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+		#define WITH_SSE2_UTF8 1
+	#else
+		#define WITH_SSE2_UTF8 0
+	#endif
+#endif
+
+#if WITH_SSE2_UTF8
+	#include <emmintrin.h>
+	#if VERSIONWIN
+		#include <intrin.h>
+	#endif
+#endif
+
 VTextConverters*		VTextConverters::sInstance = NULL;
 
 
 // ---------------------------------------------------------------------------
 //  Local static data
 //
-//  sUTFBytes
-//	  A list of counts of trailing bytes for each initial byte in the input.
-//
-//  sUTFOffsets
-//	  A list of values to offset each result char type, according to how
-//	  many source bytes when into making it.
-//
 //  sFirstByteMark
 //	  A list of values to mask onto the first byte of an encoded sequence,
 //	  indexed by the number of bytes used to create the sequence.
 // ---------------------------------------------------------------------------
-static const uBYTE sUTFBytes[256] =
-{
-		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-	,   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
-	,   1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
-	,   2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2
-	,   3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5
-};
-
-
-static const uLONG sUTFOffsets[6] =
-{
-	0, 0x3080, 0xE2080, 0x3C82080, 0xFA082080, 0x82082080
-};
-
-
 static const uBYTE sFirstByteMark[7] =
 {
 	0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC
@@ -683,6 +665,47 @@ bool VFromUnicodeConverter_Void::IsValid() const
 }
 
 
+#if WITH_SSE2_UTF8
+static inline sLONG _FirstBitSet( uLONG inMask)
+{
+#if VERSIONWIN
+	unsigned long index;
+	_BitScanForward( &index, inMask);
+	return (sLONG) index;
+#else
+	return (sLONG) __builtin_ctz( inMask);
+#endif
+}
+
+
+// Widens ASCII bytes 16 at a time while there's room for 16 chars.
+// Returns the first byte that is not ASCII or that was not converted.
+static inline const uBYTE *_WidenASCII( const uBYTE *inSrc, const uBYTE *inSrcEnd, UniChar*& ioDest, const UniChar *inDestEnd)
+{
+	const __m128i zero = _mm_setzero_si128();
+	while ( (inSrcEnd - inSrc >= 16) && (inDestEnd - ioDest >= 16) )
+	{
+		__m128i bytes = _mm_loadu_si128( (const __m128i*) inSrc);
+		_mm_storeu_si128( (__m128i*) ioDest, _mm_unpacklo_epi8( bytes, zero));
+		_mm_storeu_si128( (__m128i*) (ioDest + 8), _mm_unpackhi_epi8( bytes, zero));
+
+		uLONG mask = (uLONG) _mm_movemask_epi8( bytes);
+		if (mask != 0)
+		{
+			// keep the leading ASCII part, the chars stored past it will be overwritten
+			sLONG count = _FirstBitSet( mask);
+			inSrc += count;
+			ioDest += count;
+			break;
+		}
+		inSrc += 16;
+		ioDest += 16;
+	}
+	return inSrc;
+}
+#endif
+
+
 // ---------------------------------------------------------------------------
 //  XMLUTF8Transcoder: Implementation of the transcoder API
 //	From Xerces
@@ -713,83 +736,112 @@ bool VToUnicodeConverter_UTF8::Convert(const void* inSource, VSize inSourceBytes
 		// Special-case ASCII, which is a leading byte value of <= 127
 		if (firstByte <= 127)
 		{
+		#if WITH_SSE2_UTF8
+			const uBYTE *next = _WidenASCII( srcPtr, srcEnd, outPtr, outEnd);
+			if (next != srcPtr)
+			{
+				srcPtr = next;
+				continue;
+			}
+		#endif
 			*outPtr++ = UniChar(firstByte);
 			srcPtr++;
 			continue;
 		}
 
-		// See how many trailing src bytes this sequence is going to require
-		const unsigned int trailingBytes = sUTFBytes[firstByte];
-
 		//
-		//  If there are not enough source bytes to do this one, then we
-		//  are done. Note that we done >= here because we are implicitly
-		//  counting the 1 byte we get no matter what.
+		//  Multi-bytes sequences are validated: a stray trailing byte, a bad
+		//  trailing byte, an overlong form or an encoded surrogate gives the
+		//  replacement char U+FFFD. Leading bytes beyond U+10FFFF still fail.
 		//
-		//  If we break out here, then there is nothing to undo since we
-		//  haven't updated any pointers yet.
+		//  If there are not enough source bytes to do this one, then we
+		//  are done. If we break out here, then there is nothing to undo
+		//  since we haven't updated any pointers yet.
 		//
-		if (srcPtr + trailingBytes >= srcEnd)
-			break;
-
-		// Looks ok, so lets build up the value
-		uLONG tmpVal = 0;
-		switch(trailingBytes)
+		uLONG tmpVal;
+		if (firstByte < 0xC2)
 		{
-			case 5 : tmpVal += *srcPtr++; tmpVal <<= 6;
-			case 4 : tmpVal += *srcPtr++; tmpVal <<= 6;
-			case 3 : tmpVal += *srcPtr++; tmpVal <<= 6;
-			case 2 : tmpVal += *srcPtr++; tmpVal <<= 6;
-			case 1 : tmpVal += *srcPtr++; tmpVal <<= 6;
-			case 0 : tmpVal += *srcPtr++;
-					 break;
-
-			default :
-				isOK = false;
-				goto failure;
+			// trailing byte or overlong 2 bytes form
+			*outPtr++ = 0xFFFD;
+			srcPtr++;
 		}
-		tmpVal -= sUTFOffsets[trailingBytes];
-
-		//
-		//  If it will fit into a single char, then put it in. Otherwise
-		//  encode it as a surrogate pair. If its not valid, use the
-		//  replacement char.
-		//
-		if (!(tmpVal & 0xFFFF0000))
+		else if (firstByte < 0xE0)
 		{
-			*outPtr++ = UniChar(tmpVal);
+			if (srcPtr + 1 >= srcEnd)
+				break;
+
+			if ((srcPtr[1] & 0xC0) != 0x80)
+			{
+				*outPtr++ = 0xFFFD;
+				srcPtr++;
+				continue;
+			}
+			*outPtr++ = UniChar(((firstByte & 0x1F) << 6) | (srcPtr[1] & 0x3F));
+			srcPtr += 2;
 		}
-		else if (tmpVal > 0x10FFFF)
+		else if (firstByte < 0xF0)
 		{
-			isOK = false;
-			goto failure;
+			if (srcPtr + 2 >= srcEnd)
+				break;
+
+			if ( ((srcPtr[1] & 0xC0) != 0x80) || ((srcPtr[2] & 0xC0) != 0x80) )
+			{
+				*outPtr++ = 0xFFFD;
+				srcPtr++;
+				continue;
+			}
+			tmpVal = ((firstByte & 0x0F) << 12) | ((srcPtr[1] & 0x3F) << 6) | (srcPtr[2] & 0x3F);
+			srcPtr += 3;
+
+			if ( (tmpVal < 0x800) || ((tmpVal >= 0xD800) && (tmpVal <= 0xDFFF)) )
+				tmpVal = 0xFFFD;
+			*outPtr++ = UniChar(tmpVal);
 		}
-		else
+		else if (firstByte < 0xF5)
 		{
+			if (srcPtr + 3 >= srcEnd)
+				break;
+
+			if ( ((srcPtr[1] & 0xC0) != 0x80) || ((srcPtr[2] & 0xC0) != 0x80) || ((srcPtr[3] & 0xC0) != 0x80) )
+			{
+				*outPtr++ = 0xFFFD;
+				srcPtr++;
+				continue;
+			}
+			tmpVal = ((firstByte & 0x07) << 18) | ((srcPtr[1] & 0x3F) << 12) | ((srcPtr[2] & 0x3F) << 6) | (srcPtr[3] & 0x3F);
+
+			if ( (tmpVal < 0x10000) || (tmpVal > 0x10FFFF) )
+			{
+				*outPtr++ = 0xFFFD;
+				srcPtr += 4;
+				continue;
+			}
+
 			//
 			//  If we have enough room to store the leading and trailing
 			//  chars, then lets do it. Else, pretend this one never
-			//  happened, and leave it for the next time. Since we don't
-			//  update the bytes read until the bottom of the loop, by
-			//  breaking out here its like it never happened.
+			//  happened, and leave it for the next time.
 			//
 			if (outPtr + 1 >= outEnd)
 				break;
 
+			srcPtr += 4;
+
 			// Store the leading surrogate char
 			tmpVal -= 0x10000;
 			*outPtr++ = UniChar((tmpVal >> 10) + 0xD800);
 
-			//
-			//  And then the treailing char. This one accounts for no
-			//  bytes eaten from the source, so set the char size for this
-			//  one to be zero.
-			//
+			// And then the trailing char.
 			*outPtr++ = (UniChar) ((tmpVal & 0x3FF) + 0xDC00);
 		}
+		else
+		{
+			// 5 and 6 bytes forms, or 4 bytes beyond U+10FFFF
+			isOK = false;
+			break;
+		}
 	}
 
-failure:
 	// Update the bytes eaten
 	*outBytesConsumed = srcPtr - (uBYTE *) inSource;
 
@@ -800,6 +852,50 @@ failure:
 }
 
 
+#if WITH_SSE2_UTF8
+// Narrows UniChars below 0x80 16 at a time while there's room for 16 bytes.
+// Returns the first char that is not ASCII or that was not converted.
+static inline const UniChar *_NarrowASCII( const UniChar *inSrc, const UniChar *inSrcEnd, uBYTE*& ioDest, const uBYTE *inDestEnd, bool inStore)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i nonASCII = _mm_set1_epi16( (short) 0xFF80);
+	while ( (inSrcEnd - inSrc >= 16) && (inDestEnd - ioDest >= 16) )
+	{
+		__m128i low = _mm_loadu_si128( (const __m128i*) inSrc);
+		__m128i high = _mm_loadu_si128( (const __m128i*) (inSrc + 8));
+
+		// 2 bits per UniChar in each half
+		uLONG mask = (uLONG) _mm_movemask_epi8( _mm_cmpeq_epi16( _mm_and_si128( low, nonASCII), zero))
+					| ((uLONG) _mm_movemask_epi8( _mm_cmpeq_epi16( _mm_and_si128( high, nonASCII), zero)) << 16);
+
+		// saturation only alters non ASCII chars, which are not kept
+		if (inStore)
+			_mm_storeu_si128( (__m128i*) ioDest, _mm_packus_epi16( low, high));
+
+		if (mask != 0xFFFFFFFF)
+		{
+			sLONG count = _FirstBitSet( ~mask) >> 1;
+			inSrc += count;
+			ioDest += count;
+			break;
+		}
+		inSrc += 16;
+		ioDest += 16;
+	}
+	return inSrc;
+}
+
+#endif
+
+
+// no fast path for wchar_t, which is 32 bits on Mac and Linux
+template <class T>
+static inline const T *_NarrowASCII( const T *inSrc, const T* /*inSrcEnd*/, uBYTE*& /*ioDest*/, const uBYTE* /*inDestEnd*/, bool /*inStore*/)
+{
+	return inSrc;
+}
+
+
 template <class T>
 static bool _Convert(const T* inSource, VIndex inSourceChars, VIndex *outCharsConsumed, void* inBuffer, VSize inBufferSize, VSize *outBytesProduced)
 {
@@ -824,6 +920,16 @@ static bool _Convert(const T* inSource, VIndex inSourceChars, VIndex *outCharsCo
         //
         uLONG curVal = static_cast<uLONG>( *srcPtr);
 
+		if (curVal < 0x80)
+		{
+			const T *next = _NarrowASCII( srcPtr, srcEnd, outPtr, outEnd, inBuffer != NULL);
+			if (next != srcPtr)
+			{
+				srcPtr = next;
+				continue;
+			}
+		}
+
         //
         //  If its a leading surrogate, then lets see if we have the trailing
         //  available. If not, then give up now and leave it for next time.
@@ -19,6 +19,8 @@
 #include "VErrorContext.h"
 #include "VTime.h"
 
+#include <sys/uio.h>
+
 
 
 const sLONG	kMAX_PATH_SIZE=PATH_MAX;
@@ -86,35 +88,19 @@ VError XLinuxFileDesc::CreateFile(const char* inPath, FileCreateOptions inCreate
 VError XLinuxFileDesc::GetSize(sLONG8 *outSize) const
 {
 	//There are two easy ways to implement this function : lseek and fstat.
-	//Both are easy and should work. I choose lseek in an arbitrary way.
-
-	//Utiliser stat helper !
+	//fstat doesn't move the seek ptr, so it's safe while other threads use ReadAt/WriteAt.
 
 	if(!IsValid())
 		return VE_INVALID_PARAMETER;
 
-	sLONG8 pos=0;
-	sLONG8 end=0;
+	struct stat64 st;
 
-	VError verr=GetPos(&pos);
-	
-	if(verr==VE_OK)
-		verr=SetPos(0, END);
-	else
+	if(fstat64(fFd, &st)<0)
 		return MAKE_NATIVE_VERROR(errno);
 
-	if(verr==VE_OK)
-		verr=GetPos(&end);
-	
-	if(verr==VE_OK)
-	{
-		*outSize=end;
-		verr=SetPos(pos, SET);
-	}
-
-	xbox_assert(verr==VE_OK);	//We should always be able to restore seek ptr
+	*outSize=st.st_size;
 
-    return verr;
+    return VE_OK;
 }
 
 
@@ -162,7 +148,7 @@ VError XLinuxFileDesc::GetData(void *outData, VSize &ioCount, sLONG8 inOffset, b
 
 		count+=n;
 	}
-	while(n!=0);
+	while(n!=0 && bytes>count);
 
     //Callers expect impl. to fail if it can not fill the data buffer...
     //As a result callers fail if impl. succeed ;) So let's simulate an error !
@@ -215,6 +201,182 @@ VError XLinuxFileDesc::PutData(const void *inData, VSize& ioCount, sLONG8 inOffs
 }
 
 
+VError XLinuxFileDesc::ReadAt(void *outData, VSize &ioCount, sLONG8 inOffset) const
+{
+	if(!IsValid())
+		return VE_INVALID_PARAMETER;
+
+	VError verr=VE_OK;
+
+	ssize_t n=0;
+	ssize_t count=0;
+	ssize_t bytes=ioCount;
+	
+	do
+	{
+		if((n=pread64(fFd, (char*)(outData)+count, bytes-count, inOffset+count))<0)
+		{
+			if(errno==EINTR)
+				continue;
+			else
+			{
+				verr=MAKE_NATIVE_VERROR(errno);
+				break;
+			}
+		}
+
+		count+=n;
+	}
+	while(n!=0 && bytes>count);
+
+	//Same as GetData
+	if(verr==VE_OK && bytes>count)
+		verr=VE_STREAM_EOF;
+
+	ioCount=count;
+
+	return verr;
+}
+
+
+VError XLinuxFileDesc::WriteAt(const void *inData, VSize &ioCount, sLONG8 inOffset) const
+{
+	if(!IsValid())
+		return VE_INVALID_PARAMETER;
+
+	VError verr=VE_OK;
+
+	ssize_t n=0;
+	ssize_t count=0;
+	ssize_t bytes=ioCount;
+	
+	while(bytes-count>0)
+	{
+		if((n=pwrite64(fFd, (const char*)(inData)+count, bytes-count, inOffset+count))<0)
+		{
+			if(errno==EINTR)
+				continue;
+			else
+			{
+				verr=MAKE_NATIVE_VERROR(errno);
+				break;
+			}
+		}
+
+		count+=n;
+	}
+
+	ioCount=count;
+
+	return verr;
+}
+
+
+//Fills an iovec array from inBuffers, skipping the first inSkip bytes (already transfered). Returns the number of iovec used.
+static int _FillIOVec(struct iovec *outVec, int inMaxVec, const VFileIOBuffer *inBuffers, sLONG inBufferCount, VSize inSkip)
+{
+	int nbVec=0;
+
+	for(sLONG i=0 ; i<inBufferCount && nbVec<inMaxVec ; ++i)
+	{
+		if(inSkip>=inBuffers[i].fSize)
+		{
+			inSkip-=inBuffers[i].fSize;
+			continue;
+		}
+
+		outVec[nbVec].iov_base=(char*)inBuffers[i].fData+inSkip;
+		outVec[nbVec].iov_len=inBuffers[i].fSize-inSkip;
+		inSkip=0;
+		++nbVec;
+	}
+
+	return nbVec;
+}
+
+
+VError XLinuxFileDesc::ReadVAt(const VFileIOBuffer *inBuffers, sLONG inBufferCount, VSize &outCount, sLONG8 inOffset) const
+{
+	outCount=0;
+
+	if(!IsValid() || inBuffers==NULL || inBufferCount<0)
+		return VE_INVALID_PARAMETER;
+
+	VSize bytes=0;
+	for(sLONG i=0 ; i<inBufferCount ; ++i)
+		bytes+=inBuffers[i].fSize;
+
+	VError verr=VE_OK;
+	VSize count=0;
+	struct iovec vec[64];
+
+	while(count<bytes)
+	{
+		int nbVec=_FillIOVec(vec, 64, inBuffers, inBufferCount, count);
+		ssize_t n=preadv64(fFd, vec, nbVec, inOffset+count);
+
+		if(n<0)
+		{
+			if(errno==EINTR)
+				continue;
+
+			verr=MAKE_NATIVE_VERROR(errno);
+			break;
+		}
+
+		if(n==0)
+		{
+			verr=VE_STREAM_EOF;
+			break;
+		}
+
+		count+=n;
+	}
+
+	outCount=count;
+
+	return verr;
+}
+
+
+VError XLinuxFileDesc::WriteVAt(const VFileIOBuffer *inBuffers, sLONG inBufferCount, VSize &outCount, sLONG8 inOffset) const
+{
+	outCount=0;
+
+	if(!IsValid() || inBuffers==NULL || inBufferCount<0)
+		return VE_INVALID_PARAMETER;
+
+	VSize bytes=0;
+	for(sLONG i=0 ; i<inBufferCount ; ++i)
+		bytes+=inBuffers[i].fSize;
+
+	VError verr=VE_OK;
+	VSize count=0;
+	struct iovec vec[64];
+
+	while(count<bytes)
+	{
+		int nbVec=_FillIOVec(vec, 64, inBuffers, inBufferCount, count);
+		ssize_t n=pwritev64(fFd, vec, nbVec, inOffset+count);
+
+		if(n<0)
+		{
+			if(errno==EINTR)
+				continue;
+
+			verr=MAKE_NATIVE_VERROR(errno);
+			break;
+		}
+
+		count+=n;
+	}
+
+	outCount=count;
+
+	return verr;
+}
+
+
 VError XLinuxFileDesc::GetPos(sLONG8* outPos) const
 {
 	if(!IsValid())
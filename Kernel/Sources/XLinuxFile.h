@@ -35,6 +35,7 @@ class VFileDesc;
 // class VFileIterator;
 // class VTime;
 class VFileKind;
+struct VFileIOBuffer;
 
 
 class XLinuxFileDesc : public VObject
@@ -58,6 +59,12 @@ public:
     VError            SetPos(sLONG8 inOffset, bool inFromStart) const;
     VError            Flush() const;
 
+	// Positional I/O (pread/pwrite) : doesn't use nor move the current pos, so that several threads may share the descriptor.
+	VError            ReadAt(void *outData, VSize &ioCount, sLONG8 inOffset) const;
+	VError            WriteAt(const void *inData, VSize &ioCount, sLONG8 inOffset) const;
+	VError            ReadVAt(const VFileIOBuffer *inBuffers, sLONG inBufferCount, VSize &outCount, sLONG8 inOffset) const;
+	VError            WriteVAt(const VFileIOBuffer *inBuffers, sLONG inBufferCount, VSize &outCount, sLONG8 inOffset) const;
+
     FileDescSystemRef GetSystemRef() const;
 
 protected:
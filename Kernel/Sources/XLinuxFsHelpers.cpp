@@ -471,6 +471,17 @@ VError OpenHelper::OpenStd(const char* inPath, FileDescSystemRef* outFd, bool* o
 //        yields true BSD semantics: there is no interaction between the types of lock
 //        placed by flock() and fcntl(2), and flock() does not detect deadlock.
 
+#if VERSION_LINUX_ON_XCODE
+	//No posix_fadvise on mac.
+#elif VERSION_LINUX_STRICT
+	//Same meaning as FILE_FLAG_SEQUENTIAL_SCAN and FILE_FLAG_RANDOM_ACCESS on Windows : tune the kernel readahead.
+	//It's only a hint, so we don't care if it fails.
+	if(fOpenOpts & FO_SequentialScan)
+		posix_fadvise(*outFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	else if(fOpenOpts & FO_RandomAccess)
+		posix_fadvise(*outFd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+
 	if(lockType!=0)	//Tout buggé ;(
 	{
 		struct flock lock;
@@ -821,6 +832,17 @@ bool MapHelper::IsValid() { return !(fAddr==MAP_FAILED); }
 void* MapHelper::GetAddr() { return fAddr; }
 
 
+VError MapHelper::Advise(Advice inAdvice)
+{
+	if(!IsValid())
+		return VE_INVALID_PARAMETER;
+
+	int res=madvise(fAddr, fSize, inAdvice);
+
+	return (res==0) ? VE_OK : MAKE_NATIVE_VERROR(errno);
+}
+
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -328,6 +328,11 @@ public :
 	MapHelper&	SetOffset(VSize inOffset);
 	bool		IsValid();
 	void*		GetAddr();
+
+	//Access pattern hint for the whole mapping (madvise) ; must be called after Map().
+	typedef enum {NORMAL=MADV_NORMAL, SEQUENTIAL=MADV_SEQUENTIAL, RANDOM=MADV_RANDOM, WILLNEED=MADV_WILLNEED} Advice;
+
+	VError		Advise(Advice inAdvice);
  	
 
 private :
@@ -63,6 +63,7 @@
 #include "Kernel/Sources/IStreamable.h"
 #include "Kernel/Sources/VStream.h"
 #include "Kernel/Sources/VFileStream.h"
+#include "Kernel/Sources/VPrefetchStream.h"
 #include "Kernel/Sources/VResource.h"
 #include "Kernel/Sources/VArchiveStream.h"
 
@@ -0,0 +1,123 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+#include "KernelIPC/VKernelIPC.h"
+
+#if VERSIONMAC || VERSION_LINUX
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	Process spawns per second through VProcessLauncher, from a small parent and from a parent with a large RSS.
+
+	usage: BenchProcessLauncher [-spawns count] [-rss megabytes]
+
+	Each spawn runs /bin/true and waits for it (VProcessLauncher::ExecuteCommandLine, blocking).
+	The large parent touches -rss megabytes before spawning again: fork() has to copy its page tables,
+	posix_spawn() does not. A plain fork() and execv() loop is measured too, as the baseline.
+*/
+
+
+static void RunLauncher( const char *inParent, sLONG inSpawns)
+{
+	VString commandLine( "/bin/true");
+	sLONG failures = 0;
+	std::vector<sLONG8> latencies;
+	latencies.reserve( inSpawns);
+
+	sLONG8 start = BenchTools::Now();
+	for (sLONG i = 0 ; i < inSpawns ; ++i)
+	{
+		sLONG8 spawnStart = BenchTools::Now();
+		sLONG exitStatus = 0;
+		if (VProcessLauncher::ExecuteCommandLine( commandLine, VProcessLauncher::eVPLOption_None, NULL, NULL, NULL, NULL, NULL, &exitStatus) != 0 || exitStatus != 0)
+			++failures;
+		latencies.push_back( BenchTools::Now() - spawnStart);
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+
+	::printf( "%-6s parent  VProcessLauncher  %8.1f spawns/s  p50 %8.1f us  p99 %8.1f us  rss %lld MB",
+		inParent, BenchTools::PerSecond( inSpawns, duration),
+		BenchTools::Percentile( latencies, 50.0) / 1.0e3, BenchTools::Percentile( latencies, 99.0) / 1.0e3,
+		(long long) (BenchTools::GetRSS() / (1024 * 1024)));
+	if (failures != 0)
+		::printf( "  (%d failures)", (int) failures);
+	::printf( "\n");
+}
+
+
+#if VERSIONMAC || VERSION_LINUX
+static void RunFork( const char *inParent, sLONG inSpawns)
+{
+	sLONG failures = 0;
+
+	sLONG8 start = BenchTools::Now();
+	for (sLONG i = 0 ; i < inSpawns ; ++i)
+	{
+		pid_t pid = ::fork();
+		if (pid == 0)
+		{
+			char *arguments[] = { (char*) "/bin/true", NULL };
+			::execv( arguments[0], arguments);
+			::_exit( 1);
+		}
+		int status = 0;
+		if (pid < 0 || ::waitpid( pid, &status, 0) != pid || !WIFEXITED( status) || WEXITSTATUS( status) != 0)
+			++failures;
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+
+	::printf( "%-6s parent  fork and execv    %8.1f spawns/s", inParent, BenchTools::PerSecond( inSpawns, duration));
+	if (failures != 0)
+		::printf( "  (%d failures)", (int) failures);
+	::printf( "\n");
+}
+#endif
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG spawns = BenchTools::GetArgument( "-spawns", 500);
+	VSize rss = (VSize) BenchTools::GetArgument( "-rss", 2048) * 1024 * 1024;
+
+	RunLauncher( "small", spawns);
+#if VERSIONMAC || VERSION_LINUX
+	RunFork( "small", spawns);
+#endif
+
+	// touch every page so that it is resident and mapped in the page tables
+	std::vector<char> ballast( rss);
+	for (VSize i = 0 ; i < rss ; i += 4096)
+		ballast[i] = (char) i;
+
+	RunLauncher( "large", spawns);
+#if VERSIONMAC || VERSION_LINUX
+	RunFork( "large", spawns);
+#endif
+
+	return 0;
+}
@@ -0,0 +1,153 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+#include "KernelIPC/VKernelIPC.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	VSharedRingBuffer records per second, single producer and several producers, one consumer.
+
+	usage: BenchSharedRingBuffer [-records count] [-capacity kilobytes]
+
+	Producers and consumer are tasks of this process sharing one segment, so this measures the ring itself
+	(reservation, commit and futex wake ups) rather than the cost of crossing processes.
+	Producers block when the ring is full and the consumer blocks when it is empty.
+*/
+
+
+class BenchRing
+{
+public:
+	BenchRing( VSharedRingBuffer& inRing, sLONG inRecordsPerProducer, VSize inRecordSize)
+		: fRing( inRing), fRecordsPerProducer( inRecordsPerProducer), fRecordSize( inRecordSize), fStarted( 0), fErrors( 0)	{}
+
+	VSharedRingBuffer&	fRing;
+	sLONG				fRecordsPerProducer;
+	VSize				fRecordSize;
+	sLONG				fStarted;		// producers wait for it to be set so that they start together
+	sLONG				fErrors;
+};
+
+
+static sLONG ProducerProc( VTask *inTask)
+{
+	BenchRing *ring = (BenchRing*) inTask->GetKindData();
+	std::vector<char> record( ring->fRecordSize, 'r');
+
+	while (VInterlocked::AtomicGet( &ring->fStarted) == 0)
+		VTask::Yield();
+
+	for (sLONG i = 0 ; i < ring->fRecordsPerProducer ; ++i)
+	{
+		if (ring->fRing.Write( &record[0], record.size(), -1) != VE_OK)
+		{
+			VInterlocked::Increment( &ring->fErrors);
+			break;
+		}
+	}
+	return 0;
+}
+
+
+static void Run( uLONG inKey, VSize inCapacity, sLONG inProducerCount, sLONG inRecords, VSize inRecordSize)
+{
+	VSharedRingBuffer ring;
+	if (ring.Init( inKey, inCapacity, inProducerCount == 1) != VE_OK)
+	{
+		::printf( "could not create the ring\n");
+		return;
+	}
+
+	BenchRing bench( ring, inRecords / inProducerCount, inRecordSize);
+	sLONG total = bench.fRecordsPerProducer * inProducerCount;
+
+	std::vector<VTask*> tasks;
+	for (sLONG i = 0 ; i < inProducerCount ; ++i)
+	{
+		VTask *task = new VTask( NULL, 0, eTaskStylePreemptive, ProducerProc);
+		task->SetKindData( (sLONG_PTR) &bench);
+		task->Run();
+		tasks.push_back( task);
+	}
+
+	std::vector<char> record( ring.GetMaxRecordSize());
+	sLONG received = 0;
+	VError err = VE_OK;
+
+	sLONG8 start = BenchTools::Now();
+	VInterlocked::Exchange( &bench.fStarted, 1);
+	while (received < total && err == VE_OK)
+	{
+		VSize size = 0;
+		err = ring.Read( &record[0], record.size(), &size, 1000);
+		if (err == VE_OK)
+			++received;
+		else if (err == VE_RING_EMPTY && VInterlocked::AtomicGet( &bench.fErrors) == 0)
+			err = VE_OK;	// producers are still running, timed out on a slow machine
+	}
+	sLONG8 duration = BenchTools::Now() - start;
+
+	for (std::vector<VTask*>::iterator i = tasks.begin() ; i != tasks.end() ; ++i)
+	{
+		while (!(*i)->WaitForDeath( 1000))
+			;
+		(*i)->Release();
+	}
+
+#if VERSIONMAC || VERSION_LINUX
+	ring.Remove();
+#else
+	ring.Detach();
+#endif
+
+	if (received < total)
+	{
+		::printf( "%2d producers  %5d bytes  failed after %d records\n", (int) inProducerCount, (int) inRecordSize, (int) received);
+		return;
+	}
+
+	::printf( "%2d producers  %5d bytes  %12.0f records/s  %9.1f MB/s\n", (int) inProducerCount, (int) inRecordSize,
+		BenchTools::PerSecond( total, duration), BenchTools::PerSecond( (sLONG8) total * inRecordSize, duration) / (1024.0 * 1024.0));
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG records = BenchTools::GetArgument( "-records", 2000000);
+	VSize capacity = (VSize) BenchTools::GetArgument( "-capacity", 1024) * 1024;
+
+	static const sLONG sProducerCounts[] = { 1, 2, 4, 8 };
+	static const VSize sRecordSizes[] = { 16, 256, 4096 };
+
+	// one key per run, a removed segment may linger until its last user detached
+	uLONG key = 'bnrb';
+	for (size_t s = 0 ; s < sizeof( sRecordSizes) / sizeof( VSize) ; ++s)
+	{
+		for (size_t p = 0 ; p < sizeof( sProducerCounts) / sizeof( sLONG) ; ++p)
+			Run( key++, capacity, sProducerCounts[p], records, sRecordSizes[s]);
+	}
+
+	return 0;
+}
@@ -49,6 +49,12 @@ DECLARE_VERROR( kCOMPONENT_XTOOLBOX, 1131, VE_SEM_LOCK_FAILED);
 DECLARE_VERROR( kCOMPONENT_XTOOLBOX, 1132, VE_SEM_UNLOCK_FAILED);
 DECLARE_VERROR( kCOMPONENT_XTOOLBOX, 1133, VE_SEM_REMOVE_FAILED);
 
+DECLARE_VERROR( kCOMPONENT_XTOOLBOX, 1135, VE_RING_INVALID);
+DECLARE_VERROR( kCOMPONENT_XTOOLBOX, 1136, VE_RING_FULL);
+DECLARE_VERROR( kCOMPONENT_XTOOLBOX, 1137, VE_RING_EMPTY);
+DECLARE_VERROR( kCOMPONENT_XTOOLBOX, 1138, VE_RING_RECORD_TOO_LARGE);
+DECLARE_VERROR( kCOMPONENT_XTOOLBOX, 1139, VE_RING_BUFFER_TOO_SMALL);
+
 DECLARE_VERROR( kCOMPONENT_XTOOLBOX, 1140, VE_START_WATCHING_FOLDER_FAILED);
 DECLARE_VERROR( kCOMPONENT_XTOOLBOX, 1141, VE_STOP_WATCHING_FOLDER_FAILED);
 
@@ -0,0 +1,335 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "VKernelIPCPrecompiled.h"
+#include "VSharedRingBuffer.h"
+
+#if VERSION_LINUX
+	#include <linux/futex.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+	#include <limits.h>
+	#include <time.h>
+#endif
+
+
+// Positions are free running 32 bits counters, offsets in the ring are positions modulo the capacity.
+
+static const sLONG	kRING_MAGIC = 0x52494E47;	// 'RING'
+static const uLONG	kRING_MIN_CAPACITY = 4 * 1024;
+static const uLONG	kRING_MAX_CAPACITY = 1 << 30;
+
+// A record is a header word followed by the data, 8 bytes aligned. The word is 0 until the record is committed,
+// then holds its size with kRECORD_COMMITTED set, or kRECORD_PADDING if the record fills the end of the ring.
+
+static const uLONG	kRECORD_HEADER_SIZE = 8;
+static const sLONG	kRECORD_COMMITTED = 0x40000000;
+static const sLONG	kRECORD_PADDING = -1;
+
+static const sLONG	kATTACH_TIMEOUT = 1000;
+
+
+// Each field written by a different side has its own cache line.
+
+struct VSharedRingBuffer::RingHeader
+{
+	sLONG	fMagic;
+	sLONG	fCapacity;
+	sLONG	fSingleProducer;
+	char	fPad0[64 - 3 * sizeof(sLONG)];
+
+	sLONG	fReserve;				// next position given to a producer
+	char	fPad1[64 - sizeof(sLONG)];
+
+	sLONG	fRead;					// position of the next record to read
+	char	fPad2[64 - sizeof(sLONG)];
+
+	sLONG	fDataSequence;			// bumped when a record is committed while the consumer waits
+	sLONG	fConsumerWaiting;
+	char	fPad3[64 - 2 * sizeof(sLONG)];
+
+	sLONG	fSpaceSequence;			// bumped when space is freed while producers wait
+	sLONG	fProducersWaiting;
+	char	fPad4[64 - 2 * sizeof(sLONG)];
+};
+
+
+static inline uLONG _RecordSize(VSize inDataSize)
+{
+	return (uLONG) ((kRECORD_HEADER_SIZE + inDataSize + 7) & ~7);
+}
+
+
+VError VSharedRingBuffer::Init(uLONG inKey, VSize inCapacity, bool inSingleProducer)
+{
+	uLONG capacity = kRING_MIN_CAPACITY;
+	while (capacity < inCapacity && capacity < kRING_MAX_CAPACITY)
+		capacity <<= 1;
+
+	if (fMemory.Init(inKey, sizeof(RingHeader) + capacity) != VE_OK)
+		return vThrowError(VE_RING_INVALID);
+
+	RingHeader* header = (RingHeader*) fMemory.GetAddr();
+	if (header == NULL)
+		return vThrowError(VE_RING_INVALID);
+
+	if (fMemory.IsNew())
+	{
+		::memset(header, 0, sizeof(RingHeader) + capacity);
+
+		header->fCapacity = (sLONG) capacity;
+		header->fSingleProducer = inSingleProducer ? 1 : 0;
+
+		// The magic goes last, with a barrier : attaching processes wait for it.
+		VInterlocked::Exchange(&header->fMagic, kRING_MAGIC);
+	}
+	else
+	{
+		uLONG startTime = VSystem::GetCurrentTime();
+		while (VInterlocked::AtomicGet(&header->fMagic) != kRING_MAGIC)
+		{
+			if (VSystem::GetCurrentTime() - startTime > (uLONG) kATTACH_TIMEOUT)
+			{
+				fMemory.Detach();
+				return vThrowError(VE_RING_INVALID);
+			}
+			VTask::Sleep(1);
+		}
+
+		capacity = (uLONG) header->fCapacity;
+	}
+
+	fHeader = header;
+	fData = (char*) header + sizeof(RingHeader);
+	fCapacity = capacity;
+
+	return VE_OK;
+}
+
+
+VSize VSharedRingBuffer::GetMaxRecordSize() const
+{
+	// Half of the ring, so that a record needing a padding record before it always fits in an empty ring.
+	return (fCapacity / 2) - kRECORD_HEADER_SIZE;
+}
+
+
+VError VSharedRingBuffer::Write(const void* inData, VSize inSize, sLONG inTimeoutMilliseconds)
+{
+	if (fHeader == NULL)
+		return vThrowError(VE_RING_INVALID);
+
+	if (inSize > GetMaxRecordSize())
+		return vThrowError(VE_RING_RECORD_TOO_LARGE);
+
+	uLONG	recordSize = _RecordSize(inSize);
+	uLONG	mask = fCapacity - 1;
+	uLONG	startTime = 0;
+	uLONG	position, offset, tail, total;
+
+	for (;;)
+	{
+		// fRead is read first: it never passes fReserve, so position - read can't underflow. Read the other
+		// way round, other producers and the consumer may have moved past a stale position in between.
+		uLONG read = (uLONG) VInterlocked::AtomicGet(&fHeader->fRead);
+		position = (uLONG) VInterlocked::AtomicGet(&fHeader->fReserve);
+		if (position - read > fCapacity)
+			continue;	// read is stale: the consumer and other producers moved in between
+
+		offset = position & mask;
+		tail = fCapacity - offset;
+		total = (recordSize <= tail) ? recordSize : tail + recordSize;
+
+		if (position - read + total <= fCapacity)
+		{
+			if (fHeader->fSingleProducer)
+			{
+				VInterlocked::Exchange(&fHeader->fReserve, (sLONG) (position + total));
+				break;
+			}
+			if (VInterlocked::CompareExchange(&fHeader->fReserve, (sLONG) position, (sLONG) (position + total)) == (sLONG) position)
+				break;
+			continue;
+		}
+
+		// Full : wait for the consumer.
+
+		if (inTimeoutMilliseconds == 0)
+			return VE_RING_FULL;
+
+		if (startTime == 0)
+			startTime = VSystem::GetCurrentTime();
+
+		VInterlocked::Increment(&fHeader->fProducersWaiting);
+		sLONG sequence = VInterlocked::AtomicGet(&fHeader->fSpaceSequence);
+		bool timedOut = false;
+		if ((uLONG) VInterlocked::AtomicGet(&fHeader->fRead) == read)
+			timedOut = !_WaitForChange(&fHeader->fSpaceSequence, sequence, startTime, inTimeoutMilliseconds);
+		VInterlocked::Decrement(&fHeader->fProducersWaiting);
+
+		if (timedOut)
+			return VE_RING_FULL;
+	}
+
+	if (total != recordSize)
+	{
+		VInterlocked::Exchange((sLONG*) (fData + offset), kRECORD_PADDING);
+		offset = 0;
+	}
+
+	char* record = fData + offset;
+	if (inSize > 0)
+		::memcpy(record + kRECORD_HEADER_SIZE, inData, inSize);
+
+	VInterlocked::Exchange((sLONG*) record, kRECORD_COMMITTED | (sLONG) inSize);
+
+	if (VInterlocked::AtomicGet(&fHeader->fConsumerWaiting) != 0)
+	{
+		VInterlocked::Increment(&fHeader->fDataSequence);
+		_Wake(&fHeader->fDataSequence);
+	}
+
+	return VE_OK;
+}
+
+
+VError VSharedRingBuffer::Read(void* outData, VSize inMaxSize, VSize* outSize, sLONG inTimeoutMilliseconds)
+{
+	if (fHeader == NULL)
+		return vThrowError(VE_RING_INVALID);
+
+	uLONG	mask = fCapacity - 1;
+	uLONG	startTime = 0;
+
+	for (;;)
+	{
+		// Only the consumer moves fRead.
+		uLONG	position = (uLONG) fHeader->fRead;
+		uLONG	offset = position & mask;
+		char*	record = fData + offset;
+		sLONG	word = VInterlocked::AtomicGet((sLONG*) record);
+
+		if (word == kRECORD_PADDING)
+		{
+			// Consumed space is zeroed so that a stale word is never taken for a committed record.
+			::memset(record, 0, fCapacity - offset);
+			VInterlocked::Exchange(&fHeader->fRead, (sLONG) (position + fCapacity - offset));
+			continue;
+		}
+
+		if (word != 0)
+		{
+			VSize size = (VSize) (word & ~kRECORD_COMMITTED);
+			if (outSize != NULL)
+				*outSize = size;
+
+			if (size > inMaxSize)
+				return vThrowError(VE_RING_BUFFER_TOO_SMALL);
+
+			if (size > 0)
+				::memcpy(outData, record + kRECORD_HEADER_SIZE, size);
+
+			uLONG recordSize = _RecordSize(size);
+			::memset(record, 0, recordSize);
+			VInterlocked::Exchange(&fHeader->fRead, (sLONG) (position + recordSize));
+
+			if (VInterlocked::AtomicGet(&fHeader->fProducersWaiting) != 0)
+			{
+				VInterlocked::Increment(&fHeader->fSpaceSequence);
+				_Wake(&fHeader->fSpaceSequence);
+			}
+
+			return VE_OK;
+		}
+
+		// Empty, or the next record is reserved but not yet committed.
+
+		if (inTimeoutMilliseconds == 0)
+			return VE_RING_EMPTY;
+
+		if (startTime == 0)
+			startTime = VSystem::GetCurrentTime();
+
+		VInterlocked::Exchange(&fHeader->fConsumerWaiting, 1);
+		sLONG sequence = VInterlocked::AtomicGet(&fHeader->fDataSequence);
+		bool timedOut = false;
+		if (VInterlocked::AtomicGet((sLONG*) record) == 0)
+			timedOut = !_WaitForChange(&fHeader->fDataSequence, sequence, startTime, inTimeoutMilliseconds);
+		VInterlocked::Exchange(&fHeader->fConsumerWaiting, 0);
+
+		if (timedOut)
+			return VE_RING_EMPTY;
+	}
+}
+
+
+bool VSharedRingBuffer::_WaitForChange(sLONG* inSequence, sLONG inValue, uLONG inStartTime, sLONG inTimeoutMilliseconds)
+{
+	// Returns false once the timeout has elapsed. May return early, callers check their condition again.
+
+	sLONG remaining = -1;
+	if (inTimeoutMilliseconds > 0)
+	{
+		uLONG elapsed = VSystem::GetCurrentTime() - inStartTime;
+		if (elapsed >= (uLONG) inTimeoutMilliseconds)
+			return false;
+		remaining = inTimeoutMilliseconds - (sLONG) elapsed;
+	}
+
+#if VERSION_LINUX
+	// Not FUTEX_PRIVATE_FLAG : the word is shared with other processes.
+
+	struct timespec timeout;
+	if (remaining >= 0)
+	{
+		timeout.tv_sec = remaining / 1000;
+		timeout.tv_nsec = (remaining % 1000) * 1000000;
+	}
+	::syscall(SYS_futex, inSequence, FUTEX_WAIT, inValue, (remaining >= 0) ? &timeout : NULL, NULL, 0);
+#else
+	if (VInterlocked::AtomicGet(inSequence) == inValue)
+		VTask::Sleep(1);
+#endif
+
+	return true;
+}
+
+
+void VSharedRingBuffer::_Wake(sLONG* inSequence)
+{
+#if VERSION_LINUX
+	::syscall(SYS_futex, inSequence, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+
+VError VSharedRingBuffer::Detach()
+{
+	fHeader = NULL;
+	fData = NULL;
+
+	return fMemory.Detach();
+}
+
+
+#if VERSIONMAC || VERSION_LINUX
+VError VSharedRingBuffer::Remove()
+{
+	fHeader = NULL;
+	fData = NULL;
+
+	return fMemory.Remove();
+}
+#endif
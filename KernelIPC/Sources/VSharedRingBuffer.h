@@ -0,0 +1,80 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#ifndef __VSharedRingBuffer__
+#define __VSharedRingBuffer__
+
+
+#include "VSharedMemory.h"
+
+
+
+BEGIN_TOOLBOX_NAMESPACE
+
+
+
+/*
+	Ring of variable-length records in a shared memory segment, for one or several producers and a single consumer,
+	possibly in different processes.
+
+	Producers reserve their record with a compare-and-swap (a plain store if the ring was created single producer),
+	copy it and then commit it. The consumer reads records in reservation order. No lock and no system call is
+	involved unless one side has to wait: on Linux it then sleeps on a futex in the segment, other platforms poll.
+
+	Timeouts are in milliseconds: 0 doesn't wait, -1 waits forever. VE_RING_FULL and VE_RING_EMPTY are returned
+	without being thrown.
+*/
+
+class XTOOLBOX_API VSharedRingBuffer : public VObject
+{
+public:
+	VSharedRingBuffer() : fHeader(NULL), fData(NULL), fCapacity(0) {}
+
+	// inCapacity is rounded up to a power of two. The process creating the segment formats it, others attach to it
+	// and get its capacity.
+	VError	Init(uLONG inKey, VSize inCapacity, bool inSingleProducer = false);
+	bool	IsNew()								{ return fMemory.IsNew(); }
+	VSize	GetCapacity() const					{ return fCapacity; }
+	VSize	GetMaxRecordSize() const;
+
+	// Producer side.
+	VError	Write(const void* inData, VSize inSize, sLONG inTimeoutMilliseconds = 0);
+
+	// Consumer side (one thread of one process). If outData is too small, *outSize is set to the record size and
+	// VE_RING_BUFFER_TOO_SMALL is thrown, the record is left in the ring.
+	VError	Read(void* outData, VSize inMaxSize, VSize* outSize, sLONG inTimeoutMilliseconds = -1);
+
+	VError	Detach();
+
+#if VERSIONMAC || VERSION_LINUX
+	VError	Remove();
+#endif
+
+private:
+	struct RingHeader;
+
+	bool	_WaitForChange(sLONG* inSequence, sLONG inValue, uLONG inStartTime, sLONG inTimeoutMilliseconds);
+	void	_Wake(sLONG* inSequence);
+
+	VSharedMemory	fMemory;
+	RingHeader*		fHeader;
+	char*			fData;
+	uLONG			fCapacity;
+};
+
+
+END_TOOLBOX_NAMESPACE
+
+#endif
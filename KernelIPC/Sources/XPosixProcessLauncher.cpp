@@ -18,13 +18,48 @@
 #include "VProcessLauncher.h"
 
 #include <sys/wait.h>
-#include <sys/select.h>
+#include <poll.h>
+#include <spawn.h>
 #include <stdlib.h>
 #include <set>
 #include <signal.h>
 
+#if VERSIONMAC
+	#include <crt_externs.h>
+	#define environ (*_NSGetEnviron())
+#else
+	extern char **environ;
+#endif
+
 #define kInvalidDescriptor -1
 
+// posix_spawn() starts the child without copying the page tables of our (possibly huge) process, as fork() does.
+// It needs a file action closing every inherited descriptor (fork() path closes them in the child) : that's
+// posix_spawn_file_actions_addclosefrom_np() with glibc 2.34 or POSIX_SPAWN_CLOEXEC_DEFAULT on Mac. Otherwise,
+// or if a default directory is set and can't be changed by a file action, we still fork().
+
+#ifndef WITH_POSIX_SPAWN
+	#if VERSION_LINUX && defined(__GLIBC__)
+		#if __GLIBC_PREREQ(2, 34)
+			#define WITH_POSIX_SPAWN 1
+			#define WITH_POSIX_SPAWN_CHDIR 1
+		#endif
+	#elif VERSIONMAC && defined(POSIX_SPAWN_CLOEXEC_DEFAULT)
+		#define WITH_POSIX_SPAWN 1
+		#if __MAC_OS_X_VERSION_MIN_REQUIRED >= 101500
+			#define WITH_POSIX_SPAWN_CHDIR 1
+		#endif
+	#endif
+#endif
+
+#ifndef WITH_POSIX_SPAWN
+	#define WITH_POSIX_SPAWN 0
+#endif
+
+#ifndef WITH_POSIX_SPAWN_CHDIR
+	#define WITH_POSIX_SPAWN_CHDIR 0
+#endif
+
 extern VMemory *gMemory;
 
 // PID of independant children left running are inserted in a watch set, so their zombie processes are cleaned-up.
@@ -254,33 +289,37 @@ sLONG XPosixProcessLauncher::WriteToChild(const void *inBuffer, uLONG inBufferSi
 
 sLONG XPosixProcessLauncher::WaitForData ()
 {
+	// poll() has no FD_SETSIZE limit on descriptor values ; invalid (negative) descriptors are ignored.
+	
+	struct pollfd	fds[2];
+	int				r;
+	sLONG			code;
+	
+	fds[0].fd = fPipeChildToParent[pReadSide];
+	fds[0].events = POLLIN;
+	fds[0].revents = 0;
+	fds[1].fd = fPipeChildErrorToParent[pReadSide];
+	fds[1].events = POLLIN;
+	fds[1].revents = 0;
+
+#if VERSION_LINUX
 	sigset_t	sigmask;
-	fd_set		fds;
-	int			maximumDescriptor, r;
-	sLONG		code;
 		
 	sigprocmask (0, NULL, &sigmask);
 	sigdelset(&sigmask, SIGCHLD);
 
-	if (fPipeChildToParent[pReadSide] > fPipeChildErrorToParent[pReadSide])
-				
-		maximumDescriptor = fPipeChildToParent[pReadSide];
-		
-	else
-		
-		maximumDescriptor = fPipeChildErrorToParent[pReadSide];
+	r = ppoll(fds, 2, NULL, &sigmask);
+#else
+	// No ppoll() : SIGCHLD may not interrupt the wait, but the child's end closing its pipes does.
 	
-	FD_ZERO(&fds);
-	FD_SET(fPipeChildToParent[pReadSide], &fds);
-	FD_SET(fPipeChildErrorToParent[pReadSide], &fds);
-	
-	r = pselect(maximumDescriptor + 1, &fds, NULL, NULL, NULL, &sigmask);
+	r = poll(fds, 2, -1);
+#endif
 	
 	if (r == -1) {
 	
 		if (errno == EINTR && !IsRunning())
 			
-			// pselect() interrupted by SIGCHLD.
+			// ppoll() interrupted by SIGCHLD.
 			
 			return VProcessLauncher::eVPLTerminated;
 		
@@ -290,12 +329,14 @@ sLONG XPosixProcessLauncher::WaitForData ()
 					
 	} else if (r > 0) {
 		
+		// As with select(), end of file (POLLHUP) is reported as readable : the next read will tell.
+		
 		code = 0;
-		if (FD_ISSET(fPipeChildToParent[pReadSide], &fds))
+		if (fds[0].revents & (POLLIN | POLLHUP | POLLERR))
 			
 			code |= VProcessLauncher::eVPLStdOutFlag;
 	
-		if (FD_ISSET(fPipeChildErrorToParent[pReadSide], &fds))
+		if (fds[1].revents & (POLLIN | POLLHUP | POLLERR))
 			
 			code |= VProcessLauncher::eVPLStdErrFlag;		
 		
@@ -381,6 +422,18 @@ sLONG XPosixProcessLauncher::Start(const EnvVarNamesAndValuesMap &inVarToUse)
 	_CleanWatchSet();
 	pthread_mutex_unlock(&::sMutex);
 
+	if (_CanSpawn())
+	{
+		char**		arrayOfCStrEnvVar = NULL;
+		_BuildArrayEnvironmentVariables(inVarToUse, arrayOfCStrEnvVar);
+		
+		error = _Spawn(arrayOfCStrEnvVar);
+		
+		_Free2DCharArray(arrayOfCStrEnvVar);
+		
+		return error;
+	}
+
 	// Create child process.
 	
 	fIsRunning = true;	
@@ -485,6 +538,105 @@ sLONG XPosixProcessLauncher::Start(const EnvVarNamesAndValuesMap &inVarToUse)
 	return error;
 }
 
+bool XPosixProcessLauncher::_CanSpawn() const
+{
+#if WITH_POSIX_SPAWN
+	return WITH_POSIX_SPAWN_CHDIR || fCurrentDirectory == NULL;
+#else
+	return false;
+#endif
+}
+
+sLONG XPosixProcessLauncher::_Spawn(char **inArrayEnv)
+{
+#if WITH_POSIX_SPAWN
+	posix_spawn_file_actions_t	actions;
+	posix_spawnattr_t			attributes;
+	int							error;
+	
+	if (posix_spawn_file_actions_init(&actions) != 0)
+		return -1;
+
+	if (posix_spawnattr_init(&attributes) != 0)
+	{
+		posix_spawn_file_actions_destroy(&actions);
+		return -1;
+	}
+	
+	// Same redirections as the child side of the fork() path.
+	
+	int		stdFds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+	int		childFds[3] = { fPipeParentToChild[pReadSide], fPipeChildToParent[pWriteSide], fPipeChildErrorToParent[pWriteSide] };
+
+	error = 0;
+	for (int i = 0; i < 3 && error == 0; i++)
+	{
+		if (childFds[i] != kInvalidDescriptor)
+			error = posix_spawn_file_actions_adddup2(&actions, childFds[i], stdFds[i]);
+#if VERSIONMAC
+		else
+			error = posix_spawn_file_actions_addinherit_np(&actions, stdFds[i]);
+#endif
+	}
+
+	// Every other descriptor is closed.
+	
+#if VERSIONMAC
+	if (error == 0)
+		error = posix_spawnattr_setflags(&attributes, POSIX_SPAWN_CLOEXEC_DEFAULT);
+#else
+	if (error == 0)
+		error = posix_spawn_file_actions_addclosefrom_np(&actions, 3);
+#endif
+
+#if WITH_POSIX_SPAWN_CHDIR
+	if (error == 0 && fCurrentDirectory != NULL)
+		error = posix_spawn_file_actions_addchdir_np(&actions, fCurrentDirectory);
+#endif
+	
+	char	*defaultArgv[] = { fBinaryPath, NULL };
+	pid_t	pid = 0;
+	
+	// Set before the child exists, as in the fork() path, so that SIGCHLD can't be overridden.
+	
+	fIsRunning = true;
+	
+	if (error == 0)
+		error = posix_spawn(&pid, fBinaryPath, &actions, &attributes,
+							(fArrayArgCStrArray != NULL) ? fArrayArgCStrArray : defaultArgv,
+							(inArrayEnv != NULL) ? inArrayEnv : environ);
+	
+	posix_spawnattr_destroy(&attributes);
+	posix_spawn_file_actions_destroy(&actions);
+	
+	if (error != 0)
+	{
+		// Unlike the fork() path, a failing chdir() or exec is reported here rather than by the exit status.
+		
+		fprintf(stderr, "********** XPosixProcessLauncher::Start/posix_spawn() -> Error: [%s] spawn failed (%s)\n", fBinaryPath, strerror(error));
+		fflush(stderr);
+		
+		fIsRunning = false;
+		
+		_CloseRWPipe(fPipeParentToChild);
+		_CloseRWPipe(fPipeChildToParent);
+		_CloseRWPipe(fPipeChildErrorToParent);
+		
+		return -1;
+	}
+	
+	fProcessID = pid;
+	
+	_CloseOnePipe(&fPipeParentToChild[pReadSide]);
+	_CloseOnePipe(&fPipeChildToParent[pWriteSide]);
+	_CloseOnePipe(&fPipeChildErrorToParent[pWriteSide]);
+	
+	return 0;
+#else
+	return -1;
+#endif
+}
+
 bool XPosixProcessLauncher::IsRunning()
 {
 	if (fIsRunning) {
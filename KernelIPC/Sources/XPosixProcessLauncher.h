@@ -107,6 +107,9 @@ private:
 		void		_BuildArrayEnvironmentVariables(const EnvVarNamesAndValuesMap &inVarToUse, char **&outArrayEnv);
 
 		int			_SetNonBlocking(int fd);
+
+		bool		_CanSpawn() const;
+		sLONG		_Spawn(char **inArrayEnv);
 		
 		void		_Free2DCharArray(char **&array);
 
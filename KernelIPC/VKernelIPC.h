@@ -63,6 +63,9 @@
 // Semaphores
 #include "KernelIPC/Sources/VSharedSemaphore.h"
 
+// Shared ring buffer
+#include "KernelIPC/Sources/VSharedRingBuffer.h"
+
 #if _WIN32
 	#pragma pack( pop )
 #else
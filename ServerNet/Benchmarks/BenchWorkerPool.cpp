@@ -0,0 +1,127 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "Kernel/Benchmarks/BenchTools.h"
+#include "ServerNet/VServerNet.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+/*
+	VWorkerPool requests per second and request latency against the number of exclusive workers.
+
+	usage: BenchWorkerPool [-requests count] [-work microseconds] [-slow percent]
+
+	Requests are connection handlers that spin for -work microseconds, -slow percent of them twenty times
+	longer, so that queues get uneven and idle workers have to steal. They are all posted at once, as a burst
+	of accepted connections would be. The latency of a request runs from its posting to the end of its
+	Handle(), p50 and p99 are printed. No socket is involved: this measures the dispatch between workers.
+*/
+
+
+class BenchRun
+{
+public:
+	BenchRun( sLONG inRequests) : fLatencies( inRequests, 0), fCompleted( 0)	{}
+
+	std::vector<sLONG8>		fLatencies;
+	sLONG					fCompleted;
+};
+
+
+class VBenchRequestHandler : public VConnectionHandler
+{
+public:
+	VBenchRequestHandler( BenchRun& inRun, sLONG inIndex, sLONG8 inWork)
+		: fRun( inRun), fIndex( inIndex), fWork( inWork), fPosted( BenchTools::Now())	{ _ResetRedistributionCount(); }
+
+	virtual VError SetEndPoint( VEndPoint* /*inEndPoint*/)	{ return VE_OK; }
+	virtual bool CanShareWorker()							{ return false; }
+	virtual int GetType()									{ return 'bnch'; }
+	virtual VError Stop()									{ return VE_OK; }
+
+	virtual enum E_WORK_STATUS Handle( VError& outError)
+	{
+		sLONG8 start = BenchTools::Now();
+		while (BenchTools::Now() - start < fWork)
+			;
+		fRun.fLatencies[fIndex] = BenchTools::Now() - fPosted;
+		VInterlocked::Increment( &fRun.fCompleted);
+
+		outError = VE_OK;
+		return eWS_DONE;
+	}
+
+private:
+	BenchRun&	fRun;
+	sLONG		fIndex;
+	sLONG8		fWork;
+	sLONG8		fPosted;
+};
+
+
+static void Run( unsigned short inWorkers, sLONG inRequests, sLONG8 inWork, sLONG inSlowPercent)
+{
+	VWorkerPool *pool = new VWorkerPool( 0, 0, 0, inWorkers, inWorkers);
+	BenchRun run( inRequests);
+	BenchTools::Random random;
+	sLONG posted = 0;
+
+	sLONG8 start = BenchTools::Now();
+	for (sLONG i = 0 ; i < inRequests ; ++i)
+	{
+		sLONG8 work = ((sLONG) random.Between( 1, 100) <= inSlowPercent) ? inWork * 20 : inWork;
+		VBenchRequestHandler *handler = new VBenchRequestHandler( run, i, work);
+
+		// the pool owns the handler once it is added
+		if (pool->AddConnectionHandler( handler) == VE_OK)
+			++posted;
+		else
+			handler->Release();
+	}
+	while (VInterlocked::AtomicGet( &run.fCompleted) < posted)
+		VTask::Sleep( 1);
+	sLONG8 duration = BenchTools::Now() - start;
+
+	pool->Release();
+
+	run.fLatencies.resize( posted);
+	::printf( "%3d workers  %10.0f requests/s  p50 %10.1f us  p99 %10.1f us", (int) inWorkers, BenchTools::PerSecond( posted, duration),
+		BenchTools::Percentile( run.fLatencies, 50.0) / 1.0e3, BenchTools::Percentile( run.fLatencies, 99.0) / 1.0e3);
+	if (posted < inRequests)
+		::printf( "  (%d not posted)", (int) (inRequests - posted));
+	::printf( "\n");
+}
+
+
+int main( int argc, char *argv[])
+{
+	VProcess process;
+#if VERSION_LINUX
+	process.LINUX_CommandLineInit( argc, (const char**) argv);
+#endif
+	if (!process.Init())
+		return 1;
+
+	sLONG requests = BenchTools::GetArgument( "-requests", 100000);
+	sLONG8 work = (sLONG8) BenchTools::GetArgument( "-work", 20) * 1000;
+	sLONG slowPercent = BenchTools::GetArgument( "-slow", 5);
+
+	static const unsigned short sWorkerCounts[] = { 1, 2, 4, 8, 16, 32 };
+	for (size_t i = 0 ; i < sizeof( sWorkerCounts) / sizeof( unsigned short) ; ++i)
+		Run( sWorkerCounts[i], requests, work, slowPercent);
+
+	return 0;
+}
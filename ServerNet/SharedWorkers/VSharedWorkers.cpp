@@ -19,9 +19,10 @@
 BEGIN_TOOLBOX_NAMESPACE
 
 
-VSharedWorker::VSharedWorker ( ) :
+VSharedWorker::VSharedWorker ( VWorkerPool& vParentWorkerPool ) :
 VTask ( NULL, 0, XBOX::eTaskStylePreemptive, NULL ),
-m_qNewConnectionHandlers ( ),
+m_vParentWorkerPool ( vParentWorkerPool ),
+m_dqNewConnectionHandlers ( ),
 m_vctrConnectionHandlers ( )
 {
 	m_vcsCHQueueLock = new VCriticalSection ( );
@@ -39,6 +40,8 @@ m_vctrConnectionHandlers ( )
 	m_nBusynessDuration = 0;
 	m_nLatestHandlingStart = 0;
 	m_nPreviousBusyness = 0;
+	m_nLatestIdlingStart = 0;
+	m_nStuckThreshold = 250; /* A handler waiting behind one that runs longer than this can be stolen. */
 }
 
 VSharedWorker::~VSharedWorker ( )
@@ -94,7 +97,7 @@ VError VSharedWorker::AddConnectionHandler ( VConnectionHandler* inConnectionHan
 	{
 		if ( m_vcsCHQueueLock-> Lock ( ) )
 		{
-			m_qNewConnectionHandlers. push  ( inConnectionHandler );
+			m_dqNewConnectionHandlers. push_back ( inConnectionHandler );
 			m_vcsCHQueueLock-> Unlock ( );
 			m_vsyncEventForNewHandlers-> Unlock ( );
 		}
@@ -113,15 +116,15 @@ VError VSharedWorker::AcceptNewConnectionHandlers ( )
 		return VE_SRVR_FAILED_TO_SYNC_LOCK;
 	
 	/* NOTE: Should I do
-	 while ( m_qNewConnectionHandlers. size ( ) > 0 )
+	 while ( m_dqNewConnectionHandlers. size ( ) > 0 )
 	 instead? To accept all new connections first and only then proceed with 
 	 command handling? */
 	
 	VError							vError = VE_OK;
-	if ( m_qNewConnectionHandlers. size ( ) > 0 )
+	if ( m_dqNewConnectionHandlers. size ( ) > 0 )
 	{
-		VConnectionHandler*			vcHandler = m_qNewConnectionHandlers. front ( );
-		m_qNewConnectionHandlers. pop ( );
+		VConnectionHandler*			vcHandler = m_dqNewConnectionHandlers. front ( );
+		m_dqNewConnectionHandlers. pop_front ( );
 		
 		if ( m_vcsConnectionHandlersProtector-> Lock ( ) )
 		{
@@ -153,7 +156,10 @@ VError VSharedWorker::RunConnectionHandlers ( )
 			
 			m_vcsConnectionHandlersProtector-> Unlock ( );
 			
-			m_vsyncEventForNewHandlers-> Lock ( );
+			/* Nothing to do: take work from another worker, or park until a handler is added. An idle worker has
+			the lowest busyness, so VWorkerPool::AddConnectionHandler gives it the next handler and wakes it up. */
+			if ( !StealConnectionHandlers ( ) )
+				m_vsyncEventForNewHandlers-> Lock ( );
 			
 			return VE_OK;
 		}
@@ -311,94 +317,78 @@ void VSharedWorker::ReleaseAllConnectionHandlers ( )
 	VConnectionHandler*								vcHandler;
 	m_vcsCHQueueLock-> Lock ( );
 	
-	while ( m_qNewConnectionHandlers. size ( ) > 0 )
+	while ( m_dqNewConnectionHandlers. size ( ) > 0 )
 	{
-		vcHandler = m_qNewConnectionHandlers. front ( );
-		m_qNewConnectionHandlers. pop ( );
+		vcHandler = m_dqNewConnectionHandlers. front ( );
+		m_dqNewConnectionHandlers. pop_front ( );
 		vcHandler-> Release ( );
 	}
 	
 	m_vcsCHQueueLock-> Unlock ( );
 }
 
-VError VSharedWorker::ExtractStuckConnectionHandlers ( std::vector<VConnectionHandler*>& outStuckConnectionHandlers )
+VConnectionHandler* VSharedWorker::StealConnectionHandler ( )
 {
+	VConnectionHandler*			vcHandler = NULL;
+	
+	/* Handlers not accepted yet are taken from the back, the owner pops from the front. */
+	if ( !m_vcsCHQueueLock-> Lock ( ) )
+		return NULL;
+	
+	if ( m_dqNewConnectionHandlers. size ( ) > 0 )
+	{
+		vcHandler = m_dqNewConnectionHandlers. back ( );
+		m_dqNewConnectionHandlers. pop_back ( );
+	}
+	
+	m_vcsCHQueueLock-> Unlock ( );
+	
+	if ( vcHandler )
+		return vcHandler;
+	
+	/* Handlers waiting behind one that takes too long. */
 	if ( !m_vcsConnectionHandlersProtector-> Lock ( ) )
-		return VE_SRVR_FAILED_TO_SYNC_LOCK;
+		return NULL;
 	
 	uLONG						nStuckDuration = VSystem::GetCurrentTime ( ) - m_nLatestHandlingStart;
-	if ( m_CurrentConnectionHandler && nStuckDuration > m_nBusynessInterval / 2 )
+	if ( m_CurrentConnectionHandler && m_bIsHandling && nStuckDuration > m_nStuckThreshold )
 	{
-		/* Is stuck! */
-		std::vector<VConnectionHandler*>::iterator			iterCH = m_vctrConnectionHandlers. begin ( );
-		while ( iterCH != m_vctrConnectionHandlers. end ( ) )
+		std::vector<VConnectionHandler*>::reverse_iterator		iterCH = m_vctrConnectionHandlers. rbegin ( );
+		while ( iterCH != m_vctrConnectionHandlers. rend ( ) )
 		{
 			if ( *iterCH != m_CurrentConnectionHandler && ( *iterCH )-> _GetLoadRedistributionCount ( ) < 2 )
 			{
-				( *iterCH )-> _IncrementLoadRedistributionCount ( );
-				outStuckConnectionHandlers. push_back ( *iterCH );
-				iterCH = m_vctrConnectionHandlers. erase ( iterCH );
+				vcHandler = *iterCH;
+				vcHandler-> _IncrementLoadRedistributionCount ( );
+				m_vctrConnectionHandlers. erase ( ( ++iterCH ). base ( ) );
+				
+				break;
 			}
-			else
-				iterCH++;
+			
+			iterCH++;
 		}
 	}
 	
 	m_vcsConnectionHandlersProtector-> Unlock ( );
 	
-	if ( !m_vcsCHQueueLock-> Lock ( ) )
-		return VE_SRVR_FAILED_TO_SYNC_LOCK;
-	
-	while ( m_qNewConnectionHandlers. size ( ) > 0 )
-	{
-		outStuckConnectionHandlers. push_back ( m_qNewConnectionHandlers. front ( ) );
-		m_qNewConnectionHandlers. pop ( );
-	}
-	
-	m_vcsCHQueueLock-> Unlock ( );
-	
-	return VE_OK;
+	return vcHandler;
 }
 
-
-/*
- Shared load balancing:
- OK		* Synchronize access to the vector of current handlers in a shared worker.
- OK		* Keep a pointer to the handler that's being handled.
- OK		* Add a counter for how many times a handler has been moved from worker to worker.
- OK		* Find idle or not-very-busy workers.
- OK		* Extract handlers from the worker that "stuck" on a handler.
- * Redistribute obtained handlers between non-busy workers.
- */
-
-
-VSharedLoadBalancer::VSharedLoadBalancer ( VWorkerPool& vwPool ) :
-VTask ( NULL, 0, XBOX::eTaskStylePreemptive, NULL ),
-fWorkerPool ( vwPool ),
-m_vseWait ( )
-{
-	;
-}
-
-VSharedLoadBalancer::~VSharedLoadBalancer ( )
-{
-	;
-}
-
-Boolean VSharedLoadBalancer::DoRun ( )
+Boolean VSharedWorker::StealConnectionHandlers ( )
 {
-	while ( true )
+	VConnectionHandler*			vcHandler = m_vParentWorkerPool. StealSharedConnectionHandler ( this );
+	if ( !vcHandler )
+		return false;
+	
+	if ( m_vcsConnectionHandlersProtector-> Lock ( ) )
 	{
-		m_vseWait. Lock ( 5000 );
-		m_vseWait. Reset ( );
-		
-		if ( GetState ( ) == TS_DYING || GetState ( ) == TS_DEAD )
-			break;
-		
-		fWorkerPool. BalanceSharedLoad ( );
+		m_vctrConnectionHandlers. push_back ( vcHandler );
+		m_vcsConnectionHandlersProtector-> Unlock ( );
 	}
+	else
+		AddConnectionHandler ( vcHandler );
 	
-	return false;
+	return true;
 }
 
 
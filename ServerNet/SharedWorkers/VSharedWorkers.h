@@ -20,11 +20,14 @@
 BEGIN_TOOLBOX_NAMESPACE
 
 
+/* Each shared worker owns a deque of new connection handlers : the owner pops from the front, idle workers steal
+ from the back. A worker running out of handlers also steals handlers from a worker that is stuck on a long
+ Handle ( ) call, then parks until a handler is added, so there is no central queue and no balancing task. */
 class XTOOLBOX_API VSharedWorker : public VTask
 {
 	public :
 	
-	VSharedWorker ( );
+	VSharedWorker ( VWorkerPool& vParentWorkerPool );
 	virtual ~VSharedWorker ( );
 	
 	virtual VError AddConnectionHandler ( VConnectionHandler* inConnectionHandler );
@@ -37,7 +40,8 @@ class XTOOLBOX_API VSharedWorker : public VTask
 	virtual void WakeUpFromIdling ( );
 	virtual VError StopConnectionHandlers ( int inType );
 	
-	VError ExtractStuckConnectionHandlers ( std::vector<VConnectionHandler*>& outStuckConnectionHandlers );
+	/* Called by an idle worker : returns a pending handler, or a handler waiting behind a stuck one, or NULL. */
+	VConnectionHandler* StealConnectionHandler ( );
 	
 	protected :
 	
@@ -46,9 +50,12 @@ class XTOOLBOX_API VSharedWorker : public VTask
 	
 	virtual VError AcceptNewConnectionHandlers ( );
 	virtual void ReleaseAllConnectionHandlers ( );
+	virtual Boolean StealConnectionHandlers ( );
+	
+	VWorkerPool&								m_vParentWorkerPool;
 	
 	VCriticalSection*							m_vcsCHQueueLock;
-	std::queue<VConnectionHandler*>				m_qNewConnectionHandlers;
+	std::deque<VConnectionHandler*>				m_dqNewConnectionHandlers;
 	
 	VCriticalSection*							m_vcsConnectionHandlersProtector;
 	std::vector<VConnectionHandler*>			m_vctrConnectionHandlers;
@@ -64,24 +71,7 @@ class XTOOLBOX_API VSharedWorker : public VTask
 	volatile uLONG								m_nLatestHandlingStart;
 	volatile short								m_nPreviousBusyness;
 	volatile uLONG								m_nLatestIdlingStart;
-};
-
-
-class XTOOLBOX_API VSharedLoadBalancer : public VTask
-{
-public:
-	
-	VSharedLoadBalancer ( VWorkerPool& vwPool );
-	virtual ~VSharedLoadBalancer ( );
-	
-	virtual void WakeUpFromIdling ( ) { m_vseWait. Unlock ( ); }
-	
-protected:
-	
-	VWorkerPool&						fWorkerPool;
-	VSyncEvent							m_vseWait;
-	
-	virtual Boolean DoRun ( );
+	uLONG										m_nStuckThreshold;
 };
 
 
@@ -26,6 +26,13 @@
 
 #endif
 
+#if WITH_EPOLL_SELECT_IO
+
+	#include <sys/epoll.h>
+	#include <errno.h>
+
+#endif
+
 
 BEGIN_TOOLBOX_NAMESPACE
 
@@ -33,10 +40,22 @@ BEGIN_TOOLBOX_NAMESPACE
 using namespace ServerNetTools;
 
 
-VTCPSelectIOPool::VTCPSelectIOPool ( ) :
-fHandlerList ( )
+// Bounded load of sharded reactors: a reactor holding more than 5/4 of the average is over its share.
+
+static sLONG _GetMaxReactorLoad (sLONG inTotal, size_t inReactorCount)
 {
-	
+	return (inTotal * 5) / (4 * static_cast<sLONG>(inReactorCount)) + 1;
+}
+
+
+VTCPSelectIOPool::VTCPSelectIOPool ( EPlacement inPlacement, sLONG inReactorCount ) :
+fHandlerList ( ),
+fPlacement ( inPlacement )
+{
+	if ( inReactorCount <= 0 )
+		inReactorCount = VSystem::GetNumberOfProcessors ( );
+
+	fReactorCount = inReactorCount > 0 ? inReactorCount : 1;
 }
 
 VTCPSelectIOPool::~VTCPSelectIOPool ( )
@@ -56,6 +75,17 @@ CTCPSelectIOHandler *VTCPSelectIOPool::AddSocketForWatching (VEndPoint* inEndPoi
 	return _AddSocket(inEndPoint, inData, inCallback, outError);
 }
 
+VError VTCPSelectIOPool::_AddSocketToHandler (CTCPSelectIOHandler *inHandler, VTCPEndPoint *inEndPoint, void *inData, CTCPSelectIOHandler::ReadCallback *inCallback)
+{
+	if (inCallback == NULL)
+
+		return inHandler->AddSocketForReading(inEndPoint->GetRawSocket());
+
+	else
+
+		return inHandler->AddSocketForWatching(inEndPoint->GetRawSocket(), inEndPoint, inData, inCallback);
+}
+
 CTCPSelectIOHandler	*VTCPSelectIOPool::_AddSocket (VEndPoint *inEndPoint, void *inData, CTCPSelectIOHandler::ReadCallback *inCallback, VError& outError)
 {
 	VTCPEndPoint*			vtcpEndPoint = dynamic_cast<VTCPEndPoint*> ( inEndPoint );
@@ -74,33 +104,20 @@ CTCPSelectIOHandler	*VTCPSelectIOPool::_AddSocket (VEndPoint *inEndPoint, void *
 		return 0;
 	}
 	
+	outError = VE_OK;
+
 	CTCPSelectIOHandler*							sioHandler = 0;
+
+	if ( fPlacement == ePLACEMENT_SHARDED )
+		sioHandler = _AddSocketSharded ( vtcpEndPoint, inData, inCallback );
+
+	// All reactors full (select() is limited to FD_SETSIZE sockets), fall back on first fit with overflow handlers.
+
 	std::list<CTCPSelectIOHandler*>::iterator		iterHandler = fHandlerList. begin ( );
-	while ( iterHandler != fHandlerList. end ( ) )
+	while ( sioHandler == 0 && iterHandler != fHandlerList. end ( ) )
 	{
-		if (*iterHandler) { 
-			
-			if (inCallback == NULL) {
-				
-				if ((*iterHandler)->AddSocketForReading(vtcpEndPoint->GetRawSocket()) == VE_OK) {
-					
-					sioHandler = *iterHandler;
-					break;
-					
-				}
-				
-			} else {
-				
-				if ((*iterHandler)->AddSocketForWatching(vtcpEndPoint->GetRawSocket(), inEndPoint, inData, inCallback) == VE_OK) {
-					
-					sioHandler = *iterHandler;
-					break;
-					
-				}
-				
-			}
-			
-		}
+		if ( *iterHandler && _AddSocketToHandler ( *iterHandler, vtcpEndPoint, inData, inCallback ) == VE_OK )
+			sioHandler = *iterHandler;
 		iterHandler++;
 	}
 	
@@ -109,18 +126,21 @@ CTCPSelectIOHandler	*VTCPSelectIOPool::_AddSocket (VEndPoint *inEndPoint, void *
 		VTCPSelectIOHandler*		vioh = new VTCPSelectIOHandler ( );
 		vioh-> Run ( );
 		
-		if (inCallback == NULL)
-			
-			outError = vioh->AddSocketForReading(vtcpEndPoint->GetRawSocket());
-		
-		else 
-			
-			outError = vioh->AddSocketForWatching(vtcpEndPoint->GetRawSocket(), inEndPoint, inData, inCallback);
+		outError = _AddSocketToHandler ( vioh, vtcpEndPoint, inData, inCallback );
 		
 		sioHandler = vioh;
 		fHandlerList. push_back ( sioHandler );
 	}
 	
+	// Registered before fHandlersLock is released, so that _Rebalance ( ) can't move the socket first.
+	
+	if ( inCallback != NULL && outError == VE_OK )
+	{
+		StLocker<VCriticalSection>		lock ( &fWatchedSocketsLock );
+		
+		fWatchedSockets [ vtcpEndPoint-> GetRawSocket ( ) ] = sioHandler;
+	}
+	
 	if ( !fHandlersLock. Unlock ( ) )
 		if ( outError == VE_OK )
 			outError = VE_SRVR_FAILED_TO_SYNC_LOCK;
@@ -128,6 +148,160 @@ CTCPSelectIOHandler	*VTCPSelectIOPool::_AddSocket (VEndPoint *inEndPoint, void *
 	return sioHandler;
 }
 
+CTCPSelectIOHandler *VTCPSelectIOPool::_AddSocketSharded (VTCPEndPoint *inEndPoint, void *inData, CTCPSelectIOHandler::ReadCallback *inCallback)
+{
+	// Called with fHandlersLock held. Reactors are started on first use.
+
+	if (fReactors.empty()) {
+
+		for (sLONG i = 0; i < fReactorCount; i++) {
+
+			VTCPSelectIOHandler	*reactor = new VTCPSelectIOHandler();
+
+			reactor->Run();
+			fReactors.push_back(reactor);
+			fHandlerList.push_back(reactor);
+
+		}
+
+	}
+
+	// Simple IDs are sequential: mix them (Fibonacci hashing) rather than taking turns.
+
+	uLONG	nHash	= static_cast<uLONG>(inEndPoint->GetSimpleID()) * 2654435761U;
+	size_t	nShard	= (nHash >> 8) % fReactors.size();
+
+	// Bounded load: pass over the hashed reactor if it holds more than 5/4 of the average.
+
+	std::vector<sLONG>	counts(fReactors.size());
+	sLONG				nTotal		= 0;
+	size_t				nLeastLoaded	= nShard;
+
+	for (size_t i = 0; i < fReactors.size(); i++) {
+
+		counts[i] = fReactors[i]->GetSocketCount();
+		nTotal += counts[i];
+		if (counts[i] < counts[nLeastLoaded])
+
+			nLeastLoaded = i;
+
+	}
+
+	sLONG	nMaxLoad	= _GetMaxReactorLoad(nTotal, fReactors.size());
+
+	if (counts[nShard] > nMaxLoad)
+
+		nShard = nLeastLoaded;
+
+	if (_AddSocketToHandler(fReactors[nShard], inEndPoint, inData, inCallback) == VE_OK)
+
+		return fReactors[nShard];
+
+	// Chosen reactor refused the socket (full), try the others.
+
+	for (size_t i = 0; i < fReactors.size(); i++)
+
+		if (i != nShard && _AddSocketToHandler(fReactors[i], inEndPoint, inData, inCallback) == VE_OK)
+
+			return fReactors[i];
+
+	return NULL;
+}
+
+VError VTCPSelectIOPool::RemoveSocketForWatching (Socket inRawSocket)
+{
+	// Locks are not held while removing: the socket may be moved meanwhile, then look it up again.
+
+	CTCPSelectIOHandler	*handler	= NULL;
+	VError				vError		= VE_SRVR_SOCKET_IS_NOT_READING;
+
+	for ( ; ; ) {
+
+		CTCPSelectIOHandler	*previousHandler	= handler;
+
+		fWatchedSocketsLock.Lock();
+
+		std::map<Socket, CTCPSelectIOHandler*>::iterator	i	= fWatchedSockets.find(inRawSocket);
+
+		handler = i != fWatchedSockets.end() ? i->second : NULL;
+
+		fWatchedSocketsLock.Unlock();
+
+		if (handler == NULL || handler == previousHandler)
+
+			break;
+
+		if ((vError = handler->RemoveSocketForWatching(inRawSocket)) != VE_SRVR_SOCKET_IS_NOT_READING)
+
+			break;
+
+	}
+
+	if (vError == VE_OK) {
+
+		fWatchedSocketsLock.Lock();
+
+		std::map<Socket, CTCPSelectIOHandler*>::iterator	i	= fWatchedSockets.find(inRawSocket);
+
+		if (i != fWatchedSockets.end() && i->second == handler)
+
+			fWatchedSockets.erase(i);
+
+		fWatchedSocketsLock.Unlock();
+
+		if (fPlacement == ePLACEMENT_SHARDED)
+
+			_Rebalance(handler);
+
+	}
+
+	return vError;
+}
+
+void VTCPSelectIOPool::_Rebalance (CTCPSelectIOHandler *inHandler)
+{
+	// Caller may be a callback of a reactor that an _AddSocket() in progress waits for: don't wait for fHandlersLock.
+
+	if (!fHandlersLock.TryToLock())
+
+		return;
+
+	size_t	nTarget	= fReactors.size();
+	size_t	nMostLoaded	= 0;
+	sLONG	nTotal	= 0;
+
+	std::vector<sLONG>	counts(fReactors.size());
+
+	for (size_t i = 0; i < fReactors.size(); i++) {
+
+		if (fReactors[i] == inHandler)
+
+			nTarget = i;
+
+		counts[i] = fReactors[i]->GetSocketCount();
+		nTotal += counts[i];
+		if (counts[i] > counts[nMostLoaded])
+
+			nMostLoaded = i;
+
+	}
+
+	if (nTarget < fReactors.size()
+	&& counts[nMostLoaded] > _GetMaxReactorLoad(nTotal, fReactors.size())
+	&& counts[nMostLoaded] > counts[nTarget] + 1) {
+
+		StLocker<VCriticalSection>	lock(&fWatchedSocketsLock);
+		Socket						nRawSocket;
+
+		if (fReactors[nMostLoaded]->MoveWatchedSocket(fReactors[nTarget], nRawSocket))
+
+			fWatchedSockets[nRawSocket] = fReactors[nTarget];
+
+	}
+
+	fHandlersLock.Unlock();
+}
+
 VError VTCPSelectIOPool::Close ( )
 {
 	if ( !fHandlersLock. Lock ( ) )
@@ -142,6 +316,11 @@ VError VTCPSelectIOPool::Close ( )
 	}
 	
 	fHandlerList. clear ( );
+	fReactors. clear ( );
+	
+	fWatchedSocketsLock. Lock ( );
+	fWatchedSockets. clear ( );
+	fWatchedSocketsLock. Unlock ( );
 	
 	if ( !fHandlersLock. Unlock ( ) )
 		return VE_SRVR_FAILED_TO_SYNC_LOCK;
@@ -222,11 +401,21 @@ bool VTCPSelectReadAction::NotifyActionComplete ( )
 
 void VTCPSelectReadAction::DoAction (fd_set* fdSockets)
 {
-	int	nRawSocket	= GetRawSocket();
+	if (FD_ISSET(GetRawSocket(), fdSockets))
 
-	if (!FD_ISSET(nRawSocket, fdSockets))
+		ProcessReadable();
+}
 
-		return;
+void VTCPSelectReadAction::HandleError (fd_set* fdSockets)
+{
+	if (FD_ISSET(GetRawSocket(), fdSockets))
+
+		ProcessError();
+}
+
+void VTCPSelectReadAction::ProcessReadable ()
+{
+	int	nRawSocket	= GetRawSocket();
 
 	if (IsProcessed())
 
@@ -266,13 +455,10 @@ void VTCPSelectReadAction::DoAction (fd_set* fdSockets)
 	NotifyActionComplete ( );
 }
 
-void VTCPSelectReadAction::HandleError (fd_set* fdSockets)
+void VTCPSelectReadAction::ProcessError ()
 {
 	int	nRawSocket = GetRawSocket ( );
 
-	if (!FD_ISSET ( nRawSocket, fdSockets ))
-		return;
-
 	if (IsProcessed())
 	
 		return;
@@ -317,28 +503,30 @@ bool VTCPSelectWatchAction::TriggerReadCallback (sLONG inErrorCode)
 
 void VTCPSelectWatchAction::DoAction (fd_set* fdSockets)
 {
-	xbox_assert(GetType() == VTCPSelectAction::eTYPE_WATCH);
+	if (FD_ISSET(GetRawSocket(), fdSockets))
 
-	if (!FD_ISSET(GetRawSocket(), fdSockets))
-
-		return;
-		
-	else {		
-	
-		if (!TriggerReadCallback(0))
+		ProcessReadable();
+}
 
-			SetLastError(VE_SRVR_READ_FAILED);	// May be not a failed read, but this will prevent select() to check this socket.
+void VTCPSelectWatchAction::HandleError (fd_set* fdSockets)
+{
+	if (FD_ISSET(GetRawSocket(), fdSockets))
 
-	}
+		ProcessError();
 }
 
-void VTCPSelectWatchAction::HandleError (fd_set* fdSockets)
+void VTCPSelectWatchAction::ProcessReadable ()
 {
-	int	nRawSocket = GetRawSocket();
+	xbox_assert(GetType() == VTCPSelectAction::eTYPE_WATCH);
 
-	if (!FD_ISSET(nRawSocket, fdSockets))
+	if (!TriggerReadCallback(0))
 
-		return;
+		SetLastError(VE_SRVR_READ_FAILED);	// May be not a failed read, but this will prevent select() to check this socket.
+}
+
+void VTCPSelectWatchAction::ProcessError ()
+{
+	int	nRawSocket = GetRawSocket();
 
 	int				nError = 0;
 #if VERSIONWIN
@@ -368,14 +556,35 @@ VTCPSelectIOHandler::VTCPSelectIOHandler ( ) :
 {
 	SetName ( "ServerNet select I/O handler" );
 	fReadCount = 0;
+
+#if WITH_EPOLL_SELECT_IO
+
+	fEpollFD = epoll_create1 ( EPOLL_CLOEXEC );
+	xbox_assert( fEpollFD != -1);
+
+#endif
 }
 
 VTCPSelectIOHandler::~VTCPSelectIOHandler ( )
 {
+#if WITH_EPOLL_SELECT_IO
+
+	if ( fEpollFD != -1 )
+	{
+		close ( fEpollFD );
+		fEpollFD = -1;
+	}
+
+#endif
+
 	if ( !fReadSockLock. Lock ( ) )
 		return;
 
+#if WITH_EPOLL_SELECT_IO
+	fActionMap.clear();
+#else
 	fReadSockList.clear();
+#endif
 
 	fReadSockLock. Unlock ( );
 }
@@ -385,6 +594,417 @@ void VTCPSelectIOHandler::Stop ( )
 	Kill ( );
 }
 
+sLONG VTCPSelectIOHandler::GetSocketCount ( )
+{
+	if ( !fReadSockLock. Lock ( ) )
+		return 0;
+
+#if WITH_EPOLL_SELECT_IO
+	sLONG	nCount = static_cast<sLONG> ( fActionMap. size ( ) );
+#else
+	sLONG	nCount = static_cast<sLONG> ( fReadSockList. size ( ) );
+#endif
+
+	fReadSockLock. Unlock ( );
+
+	return nCount;
+}
+
+bool VTCPSelectIOHandler::MoveWatchedSocket ( VTCPSelectIOHandler* inTarget, Socket& outRawSocket )
+{
+	// Callbacks run with fReadSockLock held: once both locks are taken, no callback of the moved socket is in flight.
+
+	if ( !inTarget-> fReadSockLock. TryToLock ( ) )
+		return false;
+
+	if ( !fReadSockLock. TryToLock ( ) )
+	{
+		inTarget-> fReadSockLock. Unlock ( );
+		return false;
+	}
+
+	// Only healthy watch actions are moved, a failed one is waiting to be removed by its owner.
+
+	VRefPtr<VTCPSelectAction>	vtcpSelectAction;
+
+#if WITH_EPOLL_SELECT_IO
+
+	MapOfActions::iterator		iterAction = fActionMap. begin ( );
+	while ( iterAction != fActionMap. end ( )
+		&& ( iterAction-> second-> GetType ( ) != VTCPSelectAction::eTYPE_WATCH || iterAction-> second-> GetLastError ( ) != VE_OK ) )
+		++iterAction;
+
+	if ( iterAction != fActionMap. end ( ) )
+	{
+		vtcpSelectAction = iterAction-> second;
+		_DisarmSocket ( iterAction-> first );
+		fActionMap. erase ( iterAction );
+	}
+
+#else
+
+	std::list<VRefPtr<VTCPSelectAction> >::iterator		iterAction = fReadSockList. begin ( );
+	while ( iterAction != fReadSockList. end ( )
+		&& ( ( *iterAction )-> GetType ( ) != VTCPSelectAction::eTYPE_WATCH || ( *iterAction )-> GetLastError ( ) != VE_OK ) )
+		++iterAction;
+
+	if ( iterAction != fReadSockList. end ( ) )
+	{
+		vtcpSelectAction = *iterAction;
+		fReadSockList. erase ( iterAction );
+	}
+
+#endif
+
+	bool						bMoved = false;
+
+	if ( vtcpSelectAction. Get ( ) != NULL )
+	{
+		VTCPSelectWatchAction*		watchAction = ( VTCPSelectWatchAction* ) vtcpSelectAction. Get ( );
+
+		outRawSocket = watchAction-> GetRawSocket ( );
+
+		// Target may be full (FD_SETSIZE), then put the socket back.
+
+		if ( inTarget-> AddSocketForWatching ( outRawSocket, watchAction-> GetEndPoint ( ), watchAction-> GetData ( ), watchAction-> GetCallback ( ) ) == VE_OK )
+			bMoved = true;
+		else
+			AddSocketForWatching ( outRawSocket, watchAction-> GetEndPoint ( ), watchAction-> GetData ( ), watchAction-> GetCallback ( ) );
+	}
+
+	fReadSockLock. Unlock ( );
+	inTarget-> fReadSockLock. Unlock ( );
+
+	return bMoved;
+}
+
+sLONG VTCPSelectIOHandler::GetLastSocketError ( )
+{
+	#if VERSIONWIN
+		return WSAGetLastError ( );
+	#else
+		return 0;
+	#endif
+}
+
+#if WITH_EPOLL_SELECT_IO
+
+VError VTCPSelectIOHandler::_ArmSocket ( Socket inRawSocket, int inOperation, bool inWantRead )
+{
+	struct epoll_event	event;
+
+	::memset ( &event, 0, sizeof ( event ) );
+	event. events = EPOLLONESHOT;
+	if ( inWantRead )
+		event. events |= EPOLLIN | EPOLLRDHUP;
+	event. data. fd = inRawSocket;
+
+	int		nResult = epoll_ctl ( fEpollFD, inOperation, inRawSocket, &event );
+
+	DEBUG_CHECK_SOCK_RESULT( nResult, "epoll_ctl", inRawSocket);
+
+	if ( nResult == 0 )
+		return VE_OK;
+	else if ( errno == ENOSPC )
+		return VE_SRVR_TOO_MANY_SOCKETS_FOR_SELECT_IO;	// Over /proc/sys/fs/epoll/max_user_watches.
+	else
+		return VE_SRVR_INVALID_INTERNAL_STATE;
+}
+
+void VTCPSelectIOHandler::_DisarmSocket ( Socket inRawSocket )
+{
+	// Socket may already have been closed (which removes it from the epoll set), ignore errors.
+
+	struct epoll_event	event;
+
+	::memset ( &event, 0, sizeof ( event ) );
+	epoll_ctl ( fEpollFD, EPOLL_CTL_DEL, inRawSocket, &event );
+}
+
+void VTCPSelectIOHandler::_HandleTimeOuts ( )
+{
+	MapOfActions::iterator	iterAction = fActionMap. begin ( );
+	while ( iterAction != fActionMap. end ( ) )
+	{
+		VTCPSelectAction*	vtcpSelectAction = iterAction-> second. Get ( );
+
+		if ( vtcpSelectAction-> GetLastError ( ) == VE_OK
+			&& vtcpSelectAction-> GetType ( ) == VTCPSelectAction::eTYPE_READ
+			&& vtcpSelectAction-> TimeOutExpired ( )
+			&& !( ( VTCPSelectReadAction* ) vtcpSelectAction )-> IsProcessed ( ) )
+		{
+			vtcpSelectAction-> SetLastError ( VE_SRVR_READ_TIMED_OUT );
+			( ( VTCPSelectReadAction* ) vtcpSelectAction )-> NotifyActionComplete ( );
+		}
+		++iterAction;
+	}
+}
+
+Boolean VTCPSelectIOHandler::DoRun ( )
+{
+	const int			kMAX_EVENTS	= 256;
+	struct epoll_event	events [ kMAX_EVENTS ];
+	uLONG				nLastTimeOutCheck = VSystem::GetCurrentTime ( );
+
+	while ( GetState ( ) != TS_DYING && GetState ( ) != TS_DEAD )
+	{
+		StDropErrorContext errCtx;
+
+		// Same 100ms period as the select() loop, so read time-outs and task death are noticed.
+
+		int		nEvents = epoll_wait ( fEpollFD, events, kMAX_EVENTS, 100 );
+
+		if ( nEvents < 0 )
+		{
+			DEBUG_CHECK_RESULT( nEvents, "epoll_wait from IOHandler");
+			if ( errno != EINTR )
+				Sleep ( 5 );
+			continue;
+		}
+
+		if ( !fReadSockLock. Lock ( ) )
+			break;
+
+		if ( nEvents > 0 )
+			fReadCount++;
+
+		for ( int i = 0; i < nEvents; i++ )
+		{
+			Socket						nRawSocket = events [ i ]. data. fd;
+			MapOfActions::iterator		iterAction = fActionMap. find ( nRawSocket );
+
+			// Socket may have been removed after epoll_wait() returned.
+
+			if ( iterAction == fActionMap. end ( ) || iterAction-> second-> GetLastError ( ) != VE_OK )
+				continue;
+
+			VRefPtr<VTCPSelectAction>	vtcpSelectAction = iterAction-> second;
+
+			if ( events [ i ]. events & EPOLLERR )
+				vtcpSelectAction-> ProcessError ( );
+
+			if ( vtcpSelectAction-> GetLastError ( ) == VE_OK && ( events [ i ]. events & ( EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR ) ) )
+				vtcpSelectAction-> ProcessReadable ( );
+
+			// Read actions are re-armed by the next Read(). Watch actions are re-armed as long as the callback
+			// asks for it, and provided it didn't remove the socket itself.
+
+			if ( vtcpSelectAction-> GetType ( ) == VTCPSelectAction::eTYPE_WATCH && vtcpSelectAction-> GetLastError ( ) == VE_OK )
+			{
+				iterAction = fActionMap. find ( nRawSocket );
+				if ( iterAction != fActionMap. end ( ) && iterAction-> second == vtcpSelectAction )
+					_ArmSocket ( nRawSocket, EPOLL_CTL_MOD, true );
+			}
+		}
+
+		uLONG	nCurrentTime = VSystem::GetCurrentTime ( );
+		if ( nCurrentTime - nLastTimeOutCheck >= 100 )
+		{
+			_HandleTimeOuts ( );
+			nLastTimeOutCheck = nCurrentTime;
+		}
+
+		if ( !fReadSockLock. Unlock ( ) )
+			break;
+
+		//Correction pour freeze des clients mono core : Corrige ce qui semble etre un pb d'ordonnancement sur les
+		//machines ne disposant que d'un coeur. ACI0068696
+		static sLONG cpuCount=VSystem::GetNumberOfProcessors();
+
+		if(cpuCount==1)
+			VTask::YieldNow();
+	}
+
+	return true;
+}
+
+VError VTCPSelectIOHandler::AddSocketForReading ( Socket inRawSocket )
+{
+	if ( !fReadSockLock. Lock ( ) )
+		return VE_SRVR_FAILED_TO_SYNC_LOCK;
+
+	xbox_assert( inRawSocket != -1);
+
+	VError				vError = VE_OK;
+	if ( fActionMap. find ( inRawSocket ) == fActionMap. end ( ) )
+	{
+		// Registered disarmed, Read() will arm it.
+
+		vError = _ArmSocket ( inRawSocket, EPOLL_CTL_ADD, false );
+		if ( vError == VE_OK )
+			fActionMap [ inRawSocket ] = VRefPtr<VTCPSelectAction> ( new VTCPSelectReadAction ( inRawSocket, 0, 0 ), false );
+	}
+	else
+		vError = VE_SRVR_SOCKET_ALREADY_READING;
+
+	if ( !fReadSockLock. Unlock ( ) )
+		if ( vError == VE_OK )
+			vError = VE_SRVR_FAILED_TO_SYNC_LOCK;
+
+	return vError;
+}
+
+VError VTCPSelectIOHandler::RemoveSocketForReading ( Socket inRawSocket )
+{
+	if ( !fReadSockLock. Lock ( ) )
+		return VE_SRVR_FAILED_TO_SYNC_LOCK;
+	
+	VError						vError = VE_OK;
+	MapOfActions::iterator		iterAction = fActionMap. find ( inRawSocket );
+	if ( iterAction != fActionMap. end ( ) )
+	{
+		xbox_assert(iterAction->second->GetType() == VTCPSelectAction::eTYPE_READ);
+
+		// Socket may be removed for reading by another thread via ForceClose call.
+		// In this case I need to notify original reader that the read is over.
+
+		((VTCPSelectReadAction *) iterAction->second.Get())->NotifyActionComplete();
+
+		_DisarmSocket ( inRawSocket );
+		fActionMap. erase ( iterAction );
+	}
+	else
+		vError = VE_SRVR_SOCKET_IS_NOT_READING;
+
+	if ( !fReadSockLock. Unlock ( ) )
+		vError = VE_SRVR_FAILED_TO_SYNC_LOCK;
+
+	return vError;
+}
+
+VError VTCPSelectIOHandler::AddSocketForWatching (Socket inRawSocket, VEndPoint *inEndPoint, void *inData, CTCPSelectIOHandler::ReadCallback *inCallback)
+{
+	if (!fReadSockLock.Lock())
+
+		return VE_SRVR_FAILED_TO_SYNC_LOCK;
+
+	xbox_assert(inRawSocket != -1);
+
+	VError					vError = VE_OK;
+	MapOfActions::iterator	iterAction = fActionMap.find(inRawSocket);
+
+	if (iterAction == fActionMap.end()) {
+
+		// Insert before arming, an event may be reported before epoll_ctl() returns.
+
+		fActionMap[inRawSocket] = VRefPtr<VTCPSelectAction>(new VTCPSelectWatchAction(inRawSocket, inEndPoint, inData, inCallback), false);
+		if ((vError = _ArmSocket(inRawSocket, EPOLL_CTL_ADD, true)) != VE_OK)
+
+			fActionMap.erase(inRawSocket);
+
+	} else {
+
+		xbox_assert(iterAction->second->GetType() == VTCPSelectAction::eTYPE_WATCH);
+		vError = VE_SRVR_SOCKET_ALREADY_WATCHING;
+
+	}
+
+	if (!fReadSockLock.Unlock() && vError == VE_OK)
+
+		vError = VE_SRVR_FAILED_TO_SYNC_LOCK;
+
+	return vError;
+}
+
+VError VTCPSelectIOHandler::RemoveSocketForWatching (Socket inRawSocket)
+{
+	if (!fReadSockLock. Lock())
+
+		return VE_SRVR_FAILED_TO_SYNC_LOCK;
+	
+	VError					vError = VE_OK;
+	MapOfActions::iterator	iterAction = fActionMap.find(inRawSocket);
+
+	if (iterAction != fActionMap.end()) {
+
+		xbox_assert(iterAction->second->GetType() == VTCPSelectAction::eTYPE_WATCH);
+		_DisarmSocket(inRawSocket);
+		fActionMap.erase(iterAction);
+
+	} else
+
+		vError = VE_SRVR_SOCKET_IS_NOT_READING;
+
+	if (!fReadSockLock.Unlock())
+
+		vError = VE_SRVR_FAILED_TO_SYNC_LOCK;
+
+	return vError;
+}
+
+VError VTCPSelectIOHandler::Read ( Socket inRawSocket, char* inBuffer, uLONG* nBufferLength, sLONG& outError, sLONG& outSystemError, uLONG inTimeOutMillis )
+{
+	xbox_assert( inRawSocket != -1);
+
+	if ( !fReadSockLock. Lock ( ) )
+		return VE_SRVR_FAILED_TO_SYNC_LOCK;
+
+	VError							vError = VE_OK;
+	VRefPtr<VTCPSelectReadAction>	vtcpSelectReadAction;
+	MapOfActions::iterator			iterAction = fActionMap. find ( inRawSocket );
+	if ( iterAction == fActionMap. end ( ) )
+		vError = VE_SRVR_SOCKET_IS_NOT_READING;
+	else
+	{
+		xbox_assert(iterAction->second->GetType() == VTCPSelectAction::eTYPE_READ);
+
+		vtcpSelectReadAction = (VTCPSelectReadAction *) iterAction->second.Get();
+		if ( vtcpSelectReadAction-> GetLastError ( ) == VE_OK )
+		{
+			vtcpSelectReadAction-> SetBuffer ( inBuffer );
+			vtcpSelectReadAction-> SetFullBufferSize ( nBufferLength );
+			vtcpSelectReadAction-> SetProcessed ( false );
+			vtcpSelectReadAction-> SetTimeOut ( inTimeOutMillis );
+
+			vError = _ArmSocket ( inRawSocket, EPOLL_CTL_MOD, true );
+			if ( vError != VE_OK )
+				vtcpSelectReadAction-> SetProcessed ( true );
+		}
+	}
+	
+	if ( !fReadSockLock. Unlock ( ) )
+		vError = VE_SRVR_FAILED_TO_SYNC_LOCK;
+
+	if ( vError != VE_OK )
+		return vError;
+
+	// A previous read failed or timed out: the socket is no longer armed, report the error right away.
+
+	if ( vtcpSelectReadAction-> GetLastError ( ) == VE_OK && !vtcpSelectReadAction-> WaitForAction ( ) )
+		return VE_SRVR_FAILED_TO_SYNC_LOCK;
+
+	vError = vtcpSelectReadAction-> GetLastError ( );
+	if ( vError != VE_OK )
+	{
+		outError = vtcpSelectReadAction-> GetLastSocketError ( );
+		outSystemError = vtcpSelectReadAction-> GetLastSystemSocketError ( );
+	}
+
+	return vError;
+}
+
+sLONG VTCPSelectIOHandler::GetActiveReadCount ( )
+{
+	if ( !fReadSockLock. Lock ( ) )
+		return -1;
+
+	int		nResult = 0;
+	MapOfActions::iterator		iterAction = fActionMap. begin ( );
+	while ( iterAction != fActionMap. end ( ) )
+	{
+		if ( iterAction-> second-> GetLastError ( ) == VE_OK )
+			nResult++;
+		++iterAction;
+	}
+
+	if ( !fReadSockLock. Unlock ( ) )
+		return -1;
+
+	return nResult;
+}
+
+#else
+
 void VTCPSelectIOHandler::AddToFDSet ( VTCPSelectAction* vtcpSelectAction, fd_set* fdSockets )
 {
 	if ( vtcpSelectAction-> GetLastError ( ) != VE_OK )
@@ -697,15 +1317,6 @@ void VTCPSelectIOHandler::HandleError ( VTCPSelectAction* vtcpSelectAction, fd_s
 	vtcpSelectAction->HandleError(fdSockets);
 }
 
-sLONG VTCPSelectIOHandler::GetLastSocketError ( )
-{
-	#if VERSIONWIN
-		return WSAGetLastError ( );
-	#else
-		return 0;
-	#endif
-}
-
 sLONG VTCPSelectIOHandler::GetActiveReadCount ( )
 {
 	if ( !fReadSockLock. Lock ( ) )
@@ -726,4 +1337,6 @@ sLONG VTCPSelectIOHandler::GetActiveReadCount ( )
 	return nResult;
 }
 
+#endif
+
 END_TOOLBOX_NAMESPACE
\ No newline at end of file
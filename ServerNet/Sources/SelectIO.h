@@ -57,26 +57,62 @@ class XTOOLBOX_API CTCPSelectIOHandler
 };
 
 
+class VTCPSelectIOHandler;
+
 class XTOOLBOX_API VTCPSelectIOPool : public IRefCountable
 {
 	public :
 	
-	VTCPSelectIOPool ( );
+	// How sockets are placed on handlers:
+	//
+	//	+ ePLACEMENT_FIRST_FIT: first handler with room, a new handler is started when all are full;
+	//	+ ePLACEMENT_SHARDED: a fixed set of reactors (one per processor if inReactorCount is zero), endpoints
+	//	  are spread by hash of their simple ID. A reactor holding much more than its share of sockets (because
+	//	  its connections outlived the others) is passed over for the least loaded one. When a watched socket is
+	//	  removed, a watched socket of the most loaded reactor is moved to the one that lost it if the former is
+	//	  over its share. Read sockets are never moved (they are only registered for the time of a read).
+
+	typedef enum
+	{
+		ePLACEMENT_FIRST_FIT,
+		ePLACEMENT_SHARDED
+
+	} EPlacement;
+
+	VTCPSelectIOPool ( EPlacement inPlacement = ePLACEMENT_FIRST_FIT, sLONG inReactorCount = 0 );
 	virtual ~VTCPSelectIOPool ( );
 	
 	CTCPSelectIOHandler* AddSocketForReading ( VEndPoint* inEndPoint, VError& outError );
 	CTCPSelectIOHandler* AddSocketForWatching (VEndPoint* inEndPoint, void *inData, CTCPSelectIOHandler::ReadCallback *inCallback, VError& outError);
 	
+	// Remove a socket set by AddSocketForWatching(), from whichever handler it has been moved to since.
+	
+	VError RemoveSocketForWatching (Socket inRawSocket);
+	
 	VError Close ( );
 	
 private:
 	
 	std::list<CTCPSelectIOHandler*>			fHandlerList;
 	VCriticalSection						fHandlersLock;
+
+	EPlacement								fPlacement;
+	sLONG									fReactorCount;
+	std::vector<VTCPSelectIOHandler*>		fReactors;		// Sharded mode only, also in fHandlerList.
+	
+	// Handler of each watched socket. Never held while waiting for another lock.
+	
+	std::map<Socket, CTCPSelectIOHandler*>	fWatchedSockets;
+	VCriticalSection						fWatchedSocketsLock;
 	
 	// Set a "watch" if inCallback is not NULL, otherwise read socket.
 	
 	CTCPSelectIOHandler	*_AddSocket (VEndPoint *inEndPoint, void *inData, CTCPSelectIOHandler::ReadCallback *inCallback, VError& outError);
+	CTCPSelectIOHandler	*_AddSocketSharded (VTCPEndPoint *inEndPoint, void *inData, CTCPSelectIOHandler::ReadCallback *inCallback);
+
+	static VError		_AddSocketToHandler (CTCPSelectIOHandler *inHandler, VTCPEndPoint *inEndPoint, void *inData, CTCPSelectIOHandler::ReadCallback *inCallback);
+
+	void				_Rebalance (CTCPSelectIOHandler *inHandler);
 };
 
 
@@ -113,6 +149,11 @@ virtual	sLONG		GetType () = 0;
 virtual void		DoAction (fd_set* fdSockets) = 0;
 virtual void		HandleError (fd_set* fdSockets) = 0;
 
+		// Same as above, but readiness (or error) has already been established by the caller (epoll).
+
+virtual void		ProcessReadable () = 0;
+virtual void		ProcessError () = 0;
+
 	protected:
 
 					VTCPSelectAction (Socket inSocket);
@@ -154,6 +195,9 @@ virtual sLONG	GetType ()									{	return VTCPSelectAction::eTYPE_READ;	}
 virtual void	DoAction (fd_set* fdSockets);
 virtual void	HandleError (fd_set* fdSockets);
 
+virtual void	ProcessReadable ();
+virtual void	ProcessError ();
+
 	protected:
 
 virtual			~VTCPSelectReadAction()	{}
@@ -179,11 +223,18 @@ class XTOOLBOX_API VTCPSelectWatchAction : public VTCPSelectAction
 
 virtual sLONG	GetType ()					{	return VTCPSelectAction::eTYPE_WATCH;	}
 
+		VEndPoint							*GetEndPoint ()	{	return fEndPoint;	}
+		void								*GetData ()		{	return fData;	}
+		CTCPSelectIOHandler::ReadCallback	*GetCallback ()	{	return fCallback;	}
+
 		bool	TriggerReadCallback (sLONG inErrorCode);
 
 virtual void	DoAction (fd_set* fdSockets);
 virtual void	HandleError (fd_set* fdSockets);
 
+virtual void	ProcessReadable ();
+virtual void	ProcessError ();
+
 	protected:
 
 virtual			~VTCPSelectWatchAction ()	{}
@@ -212,6 +263,15 @@ class XTOOLBOX_API VTCPSelectIOHandler : public CTCPSelectIOHandler, public VTas
 
 		virtual void	Stop ( );
 
+		// Number of sockets registered for reading or watching.
+
+		sLONG			GetSocketCount ( );
+
+		// Move one watched socket to inTarget. Doesn't wait: returns false if either handler is busy (a callback
+		// may be running) or if there is no socket to move. Callbacks of the moved socket are never concurrent.
+
+		bool			MoveWatchedSocket ( VTCPSelectIOHandler* inTarget, Socket& outRawSocket );
+
 		static sLONG	GetLastSocketError ( );
 
 	protected :
@@ -220,16 +280,35 @@ class XTOOLBOX_API VTCPSelectIOHandler : public CTCPSelectIOHandler, public VTas
 
 	private :
 
-		std::list<XBOX::VRefPtr<VTCPSelectAction> >		fReadSockList;
 		VCriticalSection								fReadSockLock;
+		sLONG8											fReadCount;
+
+#if WITH_EPOLL_SELECT_IO
 
+		// Sockets are registered with EPOLLONESHOT: a read action is armed only while a Read() is pending,
+		// a watch action is re-armed after each successful callback. Events carry the raw socket, which is
+		// looked up in fActionMap (under fReadSockLock) so that an action removed concurrently is never used.
+
+		typedef std::map<Socket, XBOX::VRefPtr<VTCPSelectAction> >	MapOfActions;
+
+		MapOfActions									fActionMap;
+		int												fEpollFD;
+
+		VError	_ArmSocket ( Socket inRawSocket, int inOperation, bool inWantRead );
+		void	_DisarmSocket ( Socket inRawSocket );
+		void	_HandleTimeOuts ( );
+
+#else
+
+		std::list<XBOX::VRefPtr<VTCPSelectAction> >		fReadSockList;
 		fd_set											fReadSockSet;
-		sLONG8											fReadCount;
 
 		static void AddToFDSet ( VTCPSelectAction* vtcpSelectAction, fd_set* fdSockets );
 		static void HandleRead ( VTCPSelectAction* vtcpSelectAction, fd_set* fdSockets );
 		static void HandleError ( VTCPSelectAction* vtcpSelectAction, fd_set* fdSockets );
 
+#endif
+
 		sLONG GetActiveReadCount ( );
 };
 
@@ -34,14 +34,48 @@ class VConnectionHandlerQueue;
 class VConnectionHandlerFactory;
 class VTCPConnectionHandlerFactory;
 class VWorkerPool;
+class VSharedWorker;
 class VTCPSelectIOPool;
 
 typedef enum {DualStack, ForceV4, ForceV6, DefaultPolicy=ForceV4} IpPolicy;
 
 
+// One buffer of a gather write (see VTCPEndPoint::WriteExactlyV).
+
+struct VTCPIOBuffer
+{
+	const void*	fData;
+	uLONG		fLength;
+};
+
+
 #define WITH_SHARED_WORKERS 0
 
 
+// On Linux, a listener may open several SO_REUSEPORT sockets per port, each one accepted from by its own task
+// (see VTCPConnectionListener::SetAcceptTaskCount). Elsewhere SO_REUSEPORT doesn't balance connections.
+
+#ifndef WITH_REUSEPORT_LISTENERS
+	#if VERSION_LINUX
+		#define WITH_REUSEPORT_LISTENERS 1
+	#else
+		#define WITH_REUSEPORT_LISTENERS 0
+	#endif
+#endif
+
+
+// On Linux, select I/O handlers are driven by epoll rather than select(): there is no FD_SETSIZE
+// limit on the number of sockets per handler and wakeups only report the ready sockets.
+
+#ifndef WITH_EPOLL_SELECT_IO
+	#if VERSION_LINUX
+		#define WITH_EPOLL_SELECT_IO VERSION_LINUX_STRICT
+	#else
+		#define WITH_EPOLL_SELECT_IO 0
+	#endif
+#endif
+
+
 enum
 {
 	kServerNetTaskKind = 'SNET'
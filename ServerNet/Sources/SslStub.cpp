@@ -95,6 +95,16 @@ int	SNET_STDCALL SSLSTUB::RSA_size(const RSA* rsa)
 	return ::RSA_size(rsa);
 }
 
+long SNET_STDCALL SSLSTUB::SSL_CTX_ctrl(SSL_CTX* ctx, int cmd, long larg, void* parg)
+{
+	return ::SSL_CTX_ctrl(ctx, cmd, larg, parg);
+}
+
+void SNET_STDCALL SSLSTUB::SSL_CTX_flush_sessions(SSL_CTX* ctx, long tm)
+{
+	return ::SSL_CTX_flush_sessions(ctx, tm);
+}
+
 void SNET_STDCALL SSLSTUB::SSL_CTX_free(SSL_CTX* ctx)
 {
 	return ::SSL_CTX_free(ctx);
@@ -105,6 +115,11 @@ SSL_CTX* SNET_STDCALL SSLSTUB::SSL_CTX_new(const SSL_METHOD* meth)
 	return ::SSL_CTX_new(meth);
 }
 
+int SNET_STDCALL SSLSTUB::SSL_CTX_set_session_id_context(SSL_CTX* ctx, const unsigned char* sid_ctx, unsigned int sid_ctx_len)
+{
+	return ::SSL_CTX_set_session_id_context(ctx, sid_ctx, sid_ctx_len);
+}
+
 int SNET_STDCALL SSLSTUB::SSL_pending(const SSL *ssl)
 {
 	return ::SSL_pending(ssl);
@@ -120,11 +135,21 @@ int SNET_STDCALL SSLSTUB::SSL_CTX_use_certificate(SSL_CTX* ctx, X509* x)
 	return ::SSL_CTX_use_certificate(ctx, x);
 }
 
+long SNET_STDCALL SSLSTUB::SSL_ctrl(SSL* ssl, int cmd, long larg, void* parg)
+{
+	return ::SSL_ctrl(ssl, cmd, larg, parg);
+}
+
 void SNET_STDCALL SSLSTUB::SSL_free(SSL* ssl)
 {
 	return ::SSL_free(ssl);
 }
 
+SSL_SESSION* SNET_STDCALL SSLSTUB::SSL_get1_session(SSL* ssl)
+{
+	return ::SSL_get1_session(ssl);
+}
+
 int SNET_STDCALL SSLSTUB::SSL_get_error(const SSL* ssl, int ret)
 {
 	return ::SSL_get_error(ssl, ret);
@@ -170,6 +195,21 @@ int SNET_STDCALL SSLSTUB::SSL_set_fd(SSL* ssl, int fd)
 	return ::SSL_set_fd(ssl, fd);
 }
 
+int SNET_STDCALL SSLSTUB::SSL_set_session(SSL* ssl, SSL_SESSION* session)
+{
+	return ::SSL_set_session(ssl, session);
+}
+
+int SNET_STDCALL SSLSTUB::SSL_set_session_id_context(SSL* ssl, const unsigned char* sid_ctx, unsigned int sid_ctx_len)
+{
+	return ::SSL_set_session_id_context(ssl, sid_ctx, sid_ctx_len);
+}
+
+void SNET_STDCALL SSLSTUB::SSL_SESSION_free(SSL_SESSION* session)
+{
+	return ::SSL_SESSION_free(session);
+}
+
 int SNET_STDCALL SSLSTUB::SSL_shutdown(SSL* ssl)
 {
 	return ::SSL_shutdown(ssl);
@@ -195,6 +235,16 @@ const SSL_METHOD* SNET_STDCALL SSLSTUB::SSLv23_method()
 	return ::SSLv23_method();
 }
 
+const EVP_MD* SNET_STDCALL SSLSTUB::EVP_sha1()
+{
+	return ::EVP_sha1();
+}
+
+int SNET_STDCALL SSLSTUB::X509_digest(const X509* data, const EVP_MD* type, unsigned char* md, unsigned int* len)
+{
+	return ::X509_digest(data, type, md, len);
+}
+
 void SNET_STDCALL SSLSTUB::X509_free(X509* x)
 {
 	return ::X509_free(x);
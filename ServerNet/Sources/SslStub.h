@@ -66,12 +66,17 @@ namespace snet_ssl_stub
 	int						SNET_STDCALL	RSA_private_encrypt			(int flen, unsigned char *from, unsigned char *to, RSA *rsa, int padding);
 	int						SNET_STDCALL	RSA_size					(const RSA* rsa);
 
+	long					SNET_STDCALL	SSL_CTX_ctrl				(SSL_CTX* ctx, int cmd, long larg, void* parg);
+	void					SNET_STDCALL	SSL_CTX_flush_sessions		(SSL_CTX* ctx, long tm);
 	void					SNET_STDCALL	SSL_CTX_free				(SSL_CTX* ctx);
 	SSL_CTX*				SNET_STDCALL	SSL_CTX_new					(const SSL_METHOD* meth);
+	int						SNET_STDCALL	SSL_CTX_set_session_id_context	(SSL_CTX* ctx, const unsigned char* sid_ctx, unsigned int sid_ctx_len);
 	int						SNET_STDCALL	SSL_CTX_use_RSAPrivateKey	(SSL_CTX* ctx, RSA* rsa);
 	int						SNET_STDCALL	SSL_CTX_use_certificate		(SSL_CTX* ctx, X509* x);
 
+	long					SNET_STDCALL	SSL_ctrl					(SSL* ssl, int cmd, long larg, void* parg);
 	void					SNET_STDCALL	SSL_free					(SSL* ssl);
+	SSL_SESSION*			SNET_STDCALL	SSL_get1_session			(SSL* ssl);
 	int						SNET_STDCALL	SSL_get_error				(const SSL* ssl, int ret);
 	int						SNET_STDCALL	SSL_get_fd					(const SSL* ssl);
 	int						SNET_STDCALL	SSL_library_init			();
@@ -82,6 +87,9 @@ namespace snet_ssl_stub
 	void					SNET_STDCALL	SSL_set_connect_state		(SSL* ssl);
 	void					SNET_STDCALL	SSL_set_accept_state		(SSL* ssl);
 	int						SNET_STDCALL	SSL_set_fd					(SSL* ssl, int fd);
+	int						SNET_STDCALL	SSL_set_session				(SSL* ssl, SSL_SESSION* session);
+	int						SNET_STDCALL	SSL_set_session_id_context	(SSL* ssl, const unsigned char* sid_ctx, unsigned int sid_ctx_len);
+	void					SNET_STDCALL	SSL_SESSION_free			(SSL_SESSION* session);
 	int						SNET_STDCALL	SSL_shutdown				(SSL* ssl);
 	int						SNET_STDCALL	SSL_use_certificate			(SSL* ssl, X509* x);
 	int						SNET_STDCALL	SSL_use_RSAPrivateKey		(SSL* ssl, RSA* rsa);
@@ -89,6 +97,9 @@ namespace snet_ssl_stub
 
 	const SSL_METHOD*		SNET_STDCALL	SSLv23_method				();
 
+	const EVP_MD*			SNET_STDCALL	EVP_sha1					();
+
+	int						SNET_STDCALL	X509_digest					(const X509* data, const EVP_MD* type, unsigned char* md, unsigned int* len);
 	void					SNET_STDCALL	X509_free					(X509* x);
 
 	// Used by VSslDelegate::HandShake() (SSJS socket implementation).
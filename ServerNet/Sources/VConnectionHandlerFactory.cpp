@@ -26,6 +26,7 @@ VConnectionHandlerQueue::VConnectionHandlerQueue ( ) :
 m_qConnectionHandlers ( )
 {
 	m_vcsQueueProtector = new VCriticalSection ( );
+	m_nCount = 0;
 }
 
 VConnectionHandlerQueue::~VConnectionHandlerQueue ( )
@@ -39,7 +40,8 @@ VError VConnectionHandlerQueue::Push ( VConnectionHandler* inConnectionHandler )
 	if ( !m_vcsQueueProtector-> Lock ( ) )
 		return VE_SRVR_FAILED_TO_SYNC_LOCK;
 	
-	m_qConnectionHandlers. push ( inConnectionHandler );
+	m_qConnectionHandlers. push_back ( inConnectionHandler );
+	VInterlocked::Increment ( &m_nCount );
 	
 	m_vcsQueueProtector-> Unlock ( );
 	
@@ -59,7 +61,8 @@ VConnectionHandler* VConnectionHandlerQueue::Pop ( VError* ioError )
 	if ( m_qConnectionHandlers. size ( ) > 0 )
 	{
 		vcHandler = m_qConnectionHandlers. front ( );
-		m_qConnectionHandlers. pop ( );
+		m_qConnectionHandlers. pop_front ( );
+		VInterlocked::Decrement ( &m_nCount );
 	}
 	
 	*ioError = VE_OK;
@@ -69,6 +72,24 @@ VConnectionHandler* VConnectionHandlerQueue::Pop ( VError* ioError )
 	return vcHandler;
 }
 
+VConnectionHandler* VConnectionHandlerQueue::Steal ( )
+{
+	if ( !m_vcsQueueProtector-> Lock ( ) )
+		return NULL;
+	
+	VConnectionHandler*			vcHandler = NULL;
+	if ( m_qConnectionHandlers. size ( ) > 0 )
+	{
+		vcHandler = m_qConnectionHandlers. back ( );
+		m_qConnectionHandlers. pop_back ( );
+		VInterlocked::Decrement ( &m_nCount );
+	}
+	
+	m_vcsQueueProtector-> Unlock ( );
+	
+	return vcHandler;
+}
+
 void VConnectionHandlerQueue::ReleaseAll ( )
 {
 	m_vcsQueueProtector-> Lock ( );
@@ -77,9 +98,10 @@ void VConnectionHandlerQueue::ReleaseAll ( )
 	while ( m_qConnectionHandlers. size ( ) > 0 )
 	{
 		vcHandler = m_qConnectionHandlers. front ( );
-		m_qConnectionHandlers. pop ( );
+		m_qConnectionHandlers. pop_front ( );
 		vcHandler-> Release ( );
 	}
+	VInterlocked::Exchange ( &m_nCount, 0 );
 	
 	m_vcsQueueProtector-> Unlock ( );
 }
@@ -15,7 +15,7 @@
 */
 #include "ServerNetTypes.h"
 
-#include <queue>
+#include <deque>
 
 #ifndef __SNET_CONNECTION_HANDLER_FACTORY__
 #define __SNET_CONNECTION_HANDLER_FACTORY__
@@ -75,7 +75,8 @@ public :
 };
 
 
-/* A synchronized queue of connection handlers. */
+/* A synchronized deque of connection handlers. Each exclusive worker owns one : the owner pops the oldest
+handler, other workers steal the newest one when they run out of work. */
 class XTOOLBOX_API VConnectionHandlerQueue
 {
 public :
@@ -85,13 +86,18 @@ public :
 	
 	VError Push ( VConnectionHandler* inConnectionHandler );
 	VConnectionHandler* Pop ( VError* ioError );
+	VConnectionHandler* Steal ( );
 	void ReleaseAll ( );
 
+	/* Doesn't lock : only a hint to skip empty queues when looking for work. */
+	bool IsEmpty ( ) { return VInterlocked::AtomicGet ( &m_nCount ) == 0; }
+
 	
 private :
 	
 	VCriticalSection*						m_vcsQueueProtector;
-	std::queue<VConnectionHandler*>			m_qConnectionHandlers;
+	std::deque<VConnectionHandler*>			m_qConnectionHandlers;
+	sLONG									m_nCount;
 };
 
 
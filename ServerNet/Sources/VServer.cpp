@@ -150,16 +150,53 @@ VError VServer::Stop ( )
 }
 
 
+/* Extra accept task of a VTCPConnectionListener, using its own group of listening sockets. */
+class VTCPAcceptTask : public VTask
+{
+	public :
+	
+	VTCPAcceptTask ( VTCPConnectionListener& inListener, sLONG inGroup ) :
+	VTask ( NULL, 0, XBOX::eTaskStylePreemptive, NULL ),
+	fListener ( inListener ),
+	fGroup ( inGroup )
+	{
+		SetKind ( kServerNetTaskKind );
+		SetKindData ( kSNET_ConnectionListenerTaskKindData );
+	}
+	
+	protected :
+	
+	virtual Boolean DoRun ( )
+	{
+		while ( GetState ( ) != TS_DYING && GetState ( ) != TS_DEAD && fListener. fSockListener )
+		{
+			StDropErrorContext errCtx;
+			
+			XTCPSock* xsock = fListener. fSockListener-> GetNewConnectedSocket ( 100 /*ms*/, fGroup );
+			if ( xsock )
+				fListener. HandleConnectedSocket ( xsock );
+		}
+		
+		return false;
+	}
+	
+	VTCPConnectionListener&								fListener;
+	sLONG												fGroup;
+};
+
+
 VTCPConnectionListener::VTCPConnectionListener ( IRequestLogger* inRequestLogger ) :
 VTask ( NULL, 0, XBOX::eTaskStylePreemptive, NULL ),
 fFactories ( ),
 fCertificatePath ( ),
-fKeyPath ( )
+fKeyPath ( ),
+fAcceptTasks ( )
 {
 	fRequestLogger = inRequestLogger;
 	fSockListener = NULL;
 	fWorkerPool = NULL;
 	fSelectIOPool = NULL;
+	fAcceptTaskCount = 1;
 
 	fCertificate.Clear();
 	fKey.Clear();
@@ -215,6 +252,16 @@ void VTCPConnectionListener::SetSSLKeyAndCertificate ( VString const & inCertifi
 	fKey = inKey;
 }
 
+VError VTCPConnectionListener::SetAcceptTaskCount ( sLONG inCount )
+{
+	if ( fSockListener )
+		return VE_INVALID_PARAMETER;
+	
+	fAcceptTaskCount = ( inCount > 1 ) ? inCount : 1;
+	
+	return VE_OK;
+}
+
 VError VTCPConnectionListener::StartListening ( )
 {
 	StTmpErrorContext errCtx;
@@ -275,8 +322,23 @@ VError VTCPConnectionListener::StartListening ( )
 	
 	if ( vError == VE_OK )
 	{
+		fSockListener-> SetAcceptGroupCount ( fAcceptTaskCount );
+		
 		if ( fSockListener-> StartListening ( ) )
+		{
+			/* This task accepts from group 0, one more task per extra group. */
+			for ( sLONG g = 1; g < fSockListener-> GetAcceptGroupCount ( ); g++ )
+			{
+				VTCPAcceptTask*		acceptTask = new VTCPAcceptTask ( *this, g );
+				VString				vstrName ( "ServerNet Connection Listener " );
+				vstrName. AppendLong ( g );
+				acceptTask-> SetName ( vstrName );
+				acceptTask-> Run ( );
+				fAcceptTasks. push_back ( acceptTask );
+			}
+			
 			Run ( );
+		}
 		else
 			vError = ThrowNetError ( VE_SRVR_FAILED_TO_START_LISTENER );
 	}
@@ -307,6 +369,24 @@ VError VTCPConnectionListener::StopListening ( )
 
 void VTCPConnectionListener::DeInit ( )
 {
+	/* Extra accept tasks use the socket listener, the factories and the pools : wait for them first, without
+	a timeout since nothing may be freed while one of them is still alive. They poll their state every 100 ms. */
+	std::vector<VTCPAcceptTask*>::iterator						iterTask = fAcceptTasks. begin ( );
+	while ( iterTask != fAcceptTasks. end ( ) )
+	{
+		( *iterTask )-> Kill ( );
+		iterTask++;
+	}
+	iterTask = fAcceptTasks. begin ( );
+	while ( iterTask != fAcceptTasks. end ( ) )
+	{
+		while ( !( *iterTask )-> WaitForDeath ( 1000 ) )
+			;
+		( *iterTask )-> Release ( );
+		iterTask++;
+	}
+	fAcceptTasks. clear ( );
+	
 	if ( fSockListener )
 	{
 		fSockListener-> StopListeningAndClearPorts();
@@ -340,14 +420,10 @@ void VTCPConnectionListener::DeInit ( )
 
 Boolean VTCPConnectionListener::DoRun ( )
 {
-	VError							vError = VE_OK;
-	
 	if ( fRequestLogger != 0 )
 		fRequestLogger-> Log ( 'SRNT', 0, "SERVER_NET::VTCPConnectionListener::DoRun()::Enter", 1 );
 	
 	uLONG							nIdlePeriod = VSystem::GetCurrentTime ( );
-	std::vector<PortNumber>				vctrPorts;
-	std::vector<PortNumber>::iterator	iterPort;
 	while ( GetState ( ) != TS_DYING && GetState ( ) != TS_DEAD && fSockListener )
 	{
 		StDropErrorContext errCtx;
@@ -355,69 +431,7 @@ Boolean VTCPConnectionListener::DoRun ( )
 		XTCPSock* xsock = fSockListener-> GetNewConnectedSocket(100 /*ms*/);
 		if ( xsock )
 		{
-			if ( fRequestLogger != 0 )
-				fRequestLogger-> Log ( 'SRNT', 0, "SERVER_NET::VTCPConnectionListener::DoRun()::NewConnectionAccepted", VSystem::GetCurrentTime ( ) );
-			
-			VTCPEndPoint*		vtcpEndPoint = new VTCPEndPoint ( xsock, fSelectIOPool );
-#if EXCHANGE_ENDPOINT_ID
-			static sLONG		nIDGenerator = 0;
-			nIDGenerator++;
-			vError = vtcpEndPoint-> WriteExactly ( &nIDGenerator, sizeof ( sLONG ), 60 * 1000 );
-			vtcpEndPoint-> SetID ( nIDGenerator );
-			xbox_assert ( vError == VE_OK );
-#endif
-			
-			/* PLAN: Need to locate an appropriate factory, create new handler,
-			 give it the end point and then transfer handler to the thread pool
-			 for execution. */
-			
-			VTCPConnectionHandlerFactory*								vtcpCHFactory = NULL;
-			std::vector<VTCPConnectionHandlerFactory*>::iterator		iter = fFactories. begin ( );
-			while ( iter != fFactories. end ( ) )
-			{
-				vtcpCHFactory = *iter;
-				vctrPorts. clear ( );
-				vtcpCHFactory-> GetPorts ( vctrPorts );
-				iterPort = std::find ( vctrPorts. begin ( ), vctrPorts. end ( ), xsock-> GetPort ( ) );
-				if ( iterPort != vctrPorts. end ( ) )
-					break;
-				
-				vtcpCHFactory = NULL;
-				iter++;
-			}
-			if ( !vtcpCHFactory )
-			{
-				if ( fRequestLogger != 0 )
-					fRequestLogger-> Log ( 'SRNT', 0, "SERVER_NET::VTCPConnectionListener::DoRun()::ERROR::CONNECTION FACTORY NOT FOUND", VSystem::GetCurrentTime ( ) );
-
-				vtcpEndPoint-> Close ( );
-				vtcpEndPoint-> Release ( );
-				
-				continue;
-			}
-			
-			VConnectionHandler*						vcHandler = vtcpCHFactory-> CreateConnectionHandler ( vError );
-			if ( vcHandler == 0 )
-			{
-				if ( fRequestLogger != 0 )
-					fRequestLogger-> Log ( 'SRNT', 0, "SERVER_NET::VTCPConnectionListener::DoRun()::ERROR::FAILED TO CREATE CONNECTION HANDLER", VSystem::GetCurrentTime ( ) );
-
-				vtcpEndPoint-> Close ( );
-				vtcpEndPoint-> Release ( );
-				
-				continue;
-			}
-			
-			vcHandler-> _ResetRedistributionCount ( );
-			
-			vcHandler-> SetEndPoint ( vtcpEndPoint );
-			
-			/* Transfer vcHandler to the thread pool for execution. */
-			if ( fWorkerPool )
-				fWorkerPool-> AddConnectionHandler ( vcHandler );
-			
-			if ( fRequestLogger != 0 )
-				fRequestLogger-> Log ( 'SRNT', 0, "SERVER_NET::VTCPConnectionListener::DoRun()::New connection is being handled", VSystem::GetCurrentTime ( ) );
+			HandleConnectedSocket ( xsock );
 		}
 		else
 		{
@@ -436,6 +450,77 @@ Boolean VTCPConnectionListener::DoRun ( )
 	return false;
 }
 
+void VTCPConnectionListener::HandleConnectedSocket ( XTCPSock* xsock )
+{
+	VError							vError = VE_OK;
+	std::vector<PortNumber>				vctrPorts;
+	std::vector<PortNumber>::iterator	iterPort;
+	
+	if ( fRequestLogger != 0 )
+		fRequestLogger-> Log ( 'SRNT', 0, "SERVER_NET::VTCPConnectionListener::DoRun()::NewConnectionAccepted", VSystem::GetCurrentTime ( ) );
+	
+	VTCPEndPoint*		vtcpEndPoint = new VTCPEndPoint ( xsock, fSelectIOPool );
+#if EXCHANGE_ENDPOINT_ID
+	static sLONG		nIDGenerator = 0;
+	sLONG				nID = VInterlocked::Increment ( &nIDGenerator );
+	vError = vtcpEndPoint-> WriteExactly ( &nID, sizeof ( sLONG ), 60 * 1000 );
+	vtcpEndPoint-> SetID ( nID );
+	xbox_assert ( vError == VE_OK );
+#endif
+	
+	/* PLAN: Need to locate an appropriate factory, create new handler,
+	 give it the end point and then transfer handler to the thread pool
+	 for execution. */
+	
+	VTCPConnectionHandlerFactory*								vtcpCHFactory = NULL;
+	std::vector<VTCPConnectionHandlerFactory*>::iterator		iter = fFactories. begin ( );
+	while ( iter != fFactories. end ( ) )
+	{
+		vtcpCHFactory = *iter;
+		vctrPorts. clear ( );
+		vtcpCHFactory-> GetPorts ( vctrPorts );
+		iterPort = std::find ( vctrPorts. begin ( ), vctrPorts. end ( ), xsock-> GetPort ( ) );
+		if ( iterPort != vctrPorts. end ( ) )
+			break;
+		
+		vtcpCHFactory = NULL;
+		iter++;
+	}
+	if ( !vtcpCHFactory )
+	{
+		if ( fRequestLogger != 0 )
+			fRequestLogger-> Log ( 'SRNT', 0, "SERVER_NET::VTCPConnectionListener::DoRun()::ERROR::CONNECTION FACTORY NOT FOUND", VSystem::GetCurrentTime ( ) );
+
+		vtcpEndPoint-> Close ( );
+		vtcpEndPoint-> Release ( );
+		
+		return;
+	}
+	
+	VConnectionHandler*						vcHandler = vtcpCHFactory-> CreateConnectionHandler ( vError );
+	if ( vcHandler == 0 )
+	{
+		if ( fRequestLogger != 0 )
+			fRequestLogger-> Log ( 'SRNT', 0, "SERVER_NET::VTCPConnectionListener::DoRun()::ERROR::FAILED TO CREATE CONNECTION HANDLER", VSystem::GetCurrentTime ( ) );
+
+		vtcpEndPoint-> Close ( );
+		vtcpEndPoint-> Release ( );
+		
+		return;
+	}
+	
+	vcHandler-> _ResetRedistributionCount ( );
+	
+	vcHandler-> SetEndPoint ( vtcpEndPoint );
+	
+	/* Transfer vcHandler to the thread pool for execution. */
+	if ( fWorkerPool )
+		fWorkerPool-> AddConnectionHandler ( vcHandler );
+	
+	if ( fRequestLogger != 0 )
+		fRequestLogger-> Log ( 'SRNT', 0, "SERVER_NET::VTCPConnectionListener::DoRun()::New connection is being handled", VSystem::GetCurrentTime ( ) );
+}
+
 VError VTCPConnectionListener::AddConnectionHandlerFactory ( VConnectionHandlerFactory* inFactory )
 {
 	VTCPConnectionHandlerFactory*			vtcpCHFactory = dynamic_cast<VTCPConnectionHandlerFactory*>( inFactory );
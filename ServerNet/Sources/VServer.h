@@ -50,6 +50,7 @@ class XTOOLBOX_API VServer : public VObject, public IRefCountable
 
 
 class VWorkerPool;
+class VTCPAcceptTask;
 
 class XTOOLBOX_API VTCPConnectionListener : public IConnectionListener, public VTask
 {
@@ -72,12 +73,22 @@ class XTOOLBOX_API VTCPConnectionListener : public IConnectionListener, public V
 	virtual void SetSSLCertificatePaths ( VString const & inCertificatePath, VString const & inKeyPath );
 	virtual void SetSSLKeyAndCertificate ( VString const & inCertificate, VString const &inKey);
 	
+	/* Number of tasks accepting connections, each with its own SO_REUSEPORT listening sockets (see
+	WITH_REUSEPORT_LISTENERS ; otherwise there is always one). To be called before StartListening ( ). */
+	virtual VError SetAcceptTaskCount ( sLONG inCount );
+	
 	protected :
 	
+	friend class VTCPAcceptTask;
+	
 	virtual Boolean DoRun ( );
 	
 	virtual void DeInit ( );
 	
+	/* Finds the factory for the socket port and hands a new connection handler to the worker pool.
+	May be called by several accept tasks at the same time. */
+	virtual void HandleConnectedSocket ( XTCPSock* inSock );
+	
 	IRequestLogger*										fRequestLogger;
 	std::vector<VTCPConnectionHandlerFactory*>			fFactories;
 	VSockListener*										fSockListener;
@@ -87,6 +98,8 @@ class XTOOLBOX_API VTCPConnectionListener : public IConnectionListener, public V
 	VString												fKeyPath;
 	VString												fCertificate;
 	VString												fKey;
+	sLONG												fAcceptTaskCount;
+	std::vector<VTCPAcceptTask*>						fAcceptTasks;
 };
 
 
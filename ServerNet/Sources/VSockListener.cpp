@@ -33,10 +33,12 @@ public:
 
 #if WITH_DEPRECATED_IPV4_API
 	XSBind(IP4 inAddr, PortNumber inPort, IRequestLogger* inRequestLogger=NULL, sLONG inBoundSock=kBAD_SOCKET) :
-	fAddr(inAddr), fPort(inPort), fRequestLogger(inRequestLogger), fIsSSL(false), fBoundSock(inBoundSock), fSock(NULL) { }
+	fAddr(inAddr), fPort(inPort), fRequestLogger(inRequestLogger), fIsSSL(false), fBoundSock(inBoundSock), fSock(NULL),
+	fReusePort(false), fGroup(0) { }
 #else
 	XSBind(const VNetAddress& inAddr, IRequestLogger* inRequestLogger=NULL, sLONG inBoundSock=kBAD_SOCKET) :
-	fAddr(inAddr), fRequestLogger(inRequestLogger), fIsSSL(false), fBoundSock(inBoundSock), fSock(NULL) { }
+	fAddr(inAddr), fRequestLogger(inRequestLogger), fIsSSL(false), fBoundSock(inBoundSock), fSock(NULL),
+	fReusePort(false), fGroup(0) { }
 #endif	
 	
 	virtual ~XSBind()						{ if(fSock!=NULL) fSock->Close(), delete fSock; }
@@ -61,12 +63,37 @@ public:
 	
 	XTCPSock* GetSock()						{ return fSock; }
 	
+	bool IsBound()							{ return fBoundSock!=kBAD_SOCKET; }
+	
+	sLONG GetGroup()						{ return fGroup; }
+	
+	//Another bind on the same address and port, for accept group inGroup ; both use SO_REUSEPORT.
+	XSBind* NewSiblingBind(sLONG inGroup)
+	{
+#if WITH_DEPRECATED_IPV4_API
+		XSBind* bind=new XSBind(fAddr, fPort, fRequestLogger);
+#else
+		XSBind* bind=new XSBind(fAddr, fRequestLogger);
+#endif
+		bind->fIsSSL=fIsSSL;
+		bind->fReusePort=true;
+		bind->fGroup=inGroup;
+		
+		fReusePort=true;
+		
+		return bind;
+	}
+	
 	VError Publish()
 	{
 		StTmpErrorContext errCtx;
 
-#if WITH_DEPRECATED_IPV4_API
+#if WITH_DEPRECATED_IPV4_API && WITH_REUSEPORT_LISTENERS
+		XTCPSock* sock=XTCPSock::NewServerListeningSock(GetAddress(), GetPort(), fBoundSock, fReusePort);
+#elif WITH_DEPRECATED_IPV4_API
 		XTCPSock* sock=XTCPSock::NewServerListeningSock(GetAddress(), GetPort(), fBoundSock);
+#elif WITH_REUSEPORT_LISTENERS
+		XTCPSock* sock=XTCPSock::NewServerListeningSock(fAddr, fBoundSock, fReusePort);
 #else
 		XTCPSock* sock=XTCPSock::NewServerListeningSock(fAddr, fBoundSock);
 #endif
@@ -95,17 +122,24 @@ private:
 	bool			fIsSSL;
 	sLONG			fBoundSock;
 	XTCPSock*	fSock;
+	bool			fReusePort;
+	sLONG			fGroup;
 };
 
 
 VSockListener::VSockListener(IRequestLogger* inRequestLogger) :
-fRequestLogger(inRequestLogger), fListenStarted(false), fAcceptTimeout(0), fKeyCertPair(NULL)
-{}
+fRequestLogger(inRequestLogger), fAcceptGroupCount(1), fListenStarted(false), fAcceptTimeout(0), fKeyCertPair(NULL)
+{
+	fAcceptIterators.push_back(new XTCPAcceptIterator);
+}
 
 
 VSockListener::~VSockListener()
 {
 	StopListeningAndClearPorts();
+	
+	std::for_each(fAcceptIterators.begin(), fAcceptIterators.end(), del_fun<XTCPAcceptIterator>()); 
+	fAcceptIterators.clear();
 }
 
 
@@ -246,6 +280,31 @@ bool VSockListener::StartListening()
 	
 	if (!fListenStarted)
 	{
+		while ( fAcceptIterators. size ( ) < static_cast<size_t> ( fAcceptGroupCount ) )
+			fAcceptIterators. push_back ( new XTCPAcceptIterator );
+		
+		if ( fAcceptGroupCount > 1 )
+		{
+			/* One more listening socket per port and per extra group. */
+			std::vector<XSBind*>*			lists [ ] = { &fPlainListens, &fSslListens };
+			
+			for ( sLONG l = 0; l < 2; l++ )
+			{
+				std::vector<XSBind*>::size_type	nCount = lists [ l ]-> size ( );
+				
+				for ( std::vector<XSBind*>::size_type i = 0; i < nCount; i++ )
+				{
+					XSBind*					bind = ( *lists [ l ] ) [ i ];
+					
+					if ( bind-> IsBound ( ) )
+						continue;
+					
+					for ( sLONG g = 1; g < fAcceptGroupCount; g++ )
+						lists [ l ]-> push_back ( bind-> NewSiblingBind ( g ) );
+				}
+			}
+		}
+		
 		l_res = true;
 		std::vector<XSBind*>::iterator		iterBind = fPlainListens. begin ( );
 		while ( iterBind != fPlainListens. end ( ) )
@@ -253,7 +312,7 @@ bool VSockListener::StartListening()
 			if ( !( l_res = ( ( *iterBind )-> Publish ( ) == VE_OK ) ) )
 				break;
 			
-			fAcceptIterator.AddServiceSocket((*iterBind)->GetSock());
+			fAcceptIterators[(*iterBind)->GetGroup()]->AddServiceSocket((*iterBind)->GetSock());
 			
 			iterBind++;
 		}
@@ -270,7 +329,7 @@ bool VSockListener::StartListening()
 					break;
 				}
 				
-				fAcceptIterator.AddServiceSocket((*iterBind)->GetSock());
+				fAcceptIterators[(*iterBind)->GetGroup()]->AddServiceSocket((*iterBind)->GetSock());
 				
 				iterBind++;
 			}
@@ -290,7 +349,8 @@ void VSockListener::StopListeningAndClearPorts()
 	std::for_each(fSslListens.begin(), fSslListens.end(), del_fun<XSBind>()); 
 	fSslListens.clear();
 	
-	fAcceptIterator.ClearServiceSockets();
+	for(std::vector<XTCPAcceptIterator*>::iterator it=fAcceptIterators.begin() ; it!=fAcceptIterators.end() ; ++it)
+		(*it)->ClearServiceSockets();
 	
 	fListenStarted = false;
 }
@@ -302,6 +362,22 @@ void VSockListener::setAcceptTimeout(uLONG inMsTimeout)
 }
 
 
+void VSockListener::SetAcceptGroupCount(sLONG inCount)
+{
+	assert(!fListenStarted);
+	
+#if WITH_REUSEPORT_LISTENERS
+	fAcceptGroupCount=(inCount>1) ? inCount : 1;
+#endif
+}
+
+
+sLONG VSockListener::GetAcceptGroupCount() const
+{
+	return fAcceptGroupCount;
+}
+
+
 bool VSockListener::SetBlocking (bool isBlocking)
 {
 	for (uLONG i = 0; i < fPlainListens.size(); ++i)
@@ -319,13 +395,15 @@ bool VSockListener::SetBlocking (bool isBlocking)
 }
 
 
-XTCPSock* VSockListener::GetNewConnectedSocket(sLONG inMsTimeout)
+XTCPSock* VSockListener::GetNewConnectedSocket(sLONG inMsTimeout, sLONG inGroup)
 {
+	xbox_assert(inGroup>=0 && inGroup<static_cast<sLONG>(fAcceptIterators.size()));
+	
 	StTmpErrorContext errCtx;
 	
 	XTCPSock* sock=NULL;
 	
-	VError verr=fAcceptIterator.GetNewConnectedSocket(&sock, inMsTimeout);
+	VError verr=fAcceptIterators[inGroup]->GetNewConnectedSocket(&sock, inMsTimeout);
 	
 	if(sock!=NULL && verr==VE_OK)
 	{
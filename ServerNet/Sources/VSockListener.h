@@ -55,7 +55,14 @@ public:
 	void setAcceptTimeout(uLONG inMsTimeout);
 	bool SetBlocking (bool isBlocking = false);
 	
-	XTCPSock* GetNewConnectedSocket(sLONG inMsTimeout);
+	//Opens inCount SO_REUSEPORT listening sockets per port (not for already bound sockets), as inCount groups
+	//with their own accept iterator, so that as many tasks may accept connections concurrently.
+	//To be called before StartListening() ; always 1 without WITH_REUSEPORT_LISTENERS.
+	void SetAcceptGroupCount(sLONG inCount);
+	sLONG GetAcceptGroupCount() const;
+	
+	//Each group must be used by a single task at a time.
+	XTCPSock* GetNewConnectedSocket(sLONG inMsTimeout, sLONG inGroup=0);
 	
 	void ReleaseConnection(XTCPSock* in);
 	
@@ -69,7 +76,8 @@ private:
 	
 	std::vector<XSBind*> fPlainListens;
 	std::vector<XSBind*> fSslListens;
-	XTCPAcceptIterator fAcceptIterator;
+	std::vector<XTCPAcceptIterator*> fAcceptIterators;
+	sLONG fAcceptGroupCount;
 	bool fListenStarted;
 	uLONG fId;
 	uLONG fAcceptTimeout;
@@ -32,6 +32,14 @@ BEGIN_TOOLBOX_NAMESPACE
 #define WITH_SNET_SSL_LOG 0
 
 
+//Bounds for the server (OpenSSL internal) and client (host:port) session caches.
+const long kSERVER_SESSION_CACHE_SIZE=10*1024;
+const sLONG kCLIENT_SESSION_CACHE_SIZE=256;
+
+//Default server session id context ; connections using their own key/cert pair get a context of their own.
+static const unsigned char sSessionIdContext[]="SNET_SSL";
+
+
 //TODO : Legacy code ; Need rewrite
 const int RSA_PKCS1_PADDING_LEN=11;
 
@@ -145,6 +153,18 @@ VError SslFramework::XContext::Init()
 	if(fOpenSSLContext==NULL)
 	{
 		fOpenSSLContext=SSLSTUB::SSL_CTX_new(SSLSTUB::SSLv23_method());
+		
+		if(fOpenSSLContext!=NULL)
+		{
+			//Server side resumption : session ids live in the OpenSSL internal cache (bounded, and protected by
+			//LockingProc) ; session tickets are left enabled, as they are by default.
+			
+			SSLSTUB::SSL_CTX_set_session_cache_mode(fOpenSSLContext, SSL_SESS_CACHE_SERVER);
+			
+			SSLSTUB::SSL_CTX_sess_set_cache_size(fOpenSSLContext, kSERVER_SESSION_CACHE_SIZE);
+			
+			SSLSTUB::SSL_CTX_set_session_id_context(fOpenSSLContext, sSessionIdContext, sizeof(sSessionIdContext)-1);
+		}
 	}
 	
 	return fLocks!=NULL && fOpenSSLContext!=NULL ? VE_OK : VE_SSL_FRAMEWORK_INIT_FAILED;
@@ -271,6 +291,134 @@ VError SslFramework::XContext::SetDefaultPrivateKey(const VMemoryBuffer<>& inKey
 
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// VSslClientSessionCache
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//Client sessions, one per peer (host:port), so that reconnecting to the same server skips the full handshake.
+//The cache is bounded : the least recently used session is dropped when it's full.
+
+class VSslClientSessionCache : public VObject
+{
+public :
+	
+	VSslClientSessionCache(sLONG inMaxCount) : fMaxCount(inMaxCount), fStamp(0) {}
+	
+	virtual ~VSslClientSessionCache();
+	
+	//SSL_set_session() takes its own reference, so the session never leaves the lock without one.
+	bool ApplySession(const VString& inKey, SSL* inConnection);
+	
+	void StoreSession(const VString& inKey, SSL* inConnection);
+	void RemoveSession(const VString& inKey);
+	void Clear();
+	
+private :
+	
+	VSslClientSessionCache(const VSslClientSessionCache& inUnused);
+	VSslClientSessionCache& operator=(const VSslClientSessionCache& inUnused);
+	
+	typedef struct
+	{
+		SSL_SESSION*	fSession;
+		uLONG			fStamp;
+	} Entry;
+	
+	typedef std::map<VString, Entry> SessionMap;
+	
+	VCriticalSection	fLock;
+	SessionMap			fSessions;
+	sLONG				fMaxCount;
+	uLONG				fStamp;
+};
+
+
+//virtual
+VSslClientSessionCache::~VSslClientSessionCache()
+{
+	Clear();
+}
+
+
+bool VSslClientSessionCache::ApplySession(const VString& inKey, SSL* inConnection)
+{
+	StLocker<VCriticalSection> lock(&fLock);
+	
+	SessionMap::iterator it=fSessions.find(inKey);
+	
+	if(it==fSessions.end())
+		return false;
+	
+	it->second.fStamp=++fStamp;
+	
+	return SSLSTUB::SSL_set_session(inConnection, it->second.fSession)==1;
+}
+
+
+void VSslClientSessionCache::StoreSession(const VString& inKey, SSL* inConnection)
+{
+	SSL_SESSION* session=SSLSTUB::SSL_get1_session(inConnection);
+	
+	if(session==NULL)
+		return;
+	
+	StLocker<VCriticalSection> lock(&fLock);
+	
+	SessionMap::iterator it=fSessions.find(inKey);
+	
+	if(it!=fSessions.end())
+	{
+		SSLSTUB::SSL_SESSION_free(it->second.fSession);
+	}
+	else if(fSessions.size()>=static_cast<size_t>(fMaxCount) && !fSessions.empty())
+	{
+		SessionMap::iterator oldest=fSessions.begin();
+		
+		for(SessionMap::iterator cur=fSessions.begin() ; cur!=fSessions.end() ; ++cur)
+		{
+			if(cur->second.fStamp<oldest->second.fStamp)
+				oldest=cur;
+		}
+		
+		SSLSTUB::SSL_SESSION_free(oldest->second.fSession);
+		fSessions.erase(oldest);
+	}
+	
+	Entry& entry=fSessions[inKey];
+	
+	entry.fSession=session;
+	entry.fStamp=++fStamp;
+}
+
+
+void VSslClientSessionCache::RemoveSession(const VString& inKey)
+{
+	StLocker<VCriticalSection> lock(&fLock);
+	
+	SessionMap::iterator it=fSessions.find(inKey);
+	
+	if(it!=fSessions.end())
+	{
+		SSLSTUB::SSL_SESSION_free(it->second.fSession);
+		fSessions.erase(it);
+	}
+}
+
+
+void VSslClientSessionCache::Clear()
+{
+	StLocker<VCriticalSection> lock(&fLock);
+	
+	for(SessionMap::iterator it=fSessions.begin() ; it!=fSessions.end() ; ++it)
+		SSLSTUB::SSL_SESSION_free(it->second.fSession);
+	
+	fSessions.clear();
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // SslFramework
@@ -281,6 +429,11 @@ VError SslFramework::XContext::SetDefaultPrivateKey(const VMemoryBuffer<>& inKey
 namespace SslFramework
 {
 	SslFramework::XContext* gContext=NULL;
+	
+	VSslClientSessionCache* gClientSessions=NULL;
+	
+	sLONG gFullHandShakes=0;
+	sLONG gResumedHandShakes=0;
 }
 
 
@@ -304,6 +457,9 @@ VError SslFramework::Init()
 	if(verr!=VE_OK)
 		return VE_SSL_FRAMEWORK_INIT_FAILED;
 	
+	if(gClientSessions==NULL)
+		gClientSessions=new VSslClientSessionCache(kCLIENT_SESSION_CACHE_SIZE);
+	
 	SSLSTUB::CRYPTO_set_id_callback(SslFramework::XContext::ThreadIdProc);
 
 	SSLSTUB::CRYPTO_set_locking_callback(SslFramework::XContext::LockingProc);
@@ -331,6 +487,12 @@ VError SslFramework::DeInit()
 	
 	SSLSTUB::ERR_free_strings();
 	
+	if(gClientSessions!=NULL)
+	{
+		delete gClientSessions;
+		gClientSessions=NULL;
+	}
+	
 	SSL_CTX* sslCtx=GetContext()->GetOpenSSLContext();
 	
 	if(sslCtx!=NULL)
@@ -369,6 +531,28 @@ SslFramework::XContext* SslFramework::GetContext()
 }
 
 
+//static
+void SslFramework::GetHandshakeCounters(sLONG* outFullHandshakes, sLONG* outResumedHandshakes)
+{
+	if(outFullHandshakes!=NULL)
+		*outFullHandshakes=VInterlocked::AtomicGet(&gFullHandShakes);
+	
+	if(outResumedHandshakes!=NULL)
+		*outResumedHandshakes=VInterlocked::AtomicGet(&gResumedHandShakes);
+}
+
+
+//static
+void SslFramework::FlushSessionCaches()
+{
+	if(gContext!=NULL)
+		SSLSTUB::SSL_CTX_flush_sessions(gContext->GetOpenSSLContext(), 0);
+	
+	if(gClientSessions!=NULL)
+		gClientSessions->Clear();
+}
+
+
 class VKeyCertPair : public IRefCountable
 {
 private : 
@@ -378,14 +562,20 @@ private :
 	RSA*	fPrivateKey;
 	X509*	fCertificate;
 	
+	unsigned char	fSessionIdContext[SSL_MAX_SID_CTX_LENGTH];	//Digest of the certificate
+	unsigned int	fSessionIdContextLength;
+	
 public :
-	VKeyCertPair() : fPrivateKey(NULL), fCertificate(NULL) {}
+	VKeyCertPair() : fPrivateKey(NULL), fCertificate(NULL), fSessionIdContextLength(0) {}
 	~VKeyCertPair() {SSLSTUB::RSA_free(fPrivateKey); SSLSTUB::X509_free(fCertificate);}
 
 	VError Init(const VMemoryBuffer<>& inKeyBuffer, const VMemoryBuffer<>& inCertBuffer);
 	
 	RSA* GetPrivateKey()	{return fPrivateKey;}
 	X509* GetCertificate()	{return fCertificate;}
+	
+	const unsigned char* GetSessionIdContext()	{return fSessionIdContext;}
+	unsigned int GetSessionIdContextLength()	{return fSessionIdContextLength;}
 };
 
 
@@ -437,6 +627,24 @@ VError VKeyCertPair::Init(const VMemoryBuffer<>& inKeyBuffer, const VMemoryBuffe
 			verr=VE_SSL_FAIL_TO_GET_CERTIFICATE;
 	}	
 	
+	if(verr==VE_OK)
+	{
+		//Sessions are bound to the certificate (SHA-1 of its DER encoding), which identifies it across pairs and runs.
+		
+		unsigned char digest[EVP_MAX_MD_SIZE];
+		unsigned int digestLength=0;
+		
+		if(SSLSTUB::X509_digest(fCertificate, SSLSTUB::EVP_sha1(), digest, &digestLength)==1)
+		{
+			fSessionIdContextLength=(digestLength<SSL_MAX_SID_CTX_LENGTH) ? digestLength : SSL_MAX_SID_CTX_LENGTH;
+			memcpy(fSessionIdContext, digest, fSessionIdContextLength);
+		}
+		else
+		{
+			verr=VE_SSL_FAIL_TO_GET_CERTIFICATE;
+		}
+	}
+	
 	SSLSTUB::BIO_free(buf);
 	
 	if(verr!=VE_OK)
@@ -621,7 +829,7 @@ SSL* VSslDelegate::XConnection::GetConnection()
 //
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-VSslDelegate::VSslDelegate() : fConnection(NULL), fKeyCertPair(NULL)
+VSslDelegate::VSslDelegate() : fConnection(NULL), fKeyCertPair(NULL), fHandShakeDone(false)
 {
 	fConnection=new XConnection();
 }
@@ -673,7 +881,7 @@ VSslDelegate* VSslDelegate::NewDelegate(Socket inRawSocket)
 
 
 //static
-VSslDelegate* VSslDelegate::NewClientDelegate(Socket inRawSocket)
+VSslDelegate* VSslDelegate::NewClientDelegate(Socket inRawSocket, const VString* inSessionKey)
 {
 	SSLSTUB::ERR_clear_error();
 	
@@ -684,6 +892,13 @@ VSslDelegate* VSslDelegate::NewClientDelegate(Socket inRawSocket)
 		SSL* conn=delegate->fConnection->GetConnection();
 		
 		SSLSTUB::SSL_set_connect_state(conn);
+		
+		if(inSessionKey!=NULL && !inSessionKey->IsEmpty() && SslFramework::gClientSessions!=NULL)
+		{
+			delegate->fSessionKey=*inSessionKey;
+			
+			SslFramework::gClientSessions->ApplySession(*inSessionKey, conn);
+		}
 	}
 	
 	return delegate;
@@ -719,6 +934,16 @@ VSslDelegate* VSslDelegate::NewServerDelegate(Socket inRawSocket, VKeyCertPair*
 					verr=VE_SSL_FAIL_TO_SET_PRIVATE_KEY;
 			}
 			
+			if(verr==VE_OK)
+			{
+				//Sessions negotiated with one certificate must not be resumed with another one.
+				
+				res=SSLSTUB::SSL_set_session_id_context(conn, inKeyCertPair->GetSessionIdContext(), inKeyCertPair->GetSessionIdContextLength());
+				
+				if(res!=1)
+					verr=VE_SSL_NEW_CONTEXT_FAILED;
+			}
+			
 			if(verr==VE_OK)
 			{
 				delegate->fKeyCertPair=inKeyCertPair;
@@ -746,8 +971,12 @@ VError VSslDelegate::HandShake ()
 	// because connection negociation is pending. It will complete in an
 	// asynchronous way.
 
-	if ((r = SSLSTUB::SSL_connect(fConnection->GetConnection())) == 1
-	|| SSLSTUB::SSL_get_error(fConnection->GetConnection(), r) == SSL_ERROR_WANT_READ)
+	if ((r = SSLSTUB::SSL_connect(fConnection->GetConnection())) == 1) {
+	
+		HandShakeCompleted();
+		return XBOX::VE_OK;
+		
+	} else if (SSLSTUB::SSL_get_error(fConnection->GetConnection(), r) == SSL_ERROR_WANT_READ)
 		
 		return XBOX::VE_OK;
 
@@ -756,6 +985,31 @@ VError VSslDelegate::HandShake ()
 		return XBOX::VE_ACCESS_DENIED;		
 }
 
+void VSslDelegate::HandShakeCompleted()
+{
+	//Called once, on the first successful handshake or I/O.
+	
+	if(fHandShakeDone)
+		return;
+	
+	fHandShakeDone=true;
+	
+	SSL* conn=fConnection->GetConnection();
+	
+	if(SSLSTUB::SSL_session_reused(conn))
+	{
+		VInterlocked::Increment(&SslFramework::gResumedHandShakes);
+	}
+	else
+	{
+		VInterlocked::Increment(&SslFramework::gFullHandShakes);
+		
+		if(!fSessionKey.IsEmpty() && SslFramework::gClientSessions!=NULL)
+			SslFramework::gClientSessions->StoreSession(fSessionKey, conn);
+	}
+}
+
+
 sLONG VSslDelegate::GetBufferedDataLen()
 {
 	SSL* conn=fConnection->GetConnection();
@@ -791,6 +1045,9 @@ VError VSslDelegate::Read(void* outBuff, uLONG* ioLen)
 	if(res>0)
 	{
 		*ioLen=res;
+		
+		if(!fHandShakeDone)
+			HandShakeCompleted();
 
 	#if VERSIONDEBUG && WITH_SNET_SSL_LOG
 		
@@ -833,7 +1090,10 @@ VError VSslDelegate::Read(void* outBuff, uLONG* ioLen)
 		return VE_SOCK_WOULD_BLOCK;
 	}
 
-	//We have an error...
+	//We have an error... Don't try to resume a session that may be the cause of a failed handshake.
+	
+	if(!fHandShakeDone && !fSessionKey.IsEmpty() && SslFramework::gClientSessions!=NULL)
+		SslFramework::gClientSessions->RemoveSession(fSessionKey);
 	
 	return vThrowThreadErrorStack(VE_SSL_READ_FAILED);
 }
@@ -865,6 +1125,9 @@ VError VSslDelegate::Write(const void* inBuff, uLONG* ioLen)
 	{
 		*ioLen=res;
 		
+		if(!fHandShakeDone)
+			HandShakeCompleted();
+		
 		return VE_OK;
 	}
 	
@@ -897,6 +1160,9 @@ VError VSslDelegate::Write(const void* inBuff, uLONG* ioLen)
 	
 	//We have an error...
 	
+	if(!fHandShakeDone && !fSessionKey.IsEmpty() && SslFramework::gClientSessions!=NULL)
+		SslFramework::gClientSessions->RemoveSession(fSessionKey);
+	
 	//Clean SSL protocol termination ? I'd like to see this one !
 	xbox_assert(errCode!=SSL_ERROR_ZERO_RETURN);
 		
@@ -40,6 +40,11 @@ namespace SslFramework
 	VKeyCertPair* RetainKeyCertificatePair(const VMemoryBuffer<>& inKeyBuffer, const VMemoryBuffer<>& inCertBuffer);
 	void ReleaseKeyCertificatePair(VKeyCertPair* inKeyCertPair);
 
+	//Session resumption : servers resume through session ids and tickets, clients keep one session per host:port.
+	//Counters are the number of handshakes completed (fully or by resumption) since Init.
+	void GetHandshakeCounters(sLONG* outFullHandshakes, sLONG* outResumedHandshakes);
+	void FlushSessionCaches();
+
 	//TODO : Legacy Code ; Need rewrite.
 	VError Encrypt(uCHAR* inPrivateKeyPEM, uLONG inPrivateKeyPEMSize, uCHAR* inData, uLONG inDataSize, uCHAR* ioEncryptedData, uLONG* ioEncryptedDataSize);
 	uLONG GetEncryptedPKCS1DataSize( uLONG inKeySize /* 128 for 1024 RSA; X/8 for X RSA*/, uLONG inDataSize );
@@ -52,7 +57,8 @@ class XTOOLBOX_API VSslDelegate : public XBOX::VObject
 {
 public :
 	
-	static VSslDelegate* NewClientDelegate(Socket inRawSocket /*, VKeyCertPair* inKeyCertPair*/);
+	//inSessionKey (typically "host:port") enables session reuse for client connections to the same peer.
+	static VSslDelegate* NewClientDelegate(Socket inRawSocket /*, VKeyCertPair* inKeyCertPair*/, const VString* inSessionKey=NULL);
 	static VSslDelegate* NewServerDelegate(Socket inRawSocket, VKeyCertPair* inKeyCertPair);
 	
 	virtual ~VSslDelegate();	
@@ -82,12 +88,17 @@ private :
 	
 	static VSslDelegate* NewDelegate(Socket inRawSocket);
 	
+	void HandShakeCompleted();
+	
 	//Inner type to hide implementation connection context
 	class XConnection;
 	
 	XConnection* fConnection;
 	
 	VKeyCertPair* fKeyCertPair;
+	
+	VString fSessionKey;
+	bool fHandShakeDone;
 };
 
 
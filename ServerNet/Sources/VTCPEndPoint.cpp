@@ -25,6 +25,7 @@
 	#include "XWinSocket.h"
 #else
 	#include "XBsdSocket.h"
+	#include <poll.h>
 #endif
 
  
@@ -281,7 +282,9 @@ VError VTCPEndPoint::DisableReadCallback ()
 
 	XBOX::VError	error;
 
-	error = fSIOHandler->RemoveSocketForWatching(GetRawSocket());
+	// The pool may have moved the socket to another handler since SetReadCallback().
+
+	error = fSIOPool->RemoveSocketForWatching(GetRawSocket());
 	fSIOHandler = NULL;
 
 	fIsWatching = false;
@@ -328,17 +331,32 @@ VError VTCPEndPoint::_Read_SelectIO ( void *outBuff, uLONG *ioLen, uLONG inTimeO
 		- If the timeout has not been reached since the last read then attempt direct select
 		- If the timeout has been reached then post the socket for reading to fSIOHandler
 	*/
+	int nRawSocket = GetRawSocket ( );
+
+#if VERSIONMAC || VERSION_LINUX
+
+	// Socket may be above FD_SETSIZE (epoll select I/O handlers have no such limit).
+
+	struct pollfd					pfdReadSocket = { 0 };
+	pfdReadSocket. fd = nRawSocket;
+	pfdReadSocket. events = POLLIN;
+
+	int								nSocketsReadyForRead = poll ( &pfdReadSocket, 1, 100 );
+
+#else
+
 	struct timeval					tvTimeout;
 	tvTimeout. tv_sec = 0;
 	tvTimeout. tv_usec = 100000;
 
-	int nRawSocket = GetRawSocket ( );
 	fd_set							fdReadSocket;
 	FD_ZERO ( &fdReadSocket );
 	FD_SET ( nRawSocket, &fdReadSocket );
 
 	int								nSocketsReadyForRead = select ( FD_SETSIZE, &fdReadSocket, 0, 0, &tvTimeout );
 
+#endif
+
 	DEBUG_CHECK_SOCK_RESULT( nSocketsReadyForRead, "select from endpoint", nRawSocket);
 
 	uLONG							nCurrentTime = VSystem::GetCurrentTime ( );
@@ -670,6 +688,230 @@ VError VTCPEndPoint::DoWriteExactly(const void *inBuff, uLONG* ioLen, sLONG inMs
 	return VE_OK;
 }
 
+VError VTCPEndPoint::WriteExactlyV ( const VTCPIOBuffer *inBuffers, sLONG inBufferCount, sLONG inTimeOutMillis )
+{
+	xbox_assert ( !fIsInAutoReconnect || ( fIsInAutoReconnect && fIsInUse ) );
+	
+	if (fSock==NULL)
+		return ReportError( VE_SRVR_NULL_ENDPOINT );
+
+	if ( inBuffers == NULL || inBufferCount < 0 )
+		return ReportError(VE_INVALID_PARAMETER);
+
+#if VERSIONMAC || VERSION_LINUX
+
+	bool withTimeout=(inTimeOutMillis>0);
+	
+	sLONG timeoutMs=inTimeOutMillis;
+	
+	//Same as DoWriteExactly
+	if(!withTimeout && !IsBlocking())
+	{
+		timeoutMs=XBOX::MaxLongInt;
+		withTimeout=true;
+	}
+
+	//Current buffer and count of its bytes already sent ; the rest is passed to the socket as it is.
+	sLONG current=0;
+	uLONG sentInCurrent=0;
+	
+	for(;;)
+	{
+		while ( current < inBufferCount && sentInCurrent >= inBuffers[current].fLength )
+		{
+			current++;
+			sentInCurrent=0;
+		}
+
+		if ( current >= inBufferCount )
+			break;
+
+		//Only the first buffer may be partially sent ; patch it in a copy, and send it with the followers.
+		VTCPIOBuffer buffers[16];
+		sLONG count=0;
+		
+		buffers[count].fData=reinterpret_cast<const char*>(inBuffers[current].fData)+sentInCurrent;
+		buffers[count].fLength=inBuffers[current].fLength-sentInCurrent;
+		count++;
+
+		for ( sLONG i = current+1 ; i < inBufferCount && count < 16 ; i++ )
+			buffers[count++]=inBuffers[i];
+
+		uLONG len=0;
+		
+		VError verr=VE_OK;
+		
+		if(withTimeout)
+		{
+			sLONG spentMs=0;
+
+			verr=fSock->WriteVWithTimeout(buffers, count, &len, timeoutMs, &spentMs);
+
+			timeoutMs-=spentMs;
+		}
+		else
+			verr=fSock->WriteV(buffers, count, &len);
+
+		if(verr==VE_SOCK_CONNECTION_BROKEN)
+			return ReportError(VE_SRVR_CONNECTION_BROKEN);
+
+		if(verr==VE_SOCK_TIMED_OUT)
+			return ReportError(VE_SRVR_WRITE_TIMED_OUT, false, false);
+			
+		if(verr==VE_SOCK_WRITE_FAILED || verr==VE_SSL_WRITE_FAILED)
+			return ReportError(VE_SRVR_WRITE_FAILED);
+
+		xbox_assert(verr==VE_OK);	//No unhandled error !
+
+		if(verr!=VE_OK)
+			return ReportError(VE_SRVR_WRITE_FAILED);
+
+		//Dispatch sent bytes on buffers
+		while ( len > 0 && current < inBufferCount )
+		{
+			uLONG left=inBuffers[current].fLength-sentInCurrent;
+			
+			if ( len < left )
+			{
+				sentInCurrent+=len;
+				len=0;
+			}
+			else
+			{
+				len-=left;
+				current++;
+				sentInCurrent=0;
+			}
+		}
+
+		if ( fShouldStop )
+			return ReportError(VE_SRVR_WRITE_FAILED, false, false);
+	}
+
+	return VE_OK;
+
+#else
+
+	for ( sLONG i = 0 ; i < inBufferCount ; i++ )
+	{
+		uLONG len=inBuffers[i].fLength;
+		
+		VError verr=DoWriteExactly(inBuffers[i].fData, &len, inTimeOutMillis);
+		
+		if ( verr != VE_OK )
+			return verr;
+	}
+
+	return VE_OK;
+
+#endif
+}
+
+VError VTCPEndPoint::SendFile ( VFileDesc *inFileDesc, sLONG8 inOffset, sLONG8 inLength, sLONG inTimeOutMillis )
+{
+	xbox_assert ( !fIsInAutoReconnect || ( fIsInAutoReconnect && fIsInUse ) );
+	
+	if (fSock==NULL)
+		return ReportError( VE_SRVR_NULL_ENDPOINT );
+
+	if ( inFileDesc == NULL || inOffset < 0 || inLength < 0 )
+		return ReportError(VE_INVALID_PARAMETER);
+
+#if VERSION_LINUX
+
+	if ( !fSock->IsSSL ( ) )
+	{
+		bool withTimeout=(inTimeOutMillis>0);
+		
+		sLONG timeoutMs=inTimeOutMillis;
+		
+		if(!withTimeout && !IsBlocking())
+		{
+			timeoutMs=XBOX::MaxLongInt;
+			withTimeout=true;
+		}
+
+		int fd=inFileDesc->GetSystemRef();
+		
+		sLONG8 offset=inOffset;
+		sLONG8 past=inOffset+inLength;
+		
+		while ( offset < past )
+		{
+			//sendfile() transfers at most 0x7ffff000 bytes per call anyway
+			uLONG len=static_cast<uLONG>( Min<sLONG8> ( past-offset, 0x40000000 ) );
+
+			VError verr=VE_OK;
+			
+			if(withTimeout)
+			{
+				sLONG spentMs=0;
+
+				verr=fSock->SendFileWithTimeout(fd, offset, &len, timeoutMs, &spentMs);
+
+				timeoutMs-=spentMs;
+			}
+			else
+				verr=fSock->SendFile(fd, offset, &len);
+
+			if(verr==VE_SOCK_CONNECTION_BROKEN)
+				return ReportError(VE_SRVR_CONNECTION_BROKEN);
+
+			if(verr==VE_SOCK_TIMED_OUT)
+				return ReportError(VE_SRVR_WRITE_TIMED_OUT, false, false);
+				
+			if(verr!=VE_OK)
+				return ReportError(VE_SRVR_WRITE_FAILED);
+
+			//File is shorter than expected
+			if ( len == 0 )
+				return ReportError(VE_STREAM_EOF);
+			
+			offset+=len;
+
+			if ( fShouldStop )
+				return ReportError(VE_SRVR_WRITE_FAILED, false, false);
+		}
+
+		return VE_OK;
+	}
+
+#endif
+
+	//Generic path : read by chunks and write them.
+	const VSize kChunkSize=64*1024;
+	
+	VPtr buffer=VMemory::NewPtr(kChunkSize, 'snet');
+	
+	if ( buffer == NULL )
+		return ReportError(VE_MEMORY_FULL);
+	
+	VError verr=VE_OK;
+	
+	sLONG8 offset=inOffset;
+	sLONG8 past=inOffset+inLength;
+	
+	while ( verr == VE_OK && offset < past )
+	{
+		VSize len=static_cast<VSize>( Min<sLONG8> ( past-offset, kChunkSize ) );
+
+		verr=inFileDesc->ReadAt(buffer, len, offset);
+
+		if ( verr == VE_OK )
+		{
+			uLONG writeLen=static_cast<uLONG>(len);
+			
+			verr=DoWriteExactly(buffer, &writeLen, inTimeOutMillis);
+		}
+		
+		offset+=len;
+	}
+	
+	VMemory::DisposePtr(buffer);
+	
+	return verr;
+}
+
 VError VTCPEndPoint::EnableAutoReconnect ( )
 {
 	fIsInAutoReconnect = true;
@@ -940,8 +1182,20 @@ bool VTCPEndPoint::HasUnreadData()
 
 bool VTCPEndPoint::WaitForInput ( uLONG inTimeout )
 {
-	struct timeval	tvTimeout = { 0 };
 	int				nRawSocket = GetRawSocket ( );
+
+#if VERSIONMAC || VERSION_LINUX
+
+	struct pollfd	pfdReadSocket = { 0 };
+
+	pfdReadSocket. fd = nRawSocket;
+	pfdReadSocket. events = POLLIN;
+
+	return ( poll ( &pfdReadSocket, 1, static_cast<int> ( inTimeout ) ) > 0 );
+
+#else
+
+	struct timeval	tvTimeout = { 0 };
 	fd_set			fdReadSocket;
 
 	tvTimeout. tv_sec = inTimeout / 1000;
@@ -951,6 +1205,8 @@ bool VTCPEndPoint::WaitForInput ( uLONG inTimeout )
 	FD_SET ( nRawSocket, &fdReadSocket );
 
 	return ( select ( FD_SETSIZE, &fdReadSocket, 0, 0, &tvTimeout ) > 0 );
+
+#endif
 }
 
 
@@ -1473,7 +1729,13 @@ VTCPEndPoint* VTCPEndPointFactory::DoCreateClientConnection (
 	
 	if(outError==VE_OK && inIsSSL)
 	{
-		VError verr=xsock->PromoteToSSL();
+		//Reuse the TLS session of a previous connection to the same host:port, if any.
+		
+		VString sessionKey(inDNSNameOrIP);
+		
+		sessionKey.AppendUniChar(':').AppendLong(inPort);
+		
+		VError verr=xsock->PromoteToSSL(NULL, &sessionKey);
 		
 		if(verr!=VE_OK)
 			outError=ThrowNetError(VE_SRVR_FAILED_TO_CREATE_CONNECTED_SOCKET);	
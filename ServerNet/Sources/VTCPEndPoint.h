@@ -65,6 +65,21 @@ public:
 								 const void *inBuff,
 								 uLONG inLen,
 								 sLONG inTimeOutMillis = 0 /* Currently, time-out is supported only for non-blocking, non-select I/O */ );
+
+	/* Gather version of WriteExactly(): buffers are sent in order as if they were one, without being copied
+	 in a single buffer (headers + body for example). Uses sendmsg() on Mac and Linux for non-SSL end-points. */
+	virtual VError WriteExactlyV (
+								  const VTCPIOBuffer *inBuffers,
+								  sLONG inBufferCount,
+								  sLONG inTimeOutMillis = 0 );
+
+	/* Sends inLength bytes of a file, starting at inOffset (the file pos is not used). On Linux, for non-SSL
+	 end-points, data is sent with sendfile() and doesn't go through user space. Otherwise the file is read by chunks. */
+	virtual VError SendFile (
+							 VFileDesc *inFileDesc,
+							 sLONG8 inOffset,
+							 sLONG8 inLength,
+							 sLONG inTimeOutMillis = 0 );
 	
 	virtual VError Close ( );
 	virtual VError ForceClose ( );
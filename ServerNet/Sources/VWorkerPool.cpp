@@ -19,6 +19,10 @@
 
 #include "Tools.h"
 
+#if WITH_SHARED_WORKERS
+	#include "../SharedWorkers/VSharedWorkers.h"
+#endif
+
 
 BEGIN_TOOLBOX_NAMESPACE
 
@@ -28,11 +32,13 @@ using namespace ServerNetTools;
 
 VExclusiveWorker::VExclusiveWorker (
 								VWorkerPool& vParentWorkerPool ,
-								VConnectionHandlerQueue& vExclusiveCHQueue) :
+								VConnectionHandlerQueue& vExclusiveCHQueue,
+								unsigned short nQueueIndex ) :
 																		VTask ( NULL, 0, XBOX::eTaskStylePreemptive, NULL ),
 																		m_vParentWorkerPool ( vParentWorkerPool ),
 																		m_vsynceWaitForHandler ( ),
-																		m_vExclusiveCHQueue ( vExclusiveCHQueue )
+																		m_vExclusiveCHQueue ( vExclusiveCHQueue ),
+																		m_nQueueIndex ( nQueueIndex )
 {
 	m_vConnectionHandler = NULL;
 	m_nSpareStamp = 0;
@@ -100,8 +106,11 @@ Boolean VExclusiveWorker::DoRun ( )
 		if ( GetState ( ) == TS_DYING || GetState ( ) == TS_DEAD )
 			break;
 
-		/* Check if there are new handlers pending in the queue. */
+		/* Check if there are new handlers pending in my queue, else take one from a busy worker. */
 		if ( !( m_vConnectionHandler = m_vExclusiveCHQueue. Pop ( &vError ) ) )
+			m_vConnectionHandler = m_vParentWorkerPool. StealExclusiveConnectionHandler ( this );
+
+		if ( !m_vConnectionHandler )
 		{
 			m_vParentWorkerPool. UseAsIdling ( this );
 
@@ -134,10 +143,11 @@ VWorkerPool::VWorkerPool (
 #endif
 					m_vctrAllExclusiveWorkers ( ),
 					m_vctrExclusiveWorkersIdling ( ),
-					m_vExclusiveCHQueue ( )
+					m_vctrFreeExclusiveCHQueues ( )
 {
 #if WITH_SHARED_WORKERS
 	m_vcsSharedProtector = new VCriticalSection ( );
+	m_nNextStealVictim = 0;
 #endif
 	m_vcsExclusiveProtector = new VCriticalSection ( );
 
@@ -148,6 +158,11 @@ VWorkerPool::VWorkerPool (
 	m_nExclusiveMaxCount = nExclusiveMaxCount;
 	m_nExclusiveIdlePageSize = 5;
 
+	unsigned short			nQueueSlots = ( m_nInitialExclusiveCount > m_nExclusiveMaxCount ) ? m_nInitialExclusiveCount : m_nExclusiveMaxCount;
+	m_arrExclusiveCHQueues = new VConnectionHandlerQueue* [ nQueueSlots > 0 ? nQueueSlots : 1 ];
+	m_nExclusiveCHQueueCount = 0;
+	m_nNextExclusiveTarget = 0;
+
 	m_vstrNameFoSpare = "Spare process";
 
 #if WITH_SHARED_WORKERS
@@ -160,7 +175,7 @@ VWorkerPool::VWorkerPool (
 #if WITH_SHARED_WORKERS	
 	for ( unsigned short i = 0; i < m_nInitialSharedCount; i++ )
 	{
-		vsWorker = new VSharedWorker ( );
+		vsWorker = new VSharedWorker ( *this );
 		VString				vstrName ( "SHARED pool worker " );
 		vstrName. AppendLong ( i );
 		vsWorker-> SetName ( vstrName );
@@ -170,37 +185,17 @@ VWorkerPool::VWorkerPool (
 #endif	
 	for ( unsigned short i = 0; i < m_nInitialExclusiveCount; i++ )
 	{
-		veWorker = new VExclusiveWorker ( *this, m_vExclusiveCHQueue );
 		VString				vstrName ( m_vstrNameFoSpare );
 		vstrName += " ";
 		vstrName. AppendLong ( i );
-		veWorker-> SetName ( vstrName );
-		veWorker-> Run ( );
+		veWorker = CreateExclusiveWorker ( vstrName );
 		m_vctrExclusiveWorkersIdling. push_back ( veWorker );
-		m_vctrAllExclusiveWorkers. push_back ( veWorker );
-	}
-
-#if WITH_SHARED_WORKERS
-	if ( m_nInitialSharedCount > 0 )
-	{
-		m_vSharedLoadBalancer = new VSharedLoadBalancer ( *this );
-		m_vSharedLoadBalancer-> SetName ( CVSTR ( "Shared Load Balancer" ) );
-		m_vSharedLoadBalancer-> Run ( );
 	}
-	else
-		m_vSharedLoadBalancer = 0;
-#endif
 }
 
 VWorkerPool::~VWorkerPool ( )
 {
 #if WITH_SHARED_WORKERS	
-	if ( m_vSharedLoadBalancer != 0 )
-	{
-		m_vSharedLoadBalancer-> Kill ( );
-		m_vSharedLoadBalancer-> WakeUpFromIdling ( );
-	}
-
 	m_vcsSharedProtector-> Lock ( );
 
 		std::vector<VSharedWorker*>::iterator				iterS = m_vctrSharedWorkers. begin ( );
@@ -229,7 +224,37 @@ VWorkerPool::~VWorkerPool ( )
 	m_vcsExclusiveProtector-> Unlock ( );
 	delete m_vcsExclusiveProtector;
 
-	m_vExclusiveCHQueue. ReleaseAll ( );
+	for ( sLONG i = 0; i < m_nExclusiveCHQueueCount; i++ )
+	{
+		m_arrExclusiveCHQueues [ i ]-> ReleaseAll ( );
+		delete m_arrExclusiveCHQueues [ i ];
+	}
+	delete [] m_arrExclusiveCHQueues;
+}
+
+VExclusiveWorker* VWorkerPool::CreateExclusiveWorker ( const VString& inName )
+{
+	/* Called with m_vcsExclusiveProtector locked, or from the constructor. */
+	unsigned short				nQueueIndex;
+	if ( m_vctrFreeExclusiveCHQueues. size ( ) > 0 )
+	{
+		nQueueIndex = m_vctrFreeExclusiveCHQueues. back ( );
+		m_vctrFreeExclusiveCHQueues. pop_back ( );
+	}
+	else
+	{
+		/* Publish the queue before the count, thieves read the count first. */
+		nQueueIndex = ( unsigned short ) m_nExclusiveCHQueueCount;
+		VInterlocked::ExchangePtr ( &m_arrExclusiveCHQueues [ nQueueIndex ], new VConnectionHandlerQueue ( ) );
+		VInterlocked::Increment ( &m_nExclusiveCHQueueCount );
+	}
+
+	VExclusiveWorker*			veWorker = new VExclusiveWorker ( *this, *m_arrExclusiveCHQueues [ nQueueIndex ], nQueueIndex );
+	veWorker-> SetName ( inName );
+	veWorker-> Run ( );
+	m_vctrAllExclusiveWorkers. push_back ( veWorker );
+
+	return veWorker;
 }
 
 VError VWorkerPool::AddExclusiveConnectionHandler ( VConnectionHandler* inConnectionHandler )
@@ -247,16 +272,20 @@ VError VWorkerPool::AddExclusiveConnectionHandler ( VConnectionHandler* inConnec
 	}
 	else if ( m_vctrAllExclusiveWorkers. size ( ) < m_nExclusiveMaxCount )
 	{
-		veWorker = new VExclusiveWorker ( *this, m_vExclusiveCHQueue );
 		VString				vstrName ( "EXCLUSIVE pool worker " );
 		vstrName. AppendLong8 ( m_vctrAllExclusiveWorkers. size ( ) );
-		veWorker-> SetName ( vstrName );
-		veWorker-> Run ( );
-		m_vctrAllExclusiveWorkers. push_back ( veWorker );
+		veWorker = CreateExclusiveWorker ( vstrName );
 		vError = veWorker-> SetConnectionHandler ( inConnectionHandler );
 	}
+	else if ( m_vctrAllExclusiveWorkers. size ( ) > 0 )
+	{
+		/* Every worker is busy : queue the handler to the next one in turn. The first worker done with its
+		handler will take it, from its own queue or by stealing it. */
+		veWorker = m_vctrAllExclusiveWorkers [ m_nNextExclusiveTarget++ % m_vctrAllExclusiveWorkers. size ( ) ];
+		vError = veWorker-> GetQueue ( ). Push ( inConnectionHandler );
+	}
 	else
-		vError = m_vExclusiveCHQueue. Push ( inConnectionHandler );
+		vError = VE_INVALID_PARAMETER;
 
 	m_vcsExclusiveProtector-> Unlock ( );
 
@@ -304,7 +333,7 @@ VError VWorkerPool::AddConnectionHandler ( VConnectionHandler* inConnectionHandl
 		{
 			/* All current workers are too busy and I'm allowed to create more workers.
 			Let's do just that. */
-			vwLeastBusy = new VSharedWorker ( );
+			vwLeastBusy = new VSharedWorker ( *this );
 			VString				vstrName ( "SHARED pool worker " );
 			vstrName. AppendLong8 ( m_vctrSharedWorkers. size ( ) );
 			vwLeastBusy-> SetName ( vstrName );
@@ -327,6 +356,21 @@ VError VWorkerPool::UseAsIdling ( VExclusiveWorker* inWorker )
 	if ( !m_vcsExclusiveProtector-> Lock ( ) )
 		return VE_SRVR_FAILED_TO_SYNC_LOCK;
 
+		/* Handlers are queued with m_vcsExclusiveProtector locked, and only when no worker is idling. Look
+		for one a last time : once this worker is idling, new handlers will be given to it directly. */
+		VError						vError = VE_OK;
+		VConnectionHandler*			vcHandler = inWorker-> GetQueue ( ). Pop ( &vError );
+		if ( !vcHandler )
+			vcHandler = StealExclusiveConnectionHandler ( inWorker );
+
+		if ( vcHandler )
+		{
+			vError = inWorker-> SetConnectionHandler ( vcHandler );
+			m_vcsExclusiveProtector-> Unlock ( );
+
+			return vError;
+		}
+
 		inWorker-> MakeSpareStampDirty();
 		inWorker-> SetName( m_vstrNameFoSpare);
 		inWorker-> SetKind( kWorkerPool_SpareTaskKind );
@@ -364,6 +408,10 @@ VError VWorkerPool::RemoveExclusiveIdlers ( unsigned short inCount )
 		if ( iterWorker != m_vctrAllExclusiveWorkers. end ( ) )
 			m_vctrAllExclusiveWorkers. erase ( iterWorker );
 
+		/* An idling worker's queue is empty, the next worker created can use it. */
+		xbox_assert ( veWorker-> GetQueue ( ). IsEmpty ( ) );
+		m_vctrFreeExclusiveCHQueues. push_back ( veWorker-> GetQueueIndex ( ) );
+
 		veWorker-> Kill ( );
 		veWorker-> WakeUpFromIdling ( );
 		veWorker-> Release ( );
@@ -379,80 +427,44 @@ VError VWorkerPool::RemoveExclusiveIdlers ( unsigned short inCount )
 }
 
 
-#if WITH_SHARED_WORKERS
-VError VWorkerPool::BalanceSharedLoad ( )
+VConnectionHandler* VWorkerPool::StealExclusiveConnectionHandler ( VExclusiveWorker* inThief )
 {
-	/* NOTEs: First, of course, I should look if I can create new workers. */
-
-	std::vector<VSharedWorker*>			vctrNonBusyWorkers;
-	VError								vError = GetNonBusySharedWorkers ( vctrNonBusyWorkers );
-	if ( vError != VE_OK )
-		return vError;
-	if ( vctrNonBusyWorkers. size ( ) == 0 )
-		return VE_OK;
-
-	std::vector<VConnectionHandler*>	vctrStuckConnectionHandlers;
-	vError = ExtractStuckConnectionHandlers ( vctrStuckConnectionHandlers );
-	if ( vError != VE_OK )
-		/* TODO: Give back all the stuck connection handlers. */
-		return vError;
-	if ( vctrStuckConnectionHandlers. size ( ) == 0 )
-		return VE_OK;
+	/* Start after the thief's own queue so that thieves don't all hit the same victim. */
+	VConnectionHandler*			vcHandler = NULL;
+	sLONG						nCount = VInterlocked::AtomicGet ( &m_nExclusiveCHQueueCount );
 
-	std::vector<VSharedWorker*>::iterator				iterSW = vctrNonBusyWorkers. begin ( );
-	VConnectionHandler*									vcHandler = NULL;
-	while ( vctrStuckConnectionHandlers. size ( ) > 0 )
+	for ( sLONG i = 1; i < nCount && !vcHandler; i++ )
 	{
-		vcHandler = vctrStuckConnectionHandlers. back ( );
-		vctrStuckConnectionHandlers. pop_back ( );
-		( *iterSW )-> AddConnectionHandler ( vcHandler );
-		iterSW++;
-		if ( iterSW == vctrNonBusyWorkers. end ( ) )
-			iterSW = vctrNonBusyWorkers. begin ( );
+		VConnectionHandlerQueue*	vcQueue = m_arrExclusiveCHQueues [ ( inThief-> GetQueueIndex ( ) + i ) % nCount ];
+		if ( !vcQueue-> IsEmpty ( ) )
+			vcHandler = vcQueue-> Steal ( );
 	}
 
-	return VE_UNIMPLEMENTED;
+	return vcHandler;
 }
 
-VError VWorkerPool::GetNonBusySharedWorkers ( std::vector<VSharedWorker*>& outNonBusy )
-{
-	if ( !m_vcsSharedProtector-> Lock ( ) )
-		return VE_SRVR_FAILED_TO_SYNC_LOCK;
-
-		VError										vError = VE_OK;
-
-		std::vector<VSharedWorker*>::iterator		iter = m_vctrSharedWorkers. begin ( );
-		while ( iter != m_vctrSharedWorkers. end ( ) )
-		{
-			if ( ( *iter )-> GetBusyness ( ) < m_nSharedMaxBusyness )
-				outNonBusy. push_back ( *iter );
 
-			iter++;
-		}
-
-	m_vcsSharedProtector-> Unlock ( );
-
-	return vError;
-}
-
-VError VWorkerPool::ExtractStuckConnectionHandlers ( std::vector<VConnectionHandler*>& outStuckConnectionHandlers )
+#if WITH_SHARED_WORKERS
+VConnectionHandler* VWorkerPool::StealSharedConnectionHandler ( VSharedWorker* inThief )
 {
 	if ( !m_vcsSharedProtector-> Lock ( ) )
-		return VE_SRVR_FAILED_TO_SYNC_LOCK;
+		return NULL;
 
-		VError										vError = VE_OK;
+		/* Start from a different victim each time so that thieves don't all hit the same worker. */
+		VConnectionHandler*							vcHandler = NULL;
+		size_t										nCount = m_vctrSharedWorkers. size ( );
+		size_t										nStart = ( nCount > 0 ) ? m_nNextStealVictim++ % nCount : 0;
 
-		std::vector<VSharedWorker*>::iterator		iter = m_vctrSharedWorkers. begin ( );
-		while ( iter != m_vctrSharedWorkers. end ( ) )
+		for ( size_t i = 0; i < nCount && !vcHandler; i++ )
 		{
-			( *iter )-> ExtractStuckConnectionHandlers ( outStuckConnectionHandlers );
-
-			iter++;
+			VSharedWorker*							vsVictim = m_vctrSharedWorkers [ ( nStart + i ) % nCount ];
+			if ( vsVictim != inThief )
+				vcHandler = vsVictim-> StealConnectionHandler ( );
 		}
 
 	m_vcsSharedProtector-> Unlock ( );
 
-	return vError;
+	return vcHandler;
 }
 #endif
 
@@ -19,6 +19,7 @@
 
 #include "VConnectionHandlerFactory.h"
 
+#include <deque>
 #include <queue>
 #include <vector>
 
@@ -42,14 +43,18 @@ BEGIN_TOOLBOX_NAMESPACE
 						Name		"Reused spare process"
 */
 
-/** @brief	This class is the one used by clients of the workerpool*/
+/** @brief	This class is the one used by clients of the workerpool.
+			Each exclusive worker owns a queue of pending connection handlers. When it is done with a handler, it
+			takes the next one from its queue, or steals one from another worker's queue, and only then goes idle.
+*/
 class XTOOLBOX_API VExclusiveWorker : public VTask
 {
 	public :
 
 		VExclusiveWorker (
 						VWorkerPool& vParentWorkerPool,
-						VConnectionHandlerQueue& vExclusiveCHQueue );
+						VConnectionHandlerQueue& vExclusiveCHQueue,
+						unsigned short nQueueIndex );
 		virtual ~VExclusiveWorker ( );
 
 		virtual VError SetConnectionHandler ( VConnectionHandler* inConnectionHandler );
@@ -65,6 +70,9 @@ class XTOOLBOX_API VExclusiveWorker : public VTask
 		uLONG GetSpareStamp() const			{ return m_nSpareStamp; }
 		void MakeSpareStampDirty()			{ ++m_nSpareStamp; }
 
+		VConnectionHandlerQueue& GetQueue ( )	{ return m_vExclusiveCHQueue; }
+		unsigned short GetQueueIndex ( ) const	{ return m_nQueueIndex; }
+
 	protected :
 
 		virtual Boolean DoRun ( );
@@ -73,6 +81,7 @@ class XTOOLBOX_API VExclusiveWorker : public VTask
 		VSyncEvent									m_vsynceWaitForHandler;
 		VConnectionHandler*							m_vConnectionHandler;
 		VConnectionHandlerQueue&					m_vExclusiveCHQueue;
+		unsigned short								m_nQueueIndex;
 
 		uLONG										m_nSpareStamp;
 };
@@ -94,7 +103,14 @@ class XTOOLBOX_API VWorkerPool : public VObject, public IRefCountable
 
 		VError UseAsIdling ( VExclusiveWorker* inWorker );
 
-		VError BalanceSharedLoad ( );
+		/* Called by an exclusive worker that has emptied its own queue : takes the newest pending handler of
+		another exclusive worker, without locking the pool. */
+		VConnectionHandler* StealExclusiveConnectionHandler ( VExclusiveWorker* inThief );
+
+#if WITH_SHARED_WORKERS
+		/* Called by an idle shared worker : takes a connection handler from one of the other shared workers. */
+		VConnectionHandler* StealSharedConnectionHandler ( VSharedWorker* inThief );
+#endif
 
 		/* If inTaskID is NULL_TASK_ID then stops all connection handlers of a given type inType. Otherwise, stops
 		only a handler of a given type that's being executed by a task with a given ID. */
@@ -112,6 +128,7 @@ class XTOOLBOX_API VWorkerPool : public VObject, public IRefCountable
 #if WITH_SHARED_WORKERS
 		VCriticalSection*							m_vcsSharedProtector;
 		std::vector<VSharedWorker*>					m_vctrSharedWorkers;
+		unsigned short								m_nNextStealVictim;
 #endif
 	
 		/* Everything related to exclusive workers. */
@@ -124,22 +141,19 @@ class XTOOLBOX_API VWorkerPool : public VObject, public IRefCountable
 		unsigned short								m_nExclusiveMaxCount;
 		unsigned short								m_nExclusiveIdlePageSize;
 
-		VConnectionHandlerQueue						m_vExclusiveCHQueue;
-
-#if WITH_SHARED_WORKERS
-		VSharedLoadBalancer*						m_vSharedLoadBalancer;
-#endif
+		/* One queue per exclusive worker slot. Queues are created on demand and kept until the pool is
+		destroyed, so that thieves can scan them without taking m_vcsExclusiveProtector. */
+		VConnectionHandlerQueue**					m_arrExclusiveCHQueues;
+		sLONG										m_nExclusiveCHQueueCount;
+		std::vector<unsigned short>					m_vctrFreeExclusiveCHQueues;
+		unsigned short								m_nNextExclusiveTarget;
 
 		VString										m_vstrNameFoSpare;
 
 
 		VError AddExclusiveConnectionHandler ( VConnectionHandler* inConnectionHandler );
 		VError RemoveExclusiveIdlers ( unsigned short inCount );
-
-#if WITH_SHARED_WORKERS
-		VError GetNonBusySharedWorkers ( std::vector<VSharedWorker*>& outNonBusy );
-		VError ExtractStuckConnectionHandlers ( std::vector<VConnectionHandler*>& outStuckConnectionHandlers );
-#endif
+		VExclusiveWorker* CreateExclusiveWorker ( const VString& inName );
 };
 
 
@@ -23,6 +23,12 @@
 #include "VSslDelegate.h"
 
 #include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/uio.h>
+
+#if VERSION_LINUX
+	#include <sys/sendfile.h>
+#endif
 
 
 BEGIN_TOOLBOX_NAMESPACE
@@ -214,20 +220,14 @@ VError XBsdTCPSocket::WaitFor(Socket inFd, FdSet inSet, sLONG inMsTimeout, sLONG
 	{
 		sLONG msTimeout=stop-now;
 
-		timeval timeout={0};
-				
-		timeout.tv_sec=msTimeout/1000;
-		timeout.tv_usec=1000*(msTimeout%1000);
-		
-        fd_set set;
-        FD_ZERO(&set);
-        FD_SET(inFd, &set);
+		//poll() rather than select() : inFd may well be above FD_SETSIZE on a busy server.
+
+		pollfd pfd={0};
 
-		fd_set* rs=(inSet==kREAD_SET) ? &set : NULL;
-		fd_set* ws=(inSet==kWRITE_SET) ? &set : NULL;
-		fd_set* es=(inSet==kERROR_SET) ? &set : NULL;
+		pfd.fd=inFd;
+		pfd.events=(inSet==kREAD_SET) ? POLLIN : (inSet==kWRITE_SET) ? POLLOUT : POLLPRI;
 
-        int res=select(inFd+1, rs, ws, es, &timeout);
+        int res=poll(&pfd, 1, msTimeout);
 		
 		if(res==-1 && errno==EINTR)
 		{
@@ -326,7 +326,7 @@ VError XBsdTCPSocket::Connect(const VNetAddress& inAddr, sLONG inMsTimeout)
 }
 
 
-VError XBsdTCPSocket::Listen(const VNetAddress& inAddr, bool inAlreadyBound)
+VError XBsdTCPSocket::Listen(const VNetAddress& inAddr, bool inAlreadyBound, bool inReusePort)
 {
 	xbox_assert(fProfile==NewSock);
 
@@ -340,6 +340,16 @@ VError XBsdTCPSocket::Listen(const VNetAddress& inAddr, bool inAlreadyBound)
 		if(err!=0)
 			return vThrowNativeError(errno);
 		
+#if WITH_REUSEPORT_LISTENERS
+		if(inReusePort)
+		{
+			err=setsockopt(fSock, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+		
+			if(err!=0)
+				return vThrowNativeError(errno);
+		}
+#endif
+		
 		err=bind(fSock, inAddr.GetAddr(), inAddr.GetAddrLen());
 		
 		if(err!=0)
@@ -383,6 +393,16 @@ XBsdTCPSocket* XBsdTCPSocket::Accept(uLONG inMsTimeout)
 	if(verr!=VE_OK)
 		return NULL;
 
+	return DoAccept();
+}
+
+
+XBsdTCPSocket* XBsdTCPSocket::DoAccept()
+{
+	xbox_assert(fProfile==ServiceSock);
+
+	VError verr=VE_OK;
+
 	sockaddr_storage sa_storage;
 	socklen_t len=sizeof(sa_storage);
 	memset(&sa_storage, 0, len);
@@ -391,14 +411,23 @@ XBsdTCPSocket* XBsdTCPSocket::Accept(uLONG inMsTimeout)
 	
 	int sock=kBAD_SOCKET;
 	
+#if VERSION_LINUX
+	//The new socket doesn't inherit O_NONBLOCK from the listening socket on Linux : it's already blocking.
+	do
+		sock=accept4(GetRawSocket(), sa, &len, SOCK_CLOEXEC);
+	while(sock==kBAD_SOCKET && errno==EINTR);
+#else
 	do
 		sock=accept(GetRawSocket(), sa, &len);
 	while(sock==kBAD_SOCKET && errno==EINTR);
-
+#endif
 	
 	if(sock==kBAD_SOCKET)
 	{
-		vThrowNativeError(errno);
+		//Nothing left in the backlog (or the client gave up in between) : not an error.
+		if(errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=ECONNABORTED)
+			vThrowNativeError(errno);
+		
 		return NULL;
 	}
 		
@@ -449,6 +478,7 @@ XBsdTCPSocket* XBsdTCPSocket::Accept(uLONG inMsTimeout)
 	if(ok)
 		xsock->fProfile=ConnectedSock;
 		
+#if !VERSION_LINUX
 	if(ok)
 	{
 		verr=xsock->SetBlocking(true);
@@ -456,6 +486,7 @@ XBsdTCPSocket* XBsdTCPSocket::Accept(uLONG inMsTimeout)
 		if(verr!=VE_OK)
 			ok=false;
 	}
+#endif
 	
 	if(ok)
 	{
@@ -599,6 +630,188 @@ VError XBsdTCPSocket::DoWrite(const void* inBuff, uLONG* ioLen)
 }
 
 
+VError XBsdTCPSocket::WriteV(const VTCPIOBuffer* inBuffers, sLONG inBufferCount, uLONG* ioLen)
+{
+	// - inBuffers and ioLen are mandatory ; ioLen is always modified (set to 0 on error)
+	// - Caller should deal with special error VE_SOCK_WOULD_BLOCK
+
+	if(inBuffers==NULL || ioLen==NULL || inBufferCount<0)
+		return vThrowError(VE_INVALID_PARAMETER);
+
+	if(fSslDelegate!=NULL)
+	{
+		//SSL records are built from one buffer ; send the first non empty one, caller loops for the rest.
+		for(sLONG i=0 ; i<inBufferCount ; i++)
+		{
+			if(inBuffers[i].fLength>0)
+			{
+				*ioLen=inBuffers[i].fLength;
+				return fSslDelegate->Write(inBuffers[i].fData, ioLen);
+			}
+		}
+
+		*ioLen=0;
+		return VE_OK;
+	}
+
+	const int kMaxVec=64;	//IOV_MAX is at least 16 (posix), much more in practice ; caller loops for the rest.
+	struct iovec vec[kMaxVec];
+	int nbVec=0;
+
+	for(sLONG i=0 ; i<inBufferCount && nbVec<kMaxVec ; i++)
+	{
+		if(inBuffers[i].fLength>0)
+		{
+			vec[nbVec].iov_base=const_cast<void*>(inBuffers[i].fData);
+			vec[nbVec].iov_len=inBuffers[i].fLength;
+			nbVec++;
+		}
+	}
+
+	if(nbVec==0)
+	{
+		*ioLen=0;
+		return VE_OK;
+	}
+
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov=vec;
+	msg.msg_iovlen=nbVec;
+
+    int flags=0;
+
+#if VERSION_LINUX
+    flags|=MSG_NOSIGNAL;
+#endif
+
+	ssize_t n=sendmsg(fSock, &msg, flags);
+	
+	if(n>=0)
+	{
+		*ioLen=static_cast<uLONG>(n);
+		return VE_OK;
+	}
+	
+	//We have an error...
+	*ioLen=0;
+		
+	if(errno==EWOULDBLOCK)
+		return VE_SOCK_WOULD_BLOCK;
+	
+	if(errno==ECONNRESET || errno==ENOTSOCK || errno==EBADF || errno==EPIPE)
+		return vThrowNativeCombo(VE_SOCK_CONNECTION_BROKEN, errno);
+	
+	return vThrowNativeCombo(VE_SOCK_WRITE_FAILED, errno);
+}
+
+
+VError XBsdTCPSocket::WriteVWithTimeout(const VTCPIOBuffer* inBuffers, sLONG inBufferCount, uLONG* ioLen, sLONG inMsTimeout, sLONG* outMsSpent)
+{
+	// Same contract as DoWriteWithTimeout()
+
+	if(inBuffers==NULL || ioLen==NULL || inBufferCount<0)
+		return vThrowError(VE_INVALID_PARAMETER);
+
+	if(fSslDelegate!=NULL)
+	{
+		for(sLONG i=0 ; i<inBufferCount ; i++)
+		{
+			if(inBuffers[i].fLength>0)
+			{
+				*ioLen=inBuffers[i].fLength;
+				return DoWriteWithTimeout(inBuffers[i].fData, ioLen, inMsTimeout, outMsSpent);
+			}
+		}
+
+		*ioLen=0;
+		return VE_OK;
+	}
+
+	VError verr=WaitForWrite(inMsTimeout, outMsSpent);
+
+	if(verr==VE_OK)
+		verr=WriteV(inBuffers, inBufferCount, ioLen);
+	else
+		*ioLen=0;
+
+	//Socket was reported writable ; a spurious would block is handled as a time out.
+	if(verr==VE_SOCK_WOULD_BLOCK)
+		verr=VE_SOCK_TIMED_OUT;
+
+	return verr;
+}
+
+
+VError XBsdTCPSocket::SendFile(int inFd, sLONG8 inOffset, uLONG* ioLen)
+{
+	// - ioLen is mandatory ; ioLen is always modified (set to 0 on error)
+	// - Caller should deal with special error VE_SOCK_WOULD_BLOCK
+
+	if(ioLen==NULL || inFd<0 || inOffset<0)
+		return vThrowError(VE_INVALID_PARAMETER);
+
+#if VERSION_LINUX
+
+	if(fSslDelegate==NULL)
+	{
+		off64_t offset=inOffset;
+
+		ssize_t n=sendfile64(fSock, inFd, &offset, *ioLen);
+
+		if(n>=0)
+		{
+			*ioLen=static_cast<uLONG>(n);
+			return VE_OK;
+		}
+
+		*ioLen=0;
+
+		if(errno==EWOULDBLOCK)
+			return VE_SOCK_WOULD_BLOCK;
+
+		if(errno==ECONNRESET || errno==ENOTSOCK || errno==EBADF || errno==EPIPE)
+			return vThrowNativeCombo(VE_SOCK_CONNECTION_BROKEN, errno);
+
+		return vThrowNativeCombo(VE_SOCK_WRITE_FAILED, errno);
+	}
+
+#endif
+
+	*ioLen=0;
+	return VE_UNIMPLEMENTED;
+}
+
+
+VError XBsdTCPSocket::SendFileWithTimeout(int inFd, sLONG8 inOffset, uLONG* ioLen, sLONG inMsTimeout, sLONG* outMsSpent)
+{
+	if(ioLen==NULL)
+		return vThrowError(VE_INVALID_PARAMETER);
+
+#if VERSION_LINUX
+
+	if(fSslDelegate==NULL)
+	{
+		VError verr=WaitForWrite(inMsTimeout, outMsSpent);
+
+		if(verr==VE_OK)
+			verr=SendFile(inFd, inOffset, ioLen);
+		else
+			*ioLen=0;
+
+		if(verr==VE_SOCK_WOULD_BLOCK)
+			verr=VE_SOCK_TIMED_OUT;
+
+		return verr;
+	}
+
+#endif
+
+	*ioLen=0;
+	return VE_UNIMPLEMENTED;
+}
+
+
 VError XBsdTCPSocket::ReadWithTimeout(void* outBuff, uLONG* ioLen, sLONG inMsTimeout, sLONG* outMsSpent)
 {
 //	if(outBuff==NULL || ioLen==NULL)
@@ -934,7 +1147,7 @@ XBsdTCPSocket* XBsdTCPSocket::NewClientConnectedSock(const VString& inDnsName, P
 #if WITH_DEPRECATED_IPV4_API
 
 //static
-XBsdTCPSocket* XBsdTCPSocket::NewServerListeningSock(uLONG inIPv4, PortNumber inPort, Socket inBoundSock)
+XBsdTCPSocket* XBsdTCPSocket::NewServerListeningSock(uLONG inIPv4, PortNumber inPort, Socket inBoundSock, bool inReusePort)
 {
 	sockaddr_in v4={0};
 	v4.sin_family=AF_INET;
@@ -964,7 +1177,7 @@ XBsdTCPSocket* XBsdTCPSocket::NewServerListeningSock(uLONG inIPv4, PortNumber in
 	
 	VNetAddress addr(v4);
 	
-	VError verr=xsock->Listen(addr, alreadyBound);
+	VError verr=xsock->Listen(addr, alreadyBound, inReusePort);
 	
 	if(verr!=VE_OK)
 	{
@@ -986,7 +1199,7 @@ XBsdTCPSocket* XBsdTCPSocket::NewServerListeningSock(uLONG inIPv4, PortNumber in
 #else
 
 //static
-XBsdTCPSocket* XBsdTCPSocket::NewServerListeningSock(const VNetAddress& inAddr, Socket inBoundSock)
+XBsdTCPSocket* XBsdTCPSocket::NewServerListeningSock(const VNetAddress& inAddr, Socket inBoundSock, bool inReusePort)
 {
 	bool alreadyBound=(inBoundSock!=kBAD_SOCKET) ? true : false;
 	
@@ -1008,7 +1221,7 @@ XBsdTCPSocket* XBsdTCPSocket::NewServerListeningSock(const VNetAddress& inAddr,
 	
 	xsock->SetServicePort(inAddr.GetPort());
 		
-	VError verr=xsock->Listen(inAddr, alreadyBound);
+	VError verr=xsock->Listen(inAddr, alreadyBound, inReusePort);
 	
 	if(verr!=VE_OK)
 	{
@@ -1055,7 +1268,7 @@ XBOX::VError XBsdTCPSocket::SetNoDelay(bool inYesNo)
 }
 
 
-XBOX::VError XBsdTCPSocket::PromoteToSSL(VKeyCertPair* inKeyCertPair)
+XBOX::VError XBsdTCPSocket::PromoteToSSL(VKeyCertPair* inKeyCertPair, const VString* inSessionKey)
 {
 	VSslDelegate* delegate=NULL;
 	
@@ -1068,7 +1281,7 @@ XBOX::VError XBsdTCPSocket::PromoteToSSL(VKeyCertPair* inKeyCertPair)
 			
 	case ClientSock :
 			
-			delegate=VSslDelegate::NewClientDelegate(GetRawSocket()/*, inKeyCertPair*/);
+			delegate=VSslDelegate::NewClientDelegate(GetRawSocket()/*, inKeyCertPair*/, inSessionKey);
 			break;
 			
 	default :
@@ -1098,6 +1311,13 @@ bool XBsdTCPSocket::IsSSL()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
+//virtual
+XBsdAcceptIterator::~XBsdAcceptIterator()
+{
+	ClearServiceSockets();
+}
+
+
 VError XBsdAcceptIterator::AddServiceSocket(XBsdTCPSocket* inSock)
 {
 	if(inSock==NULL)
@@ -1117,6 +1337,16 @@ VError XBsdAcceptIterator::AddServiceSocket(XBsdTCPSocket* inSock)
 
 VError XBsdAcceptIterator::ClearServiceSockets()
 {
+	//Connections accepted in the last batch but never handed out are closed.
+	while(!fPendingSocks.empty())
+	{
+		XBsdTCPSocket* sock=fPendingSocks.front();
+		fPendingSocks.pop_front();
+		
+		sock->Close();
+		delete sock;
+	}
+	
 	fSocks.clear();
 	
 	//clear will invalidate the collection iterator...
@@ -1166,6 +1396,13 @@ VError XBsdAcceptIterator::GetNewConnectedSocket(XBsdTCPSocket** outSock, sLONG
 	if(inMsTimeout<0)
 		return VE_SOCK_TIMED_OUT;
 	
+	if(!fPendingSocks.empty())
+	{
+		*outSock=fPendingSocks.front();
+		fPendingSocks.pop_front();
+		
+		return VE_OK;
+	}
 	
 	if(fSockIt==fSocks.end())
 	{
@@ -1242,6 +1479,17 @@ VError XBsdAcceptIterator::GetNewConnectedSocket(XBsdTCPSocket** outSock, sLONG
 			
 			*outSock=(*fSockIt)->Accept(0 /*No timeout*/);
 			
+			//Drain the backlog while we're at it : accept storms don't need one select() per connection.
+			for(sLONG i=1 ; *outSock!=NULL && i<kACCEPT_BATCH_SIZE ; i++)
+			{
+				XBsdTCPSocket* sock=(*fSockIt)->DoAccept();
+				
+				if(sock==NULL)
+					break;
+				
+				fPendingSocks.push_back(sock);
+			}
+			
 			//DebugMsg ("[%d] XBsdAcceptIterator::GetNewConnectedSocket() : New socket %d accepted from socket %d\n",
 			//		  VTask::GetCurrentID(), (*outSock!=NULL) ? (*outSock)->GetRawSocket() : -1, (*fSockIt)->GetRawSocket(), (*fSockIt)->GetServicePort());
 
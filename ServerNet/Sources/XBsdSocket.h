@@ -20,6 +20,8 @@
 #include <sys/socket.h>
 #include <netdb.h>
 
+#include <deque>
+
 #include "ServerNetTypes.h"
 
 #include "XBsdNetAddr.h" //todo : VNetAddr.h à la place...
@@ -38,10 +40,12 @@ class XTOOLBOX_API XBsdTCPSocket : public VObject
  public:
 	
 	static XBsdTCPSocket* NewClientConnectedSock(const VString& inDnsName, PortNumber inPort, sLONG inMsTimeout);	//Client specific !
+	//With inReusePort, several listening sockets may be bound to the same address and port (SO_REUSEPORT, see
+	//WITH_REUSEPORT_LISTENERS) ; the kernel spreads incoming connections between them.
 #if WITH_DEPRECATED_IPV4_API
-	static XBsdTCPSocket* NewServerListeningSock(uLONG inIPv4, PortNumber inPort, Socket inBoundSock=kBAD_SOCKET);	//Server specific !
+	static XBsdTCPSocket* NewServerListeningSock(uLONG inIPv4, PortNumber inPort, Socket inBoundSock=kBAD_SOCKET, bool inReusePort=false);	//Server specific !
 #else
-	static XBsdTCPSocket* NewServerListeningSock(const VNetAddress& inAddr, Socket inBoundSock=kBAD_SOCKET);	//Server specific !
+	static XBsdTCPSocket* NewServerListeningSock(const VNetAddress& inAddr, Socket inBoundSock=kBAD_SOCKET, bool inReusePort=false);	//Server specific !
 #endif
 	
 	static XBsdTCPSocket* NewServerListeningSock(PortNumber inPorts, Socket inBoundSock=kBAD_SOCKET);	//Server specific !
@@ -73,9 +77,19 @@ class XTOOLBOX_API XBsdTCPSocket : public VObject
 	VError ReadWithTimeout(void* outBuff, uLONG* ioLen, sLONG inMsTimeout, sLONG* outMsSpent=NULL);
 	VError WriteWithTimeout(const void* inBuff, uLONG* ioLen, sLONG inMsTimeout, sLONG* outMsSpent=NULL, bool unusedWithEmptyTail=false);
 
+	//Gather write (sendmsg) : same contract as Write(), *ioLen receives the count of bytes sent from the concatenated buffers.
+	//With SSL, only the first non empty buffer is sent.
+	VError WriteV(const VTCPIOBuffer* inBuffers, sLONG inBufferCount, uLONG* ioLen);
+	VError WriteVWithTimeout(const VTCPIOBuffer* inBuffers, sLONG inBufferCount, uLONG* ioLen, sLONG inMsTimeout, sLONG* outMsSpent=NULL);
+
+	//Sends *ioLen bytes of file inFd from inOffset with sendfile(), without going through user space.
+	//Same contract as Write(). Linux only, and not for SSL sockets : returns VE_UNIMPLEMENTED otherwise.
+	VError SendFile(int inFd, sLONG8 inOffset, uLONG* ioLen);
+	VError SendFileWithTimeout(int inFd, sLONG8 inOffset, uLONG* ioLen, sLONG inMsTimeout, sLONG* outMsSpent=NULL);
+
 	XBOX::VError SetNoDelay (bool inYesNo);
 	
-	VError PromoteToSSL(VKeyCertPair* inKeyCertPair=NULL);
+	VError PromoteToSSL(VKeyCertPair* inKeyCertPair=NULL, const VString* inSessionKey=NULL);
 	bool IsSSL();
 
 	// Used by SSJS socket implementation only (for doing handshake).
@@ -84,6 +98,8 @@ class XTOOLBOX_API XBsdTCPSocket : public VObject
 	
  private :
 	
+	friend class XBsdAcceptIterator;
+	
 	XBsdTCPSocket(Socket inSock) :
 		fSock(inSock), fServicePort(kBAD_PORT), fProfile(NewSock), fSslDelegate(NULL) {}
 	
@@ -100,7 +116,10 @@ class XTOOLBOX_API XBsdTCPSocket : public VObject
 	PortNumber GetSockAddrPort() const;
 
 	VError Connect(const VNetAddress& inAddr, sLONG inMsTimeout);			//Client specific !
-	VError Listen(const VNetAddress& inAddr, bool inAlreadyBound=false);	//Server specific !
+	VError Listen(const VNetAddress& inAddr, bool inAlreadyBound=false, bool inReusePort=false);	//Server specific !
+	
+	//Accepts a pending connection on a non blocking listening socket ; returns NULL without error if there is none.
+	XBsdTCPSocket* DoAccept();
 
 	VError SetServicePort(PortNumber inServicePort);
 	
@@ -131,6 +150,8 @@ class XBsdAcceptIterator : public VObject
 
 public :
 	
+	virtual ~XBsdAcceptIterator();
+	
 	VError AddServiceSocket(XBsdTCPSocket* inSock);
 	VError ClearServiceSockets();
 	VError GetNewConnectedSocket(XBsdTCPSocket** outSock, sLONG inMsTimeout);
@@ -147,6 +168,11 @@ private :
 
 	fd_set fReadSet;
 	
+	//Each wakeup drains up to kACCEPT_BATCH_SIZE connections from a ready service socket ; the ones
+	//not returned yet wait here.
+	enum {kACCEPT_BATCH_SIZE=32};
+	
+	std::deque<XBsdTCPSocket*> fPendingSocks;
 };
 
 
@@ -941,7 +941,7 @@ XBOX::VError XWinTCPSocket::SetNoDelay (bool inYesNo)
 }
 
 
-XBOX::VError XWinTCPSocket::PromoteToSSL(VKeyCertPair* inKeyCertPair)
+XBOX::VError XWinTCPSocket::PromoteToSSL(VKeyCertPair* inKeyCertPair, const VString* inSessionKey)
 {
 	VSslDelegate* delegate=NULL;
 	
@@ -954,7 +954,7 @@ XBOX::VError XWinTCPSocket::PromoteToSSL(VKeyCertPair* inKeyCertPair)
 			
 	case ClientSock :
 			
-			delegate=VSslDelegate::NewClientDelegate(GetRawSocket()/*, inKeyCertPair*/);
+			delegate=VSslDelegate::NewClientDelegate(GetRawSocket()/*, inKeyCertPair*/, inSessionKey);
 			break;
 			
 	default :
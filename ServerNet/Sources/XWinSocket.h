@@ -72,7 +72,7 @@ class XTOOLBOX_API XWinTCPSocket : public VObject
 
 	XBOX::VError SetNoDelay (bool inYesNo);
 	
-	VError PromoteToSSL(VKeyCertPair* inKeyCertPair=NULL);
+	VError PromoteToSSL(VKeyCertPair* inKeyCertPair=NULL, const VString* inSessionKey=NULL);
 	bool IsSSL();
 
 // Used by SSJS socket implementation only (for doing handshake).
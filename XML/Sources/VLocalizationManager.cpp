@@ -23,6 +23,111 @@ BEGIN_TOOLBOX_NAMESPACE
 static const VString kXliffExtension(L"xlf");
 static const VString kStringsExtension(L"strings");
 
+
+/**
+* @brief STR# Code hash and comparison function (same conventions as VString_Hash_Function)
+*/
+struct STRSharpCodes_Hash_Function
+{
+#if COMPIL_VISUAL
+	enum
+	{
+		bucket_size = 4,
+		min_buckets = 8
+	};
+#endif
+
+	size_t operator()(const STRSharpCodes& inCodes) const
+	{
+		return (size_t) ((uLONG) inCodes.fID * 31 + inCodes.fStringID);
+	}
+
+	bool operator()(const STRSharpCodes& inCodes1, const STRSharpCodes& inCodes2) const
+	{
+#if COMPIL_VISUAL
+		return CompareTwoSTRSharpCodes()(inCodes1, inCodes2);
+#else
+		return (inCodes1.fID == inCodes2.fID) && (inCodes1.fStringID == inCodes2.fStringID);
+#endif
+	}
+};
+
+
+/**
+* @brief Immutable copy of the localized strings, used for lookups.
+* A snapshot is never modified once published, so that any number of tasks can read it without lock.
+*/
+class VLocalizationSnapshot : public VObject
+{
+public:
+#if COMPIL_VISUAL
+	typedef STL_EXT_NAMESPACE::hash_map<STRSharpCodes, VString, STRSharpCodes_Hash_Function>												STRSharpCodeMap;
+#else
+	typedef STL_EXT_NAMESPACE::hash_map<STRSharpCodes, VString, STRSharpCodes_Hash_Function, STRSharpCodes_Hash_Function>					STRSharpCodeMap;
+#endif
+	typedef STL_EXT_NAMESPACE::hash_map<VString, VString, STL_EXT_NAMESPACE::STL_HASH_FUNCTOR_NAME<VString> >								StringMap;
+	typedef STL_EXT_NAMESPACE::hash_map<VString, std::vector<VString>, STL_EXT_NAMESPACE::STL_HASH_FUNCTOR_NAME<VString> >					GroupMap;
+
+	STRSharpCodeMap		fStringsRelativeToSTRSharpCodes;
+	StringMap			fStringsRelativeToObjects;
+	GroupMap			fOrderedStringsOfGroups;
+	StringMap			fStringsRelativeToDotStrings;
+};
+
+
+/**
+* @brief Gives access to the published snapshot for the duration of a lookup.
+* The lookup registers in the readers count of the current epoch before reading the snapshot pointer.
+* The snapshot it gets can't be deleted until that count drops to zero, see VLocalizationManager::_PublishSnapshot().
+*/
+class StLocalizationSnapshotReader
+{
+public:
+	StLocalizationSnapshotReader(sLONG *inReaders, sLONG *inReaderEpoch, VLocalizationSnapshot **inSnapshot)
+	{
+		// if the epoch changed before we registered, the publisher may not wait for us: register again in the new one
+		for (;;)
+		{
+			sLONG epoch = VInterlocked::AtomicGet(inReaderEpoch);
+			fReaders = &inReaders[epoch];
+			VInterlocked::Increment(fReaders);
+			if (VInterlocked::AtomicGet(inReaderEpoch) == epoch)
+				break;
+			VInterlocked::Decrement(fReaders);
+		}
+		fSnapshot = *inSnapshot;
+	}
+
+	~StLocalizationSnapshotReader()
+	{
+		VInterlocked::Decrement(fReaders);
+	}
+
+	const VLocalizationSnapshot* operator->() const	{ return fSnapshot; }
+
+private:
+	sLONG*					fReaders;
+	VLocalizationSnapshot*	fSnapshot;
+};
+
+
+/**
+* @brief Brackets a change of the localization containers. The snapshot is published when the outermost change
+* ends, so that lookups never see a file or a folder partly loaded, and a direct call to a public Insert function
+* or to ClearLocalizations() is visible as soon as it returns.
+* Must be declared before the VTaskLock of the function, so that the lock is released before publishing.
+*/
+class StLocalizationChange
+{
+public:
+	StLocalizationChange(VLocalizationManager *inManager) : fManager(inManager)	{ fManager->_BeginChange(); }
+	~StLocalizationChange()														{ fManager->_EndChange(); }
+
+private:
+	VLocalizationManager*	fManager;
+};
+
+
 #pragma mark Public
 
 VLocalizationManager::VLocalizationManager(DialectCode inDialectCode): fCurrentDialectCode(inDialectCode)
@@ -31,6 +136,12 @@ VLocalizationManager::VLocalizationManager(DialectCode inDialectCode): fCurrentD
 	fSAXParser->Init();
 	fSAXHandler = new VLocalizationXMLHandler(this);
 	fLocalizedStringsSet = new StringsSet();
+
+	fSnapshot = new VLocalizationSnapshot;
+	fReaders[0] = fReaders[1] = 0;
+	fReaderEpoch = 0;
+	fSnapshotIsStale = false;
+	fChangeDepth = 0;
 }
 
 VLocalizationManager::~VLocalizationManager()
@@ -42,10 +153,13 @@ VLocalizationManager::~VLocalizationManager()
 		delete fSAXParser;
 	}
 	delete fLocalizedStringsSet;
+
+	delete fSnapshot;
 }
 
 bool VLocalizationManager::ClearLocalizations()
 {
+	StLocalizationChange change(this);
 	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
 
 	delete fLocalizedStringsSet;
@@ -58,6 +172,8 @@ bool VLocalizationManager::ClearLocalizations()
 
 	fGroupBagsByResname.clear();
 	fGroupBagsByRestype.clear();
+
+	fSnapshotIsStale = true;
 	
 	return true;
 }
@@ -127,6 +243,8 @@ bool VLocalizationManager::DoesNeedAnUpdate()
 bool VLocalizationManager::UpdateIfNeeded()
 {
 	if(DoesNeedAnUpdate()){
+		StLocalizationChange change(this);
+
 		//Cleaning...
 		ClearLocalizations();
 
@@ -137,19 +255,20 @@ bool VLocalizationManager::UpdateIfNeeded()
 				if(filesAndFoldersProcessedIterator->IsFolder()){
 					VFolder * folderToReload = new VFolder(*filesAndFoldersProcessedIterator);
 					if(folderToReload && folderToReload->Exists())
-						ScanAndLoadFolder(folderToReload);
+						_ScanAndLoadFolder(folderToReload);
 					ReleaseRefCountable(&folderToReload);
 				}
 				else if(filesAndFoldersProcessedIterator->IsFile()){
 					VFile * fileToReload = new VFile(*filesAndFoldersProcessedIterator);
 					if(fileToReload && fileToReload->Exists())
-						LoadFile(fileToReload);
+						_LoadFile(fileToReload, false);
 					ReleaseRefCountable(&fileToReload);
 				}	
 			}
 			++filesAndFoldersProcessedIterator;
 		}
 
+		//Lookups use the previous strings until the change ends
 		return true;
 	}
 
@@ -158,6 +277,7 @@ bool VLocalizationManager::UpdateIfNeeded()
 
 VError VLocalizationManager::LoadFile(VFile* inFileToAdd, bool inForceLoading)
 {
+	StLocalizationChange change(this);
 	return _LoadFile(inFileToAdd, false, inForceLoading);
 }
 
@@ -212,6 +332,12 @@ VError VLocalizationManager::_LoadFile(VFile* inFileToAdd, bool actuallyLoadingO
 }
 
 VError VLocalizationManager::ScanAndLoadFolder( VFolder* inFolderToScan, bool inForceLoading)
+{
+	StLocalizationChange change(this);
+	return _ScanAndLoadFolder(inFolderToScan, inForceLoading);
+}
+
+VError VLocalizationManager::_ScanAndLoadFolder( VFolder* inFolderToScan, bool inForceLoading)
 {
 	if (!testAssert(inFolderToScan != NULL))
 		return VE_INVALID_PARAMETER;
@@ -249,8 +375,10 @@ bool VLocalizationManager::LoadDefaultLocalizationFolders( VFolder * inFolderTha
 	if (inFolderThatContainsLocalizationFolders == NULL || !inFolderThatContainsLocalizationFolders->Exists())
 		return false;
 
+	StLocalizationChange change(this);
+
 	// also parse xliff files we may find in the resources folder for non optionnally localized strings such as constants.
-	ScanAndLoadFolder( inFolderThatContainsLocalizationFolders, true);
+	_ScanAndLoadFolder( inFolderThatContainsLocalizationFolders, true);
 
 	VectorOfVFolder localizationFolders;
 	if (!VIntlMgr::GetLocalizationFoldersWithDialect(fCurrentDialectCode, inFolderThatContainsLocalizationFolders->GetPath(), localizationFolders))
@@ -259,7 +387,7 @@ bool VLocalizationManager::LoadDefaultLocalizationFolders( VFolder * inFolderTha
 	bool oneFileAtLeastWasLoaded = false;
 	for( VectorOfVFolder::const_iterator i = localizationFolders.begin() ; i != localizationFolders.end() ; ++i)
 	{
-		if (ScanAndLoadFolder(*i) == VE_OK)
+		if (_ScanAndLoadFolder(*i) == VE_OK)
 			oneFileAtLeastWasLoaded = true;
 	}
 
@@ -288,10 +416,10 @@ bool VLocalizationManager::LocalizeStringWithKey(const VString& inKeyToLookUp, V
 {
 	bool result = false;
 	
-	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
-	OOSyntaxStringAndStringMap::iterator urlToStringHashMapIterator = fStringsRelativeToObjects.find(inKeyToLookUp);
-	if(urlToStringHashMapIterator != fStringsRelativeToObjects.end()){
-		outLocalizedString = *(urlToStringHashMapIterator->second);
+	StLocalizationSnapshotReader snapshot(fReaders, &fReaderEpoch, &fSnapshot);
+	VLocalizationSnapshot::StringMap::const_iterator urlToStringHashMapIterator = snapshot->fStringsRelativeToObjects.find(inKeyToLookUp);
+	if(urlToStringHashMapIterator != snapshot->fStringsRelativeToObjects.end()){
+		outLocalizedString = urlToStringHashMapIterator->second;
 		result = true;
 	}
 	
@@ -302,10 +430,10 @@ bool VLocalizationManager::LocalizeStringWithSTRSharpCodes(const STRSharpCodes&
 {
 	bool result = false;
 	
-	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
-	STRSharpCodeAndStringMap::iterator stringsMapsRelativeToSTRSharpCodesIterator = fStringsRelativeToSTRSharpCodes.find(inSTRSharpCodesToLookUp);
-	if(stringsMapsRelativeToSTRSharpCodesIterator != fStringsRelativeToSTRSharpCodes.end()){
-		outLocalizedString = *(stringsMapsRelativeToSTRSharpCodesIterator->second);
+	StLocalizationSnapshotReader snapshot(fReaders, &fReaderEpoch, &fSnapshot);
+	VLocalizationSnapshot::STRSharpCodeMap::const_iterator stringsMapsRelativeToSTRSharpCodesIterator = snapshot->fStringsRelativeToSTRSharpCodes.find(inSTRSharpCodesToLookUp);
+	if(stringsMapsRelativeToSTRSharpCodesIterator != snapshot->fStringsRelativeToSTRSharpCodes.end()){
+		outLocalizedString = stringsMapsRelativeToSTRSharpCodesIterator->second;
 		result = true;
 	}
 
@@ -315,7 +443,7 @@ bool VLocalizationManager::LocalizeStringWithSTRSharpCodes(const STRSharpCodes&
 
 bool VLocalizationManager::LocalizeGroupOfStringsWithAStrSharpID( sLONG inID, std::vector<VString>& outLocalizedStrings)
 {
-	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
+	StLocalizationSnapshotReader snapshot(fReaders, &fReaderEpoch, &fSnapshot);
 
 	outLocalizedStrings.clear();
 	try
@@ -323,10 +451,10 @@ bool VLocalizationManager::LocalizeGroupOfStringsWithAStrSharpID( sLONG inID, st
 		uLONG index = 1;
 		do
 		{
-			STRSharpCodeAndStringMap::iterator i = fStringsRelativeToSTRSharpCodes.find( STRSharpCodes( inID, index));
-			if (i == fStringsRelativeToSTRSharpCodes.end())
+			VLocalizationSnapshot::STRSharpCodeMap::const_iterator i = snapshot->fStringsRelativeToSTRSharpCodes.find( STRSharpCodes( inID, index));
+			if (i == snapshot->fStringsRelativeToSTRSharpCodes.end())
 				break;
-			outLocalizedStrings.push_back( *(i->second));
+			outLocalizedStrings.push_back( i->second);
 			++index;
 		} while( true);
 	}
@@ -346,18 +474,13 @@ bool VLocalizationManager::GetOrderedStringsOfGroup(const VString& groupName, st
 
 	bool result = false;
 	
-	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
-	GroupToIDAndStringsMap::iterator groupsMapIterator = fStringsAndIDsRelativeToGroups.find(groupName);
-	if(groupsMapIterator != fStringsAndIDsRelativeToGroups.end()){
+	StLocalizationSnapshotReader snapshot(fReaders, &fReaderEpoch, &fSnapshot);
+	VLocalizationSnapshot::GroupMap::const_iterator groupsMapIterator = snapshot->fOrderedStringsOfGroups.find(groupName);
+	if(groupsMapIterator != snapshot->fOrderedStringsOfGroups.end()){
 		if(groupsMapIterator->second.size() > 0){
 			
-			// Thanks to the map, which is automatically sorted relatively to the id, outLocalizedStringsVector is sorted  
-			std::map< uLONG, VString * >::iterator stringsIterator = groupsMapIterator->second.begin();
-			while(stringsIterator !=  groupsMapIterator->second.end()){
-				VString newString(*(stringsIterator->second));
-				outLocalizedStringsVector.push_back(newString);
-				++stringsIterator;
-			}
+			// The snapshot strings of a group are already sorted relatively to the id
+			outLocalizedStringsVector = groupsMapIterator->second;
 			
 			result = true;
 		}
@@ -370,10 +493,10 @@ bool VLocalizationManager::LocalizeStringWithDotStringsKey(const VString& inKeyT
 {
 	bool result = false;
 	
-	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
-	DotStringsAndStringsMap::iterator dotStringsKeyToStringHashMapIterator = fStringsRelativeToDotStrings.find(inKeyToLookUp);
-	if(dotStringsKeyToStringHashMapIterator != fStringsRelativeToDotStrings.end()){
-		outLocalizedString = *(dotStringsKeyToStringHashMapIterator->second);
+	StLocalizationSnapshotReader snapshot(fReaders, &fReaderEpoch, &fSnapshot);
+	VLocalizationSnapshot::StringMap::const_iterator dotStringsKeyToStringHashMapIterator = snapshot->fStringsRelativeToDotStrings.find(inKeyToLookUp);
+	if(dotStringsKeyToStringHashMapIterator != snapshot->fStringsRelativeToDotStrings.end()){
+		outLocalizedString = dotStringsKeyToStringHashMapIterator->second;
 		result = true;
 	}
 	
@@ -402,6 +525,7 @@ DialectCode VLocalizationManager::GetLocalizationLanguage()
 
 bool VLocalizationManager::InsertSTRSharpCodeAndString(const STRSharpCodes inSTRSharpCodeToAdd, VString& inLocalizedStringToAdd, bool inShouldOverwriteExistentValue)
 {
+	StLocalizationChange change(this);
 	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
 	
 	//We verify if we can overwrite an existent value
@@ -424,12 +548,14 @@ bool VLocalizationManager::InsertSTRSharpCodeAndString(const STRSharpCodes inSTR
 		{
 			fStringsRelativeToSTRSharpCodes.insert(STRSharpCodeAndStringMap::value_type(inSTRSharpCodeToAdd, *(resultOfInsert.first)));
 		}
+		fSnapshotIsStale = true;
 	}
 	return true;
 }
 
 bool VLocalizationManager::InsertObjectURLAndString(const VString& inObjectURL, const VString& inLocalizedStringToAdd, bool inShouldOverwriteExistentValue)
 {
+	StLocalizationChange change(this);
 	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
 	//We verify if we can overwrite an existent value
 	OOSyntaxStringAndStringMap::iterator objectsMapIterator = fStringsRelativeToObjects.find(inObjectURL);
@@ -446,6 +572,7 @@ bool VLocalizationManager::InsertObjectURLAndString(const VString& inObjectURL,
 		else{
 			fStringsRelativeToObjects.insert(OOSyntaxStringAndStringMap::value_type(inObjectURL, *(resultOfInsert.first)));
 		}
+		fSnapshotIsStale = true;
 	}
 
 	return true;
@@ -453,6 +580,7 @@ bool VLocalizationManager::InsertObjectURLAndString(const VString& inObjectURL,
 
 bool VLocalizationManager::InsertIDAndStringInAGroup(uLONG inID, const VString& inLocalizedString, const VString& inGroup, bool inShouldOverwriteExistentValue)
 {
+	StLocalizationChange change(this);
 	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
 	
 	//Find if the group is already inserted, if not insert it
@@ -473,11 +601,14 @@ bool VLocalizationManager::InsertIDAndStringInAGroup(uLONG inID, const VString&
 	else
 		groupsMapIterator->second[inID] = stringToInsert;
 
+	fSnapshotIsStale = true;
+
 	return true;
 }
 
 bool VLocalizationManager::InsertDotStringsKeyAndString(const VString& inDotStringsKey, const VString& inLocalizedStringToAdd, bool inShouldOverwriteExistentValue)
 {
+	StLocalizationChange change(this);
 	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
 	//We verify if we can overwrite an existent value
 	DotStringsAndStringsMap::iterator dotStringsMapIterator = fStringsRelativeToDotStrings.find(inDotStringsKey);
@@ -494,6 +625,7 @@ bool VLocalizationManager::InsertDotStringsKeyAndString(const VString& inDotStri
 		else{
 			fStringsRelativeToDotStrings.insert(DotStringsAndStringsMap::value_type(inDotStringsKey, *(resultOfInsert.first)));
 		}
+		fSnapshotIsStale = true;
 	}
 
 	return true;
@@ -538,6 +670,72 @@ void VLocalizationManager::RetainGroupBagsByRestype( const VString& inResType, s
 
 #pragma mark Protected
 
+void VLocalizationManager::_BeginChange()
+{
+	VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
+	++fChangeDepth;
+}
+
+void VLocalizationManager::_EndChange()
+{
+	bool isOutermost;
+	{
+		VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
+		isOutermost = (--fChangeDepth == 0);
+	}
+	if (isOutermost)
+		_PublishSnapshot();
+}
+
+void VLocalizationManager::_PublishSnapshot()
+{
+	// one publication at a time, fReadWriteCriticalSection is only held while the snapshot is built and swapped
+	VTaskLock fPublishLocker(&fPublishCriticalSection);
+
+	VLocalizationSnapshot *oldSnapshot = NULL;
+	sLONG oldEpoch = 0;
+	{
+		VTaskLock fReadWriteLocker(&fReadWriteCriticalSection);
+
+		// another change may have begun since ours ended, it will publish when complete
+		if (!fSnapshotIsStale || fChangeDepth > 0)
+			return;
+
+		VLocalizationSnapshot *snapshot = new VLocalizationSnapshot;
+
+		for (STRSharpCodeAndStringMap::const_iterator i = fStringsRelativeToSTRSharpCodes.begin() ; i != fStringsRelativeToSTRSharpCodes.end() ; ++i)
+			snapshot->fStringsRelativeToSTRSharpCodes.insert(VLocalizationSnapshot::STRSharpCodeMap::value_type(i->first, *(i->second)));
+
+		for (OOSyntaxStringAndStringMap::const_iterator i = fStringsRelativeToObjects.begin() ; i != fStringsRelativeToObjects.end() ; ++i)
+			snapshot->fStringsRelativeToObjects.insert(VLocalizationSnapshot::StringMap::value_type(i->first, *(i->second)));
+
+		for (GroupToIDAndStringsMap::const_iterator i = fStringsAndIDsRelativeToGroups.begin() ; i != fStringsAndIDsRelativeToGroups.end() ; ++i)
+		{
+			std::vector<VString>& strings = snapshot->fOrderedStringsOfGroups[i->first];
+			strings.reserve(i->second.size());
+			for (std::map< uLONG, VString* >::const_iterator j = i->second.begin() ; j != i->second.end() ; ++j)
+				strings.push_back(*(j->second));
+		}
+
+		for (DotStringsAndStringsMap::const_iterator i = fStringsRelativeToDotStrings.begin() ; i != fStringsRelativeToDotStrings.end() ; ++i)
+			snapshot->fStringsRelativeToDotStrings.insert(VLocalizationSnapshot::StringMap::value_type(i->first, *(i->second)));
+
+		oldSnapshot = VInterlocked::ExchangePtr(&fSnapshot, snapshot);
+		fSnapshotIsStale = false;
+
+		// Lookups registering from now on land in the other epoch and read the new snapshot.
+		oldEpoch = VInterlocked::AtomicGet(&fReaderEpoch);
+		VInterlocked::Exchange(&fReaderEpoch, 1 - oldEpoch);
+	}
+
+	// Only lookups registered in the old epoch may still use the old snapshot. New lookups never join
+	// that count, so it drops to zero as soon as these few complete, whatever the traffic.
+	while (VInterlocked::AtomicGet(&fReaders[oldEpoch]) != 0)
+		VTask::Yield();
+
+	delete oldSnapshot;
+}
+
 VError VLocalizationManager::AnalyzeXLIFFFile(VFile* inFileToAnalyze, bool inForceLoading)
 {
 	fSAXHandler->SetAvoidLanguageChecking(inForceLoading);
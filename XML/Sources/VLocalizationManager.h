@@ -74,6 +74,8 @@ BEGIN_TOOLBOX_NAMESPACE
 
 class VXMLParser;
 class VLocalizationXMLHandler;
+class VLocalizationSnapshot;
+class StLocalizationChange;
 
 #define OO_SYNTAX_INTERNAL_DIVIDER L"#}[{@"
 
@@ -82,6 +84,8 @@ class VLocalizationXMLHandler;
 * It manages the localization from the default language : 
 * - Analysis of the localization files
 * - Lookups 
+* Lookups don't take any lock: they are done in an immutable hash-indexed snapshot of the localizations, 
+* which is rebuilt and published atomically at the end of each load, update, or direct call to an Insert function.
 */
 class XTOOLBOX_API VLocalizationManager : public VObject, public IRefCountable, public ILocalizer
 {
@@ -128,7 +132,7 @@ public:
 	
 	/**
 	* @brief Returns the localized string corresponding to a STR# code.
-	* If the STR# code (ID + String ID) has been found in a parsed file, the corresponding localized string is returned. Complexity : O(log(n)).
+	* If the STR# code (ID + String ID) has been found in a parsed file, the corresponding localized string is returned. Complexity : O(1).
 	* @param inKeyToLookUp The STR# Code to lookup
 	* @param outLocalizedString The localized string if the manager found it
 	* @return the result of the lookup. (false == no translation done)
@@ -138,7 +142,7 @@ public:
 	
 	/**
 	* @brief Returns the localized string corresponding to an object oriented syntax.
-	* If the string corresponding to an object oriented syntax has been found in a parsed file, the corresponding localized string is returned. Complexity : O(log(n)).
+	* If the string corresponding to an object oriented syntax has been found in a parsed file, the corresponding localized string is returned. Complexity : O(1).
 	* @param inKeyToLookUp The string with an OO syntax to lookup
 	* @param outLocalizedString The localized string if the manager found it
 	* @return the result of the lookup. (false == no translation done)
@@ -163,7 +167,7 @@ public:
 
 	/**
 	* @brief Returns the localized string corresponding to .strings key.
-	* If the string corresponding to .strings key has been found in a parsed .strings file, the corresponding localized string is returned. Complexity : O(log(n)).
+	* If the string corresponding to .strings key has been found in a parsed .strings file, the corresponding localized string is returned. Complexity : O(1).
 	* @param inKeyToLookUp The .strings key
 	* @param outLocalizedString The localized string if the manager found it
 	* @return the result of the lookup. (false == no translation done)
@@ -191,6 +195,8 @@ public:
 	
 	/**
 	* @brief Insert a string relative to a STR# code
+	* Called outside a load, the string is published before returning, which rebuilds the whole lookup snapshot:
+	* prefer loading files to inserting many strings one by one (same for the other Insert functions).
 	* @param inSTRSharpCodeToAdd The STR# code
 	* @param inLocalizedStringToAdd The localized string taht corresponds to the STR# code
 	* @param inShouldOverwriteExistentValue Specifies if an existent STR# Code should be overwritten
@@ -279,6 +285,23 @@ protected:
 	* - VE_STREAM_BAD_NAME if the file extension is not supported 
 	*/
 	VError			_LoadFile(VFile* inFileToAdd, bool actuallyLoadingOfAFolder, bool inForceLoading = false);
+
+	/**
+	* @brief Same as ScanAndLoadFolder() without publishing the loaded strings.
+	*/
+	VError			_ScanAndLoadFolder(VFolder* inFolderToScan, bool inForceLoading = false);
+
+	/**
+	* @brief Rebuild the lookup snapshot from the localization containers if they have changed and no change is
+	* in progress, and publish it. Waits for the lookups that may use the previous snapshot before deleting it.
+	*/
+	void			_PublishSnapshot();
+
+	/**
+	* @brief Change nesting, see StLocalizationChange. The snapshot is published when the outermost change ends.
+	*/
+	void			_BeginChange();
+	void			_EndChange();
 	
 	/**
 	* @brief Returns true if the receiver needs to be displayed; returns false otherwise..
@@ -291,6 +314,8 @@ protected:
 	bool			ClearLocalizations();
 		
 private:
+	friend class StLocalizationChange;
+
 	virtual									~VLocalizationManager();
 
 											VLocalizationManager( const VLocalizationManager&);	// no
@@ -298,6 +323,13 @@ private:
 	
 	VCriticalSection						fReadWriteCriticalSection;			/**< Critical section, thread-safe behaviour of the class (i/o protection) */
 
+	VLocalizationSnapshot*					fSnapshot;						/**< Published snapshot used by lookups, never NULL */
+	VCriticalSection						fPublishCriticalSection;		/**< Serializes the snapshot publications */
+	sLONG									fReaders[2];					/**< Number of lookups in progress, per epoch */
+	sLONG									fReaderEpoch;					/**< Epoch new lookups register in, flipped by each publication */
+	sLONG									fChangeDepth;					/**< Nesting of the changes in progress, see StLocalizationChange */
+	bool									fSnapshotIsStale;				/**< The containers have changed since the snapshot was built */
+
 	StringsSet*								fLocalizedStringsSet;			/**< Effective container of the localized strings */
 	DialectCode								fCurrentDialectCode; 			/**< Unique language used when parsing localization files */
 	STRSharpCodeAndStringMap				fStringsRelativeToSTRSharpCodes;/**< STR# Code -> localized string */
@@ -73,9 +73,46 @@ bool VXMLParser::Parse( VFile *inFile, IXMLHandler *inHandler, XMLParsingOptions
 	inFile->GetPath(full_path);
 	#endif
 	
-	xercesc::LocalFileInputSource source(full_path.GetCPointer());
+	// with XML_MapFile, large files are parsed directly from their mapping in memory, the path is kept as system id for error reporting.
+	// a file truncated by someone else while mapped raises SIGBUS, hence the opt-in.
+	VMappedFileStream stream( inFile);
+	const void *data = NULL;
+	sLONG8 size = 0;
+	if ( (inOptions & XML_MapFile) && inFile->Exists())
+		inFile->GetSize( &size);
+	if ( (size >= VMappedFileStream::kMinMappedSize) && (size <= MaxLongInt) )
+	{
+		// a failed mapping falls back to the plain file, its error must not be reported
+		StErrorContextInstaller errors( false);
+		if (stream.OpenReading() == VE_OK)
+		{
+			size = stream.GetSize();
+			data = stream.GetDataPointer( 0, (VSize) size);
+		}
+		else
+		{
+			stream.ResetLastError();
+		}
+	}
 
-	return SAXParse( this, source, inHandler, inOptions);
+	bool ok;
+	if (data != NULL)
+	{
+		xercesc::MemBufInputSource source( (const XMLByte *) data, (unsigned int) size, full_path.GetCPointer());
+
+		ok = SAXParse( this, source, inHandler, inOptions);
+	}
+	else
+	{
+		xercesc::LocalFileInputSource source(full_path.GetCPointer());
+
+		ok = SAXParse( this, source, inHandler, inOptions);
+	}
+
+	if (stream.IsReading())
+		stream.CloseReading();
+
+	return ok;
 }
 
 
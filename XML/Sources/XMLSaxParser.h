@@ -29,6 +29,7 @@ enum {
 	XML_ValidateNever		= 2,	// Ignore the DTD
 	XML_DoNameSpaces		= 4,	// Enforce namespaces validation rules
 	XML_LoadExternalDTD		= 8,	// Allow loading of external DTD
+	XML_MapFile				= 16,	// Parse large files from a memory mapping (the file must not be truncated while parsing)
 	XML_Default				= 0		// validate if there's a dtd mentionned. No external DTD loading, no namespace
 };
 